@@ -0,0 +1,304 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  brick.h
+//    Sparse brick map of the part of map() that does not move with Time.x
+//    (SdfStatic, see SdfSplit) around the camera. The region is N^3 cells
+//    of 7 voxels : every cell keeps the distance at its centre (the coarse
+//    grid) and the cells the surface can cross keep an 8^3 brick sampled
+//    on their voxel corners, faces repeated in the neighbour. Cells are
+//    addressed modulo N, so when the region follows the camera only the
+//    cells that enter it are baked again, 8 points per SdfStatic8 on the
+//    jobs, whatever the time.
+//    Sample interpolates a brick trilinearly, bounds an empty cell by its
+//    centre distance minus the distance to the centre, and leaves points
+//    outside the region to map(). Bound takes margin, the largest error
+//    of the interpolation seen on the bakes, off it and the min with
+//    SdfMoving, the rotating part as is : a lower bound of map() to step
+//    with. Under exact it is map()'s turn, so hits stay map()'s own.
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _BRICK_H_
+#define _BRICK_H_
+
+#include <limits.h>
+#include <math.h>
+#include <vector>
+#include "../../common/simd.h"
+#include "../../common/jobs.h"
+#include "map_sdf.h"
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// BrickMap
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+TARGET_AVX2 inline void BrickEval8(const float *x, const float *y, const float *z, float *out) {
+  _mm256_storeu_ps(out, SdfStatic8(_mm256_loadu_ps(x), _mm256_loadu_ps(y), _mm256_loadu_ps(z), 0));
+}
+
+struct BrickMap {
+  enum { Side = 8, Voxels = Side * Side * Side, N = 64, Cells = N * N * N, Probes = 8 };
+
+  float              voxel, cell;
+  float              near;       //|centre distance| under which a cell gets a brick
+  float              margin;     //under the bricks, SdfStatic is at most that much lower
+  float              exact;      //Bound under it : map() instead
+  bool               baked;
+  int                origin[3];  //first cell of the region
+  std::vector<float> coarse;     //Cells, distance at the centre
+  std::vector<int>   index;      //Cells, brick or -1
+  std::vector<int>   key;        //Cells * 3, cell held by the slot
+  std::vector<float> brick;      //Voxels per brick
+  std::vector<int>   freed;
+  int                count;      //bricks in use
+  int                rebaked;    //cells baked by the last Update
+
+  //voxel : sample spacing, the region is N * 7 * voxel wide
+  void Init(float v = 0.25f) {
+    voxel = v;
+    cell  = v * (Side - 1);
+    //centre to corner is 0.87 cell, map() is not exactly 1-Lipschitz (noise)
+    near  = cell * 1.5f;
+    margin = 0;
+    exact  = Exact();
+    baked = false;
+    count = rebaked = 0;
+    origin[0] = origin[1] = origin[2] = 0;
+    coarse.assign(Cells, 0);
+    index.assign(Cells, -1);
+    key.assign(Cells * 3, INT_MIN);
+    brick.clear();
+    freed.clear();
+  }
+
+  static int Slot(int x, int y, int z) {
+    return (x & (N - 1)) | ((y & (N - 1)) << 6) | ((z & (N - 1)) << 12);
+  }
+
+  size_t Bytes() const {
+    return (coarse.size() + index.size() + key.size() + brick.size()) * 4;
+  }
+
+  //the hit distances of march.h (0.03, shadows 0.1) must stay under exact,
+  //where Bound is below map() by up to margin + SdfMovingSlack
+  float Exact() const {
+    return fmaxf(0.1f, margin + SdfMovingSlack);
+  }
+
+  //points of a brick, 8 x per call
+  static void Eval(int isa, const float *x, const float *y, const float *z, float *out) {
+    if(isa == IsaAVX2) {
+      BrickEval8(x, y, z, out);
+      return;
+    }
+    for(int k = 0; k < 8; k++) out[k] = SdfStatic(x[k], y[k], z[k], 0);
+  }
+
+  //region centred on pos, bakes the cells that are not there yet.
+  //Nothing if all of map() moves with Time.x
+  void Update(JobSystem *jobs, int isa, const float pos[3]) {
+    if(SdfStaticSize == 0) return;
+    if(!baked) {
+      key.assign(Cells * 3, INT_MIN);
+      baked = true;
+    }
+    for(int e = 0; e < 3; e++) origin[e] = (int)floorf(pos[e] / cell) - N / 2;
+
+    std::vector<int> stale;
+    for(int s = 0; s < Cells; s++) {
+      int c[3] = { s & (N - 1), (s >> 6) & (N - 1), s >> 12 };
+      for(int e = 0; e < 3; e++) c[e] = origin[e] + ((c[e] - origin[e]) & (N - 1));
+      int *k = &key[s * 3];
+      if(k[0] == c[0] && k[1] == c[1] && k[2] == c[2]) continue;
+      k[0] = c[0];
+      k[1] = c[1];
+      k[2] = c[2];
+      stale.push_back(s);
+    }
+    rebaked = (int)stale.size();
+    if(stale.empty()) return;
+    auto run = [&](int n, int chunk, const std::function<void(int, int, int)> &func) {
+      if(jobs) jobs->ParallelFor(n, chunk, func);
+      else     func(0, n, 0);
+    };
+
+    //coarse grid, 8 cells per call
+    stale.resize((stale.size() + 7) & ~7, stale.back());
+    run((int)stale.size() / 8, 64, [&](int b, int e, int) {
+      for(int i = b; i < e; i++) {
+        float x[8], y[8], z[8], d[8];
+        for(int k = 0; k < 8; k++) {
+          const int *c = &key[stale[i * 8 + k] * 3];
+          x[k] = (c[0] + 0.5f) * cell;
+          y[k] = (c[1] + 0.5f) * cell;
+          z[k] = (c[2] + 0.5f) * cell;
+        }
+        Eval(isa, x, y, z, d);
+        for(int k = 0; k < 8; k++) coarse[stale[i * 8 + k]] = d[k];
+      }
+    });
+    stale.resize(rebaked);
+
+    //bricks where the surface may pass, storage reused from the cells that left
+    std::vector<int> fill;
+    for(size_t i = 0; i < stale.size(); i++) {
+      int s = stale[i];
+      if(index[s] >= 0) {
+        freed.push_back(index[s]);
+        index[s] = -1;
+        count--;
+      }
+      if(fabsf(coarse[s]) >= near) continue;
+      if(freed.empty()) {
+        freed.push_back((int)(brick.size() / Voxels));
+        brick.resize(brick.size() + Voxels);
+      }
+      index[s] = freed.back();
+      freed.pop_back();
+      count++;
+      fill.push_back(s);
+    }
+    run((int)fill.size(), 16, [&](int b, int e, int) {
+      for(int i = b; i < e; i++) {
+        const int *c   = &key[fill[i] * 3];
+        float     *out = &brick[(size_t)index[fill[i]] * Voxels];
+        float      x[8], y[8], z[8];
+        for(int k = 0; k < Side; k++) x[k] = c[0] * cell + k * voxel;
+        for(int r = 0; r < Side * Side; r++) {
+          float py = c[1] * cell + (r & (Side - 1)) * voxel, pz = c[2] * cell + (r / Side) * voxel;
+          for(int k = 0; k < Side; k++) {
+            y[k] = py;
+            z[k] = pz;
+          }
+          Eval(isa, x, y, z, out + r * Side);
+        }
+      }
+    });
+
+    //margin : Probes points inside each new brick against SdfStatic
+    unsigned seed = (unsigned)fill.size() * 2654435761u + (unsigned)count;
+    for(size_t i = 0; i < fill.size(); i++) {
+      const int *c = &key[fill[i] * 3];
+      float x[Probes], y[Probes], z[Probes], d[Probes];
+      for(int k = 0; k < Probes; k++) {
+        float *p[3] = { &x[k], &y[k], &z[k] };
+        for(int e = 0; e < 3; e++) {
+          seed  = seed * 1664525u + 1013904223u;
+          *p[e] = (c[e] + (seed >> 8) * (1.0f / 16777216.0f)) * cell;
+        }
+      }
+      Eval(isa, x, y, z, d);
+      for(int k = 0; k < Probes; k++) {
+        float b;
+        Sample(x[k], y[k], z[k], &b);
+        margin = fmaxf(margin, b - d[k]);
+      }
+    }
+    exact = Exact();
+  }
+
+  //false outside the region
+  bool Sample(float x, float y, float z, float *d) const {
+    float p[3] = { x, y, z }, u[3];
+    int   c[3], i[3];
+    for(int e = 0; e < 3; e++) {
+      c[e] = (int)floorf(p[e] / cell);
+      if((unsigned)(c[e] - origin[e]) >= (unsigned)N) return false;
+    }
+    int s = Slot(c[0], c[1], c[2]);
+    if(index[s] < 0) {
+      float dx = x - (c[0] + 0.5f) * cell, dy = y - (c[1] + 0.5f) * cell, dz = z - (c[2] + 0.5f) * cell;
+      *d = coarse[s] - sqrtf(dx * dx + dy * dy + dz * dz);
+      return true;
+    }
+    for(int e = 0; e < 3; e++) {
+      u[e] = fminf(fmaxf(p[e] / voxel - c[e] * (Side - 1), 0), Side - 1);
+      i[e] = u[e] < Side - 2 ? (int)u[e] : Side - 2;
+      u[e] -= i[e];
+    }
+    const float *v = &brick[(size_t)index[s] * Voxels + i[0] + i[1] * Side + i[2] * Side * Side];
+    float a = v[0] + (v[1] - v[0]) * u[0];
+    float b = v[Side] + (v[Side + 1] - v[Side]) * u[0];
+    float g = v[Side * Side] + (v[Side * Side + 1] - v[Side * Side]) * u[0];
+    float h = v[Side * Side + Side] + (v[Side * Side + Side + 1] - v[Side * Side + Side]) * u[0];
+    a += (b - a) * u[1];
+    g += (h - g) * u[1];
+    *d = a + (g - a) * u[2];
+    return true;
+  }
+
+  //lower bound of map() at time t, false outside the region
+  bool Bound(float x, float y, float z, float t, float *d) const {
+    if(!Sample(x, y, z, d)) return false;
+    *d = fminf(*d - margin, SdfMoving(x, y, z, t));
+    return true;
+  }
+
+  //lanes of active inside the region are set in *inside, the others are 0
+  TARGET_AVX2 __m256 Sample8(__m256 x, __m256 y, __m256 z, __m256 active, __m256 *inside) const {
+    __m256  ic = _mm256_set1_ps(1.0f / cell);
+    __m256  fx = _mm256_floor_ps(_mm256_mul_ps(x, ic));
+    __m256  fy = _mm256_floor_ps(_mm256_mul_ps(y, ic));
+    __m256  fz = _mm256_floor_ps(_mm256_mul_ps(z, ic));
+    __m256i cx = _mm256_cvtps_epi32(fx), cy = _mm256_cvtps_epi32(fy), cz = _mm256_cvtps_epi32(fz);
+    __m256i rx = _mm256_sub_epi32(cx, _mm256_set1_epi32(origin[0]));
+    __m256i ry = _mm256_sub_epi32(cy, _mm256_set1_epi32(origin[1]));
+    __m256i rz = _mm256_sub_epi32(cz, _mm256_set1_epi32(origin[2]));
+    __m256i out = _mm256_and_si256(_mm256_or_si256(rx, _mm256_or_si256(ry, rz)), _mm256_set1_epi32(~(N - 1)));
+    __m256  in  = _mm256_and_ps(active, _mm256_castsi256_ps(_mm256_cmpeq_epi32(out, _mm256_setzero_si256())));
+    *inside = in;
+    if(!_mm256_movemask_ps(in)) return _mm256_setzero_ps();
+
+    __m256i m    = _mm256_set1_epi32(N - 1);
+    __m256i slot = _mm256_or_si256(_mm256_and_si256(cx, m),
+                   _mm256_or_si256(_mm256_slli_epi32(_mm256_and_si256(cy, m), 6), _mm256_slli_epi32(_mm256_and_si256(cz, m), 12)));
+    __m256i idx  = _mm256_mask_i32gather_epi32(_mm256_set1_epi32(-1), &index[0], slot, _mm256_castps_si256(in), 4);
+    __m256  dc   = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), &coarse[0], slot, in, 4);
+
+    //empty cell : centre distance less the way to the centre
+    __m256 h  = _mm256_set1_ps(0.5f), c = _mm256_set1_ps(cell);
+    __m256 ox = _mm256_sub_ps(x, _mm256_mul_ps(_mm256_add_ps(fx, h), c));
+    __m256 oy = _mm256_sub_ps(y, _mm256_mul_ps(_mm256_add_ps(fy, h), c));
+    __m256 oz = _mm256_sub_ps(z, _mm256_mul_ps(_mm256_add_ps(fz, h), c));
+    __m256 r  = _mm256_sub_ps(dc, _mm256_sqrt_ps(_mm256_fmadd_ps(ox, ox, _mm256_fmadd_ps(oy, oy, _mm256_mul_ps(oz, oz)))));
+
+    __m256 has = _mm256_and_ps(in, _mm256_castsi256_ps(_mm256_cmpgt_epi32(idx, _mm256_set1_epi32(-1))));
+    if(!_mm256_movemask_ps(has)) return r;
+
+    //brick : trilinear between the 8 voxel corners around the point
+    __m256 iv = _mm256_set1_ps(1.0f / voxel), sd = _mm256_set1_ps(float(Side - 1));
+    __m256 lo = _mm256_setzero_ps(), hi = _mm256_set1_ps(float(Side - 2));
+    __m256 ux = _mm256_min_ps(_mm256_max_ps(_mm256_fnmadd_ps(fx, sd, _mm256_mul_ps(x, iv)), lo), sd);
+    __m256 uy = _mm256_min_ps(_mm256_max_ps(_mm256_fnmadd_ps(fy, sd, _mm256_mul_ps(y, iv)), lo), sd);
+    __m256 uz = _mm256_min_ps(_mm256_max_ps(_mm256_fnmadd_ps(fz, sd, _mm256_mul_ps(z, iv)), lo), sd);
+    __m256 ix = _mm256_min_ps(_mm256_floor_ps(ux), hi), iy = _mm256_min_ps(_mm256_floor_ps(uy), hi), iz = _mm256_min_ps(_mm256_floor_ps(uz), hi);
+    ux = _mm256_sub_ps(ux, ix);
+    uy = _mm256_sub_ps(uy, iy);
+    uz = _mm256_sub_ps(uz, iz);
+    __m256i base = _mm256_add_epi32(_mm256_slli_epi32(idx, 9), _mm256_cvtps_epi32(
+      _mm256_fmadd_ps(iz, _mm256_set1_ps(Side * Side), _mm256_fmadd_ps(iy, _mm256_set1_ps(Side), ix))));
+    base = _mm256_and_si256(base, _mm256_castps_si256(has));
+
+    const float *b = &brick[0];
+    __m256 v[8];
+    for(int k = 0; k < 8; k++) {
+      int o = (k & 1) + ((k >> 1) & 1) * Side + (k >> 2) * Side * Side;
+      v[k] = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), b, _mm256_add_epi32(base, _mm256_set1_epi32(o)), has, 4);
+    }
+    for(int k = 0; k < 8; k += 2) v[k >> 1] = _mm256_fmadd_ps(_mm256_sub_ps(v[k + 1], v[k]), ux, v[k]);
+    v[0] = _mm256_fmadd_ps(_mm256_sub_ps(v[1], v[0]), uy, v[0]);
+    v[2] = _mm256_fmadd_ps(_mm256_sub_ps(v[3], v[2]), uy, v[2]);
+    v[0] = _mm256_fmadd_ps(_mm256_sub_ps(v[2], v[0]), uz, v[0]);
+    return _mm256_blendv_ps(r, v[0], has);
+  }
+
+  TARGET_AVX2 __m256 Bound8(__m256 x, __m256 y, __m256 z, float t, __m256 active, __m256 *inside) const {
+    __m256 d = Sample8(x, y, z, active, inside);
+    if(!_mm256_movemask_ps(*inside)) return d;
+    return _mm256_min_ps(_mm256_sub_ps(d, _mm256_set1_ps(margin)), SdfMoving8(x, y, z, t));
+  }
+};
+
+#endif //_BRICK_H_
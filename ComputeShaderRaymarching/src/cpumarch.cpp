@@ -0,0 +1,1026 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  cpumarch.cpp
+//    Headless reference of main.fx on the CPU (march.h).
+//    cpumarch [time] [out] [threads] : writes out.ppm through the ps_main
+//    post, out.exr with the raw UAV (RGB + depth in A), and prints rays/s
+//    for scalar, AVX2 and AVX2 on all threads plus the per tile steps, map()
+//    pruned per tile and depth (prune.h) against the compiled one, the
+//    brick map bake, speed and error (brick.h), the cone prepass flat and
+//    split and the packets, the inter() strategies against a long
+//    reference, the normals of mapgrad() against 4 map() calls and a double
+//    precision reference, frames started from the last one's depth against
+//    full ones, checkerboard and 2 x 2 frames rebuilt from their marched
+//    pixels and the last frame against full ones, the resolution governor
+//    (governor.h) on synthetic frame times and on frames rendered at its
+//    scale, the upscale (upscale.h) against full frames, the post (post.h)
+//    fused against its stages one after the other, then the scaling of the
+//    tile scheduler (tilesched.h) from 1 to threads.
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include "march.h"
+#include "governor.h"
+#include "upscale.h"
+#include "post.h"
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// ps_main
+//-----------//-----------//-----------//-----------//-----------//-----------
+//buf rendered at scale, upscaled (upscale.h) or at full size
+//its 5 taps, then the rest of ps_main scalar with powf (post.h)
+static void Present(const std::vector<MarchColor> &buf, std::vector<unsigned char> &rgb, float scale = 1) {
+  std::vector<MarchColor> up(buf.size());
+  std::vector<unsigned>   rgba(buf.size());
+  if(scale == 1) UpscaleNative(&buf[0], &up[0]);
+  else           Upscale(NULL, DetectIsa(), scale, &buf[0], &up[0]);
+  Post(NULL, IsaScalar, PostOptions(), &up[0], &rgba[0]);
+  rgb.resize((size_t)ScreenX * ScreenY * 3);
+  for(size_t i = 0; i < rgba.size(); i++) {
+    for(int c = 0; c < 3; c++) rgb[i * 3 + c] = (unsigned char)(rgba[i] >> (c * 8));
+  }
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// file
+//-----------//-----------//-----------//-----------//-----------//-----------
+static bool WritePPM(const char *name, const std::vector<unsigned char> &rgb) {
+  FILE *fp = fopen(name, "wb");
+  if(!fp) return false;
+  fprintf(fp, "P6\n%d %d\n255\n", ScreenX, ScreenY);
+  fwrite(&rgb[0], 1, rgb.size(), fp);
+  fclose(fp);
+  return true;
+}
+
+//scanline, uncompressed, FLOAT channels A B G R (sorted by name as the format wants)
+static void ExrAttr(std::string &h, const char *name, const char *type, const void *v, int size) {
+  h.append(name, strlen(name) + 1);
+  h.append(type, strlen(type) + 1);
+  h.append((const char *)&size, 4);
+  h.append((const char *)v, size);
+}
+
+static bool WriteEXR(const char *name, const std::vector<MarchColor> &buf) {
+  std::string h;
+  const unsigned char magic[8] = { 0x76, 0x2f, 0x31, 0x01, 2, 0, 0, 0 };
+  h.append((const char *)magic, 8);
+
+  std::string ch;
+  const char *chname[4] = { "A", "B", "G", "R" };
+  for(int c = 0; c < 4; c++) {
+    int desc[4] = { 2, 0, 1, 1 };    //FLOAT, pLinear + reserved, xSampling, ySampling
+    ch.append(chname[c], 2);
+    ch.append((const char *)desc, 16);
+  }
+  ch.push_back(0);
+  int box[4] = { 0, 0, ScreenX - 1, ScreenY - 1 };
+  float one = 1, center[2] = { 0, 0 };
+  unsigned char zero = 0;
+  ExrAttr(h, "channels", "chlist", ch.data(), (int)ch.size());
+  ExrAttr(h, "compression", "compression", &zero, 1);
+  ExrAttr(h, "dataWindow", "box2i", box, 16);
+  ExrAttr(h, "displayWindow", "box2i", box, 16);
+  ExrAttr(h, "lineOrder", "lineOrder", &zero, 1);
+  ExrAttr(h, "pixelAspectRatio", "float", &one, 4);
+  ExrAttr(h, "screenWindowCenter", "v2f", center, 8);
+  ExrAttr(h, "screenWindowWidth", "float", &one, 4);
+  h.push_back(0);
+
+  FILE *fp = fopen(name, "wb");
+  if(!fp) return false;
+  fwrite(h.data(), 1, h.size(), fp);
+  int line = 8 + ScreenX * 4 * 4;
+  for(int y = 0; y < ScreenY; y++) {
+    unsigned long long offset = h.size() + (size_t)ScreenY * 8 + (size_t)y * line;
+    fwrite(&offset, 8, 1, fp);
+  }
+  std::vector<float> row((size_t)ScreenX * 4);
+  for(int y = 0; y < ScreenY; y++) {
+    for(int x = 0; x < ScreenX; x++) {
+      const MarchColor &c = buf[x + (size_t)y * ScreenX];
+      row[x]               = c.a;
+      row[x + ScreenX]     = c.b;
+      row[x + ScreenX * 2] = c.g;
+      row[x + ScreenX * 3] = c.r;
+    }
+    int size = ScreenX * 4 * 4;
+    fwrite(&y, 4, 1, fp);
+    fwrite(&size, 4, 1, fp);
+    fwrite(&row[0], 4, row.size(), fp);
+  }
+  fclose(fp);
+  return true;
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// run
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct RunResult {
+  double   ms;
+  unsigned steps;
+  unsigned rays;
+};
+
+static RunResult Run(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &buf, std::vector<MarchTileStat> &stat) {
+  auto start = std::chrono::high_resolution_clock::now();
+  MarchRender(jobs, isa, time, &buf[0], &stat[0]);
+  RunResult r;
+  r.ms    = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  r.steps = 0;
+  r.rays  = 0;
+  for(size_t t = 0; t < stat.size(); t++) {
+    r.steps += stat[t].steps;
+    r.rays  += stat[t].rays;
+  }
+  return r;
+}
+
+static void Report(const char *name, const RunResult &r) {
+  double pixels = (double)MarchTilesX * GroupX * MarchTilesY * GroupY;
+  printf("%-12s %9.1f ms %8.2f Mrays/s (primary) %8.2f Mrays/s (all) %8.2f Msteps/s\n", name, r.ms,
+    pixels / r.ms * 1e-3, r.rays / r.ms * 1e-3, r.steps / r.ms * 1e-3);
+}
+
+//per tile steps : min / avg / max and a coarse map, one char per tile
+static void TileMap(const std::vector<MarchTileStat> &stat) {
+  unsigned lo = ~0u, hi = 0;
+  double   sum = 0;
+  for(size_t t = 0; t < stat.size(); t++) {
+    lo   = stat[t].steps < lo ? stat[t].steps : lo;
+    hi   = stat[t].steps > hi ? stat[t].steps : hi;
+    sum += stat[t].steps;
+  }
+  printf("tile steps   min %u avg %.0f max %u (%d x %d tiles of %d x %d)\n", lo, sum / stat.size(), hi,
+    MarchTilesX, MarchTilesY, GroupX, GroupY);
+  const char ramp[] = " .:-=+*#%@";
+  for(int ty = 0; ty < MarchTilesY; ty++) {
+    printf("  ");
+    for(int tx = 0; tx < MarchTilesX; tx++) {
+      unsigned s = stat[tx + ty * MarchTilesX].steps;
+      int      k = hi > lo ? int((s - lo) * 9.0 / (hi - lo) + 0.5) : 0;
+      putchar(ramp[k]);
+    }
+    putchar('\n');
+  }
+}
+
+//scalar vs AVX2 : sin/fmod differ in the last bits and a ray near a
+//threshold may take one more step, so count the pixels that agree
+static void Compare(const std::vector<MarchColor> &a, const std::vector<MarchColor> &b) {
+  int    total = MarchTilesX * GroupX * MarchTilesY * GroupY, same = 0;
+  double err = 0;
+  for(int y = 0; y < MarchTilesY * GroupY; y++) {
+    for(int x = 0; x < MarchTilesX * GroupX; x++) {
+      const MarchColor &p = a[x + y * ScreenX], &q = b[x + y * ScreenX];
+      float e = fabsf(p.a - q.a) / (1 + fabsf(p.a));
+      same += e < 1e-3f;
+      err  += e;
+    }
+  }
+  printf("scalar/AVX2  %.3f%% of pixels within 1e-3 depth, mean rel error %.2e\n", 100.0 * same / total, err / total);
+}
+
+//the frame with map() as compiled and pruned per tile and depth range
+//(MarchOptions::prune), best of 3 : map() calls and instructions per
+//pixel of the primary rays, gate sides off per tile, depths that match
+static void Pruning(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &ref, std::vector<MarchTileStat> &stat) {
+  if(isa != IsaAVX2 || !MarchGates::Get().ok) {
+    printf("pruning : needs AVX2 and map_sdf.h from map.sdf\n");
+    return;
+  }
+  double pixels = (double)MarchTilesX * GroupX * MarchTilesY * GroupY;
+  std::vector<MarchColor> buf(ref.size());
+  const char *name[2] = { "compiled", "pruned" };
+  printf("map()          ms   evals/pixel   ops/pixel   pruned/tile   same depth   (%d gates)\n", SdfGateCount);
+  for(int mode = 0; mode < 2; mode++) {
+    MarchOptions opt;
+    opt.prune = mode == 1;
+    double ms = 1e30;
+    for(int k = 0; k < 3; k++) {
+      auto start = std::chrono::high_resolution_clock::now();
+      MarchRender(jobs, isa, time, &buf[0], &stat[0], opt);
+      ms = std::min(ms, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    double steps = 0, ops = 0, pruned = 0;
+    for(size_t t = 0; t < stat.size(); t++) {
+      steps  += stat[t].steps;
+      ops    += stat[t].ops;
+      pruned += stat[t].pruned;
+    }
+    int same = 0;
+    for(int y = 0; y < MarchTilesY * GroupY; y++) {
+      for(int x = 0; x < MarchTilesX * GroupX; x++) {
+        same += fabsf(buf[x + y * ScreenX].a - ref[x + y * ScreenX].a) <= 1e-3f * (1 + fabsf(ref[x + y * ScreenX].a));
+      }
+    }
+    printf("%-12s %7.1f %13.1f %11.0f %13.1f %11.3f%%\n", name[mode], ms, steps / pixels, ops / pixels,
+      pruned / stat.size(), 100.0 * same / pixels);
+  }
+}
+
+//brick map around the camera for two voxel sizes : full bake, then the
+//bake as the camera moves over the next second, the frame through the
+//bricks against map(), the error of the baked field against SdfStatic
+//and how often the bound went above map()
+static void Bricks(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &ref, std::vector<MarchTileStat> &stat) {
+  typedef std::chrono::high_resolution_clock Clock;
+  auto   ms     = [](Clock::time_point a) { return std::chrono::duration<double, std::milli>(Clock::now() - a).count(); };
+  double pixels = (double)MarchTilesX * GroupX * MarchTilesY * GroupY;
+  std::vector<MarchColor> buf(ref.size());
+  MarchFrame f;
+  f.Set(time);
+
+  auto start = Clock::now();
+  MarchRender(jobs, isa, time, &buf[0], &stat[0]);
+  double base = ms(start), evals = 0;
+  for(size_t i = 0; i < stat.size(); i++) evals += stat[i].steps;
+  printf("bricks   voxel  region  bricks      MB  bake ms  moving ms/cells       ms  speedup  evals/pixel  same depth\n");
+  printf("map() %66.1f     1.00 %12.1f\n", base, evals / pixels);
+  for(int v = 0; v < 2; v++) {
+    BrickMap map;
+    map.Init(v ? 0.125f : 0.25f);
+    start = Clock::now();
+    map.Update(jobs, isa, f.pos);
+    double bake = ms(start), inc = 0;
+    int    cells = 0;
+    for(int k = 1; k <= 60; k++) {
+      MarchFrame g;
+      g.Set(time + k / 60.0f);
+      start = Clock::now();
+      map.Update(jobs, isa, g.pos);
+      inc   += ms(start);
+      cells += map.rebaked;
+    }
+    map.Update(jobs, isa, f.pos);
+
+    start = Clock::now();
+    MarchOptions opt;
+    opt.bricks = &map;
+    MarchRender(jobs, isa, time, &buf[0], &stat[0], opt);
+    double t = ms(start), steps = 0;
+    for(size_t i = 0; i < stat.size(); i++) steps += stat[i].steps;
+    int same = 0;
+    for(int y = 0; y < MarchTilesY * GroupY; y++) {
+      for(int x = 0; x < MarchTilesX * GroupX; x++) {
+        same += fabsf(buf[x + y * ScreenX].a - ref[x + y * ScreenX].a) <= 1e-3f * (1 + fabsf(ref[x + y * ScreenX].a));
+      }
+    }
+    printf("%15.3f %7.0f %7d %7.1f %8.1f %7.2f/%-7d %7.1f %8.2f %12.1f %10.3f%%\n", map.voxel, map.cell * BrickMap::N,
+      map.count, map.Bytes() / 1048576.0, bake, inc / 60, cells / 60, t, base / t, steps / pixels, 100.0 * same / pixels);
+
+    //random points of the region : bricks against SdfStatic, empty cells and the bound should stay under it
+    unsigned seed = 777;
+    auto rnd = [&] {
+      seed = seed * 1664525u + 1013904223u;
+      return (seed >> 8) * (1.0f / 16777216.0f);
+    };
+    double err = 0, sum = 0, surface = 0;
+    int    count = 0, empty = 0, over = 0, inside = 0, above = 0;
+    for(int i = 0; i < 1 << 18; i++) {
+      float p[3], d;
+      int   c[3];
+      for(int e = 0; e < 3; e++) {
+        p[e] = (map.origin[e] + rnd() * BrickMap::N) * map.cell;
+        c[e] = (int)floorf(p[e] / map.cell);
+      }
+      float a = SdfStatic(p[0], p[1], p[2], time), b;
+      if(!map.Sample(p[0], p[1], p[2], &d)) continue;
+      map.Bound(p[0], p[1], p[2], time, &b);
+      inside++;
+      above += b > SdfMap(p[0], p[1], p[2], time);
+      if(map.index[BrickMap::Slot(c[0], c[1], c[2])] < 0) {
+        empty++;
+        over += d > a + 1e-4f;
+        continue;
+      }
+      err  = fmax(err, fabs(d - a));
+      sum += fabs(d - a);
+      if(fabsf(a) < 0.1f) surface = fmax(surface, fabs(d - a));
+      count++;
+    }
+    printf("           error max %.4f, mean %.5f, within 0.1 of the surface %.4f; empty cells above SdfStatic %.2f%%\n",
+      err, sum / (count ? count : 1), surface, 100.0 * over / (empty ? empty : 1));
+    printf("           margin %.4f, map() under %.4f; bound above map() %.3f%%\n", map.margin, map.exact,
+      100.0 * above / (inside ? inside : 1));
+  }
+}
+
+//map() calls per pixel from 0, from the cone prepass of 4 and 8 pixels,
+//from cones of 8 and 16 split down to 4 and from packets of 4 x 4 and
+//8 x 8 rays (opt.packet, AVX2), and the map() calls per frame they save.
+//A packet's depths stay in it, it has no passed, over/under.
+//passed : the reference stopped on the surface and the ray now starts
+//past it, the cone went through something.
+//over/under : the ray starts short of the reference's surface but
+//inter() steps over it from there / the reference stepped over the
+//surface the ray now stops on. map() is not 1-Lipschitz (noise, wave),
+//a ray grazing a thin edge hits or not as its steps happen to fall,
+//from 0 as from any start : both ways come out alike.
+static void Cones(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &ref, std::vector<MarchTileStat> &stat) {
+  double pixels = (double)MarchTilesX * GroupX * MarchTilesY * GroupY, base = 0, calls = 0;
+  std::vector<MarchColor> buf(ref.size());
+  MarchFrame f;
+  f.Set(time);
+  std::vector<float> begin(ref.size());
+  Vec3 pos = V3(f.pos[0], f.pos[1], f.pos[2]);
+  auto surface = [&](int x, int y, float d) {
+    return d <= MarchFar && MarchMap(f, pos + MarchCamera(f, -1 + 2 * float(x) / float(ScreenX), 1 - 2 * float(y) / float(ScreenY)) * d) < 0.03f;
+  };
+  printf("start          ms   speedup   inter()/pixel   pre/pixel   map()/frame   saved   same depth   passed   over/under\n");
+  for(int mode = 0; mode < 7; mode++) {
+    const char  *name[7] = { "0", "cone 4", "cone 8", "cone 8>4", "cone 16>4", "packet 4", "packet 8" };
+    const int    step[7] = { 0, 4, 8, 8, 16, 0, 0 };
+    MarchCone    cone;
+    MarchOptions opt;
+    if(mode >= 5 && isa != IsaAVX2) break;
+    cone.Init(step[mode], mode == 3 || mode == 4 ? 4 : 0);
+    opt.cone   = &cone;
+    opt.packet = mode >= 5 ? (mode - 4) * 4 : 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    MarchRender(jobs, isa, time, &buf[0], &stat[0], opt);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    double steps = 0, pre = 0;
+    for(size_t t = 0; t < stat.size(); t++) {
+      steps += stat[t].steps;
+      pre   += stat[t].cone;
+    }
+
+    //the starts again, tile by tile
+    MarchFrame g;
+    g.Set(time, opt);
+    for(int t = 0; t < MarchTilesX * MarchTilesY; t++) {
+      int   x0 = (t % MarchTilesX) * GroupX, y0 = (t / MarchTilesX) * GroupY;
+      float s[GroupX * GroupY];
+      MarchStart(g, isa == IsaAVX2, x0, y0, s);
+      for(int i = 0; i < GroupX * GroupY; i++) begin[x0 + i % GroupX + (y0 + i / GroupX) * ScreenX] = s[i];
+    }
+    int same = 0, passed = 0, over = 0, under = 0;
+    for(int y = 0; y < MarchTilesY * GroupY; y++) {
+      for(int x = 0; x < MarchTilesX * GroupX; x++) {
+        float a = ref[x + y * ScreenX].a, b = buf[x + y * ScreenX].a;
+        same += fabsf(b - a) <= 1e-3f * (1 + fabsf(a));
+        if(b > a + 1 && surface(x, y, a)) {
+          passed += begin[x + y * ScreenX] > a;
+          over   += begin[x + y * ScreenX] <= a;
+        }
+        under += a > b + 1 && surface(x, y, b);
+      }
+    }
+    base  = mode ? base : ms;
+    calls = mode ? calls : steps + pre;
+    printf("%-10s %6.1f %9.2f %15.2f %11.3f %12.0f %6.1f%% %11.3f%%", name[mode], ms, base / ms, steps / pixels, pre / pixels,
+      steps + pre, 100.0 * (1 - (steps + pre) / calls), 100.0 * same / pixels);
+    if(opt.packet) printf("        -           -\n");
+    else printf(" %8d %7d/%d\n", passed, over, under);
+  }
+}
+
+//depth of the primary rays of row ty alone, returns the map() calls
+TARGET_AVX2 static unsigned TraceRow8(const MarchFrame &f, int strategy, int ty, int ite, float cend, float *depth) {
+  Vec8    pos   = { _mm256_set1_ps(f.pos[0]), _mm256_set1_ps(f.pos[1]), _mm256_set1_ps(f.pos[2]) };
+  __m256  all   = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  __m256i steps = _mm256_setzero_si256();
+  float   y     = -1 + (2 * float(ty) / float(ScreenY));
+  for(int tx = 0; tx < MarchTilesX * GroupX; tx += 8) {
+    __m256 x = _mm256_add_ps(_mm256_set1_ps(float(tx)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    x = _mm256_add_ps(_mm256_set1_ps(-1), _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(2), x), _mm256_set1_ps(float(ScreenX))));
+    Vec8 dir = MarchCamera8(f, x, _mm256_set1_ps(y));
+    _mm256_storeu_ps(depth + tx, MarchTrace8(f, strategy, pos, dir, all, ite, _mm256_setzero_ps(), cend, &steps));
+  }
+  unsigned s[8];
+  _mm256_storeu_si256((__m256i *)s, steps);
+  return s[0] + s[1] + s[2] + s[3] + s[4] + s[5] + s[6] + s[7];
+}
+
+static unsigned TraceRow(const MarchFrame &f, int isa, int strategy, int ty, int ite, float cend, float *depth) {
+  if(isa == IsaAVX2) return TraceRow8(f, strategy, ty, ite, cend, depth);
+  unsigned steps = 0;
+  Vec3     pos   = V3(f.pos[0], f.pos[1], f.pos[2]);
+  for(int tx = 0; tx < MarchTilesX * GroupX; tx++) {
+    Vec3 dir = MarchCamera(f, -1 + 2 * float(tx) / float(ScreenX), 1 - 2 * float(ty) / float(ScreenY));
+    depth[tx] = MarchTrace(f, strategy, pos, dir, MarchIte, 0, cend, &steps);
+  }
+  return steps;
+}
+
+//primary rays alone through every strategy, against classic with 1024
+//steps down to 1e-4 : steps per ray, rays/s, rays that hit or miss as the
+//reference does and the depth error of the hits. Rays out of steps before
+//the surface (grazing) end far from it, the median and 90th percentile
+//show the error of the ones that got there.
+static void Strategies(JobSystem *jobs, int isa, float time) {
+  int    w = MarchTilesX * GroupX, h = MarchTilesY * GroupY;
+  double rays = (double)w * h;
+  MarchFrame f;
+  f.Set(time);
+  std::vector<float>    ref(w * h), depth(w * h);
+  std::vector<unsigned> row(h);
+  auto trace = [&](int strategy, int ite, float cend, std::vector<float> &out) {
+    jobs->ParallelFor(h, 1, [&](int b, int e, int) {
+      for(int y = b; y < e; y++) row[y] = TraceRow(f, isa, strategy, y, ite, cend, &out[y * w]);
+    });
+    double steps = 0;
+    for(int y = 0; y < h; y++) steps += row[y];
+    return steps;
+  };
+  trace(MarchClassic, 1024, 1e-4f, ref);
+  printf("inter()      steps/ray   Mrays/s   same hit   median error   90%% error   within 0.01\n");
+  for(int s = 0; s < MarchStrategies; s++) {
+    auto   start = std::chrono::high_resolution_clock::now();
+    double steps = trace(s, MarchIte, 0.03f, depth);
+    double ms    = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    std::vector<float> err;
+    int same = 0, near = 0;
+    for(int i = 0; i < w * h; i++) {
+      bool a = ref[i] <= MarchFar, b = depth[i] <= MarchFar;
+      same += a == b;
+      if(!a || !b) continue;
+      err.push_back(fabsf(depth[i] - ref[i]));
+      near += err.back() <= 0.01f;
+    }
+    std::sort(err.begin(), err.end());
+    size_t n = err.size();
+    printf("%-10s %11.2f %9.2f %9.3f%% %14.4f %11.4f %12.3f%%\n", MarchStrategyName(s), steps / rays, rays / ms / 1000,
+      100.0 * same / rays, n ? err[n / 2] : 0, n ? err[n * 9 / 10] : 0, 100.0 * near / (n ? n : 1));
+  }
+}
+
+//map() in double with hash() held at its float value held[i] : the field
+//the normals are the gradient of, without the jitter's noise
+static double EvalDouble(const SdfProgram &prog, const double *p, double time, const float *held) {
+  double r[SdfProgram::InstMax];
+  for(size_t i = 0; i < prog.Code.size(); i++) {
+    const SdfInst &in = prog.Code[i];
+    double a = in.a >= 0 ? r[in.a] : 0, b = in.b >= 0 ? r[in.b] : 0;
+    switch(in.op) {
+    case SdfConst:  r[i] = in.value; break;
+    case SdfInX:    r[i] = p[0]; break;
+    case SdfInY:    r[i] = p[1]; break;
+    case SdfInZ:    r[i] = p[2]; break;
+    case SdfTime:   r[i] = time; break;
+    case SdfAdd:    r[i] = a + b; break;
+    case SdfSub:    r[i] = a - b; break;
+    case SdfMul:    r[i] = a * b; break;
+    case SdfDiv:    r[i] = a / b; break;
+    case SdfMod:    r[i] = fmod(a, b); break;
+    case SdfMin:    r[i] = fmin(a, b); break;
+    case SdfMax:    r[i] = fmax(a, b); break;
+    case SdfNeg:    r[i] = -a; break;
+    case SdfAbs:    r[i] = fabs(a); break;
+    case SdfSqrt:   r[i] = sqrt(a); break;
+    case SdfSin:    r[i] = sin(a); break;
+    case SdfCos:    r[i] = cos(a); break;
+    case SdfHashOp: r[i] = held[i]; break;
+    }
+  }
+  return r[prog.Result];
+}
+
+static volatile float NormalSink;     //keeps the timed normals alive
+
+//ns per normal of 8 points at a time, method 0 : 4 map() forward, 1 : 4 map() tetrahedral, 2 : mapgrad
+TARGET_AVX2 static double NormalTime8(const std::vector<float> &pt, float time, int method, float *sink) {
+  static const float corner[4][3] = { { 1, -1, -1 }, { -1, -1, 1 }, { -1, 1, -1 }, { 1, 1, 1 } };
+  size_t n = pt.size() / 3 / 8 * 8;
+  __m256 sum = _mm256_setzero_ps(), e = _mm256_set1_ps(0.01f);
+  auto   start = std::chrono::high_resolution_clock::now();
+  for(size_t i = 0; i < n; i += 8) {
+    __m256 x = _mm256_setr_ps(pt[i * 3 +  0], pt[i * 3 +  3], pt[i * 3 +  6], pt[i * 3 +  9], pt[i * 3 + 12], pt[i * 3 + 15], pt[i * 3 + 18], pt[i * 3 + 21]);
+    __m256 y = _mm256_setr_ps(pt[i * 3 +  1], pt[i * 3 +  4], pt[i * 3 +  7], pt[i * 3 + 10], pt[i * 3 + 13], pt[i * 3 + 16], pt[i * 3 + 19], pt[i * 3 + 22]);
+    __m256 z = _mm256_setr_ps(pt[i * 3 +  2], pt[i * 3 +  5], pt[i * 3 +  8], pt[i * 3 + 11], pt[i * 3 + 14], pt[i * 3 + 17], pt[i * 3 + 20], pt[i * 3 + 23]);
+    __m256 g[3] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+    if(method == 0) {
+      __m256 c = SdfMap8(x, y, z, time);
+      g[0] = _mm256_sub_ps(SdfMap8(_mm256_add_ps(x, e), y, z, time), c);
+      g[1] = _mm256_sub_ps(SdfMap8(x, _mm256_add_ps(y, e), z, time), c);
+      g[2] = _mm256_sub_ps(SdfMap8(x, y, _mm256_add_ps(z, e), time), c);
+    } else if(method == 1) {
+      for(int k = 0; k < 4; k++) {
+        __m256 c = SdfMap8(_mm256_fmadd_ps(_mm256_set1_ps(corner[k][0]), e, x), _mm256_fmadd_ps(_mm256_set1_ps(corner[k][1]), e, y),
+          _mm256_fmadd_ps(_mm256_set1_ps(corner[k][2]), e, z), time);
+        for(int a = 0; a < 3; a++) g[a] = _mm256_fmadd_ps(_mm256_set1_ps(corner[k][a]), c, g[a]);
+      }
+    } else {
+      SdfMapGrad8(x, y, z, time, g);
+    }
+    sum = _mm256_add_ps(sum, _mm256_add_ps(g[0], _mm256_add_ps(g[1], g[2])));
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+  float  s[8];
+  _mm256_storeu_ps(s, sum);
+  *sink += s[0];
+  return n ? ns / n : 0;
+}
+
+//getnormal over the hits of every 4th pixel and row : the shader's 4
+//map() forward difference, 4 map() on a tetrahedron, mapgrad() and the
+//dual numbers alone (hash held) against central differences of the
+//double field with hash held. The jitter's hash is noise at any step,
+//the first three carry it as the shader always did, the last shows
+//what is left without it. Then ns per normal and the frame.
+static void Normals(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &ref, std::vector<MarchTileStat> &stat) {
+  static const float corner[4][3] = { { 1, -1, -1 }, { -1, -1, 1 }, { -1, 1, -1 }, { 1, 1, 1 } };
+  SdfProgram  prog;
+  std::string error;
+  if(!SdfCompile(SdfScene, &prog, &error)) {
+    printf("normals : %s\n", error.c_str());
+    return;
+  }
+  MarchFrame f, fd;
+  MarchOptions opt;
+  opt.grad = false;
+  f.Set(time);
+  fd.Set(time, opt);
+  f.grad = true;
+  Vec3 pos = V3(f.pos[0], f.pos[1], f.pos[2]);
+  std::vector<float> pt;
+  for(int y = 0; y < MarchTilesY * GroupY; y += 4) {
+    for(int x = 0; x < MarchTilesX * GroupX; x += 4) {
+      float d = ref[x + y * ScreenX].a;
+      if(!(d <= MarchFar)) continue;
+      Vec3 ip = pos + MarchCamera(f, -1 + 2 * float(x) / float(ScreenX), 1 - 2 * float(y) / float(ScreenY)) * d;
+      pt.push_back(ip.x);
+      pt.push_back(ip.y);
+      pt.push_back(ip.z);
+    }
+  }
+  size_t n = pt.size() / 3;
+  std::vector<float> err[4], held(prog.Code.size(), 0);
+  for(size_t i = 0; i < n; i++) {
+    Vec3 ip = V3(pt[i * 3], pt[i * 3 + 1], pt[i * 3 + 2]);
+    for(size_t k = 0; k < prog.Code.size(); k++) {
+      if(prog.Code[k].op == SdfHashOp) held[k] = prog.Eval(ip.x, ip.y, ip.z, time, (int)k);
+    }
+    double g[3], h = 1e-5, l = 0;
+    for(int a = 0; a < 3; a++) {
+      double p0[3] = { ip.x, ip.y, ip.z }, p1[3] = { ip.x, ip.y, ip.z };
+      p0[a] += h;
+      p1[a] -= h;
+      g[a] = EvalDouble(prog, p0, time, &held[0]) - EvalDouble(prog, p1, time, &held[0]);
+      l   += g[a] * g[a];
+    }
+    Vec3  tetra = V3(0, 0, 0);
+    float dual[3];
+    for(int k = 0; k < 4; k++) {
+      Vec3 c = V3(corner[k][0], corner[k][1], corner[k][2]);
+      tetra = tetra + c * MarchMap(f, ip + c * 0.01f);
+    }
+    prog.EvalGrad(ip.x, ip.y, ip.z, time, dual, false);
+    Vec3 N[4] = { MarchNormal(fd, ip), Normalize(tetra), MarchNormal(f, ip), Normalize(V3(dual[0], dual[1], dual[2])) };
+    for(int m = 0; m < 4; m++) {
+      double c = (N[m].x * g[0] + N[m].y * g[1] + N[m].z * g[2]) / sqrt(l);
+      err[m].push_back((float)(acos(fmin(fmax(c, -1.0), 1.0)) * 180 / 3.14159265358979));
+    }
+  }
+
+  //scalar and AVX2 time per normal
+  double ns[3][2] = {};
+  float  sink = 0;
+  for(int m = 0; m < 3; m++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for(size_t i = 0; i < n; i++) {
+      Vec3 ip = V3(pt[i * 3], pt[i * 3 + 1], pt[i * 3 + 2]), N = V3(0, 0, 0);
+      if(m == 0) N = MarchNormal(fd, ip);
+      if(m == 2) N = MarchNormal(f, ip);
+      for(int k = 0; m == 1 && k < 4; k++) {
+        Vec3 c = V3(corner[k][0], corner[k][1], corner[k][2]);
+        N = N + c * MarchMap(f, ip + c * 0.01f);
+      }
+      sink += N.x;
+    }
+    ns[m][0] = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / (n ? n : 1);
+    if(isa == IsaAVX2) ns[m][1] = NormalTime8(pt, time, m, &sink);
+  }
+
+  printf("normal (%d hits)        mean     median   99%%      max    ns scalar   ns avx2   map()s\n", (int)n);
+  const char *name[4] = { "4 map() forward", "4 map() tetrahedral", "mapgrad", "dual, hash held" };
+  for(int m = 0; m < 4; m++) {
+    std::vector<float> &e = err[m];
+    double mean = 0;
+    for(size_t i = 0; i < e.size(); i++) mean += e[i];
+    std::sort(e.begin(), e.end());
+    size_t c = e.size();
+    printf("%-22s %7.3f %8.3f %8.3f %8.2f", name[m], mean / (c ? c : 1), c ? e[c / 2] : 0, c ? e[c * 99 / 100] : 0, c ? e[c - 1] : 0);
+    if(m < 3) printf(" %10.1f %9.1f %8.2f\n", ns[m][0], ns[m][1], ns[m][0] / ns[0][0] * 4);
+    else      printf("          -         -        -\n");
+  }
+
+  //the frame both ways
+  double ms[2];
+  for(int g = 0; g < 2; g++) {
+    std::vector<MarchColor> buf(ref.size());
+    opt.grad = g != 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    MarchRender(jobs, isa, time, &buf[0], &stat[0], opt);
+    ms[g] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  }
+  printf("frame  4 map() %.1f ms  mapgrad %.1f ms  speedup %.2f\n", ms[0], ms[1], ms[0] / ms[1]);
+  NormalSink = sink;
+}
+
+//PSNR of the presented 8 bit images, over the rows a full frame renders
+//(an upscaled one fills the rest)
+static double Psnr(const std::vector<MarchColor> &a, const std::vector<MarchColor> &b) {
+  std::vector<unsigned char> ra, rb;
+  Present(a, ra);
+  Present(b, rb);
+  size_t n  = (size_t)ScreenX * MarchTilesY * GroupY * 3;
+  double se = 0;
+  for(size_t i = 0; i < n; i++) se += (double)(ra[i] - rb[i]) * (ra[i] - rb[i]);
+  return se > 0 ? 10 * log10(255.0 * 255.0 * n / se) : 99;
+}
+
+//frames 1/60 apart from time on, each marched in full and from the
+//history of the ones before it (the first fills it) : map() calls per
+//pixel with the history checks, rays that started from it, depths that
+//match the full march, rays that started past a surface and PSNR
+static void Temporal(JobSystem *jobs, int isa, float time, std::vector<MarchTileStat> &stat) {
+  double pixels = (double)MarchTilesX * GroupX * MarchTilesY * GroupY;
+  std::vector<MarchColor> full((size_t)ScreenX * ScreenY), temp(full.size());
+  MarchHistory history;
+  MarchOptions opt;
+  history.Init();
+  opt.history = &history;
+  printf("frame   full ms  temporal ms   map()/pixel   temporal   reused   same depth   passed    PSNR\n");
+  double total[2] = {};
+  for(int n = 0; n < 6; n++) {
+    float  t = time + n / 60.0f;
+    double ms[2], steps[2] = {}, reused = 0;
+    for(int k = 0; k < 2; k++) {
+      auto start = std::chrono::high_resolution_clock::now();
+      MarchRender(jobs, isa, t, k ? &temp[0] : &full[0], &stat[0], k ? opt : MarchOptions());
+      ms[k] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+      for(size_t i = 0; i < stat.size(); i++) {
+        steps[k] += stat[i].steps + stat[i].cone;
+        reused   += k ? stat[i].reproj : 0;
+      }
+    }
+    int same = 0, passed = 0;
+    MarchFrame f;
+    f.Set(t);
+    for(int y = 0; y < MarchTilesY * GroupY; y++) {
+      for(int x = 0; x < MarchTilesX * GroupX; x++) {
+        float a = full[x + y * ScreenX].a, b = temp[x + y * ScreenX].a;
+        same   += fabsf(b - a) <= 1e-3f * (1 + fabsf(a));
+        if(b > a + 1 && a <= MarchFar) {
+          Vec3 dir = MarchCamera(f, -1 + 2 * float(x) / float(ScreenX), 1 - 2 * float(y) / float(ScreenY));
+          passed  += MarchMap(f, V3(f.pos[0], f.pos[1], f.pos[2]) + dir * a) < 0.03f;
+        }
+      }
+    }
+    if(n) {
+      total[0] += steps[0];
+      total[1] += steps[1];
+    }
+    printf("%5d %9.1f %12.1f %13.2f %10.2f %7.1f%% %11.3f%% %8d %7.2f\n", n, ms[0], ms[1], steps[0] / pixels, steps[1] / pixels,
+      100.0 * reused / pixels, 100.0 * same / pixels, passed, Psnr(full, temp));
+  }
+  printf("temporal : %.1f%% of the map() calls of the full march after the first frame\n", 100.0 * total[1] / total[0]);
+}
+
+//frames 1/60 apart from time on, marched in full and sparse (MarchSparse)
+//: rays and map() calls against the full march and PSNR of the frame
+//rebuilt with the last frame (SparseHistory) and from its marched pixels
+//alone, averaged after the first
+static void Interleave(JobSystem *jobs, int isa, float time, std::vector<MarchTileStat> &stat) {
+  static const char *name[] = { "every", "checker", "quad" };
+  std::vector<MarchColor> full((size_t)ScreenX * ScreenY), temp(full.size()), flat(full.size());
+  for(int mode = MarchChecker; mode <= MarchQuad; mode++) {
+    MarchSparse  history, alone;
+    MarchOptions opt[2];
+    history.Init(mode, true);
+    alone.Init(mode, false);
+    opt[0].sparse = &history;
+    opt[1].sparse = &alone;
+    printf("%-7s  full ms  sparse ms   rays   map()   PSNR history  alone\n", name[mode]);
+    double psnr[2] = {};
+    for(int n = 0; n < 6; n++) {
+      float  t = time + n / 60.0f;
+      double ms[2], rays[2] = {}, steps[2] = {};
+      for(int k = 0; k < 2; k++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        MarchRender(jobs, isa, t, k ? &temp[0] : &full[0], &stat[0], k ? opt[0] : MarchOptions());
+        ms[k] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        for(size_t i = 0; i < stat.size(); i++) {
+          rays[k]  += stat[i].rays;
+          steps[k] += stat[i].steps + stat[i].cone;
+        }
+      }
+      MarchRender(jobs, isa, t, &flat[0], &stat[0], opt[1]);
+      double p[2] = { Psnr(full, temp), Psnr(full, flat) };
+      if(n) {
+        psnr[0] += p[0] / 5;
+        psnr[1] += p[1] / 5;
+      }
+      printf("%5d %10.1f %10.1f %6.3f %7.3f %13.2f %6.2f\n", n, ms[0], ms[1], rays[1] / rays[0], steps[1] / steps[0], p[0], p[1]);
+    }
+    printf("%s : PSNR %.2f with the last frame, %.2f without, after the first\n", name[mode], psnr[0], psnr[1]);
+  }
+}
+
+//synthetic frame times : cost ms at full size, the frame takes cost * scale^2
+//+ 1 ms, noise of +-noise of it and every spike frames 3 times as long
+struct GovernTrace {
+  const char *name;
+  float       cost[2];       //before and after frame 300
+  float       noise;
+  int         spike;         //0 : none
+  float       scale;         //expected at the end
+  int         changes;       //at most
+  float       over;          //% of frames over budget from frame 400, at most
+};
+
+static bool GovernRun(const GovernTrace &t, float budget) {
+  ResGovernor g;
+  g.Init(budget);
+  unsigned seed = 12345;
+  int      over = 0, frames = 600;
+  float    worst = 0;
+  for(int n = 0; n < frames; n++) {
+    seed = seed * 1664525u + 1013904223u;
+    float s  = g.Scale(), r = (seed >> 8) / float(1 << 24) * 2 - 1;
+    float ms = (t.cost[n >= 300] * s * s + 1) * (1 + t.noise * r);
+    if(t.spike && n % t.spike == t.spike - 1) ms *= 3;
+    over  += n >= 400 && ms > budget;
+    worst  = n >= 400 && ms > worst ? ms : worst;
+    g.Update(ms);
+  }
+  bool ok = g.Scale() == t.scale && g.Changes <= t.changes && over * 100.0f <= t.over * (frames - 400);
+  printf("%-10s %6.1f %6.1f %6.3f %8d %7.1f%% %8.1f  %s\n", t.name, t.cost[0], t.cost[1], g.Scale(), g.Changes,
+    100.0 * over / (frames - 400), worst, ok ? "ok" : "failed");
+  return ok;
+}
+
+//ResGovernor on synthetic traces at 60 fps, then on frames of the CPU march
+//at a budget of 0.6 times the full frame : level, ms, PSNR of the upscale
+//against the full frame. The number of traces that failed
+static int Governor(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &ref, std::vector<MarchTileStat> &stat) {
+  static const GovernTrace trace[] = {
+    //name         cost           noise  spike  scale   changes  over
+    { "steady",    { 25, 25 },    0.1f,  0,     0.75f,  1,       0 },
+    { "drop",      { 10, 44 },    0.1f,  0,     0.5f,   3,       0 },
+    { "recover",   { 40, 10 },    0.1f,  0,     1.0f,   6,       0 },
+    { "border",    { 20, 20 },    0.2f,  0,     0.75f,  2,       0 },
+    //the spikes themselves, 1 in 45, are over : they are left out, not paid for in scale
+    { "spikes",    { 12, 12 },    0.1f,  45,    1.0f,   0,       3 },
+  };
+  printf("trace        cost   then  scale  changes  over budget  worst ms\n");
+  int failed = 0;
+  for(const GovernTrace &t : trace) failed += !GovernRun(t, 1000 / 60.0f);
+  if(failed) printf("governor : %d traces failed\n", failed);
+
+  //the march : the first frame sets the budget
+  std::vector<MarchColor> low(ref.size()), up(ref.size());
+  ResGovernor g;
+  MarchOptions opt;
+  g.Init(0);
+  printf("frame  scale      ms   PSNR\n");
+  for(int n = 0; n < 8; n++) {
+    float t = time + n / 60.0f;
+    opt.scale = g.Scale();
+    auto start = std::chrono::high_resolution_clock::now();
+    MarchRender(jobs, isa, t, &low[0], &stat[0], opt);
+    Upscale(jobs, isa, opt.scale, &low[0], &up[0]);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    if(!n) g.Init(float(ms * 0.6));
+    g.Update(float(ms));
+    MarchRender(jobs, isa, t, &ref[0], &stat[0]);
+    printf("%5d %6.3f %7.1f %6.2f\n", n, opt.scale, ms, Psnr(ref, up));
+  }
+  return failed;
+}
+
+//PSNR of the colour after gamma, before the rest of the post, over the rows
+//a full frame renders
+static double PsnrGamma(const std::vector<MarchColor> &a, const std::vector<MarchColor> &b) {
+  double se = 0;
+  size_t n  = 0;
+  for(int y = 0; y < MarchTilesY * GroupY; y++) {
+    for(int x = 0; x < ScreenX; x++) {
+      for(int c = 0; c < 3; c++, n++) {
+        float u = powf(std::min(std::max((&a[x + y * ScreenX].r)[c], 0.0f), 1.0f), 0.4545f);
+        float v = powf(std::min(std::max((&b[x + y * ScreenX].r)[c], 0.0f), 1.0f), 0.4545f);
+        se += (double)(u - v) * (u - v);
+      }
+    }
+  }
+  return se > 0 ? 10 * log10(n / se) : 99;
+}
+
+//frames rendered at 0.75 and 0.5 brought back to full size, bilinear :
+//PSNR against the full frame, the depth error on its silhouettes, Mpixel/s
+//of MarchUpscale and of Upscale scalar, AVX2 and on all threads
+static void Upscaling(JobSystem *jobs, int isa, float time, std::vector<MarchColor> &ref, std::vector<MarchTileStat> &stat) {
+  size_t size = ref.size();
+  std::vector<MarchColor> low(size), bilinear(size), up(size), check(size);
+  MarchRender(jobs, isa, time, &ref[0], &stat[0]);
+
+  //silhouettes : a neighbour 10% nearer or further
+  std::vector<int> rim;
+  for(int y = 1; y < MarchTilesY * GroupY - 1; y++) {
+    for(int x = 1; x < ScreenX - 1; x++) {
+      int   i = x + y * ScreenX;
+      float d = ref[i].a;
+      for(int o : { 1, -1, ScreenX, -ScreenX }) {
+        if(fabsf(ref[i + o].a - d) <= 0.1f * std::min(d, ref[i + o].a)) continue;
+        rim.push_back(i);
+        break;
+      }
+    }
+  }
+  double mpix = (double)ScreenX * ScreenY / 1000;
+  printf("scale   PSNR   rim depth   Mpix/s MarchUpscale   scalar   avx2   jobs\n");
+  for(float scale : { 0.75f, 0.5f }) {
+    MarchOptions opt;
+    opt.scale = scale;
+    MarchRender(jobs, isa, time, &low[0], &stat[0], opt);
+    double ms[4];
+    for(int k = 0; k < 4; k++) {
+      auto start = std::chrono::high_resolution_clock::now();
+      if(k == 0) MarchUpscale(NULL, scale, &low[0], &bilinear[0]);
+      if(k == 1) Upscale(NULL, IsaScalar, scale, &low[0], &check[0]);
+      if(k == 2) Upscale(NULL, isa, scale, &low[0], &up[0]);
+      if(k == 3) Upscale(jobs, isa, scale, &low[0], &up[0]);
+      ms[k] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+    float diff = 0;
+    for(size_t i = 0; i < size; i++) {
+      for(int c = 0; c < 3; c++) diff = std::max(diff, fabsf((&check[i].r)[c] - (&up[i].r)[c]));
+    }
+    double rim_error = 0;
+    for(int i : rim) rim_error += fabsf(up[i].a - ref[i].a) / ref[i].a;
+    printf("%5.2f %6.2f %11.3f %20.1f %8.1f %6.1f %6.1f\n", scale, PsnrGamma(ref, up), rim.empty() ? 0 : rim_error / rim.size(),
+      mpix / ms[0], mpix / ms[1], mpix / ms[2], mpix / ms[3]);
+    if(diff > 1e-4f) printf("upscale : scalar and avx2 differ by %g\n", diff);
+  }
+}
+
+//the post without and with a blur, each gamma : ms of the stages one after
+//the other (PostChain) and fused (Post), scalar and AVX2 on one thread, the
+//bytes per pixel each moves and what that makes per second in AVX2, the
+//share of bytes off the scalar powf post and by how much (the dither hash
+//turns the last bit of a colour into a few)
+static void Postprocess(int isa, std::vector<MarchColor> &ref) {
+  float perr[3] = { 0, 0, 0 };
+  for(int i = 0; i <= 100000; i++) {
+    float c = i / 100000.0f, r = powf(c, PostGammaExp);
+    perr[PostPoly] = std::max(perr[PostPoly], fabsf(PostGammaPoly(c) - r));
+    perr[PostLut]  = std::max(perr[PostLut], fabsf(PostGammaLut(c) - r));
+  }
+  printf("gamma over 0..1 against powf : poly max error %.2e, lut %.2e\n", perr[PostPoly], perr[PostLut]);
+
+  size_t size = ref.size();
+  std::vector<MarchColor> t0(size), t1(size);
+  std::vector<unsigned>   base(size), out(size);
+  MarchColor *tmp[2] = { &t0[0], &t1[0] };
+  const char *names[3] = { "pow", "poly", "lut" };
+  double      mpix = (double)ScreenX * ScreenY / 1000;
+  printf("blur  gamma   chain scalar ms   avx2   fused scalar ms   avx2   B/pixel chain  fused   GB/s chain  fused   Mpix/s fused   differ   max\n");
+  for(float blur : { 0.0f, 0.5f }) {
+    PostOptions o;
+    o.blur = blur;
+    Post(NULL, IsaScalar, o, &ref[0], &base[0]);
+    for(int g = PostPow; g <= PostLut; g++) {
+      o.gamma = g;
+      double ms[4];
+      for(int k = 0; k < 4; k++) {
+        int i = k & 1 ? isa : IsaScalar;
+        ms[k] = 1e30;
+        for(int n = 0; n < 3; n++) {
+          auto start = std::chrono::high_resolution_clock::now();
+          if(k < 2) PostChain(NULL, i, o, &ref[0], tmp, &out[0]);
+          else      Post(NULL, i, o, &ref[0], &out[0]);
+          ms[k] = std::min(ms[k], std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+      }
+      size_t differ = 0;
+      int    most   = 0;
+      for(size_t i = 0; i < size; i++) {
+        for(int c = 0; c < 24; c += 8) {
+          int d = abs((int)((out[i] >> c) & 255) - (int)((base[i] >> c) & 255));
+          differ += d != 0;
+          most    = std::max(most, d);
+        }
+      }
+      int bc = PostChainBytes(o), bf = PostFusedBytes();
+      printf("%4.1f  %-5s %15.1f %6.1f %17.1f %6.1f %13d %6d %12.2f %6.2f %14.1f %7.2f%% %5d\n", blur, names[g], ms[0], ms[1], ms[2], ms[3], bc, bf,
+        mpix * bc / ms[1] / 1000, mpix * bf / ms[3] / 1000, mpix / ms[3], 100.0 * differ / (size * 3), most);
+    }
+  }
+}
+
+//1..threads : static blocks, stealing, stealing ordered by the previous
+//frame's tile cost (time - 1/60 is rendered first to seed it)
+static void Scaling(int isa, float time, int threads, std::vector<MarchColor> &buf, std::vector<MarchTileStat> &stat) {
+  printf("threads   static ms   steal ms  sorted ms  speedup  util min/avg  steals\n");
+  double base = 0;
+  for(int n = 1; n <= threads; n++) {
+    TileScheduler sched;
+    sched.Init(n);
+    sched.Sorted   = true;
+    sched.Stealing = true;
+    MarchRender(sched, isa, time - 1.0f / 60, &buf[0], &stat[0]);
+    MarchRender(sched, isa, time, &buf[0], &stat[0]);
+    double sorted = sched.Wall, lo = 1, sum = 0;
+    int    steals = 0, done = 0;
+    for(int t = 0; t < n; t++) {
+      double u = sched.Utilization(t);
+      lo      = u < lo ? u : lo;
+      sum    += u;
+      steals += sched.Stat[t].steals;
+      done   += sched.Stat[t].tiles;
+    }
+    if(done != MarchTilesX * MarchTilesY) printf("scheduler ran %d of %d tiles\n", done, MarchTilesX * MarchTilesY);
+
+    sched.Sorted   = false;
+    sched.Stealing = false;
+    MarchRender(sched, isa, time, &buf[0], &stat[0]);
+    double fixed = sched.Wall;
+    sched.Stealing = true;
+    MarchRender(sched, isa, time, &buf[0], &stat[0]);
+    double steal = sched.Wall;
+
+    if(n == 1) base = sorted;
+    printf("%7d %11.1f %10.1f %10.1f %8.2f   %5.2f/%5.2f %7d\n", n, fixed, steal, sorted, base / sorted, lo, sum / n, steals);
+  }
+}
+
+//Init again on a scheduler that already ran : every tile once per run, and
+//no worker left behind on the old run to release Done early
+static bool Reinit() {
+  TileScheduler sched;
+  const int count = 64;
+  std::atomic<int> hit[count];
+  int bad = 0;
+  for(int k = 0; k < 50; k++) {
+    sched.Init(4);
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    for(int r = 0; r < 2; r++) {
+      {
+        //a worker woken on the old run has already taken Busy below zero
+        std::lock_guard<std::mutex> lk(sched.Lock);
+        bad += sched.Busy != 0;
+      }
+      for(int i = 0; i < count; i++) hit[i].store(0);
+      sched.Run(count, [&](int tile, int) {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        hit[tile].fetch_add(1);
+      });
+      for(int i = 0; i < count; i++) bad += hit[i].load() != 1;
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  }
+  printf("scheduler re-init : 100 runs, %d bad %s\n", bad, bad ? "FAILED" : "ok");
+  return bad == 0;
+}
+
+int main(int argc, char *argv[]) {
+  float       time    = argc > 1 ? (float)atof(argv[1]) : 10.0f;
+  std::string out     = argc > 2 ? argv[2] : "cpumarch";
+  int         threads = argc > 3 ? atoi(argv[3]) : 0;
+  int         isa     = DetectIsa();
+  size_t      size    = (size_t)ScreenX * ScreenY;
+  int         tiles   = MarchTilesX * MarchTilesY;
+
+  std::vector<MarchColor>    scalar(size), simd(size);
+  std::vector<MarchTileStat> stat(tiles);
+  memset(&scalar[0], 0, sizeof(MarchColor) * size);
+  memset(&simd[0], 0, sizeof(MarchColor) * size);
+
+  JobSystem jobs;
+  jobs.Init(threads);
+  printf("time %.2f  %d x %d  isa %s  threads %d\n", time, ScreenX, ScreenY, IsaName(isa), jobs.Threads());
+
+  Report("scalar", Run(NULL, IsaScalar, time, scalar, stat));
+  if(isa == IsaAVX2) {
+    Report("avx2", Run(NULL, IsaAVX2, time, simd, stat));
+    Compare(scalar, simd);
+  }
+  Report("jobs", Run(&jobs, isa, time, simd, stat));
+  TileMap(stat);
+  Pruning(&jobs, isa, time, simd, stat);
+  Bricks(&jobs, isa, time, simd, stat);
+  Cones(&jobs, isa, time, simd, stat);
+  Strategies(&jobs, isa, time);
+  Normals(&jobs, isa, time, simd, stat);
+  Temporal(&jobs, isa, time, stat);
+  Interleave(&jobs, isa, time, stat);
+  int governFailed = Governor(&jobs, isa, time, simd, stat);
+  Upscaling(&jobs, isa, time, simd, stat);
+  MarchRender(&jobs, isa, time, &simd[0], &stat[0]);
+  Postprocess(isa, simd);
+  Scaling(isa, time, jobs.Threads(), simd, stat);
+  bool pass = Reinit();
+
+  std::vector<unsigned char> rgb;
+  Present(simd, rgb);
+  bool ok = WritePPM((out + ".ppm").c_str(), rgb) && WriteEXR((out + ".exr").c_str(), simd);
+  printf("%s %s.ppm %s.exr\n", ok ? "wrote" : "failed", out.c_str(), out.c_str());
+  return ok && pass && !governFailed ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  governor.h
+//    Render scale from the frame time. Frames are averaged (Avg) with their
+//    mean deviation (Dev) and the load, Avg + Dev, held against a budget :
+//    an average under the budget still has about half its frames over it
+//    when they are noisy. A run of loads over it drops the scale to the
+//    step that fits, a longer run where the next step up is predicted to
+//    fit well under it raises one step. A lone frame over Hitch times the
+//    average (a page fault, the OS) is left out, two in a row are load. The
+//    cost is taken as pixels, scale^2. The gap between the two bands, the
+//    longer run up and the hold after a change keep it from going back and
+//    forth. The buffers stay at full size, only the part rendered changes.
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _GOVERNOR_H_
+#define _GOVERNOR_H_
+
+#include <math.h>
+
+#define GovernLevels       5
+
+//scale of each level, 0 : full size
+static const float GovernScale[GovernLevels] = { 1.0f, 0.875f, 0.75f, 0.625f, 0.5f };
+
+struct ResGovernor {
+  float Budget;              //ms per frame
+  float Smooth;              //weight of the newest frame in Avg
+  float High;                //drop above Budget * High
+  float Low;                 //raise where the level up comes below Budget * Low
+  int   DropAfter;           //averages over in a row to drop
+  int   RaiseAfter;          //averages under in a row to raise
+  int   Hold;                //frames after a change with none
+  int   Level;
+  float Hitch;               //a frame over Avg * Hitch alone is left out
+  float Avg;                 //ms, -1 : no frame yet
+  float Dev;                 //mean |ms - Avg|
+  bool  Skipped;             //the frame before was left out
+  int   Over, Under, Wait;
+  int   Changes;
+
+  void Init(float budget) {
+    Budget     = budget;
+    Smooth     = 0.1f;
+    High       = 1.05f;
+    Low        = 0.85f;
+    DropAfter  = 3;
+    RaiseAfter = 30;
+    Hold       = 15;
+    Hitch      = 2.0f;
+    Level      = 0;
+    Avg        = -1;
+    Dev        = 0;
+    Skipped    = false;
+    Over       = 0;
+    Under      = 0;
+    Wait       = 0;
+    Changes    = 0;
+  }
+
+  float Scale() const { return GovernScale[Level]; }
+
+  //ms of the frame at level l moved to level to
+  static float Predict(float ms, int l, int to) {
+    float r = GovernScale[to] / GovernScale[l];
+    return ms * r * r;
+  }
+
+  //after every frame, true when the level changed
+  bool Update(float ms) {
+    if(Budget <= 0) return false;
+    Skipped = !Skipped && Avg >= 0 && ms > Avg * Hitch;
+    if(Skipped) return false;
+    Dev = Avg < 0 ? 0 : Dev + (fabsf(ms - Avg) - Dev) * Smooth;
+    Avg = Avg < 0 ? ms : Avg + (ms - Avg) * Smooth;
+    float load = Avg + Dev;
+    if(Wait > 0) {
+      Wait--;
+      return false;
+    }
+    Over  = load > Budget * High ? Over + 1 : 0;
+    Under = Level > 0 && Predict(load, Level, Level - 1) < Budget * Low ? Under + 1 : 0;
+    int to = Level;
+    if(Over >= DropAfter) {
+      //one step at least, more while the load does not fit
+      for(to = Level + 1; to < GovernLevels - 1 && Predict(load, Level, to) > Budget; to++) {}
+      to = to < GovernLevels ? to : GovernLevels - 1;
+    } else if(Under >= RaiseAfter) {
+      to = Level - 1;
+    }
+    if(to == Level) return false;
+    Avg   = Predict(Avg, Level, to);
+    Dev   = Predict(Dev, Level, to);
+    Level = to;
+    Over  = 0;
+    Under = 0;
+    Wait  = Hold;
+    Changes++;
+    return true;
+  }
+};
+
+#endif //_GOVERNOR_H_
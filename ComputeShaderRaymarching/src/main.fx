@@ -14,7 +14,16 @@ RWStructuredBuffer <float4> buffer  : register(u0);
 
 //http://msdn.microsoft.com/ja-jp/library/ee419707(v=vs.85).aspx (see Start UAV Slot)
 RWStructuredBuffer <float4> cstex   : register(u1);
-float4                 Time         : register(c0);
+#if ConeStep
+RWStructuredBuffer <float>  cone    : register(u2);  //cs_cone -> cs_main, ConeX * ConeY
+#endif
+#if Sparse && SparseHistory
+RWStructuredBuffer <float4> history : register(u3);  //last frame after cs_resolve
+#endif
+float4                 Time         : register(c0);  //x : time, y : last frame's (< 0 : no history), z : frame, w : scale
+
+//the governor's render size : the camera spans the top left of the buffers
+float2 rendersize() { return float2(ScreenX, ScreenY) * Time.w; }
 
 //--------------------------------------------------------------------------------------
 // gs data
@@ -48,45 +57,8 @@ float3 irep(float3 p, float x) { return (( (p) % (x*2)) - x);     }
 float  fgen(float3 p, float fq, float gain) {
   return gain * (sin(p.x * fq / 2) +  sin(p.y * fq / 2) + sin( 1.7* sin(p.z * fq)));
 }
-float map(in float3 p) {
-  float   k = 2560;
-  float3 tp = p + hash(p) * 0.002;
-  float  fq = 0;
-  fq = 11; float kk  = 0.0125 * (sin(p.x * fq) +  sin(p.y * fq) +  sin(p.z * fq));
-  fq  = 6; float kk2 = 0.0325 * (sin(p.x * fq) +  sin(p.y * fq) +  sin(sin(p.z * fq)));
-  if(1) {
-    float3 ap = tp;
-    rot(ap.xy, Time.x * 0.3);
-    k = (length(abs(ap % 20) - 10) - 3) + kk + kk2;
-  }
-  if(0) {
-    float k1 = (length(abs(tp.yz % 50) - 25) - 4.5) + kk + kk2;
-    float k2 = (length(abs((30. + tp.zx) % 50) - 25) - 4.5) + kk + kk2;
-    float k3 = (length(abs((40. + tp.xy) % 50) - 25) - 4.5) + kk + kk2;
-    k = min(k1, min(k2, min(k3, k)));
-  }
-  
-  if(1) {
-    tp += 5.5;
-    float k1 = (length(abs((tp.yz) % 80) - 40) - 5.5) + kk + kk2;
-    float k2 = (length(abs((tp.zx) % 100) - 50) - 20.5) + kk + kk2;
-    tp.x += sin( 5.4 * sin(tp.z * 0.14 )) * 0.3;
-    tp.y += sin( 7.4 * cos(tp.z * 0.12 ));
-    float k3 = (length(abs((tp.xy) % 30) - 15) - 2.5) + kk + kk2; 
-    k = min(k1, min(k2, min(k3, k)));
-    
-    if(0)
-    {
-      float k6 = (length(abs((tp.xy) % 20) - 10) - 5.25) + kk + kk2;;
-      float k7 = (length(abs((tp.yz) % 20) - 10) - 7.25) + kk + kk2;;
-      float k8 = (length(abs((tp.zx) % 20) - 10) - 5.25) + kk + kk2;;
-      k = max(-k6, k);
-      k = max(-k7, k);
-      k = max(-k8, k);
-    }
-  }
-  return k;
-}
+//generated from map.sdf : sdfc map.sdf map.fxh map_sdf.h
+#include "map.fxh"
 
 float inter(float3 ro, float3 dir, int ite, float cstart, float cend, float mult = 0.95) {
   float  d = cstart;
@@ -100,17 +72,22 @@ float inter(float3 ro, float3 dir, int ite, float cstart, float cend, float mult
 
 
 float3 getnormal(float3 ip) {
+#if MapGrad
+  float3 g;
+  mapgrad(ip, g);
+  return normalize(g);
+#else
   float2 h      = float2(0.0, 0.01);
   return normalize(
     float3(
       map(ip + h.yxx),
       map(ip + h.xyx),
       map(ip + h.xxy)) - map(ip));
+#endif
 }
 
-void getcamera(in float2 suv, out float3 pos, out float3 dir) {
+void getcamera(in float2 suv, in float tm, out float3 pos, out float3 dir) {
   dir = normalize(float3(suv * float2(1.25,  1), 1.0));
-  float  tm  = Time.x;
   if(1)
   {
     rot(dir.xz, tm * 0.042);
@@ -126,18 +103,89 @@ void getcamera(in float2 suv, out float3 pos, out float3 dir) {
   }
 }
 
+void getcamera(in float2 suv, out float3 pos, out float3 dir) {
+  getcamera(suv, Time.x, pos, dir);
+}
+
+//getcamera backwards : render pixel of ip at time tm
+bool project(float3 ip, float tm, out float2 px) {
+  float3 pos, dir;
+  getcamera(0, tm, pos, dir);
+  float3 v = ip - pos;
+  rot(v.yz, -tm * 0.05);
+  rot(v.xz, -tm * 0.042);
+  float2 suv = v.xy / (v.z * float2(1.25, 1));
+  px = float2(suv.x + 1, 1 - suv.y) * rendersize() / 2;
+  return v.z > 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Sparse : cs_main marches half (checkerboard) or one of 2 x 2 of the pixels, in turn
+// per frame, as MarchRowStart in march.h. cs_resolve rebuilds the others.
+//--------------------------------------------------------------------------------------
+#if Sparse
+uint2 sparsepixel(uint2 tid) {
+  uint f = uint(Time.z);
+#if Sparse == 1
+  return uint2(tid.x * 2 + ((tid.y + f) & 1), tid.y);
+#else
+  return uint2(tid.x * 2 + (f & 1), tid.y * 2 + ((f >> 1) & 1));
+#endif
+}
+
+bool sparsemarched(int2 p) {
+  uint f = uint(Time.z);
+#if Sparse == 1
+  return ((uint(p.x + p.y) + f) & 1) == 0;
+#else
+  return uint(p.x & 1) == (f & 1) && uint(p.y & 1) == ((f >> 1) & 1);
+#endif
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Cone prepass : one cone per ConeStep x ConeStep pixels, as wide as their rays.
+// While map() clears its radius nothing is in the cone, cs_main starts there.
+//--------------------------------------------------------------------------------------
+#if ConeStep
+[numthreads(8, 8, 1)]
+void cs_cone(uint3 tid : SV_DispatchThreadID)
+{
+  if(tid.x >= ConeX || tid.y >= ConeY) return;
+  float2 size = rendersize();
+  float  x = -1 + (2 * ((tid.x + 0.5) * ConeStep - 0.5) / size.x);
+  float  y = -1 + (2 * ((tid.y + 0.5) * ConeStep - 0.5) / size.y);
+  float3 pos, dir;
+  getcamera(float2(x, -y), pos, dir);
+  
+  //radius / depth : half the block's diagonal at z = 1
+  float  k = 0.5 * ConeStep * length(float2(2.5, 2.0) / size);
+  float  d = 0;
+  for(int i = 0 ; i < 64 && d <= 1024; i++) {
+    float gap = map(pos + dir * d) - k * d;
+    if(gap < 0.03) break;
+    d += gap / (1 + k);
+  }
+  cone[tid.x + tid.y * ConeX] = d;
+}
+#endif
+
 //--------------------------------------------------------------------------------------
 // Compute Shader
 //--------------------------------------------------------------------------------------
 [numthreads(GroupX, GroupY, 1)]  //tekitou
 void cs_main(uint3 tid : SV_DispatchThreadID)
 {
+#if Sparse
+  if(tid.x >= SparseX || tid.y >= SparseY) return;
+  tid.xy = sparsepixel(tid.xy);
+#endif
   uint   index = tid.x + (tid.y * ScreenX);
   float  tm  = Time.x;
   float  tx  = float(tid.x);
   float  ty  = float(tid.y);
-  float x = -1 + (2 * tx / float(ScreenX));
-  float y = -1 + (2 * ty / float(ScreenY));
+  float x = -1 + (2 * tx / rendersize().x);
+  float y = -1 + (2 * ty / rendersize().y);
   
 	/*
   if(abs(y) > 0.8) {
@@ -150,7 +198,11 @@ void cs_main(uint3 tid : SV_DispatchThreadID)
   float2 uv     = float2(x, -y);
   getcamera(uv, pos, dir);
   
-  float  d      = inter(pos, dir, 64, 0, 0.03, 1.0);
+  float  start  = 0;
+#if ConeStep
+  start = cone[tid.x / ConeStep + (tid.y / ConeStep) * ConeX];
+#endif
+  float  d      = inter(pos, dir, 64, start, 0.03, 1.0);
   if(d > 1024) {
     buffer[index] = d;
     return ;
@@ -165,21 +217,104 @@ void cs_main(uint3 tid : SV_DispatchThreadID)
   float4 result = float4( D * col * S * 0.01, d);
   buffer[index] = result;
 }
+
+//--------------------------------------------------------------------------------------
+// Sparse resolve : a pixel cs_main left takes the nearest depth of the marched ones
+// around it and averages those at that depth. With SparseHistory it moves into the
+// last frame at that depth and takes the colour (bilinear) and depth (nearest) there,
+// clamped to the range of the marched ones, as MarchResolve.
+//--------------------------------------------------------------------------------------
+#if Sparse
+[numthreads(GroupX, GroupY, 1)]
+void cs_resolve(uint3 tid : SV_DispatchThreadID)
+{
+  int2   p = int2(tid.xy);
+  int2   size = int2(ceil(rendersize()));
+  if(p.x >= size.x || p.y >= size.y || sparsemarched(p)) return;
+  int    k    = Sparse == 2 ? 2 : 1;
+  float4 lo   = 1e30, hi = -1e30;
+  for(int v = -k; v <= k; v++) {
+    for(int u = -k; u <= k; u++) {
+      int2 q = p + int2(u, v);
+      if(q.x < 0 || q.y < 0 || q.x >= size.x || q.y >= size.y || !sparsemarched(q)) continue;
+      float4 c = buffer[q.x + q.y * ScreenX];
+      lo = min(lo, c);
+      hi = max(hi, c);
+    }
+  }
+  float  near = lo.w;
+  float4 sum  = 0;
+  for(int v = -k; v <= k; v++) {
+    for(int u = -k; u <= k; u++) {
+      int2 q = p + int2(u, v);
+      if(q.x < 0 || q.y < 0 || q.x >= size.x || q.y >= size.y || !sparsemarched(q)) continue;
+      float4 c = buffer[q.x + q.y * ScreenX];
+      if(c.w <= near * 1.1) sum += float4(c.xyz, 1);
+    }
+  }
+  float4 result = float4(sum.xyz / max(sum.w, 1), near);
+#if SparseHistory
+  float2 rs = rendersize();
+  float3 pos, dir;
+  float2 hp;
+  getcamera(float2(-1 + 2 * p.x / rs.x, 1 - 2 * p.y / rs.y), pos, dir);
+  if(Time.y >= 0 && sum.w > 0 && near <= 1024 && project(pos + dir * near, Time.y, hp) && all(hp >= 0) && all(hp <= size - 1)) {
+    int2   i = min(int2(hp), size - 2);
+    float2 f = hp - i;
+    float4 t[4] = { history[i.x + i.y * ScreenX], history[i.x + 1 + i.y * ScreenX], history[i.x + (i.y + 1) * ScreenX], history[i.x + 1 + (i.y + 1) * ScreenX] };
+    result.xyz = clamp(lerp(lerp(t[0], t[1], f.x), lerp(t[2], t[3], f.x), f.y).xyz, lo.xyz, hi.xyz);
+    
+    //the nearest texel's point, from this camera
+    int2   h = int2(hp + 0.5);
+    float  d = history[h.x + h.y * ScreenX].w;
+    float3 lpos, ldir;
+    getcamera(float2(-1 + 2 * h.x / rs.x, 1 - 2 * h.y / rs.y), Time.y, lpos, ldir);
+    if(d <= 1024) result.w = clamp(length(lpos + ldir * d - pos), lo.w, hi.w);
+  }
+#endif
+  buffer[p.x + p.y * ScreenX] = result;
+}
+#endif
 //--------------------------------------------------------------------------------------
 // put color
 //--------------------------------------------------------------------------------------
+//cstex at screen pixel i, clamped
+float4 fetch(int2 i) {
+  i = clamp(i, 0, int2(ScreenX, ScreenY) - 1);
+  return cstex[i.x + i.y * ScreenX];
+}
+
+//cstex at render pixel q : the upscale from rendersize() to the screen, bilinear as upscale.h
+float4 upscale(float2 q) {
+  float2 m = rendersize() - 1;
+  q = clamp(q, 0, m);
+  int2   i = int2(q);
+  int2   j = min(i + 1, int2(m));
+  float2 f = q - i;
+  float4 t[4] = { cstex[i.x + i.y * ScreenX], cstex[j.x + i.y * ScreenX], cstex[i.x + j.y * ScreenX], cstex[j.x + j.y * ScreenX] };
+  float4 w = float4((1 - f.x) * (1 - f.y), f.x * (1 - f.y), (1 - f.x) * f.y, f.x * f.y);
+  return t[0] * w.x + t[1] * w.y + t[2] * w.z + t[3] * w.w;
+}
+
 float4 ps_main( float4 p : SV_POSITION ) : SV_Target {
   float2  uv = -1 + 2 * float2(p.x, p.y) / float2(ScreenX, ScreenY);
   float   vignette = (1 - dot(uv * 0.5, uv)) * 0.7;
-  uint   index  = uint(p.x + 0) + uint(p.y  + 0) * ScreenX;
-  uint   index1 = uint(p.x + 1) + uint(p.y  + 1) * ScreenX;
-  uint   index2 = uint(p.x + 1) + uint(p.y  +-1) * ScreenX;
-  uint   index3 = uint(p.x +-1) + uint(p.y  + 1) * ScreenX;
-  uint   index4 = uint(p.x +-1) + uint(p.y  +-1) * ScreenX;
-  float3 result = (cstex[index1] + cstex[index2] + cstex[index3] + cstex[index4]).xyz / 4;
-  result = lerp( result, cstex[index].xyz, 0.5 );
+  float   s  = Time.w;                            //a screen pixel in render pixels
+  float4  c;
+  float3  result;
+  if(s == 1) {
+    //full size, nothing to upscale : half way to the 4 diagonals
+    int2 i = int2(p.xy);
+    c      = fetch(i);
+    result = (fetch(i + int2(1, 1)) + fetch(i + int2(1, -1)) + fetch(i + int2(-1, 1)) + fetch(i + int2(-1, -1))).xyz / 4;
+    result = lerp( result, c.xyz, 0.5 );
+  } else {
+    float2  q  = (floor(p.xy) + 0.5) * s - 0.5;   //pixel centres line up
+    c      = upscale(q);
+    result = c.xyz;
+  }
   
-  float depth = cstex[index].w;
+  float depth = c.w;
   //result     *= float3(1.4, 1.04, 1.0);
   result    = pow(result, 0.4545);
   
@@ -1,4 +1,6 @@
 cl /W3 /O2 main.cpp scene.cpp  /EHsc d3d.cpp %1 %2 %3 %4
+cl /W3 /O2 cpumarch.cpp /EHsc %1 %2 %3 %4
+cl /W3 /O2 sdfc.cpp /EHsc %1 %2 %3 %4
 
 
 
@@ -0,0 +1,1381 @@
+//generated by sdfc from map.sdf, do not edit
+#ifndef _MAP_SDF_H_
+#define _MAP_SDF_H_
+
+#include "sdf.h"
+
+enum { SdfMapSize = 127, SdfStaticSize = 97, SdfGateCount = 3 };   //0 : SdfStatic is map(), nothing to bake
+static const float SdfMovingSlack = 0.13499999f;
+
+static const char SdfScene[] =
+  "; map() of main.fx. Edit here, then : sdfc map.sdf map.fxh map_sdf.h\n"
+  "(displace\n"
+  "  (noise 0.0125 11 x y z)\n"
+  "  (noise 0.0325 6 x y z2)\n"
+  "  (jitter 0.002\n"
+  "    (max\n"
+  "      (min\n"
+  "        (rotate xy 0 0.3\n"
+  "          (rep 10 xyz (sphere 3)))\n"
+  "        (off\n"
+  "          (min\n"
+  "            (rep 25 yz (cylinder x 4.5))\n"
+  "            (move 30 0 30 (rep 25 zx (cylinder y 4.5)))\n"
+  "            (move 40 40 0 (rep 25 xy (cylinder z 4.5)))))\n"
+  "        (move 5.5 5.5 5.5\n"
+  "          (min\n"
+  "            (rep 40 yz (cylinder x 5.5))\n"
+  "            (rep 50 zx (cylinder y 20.5))\n"
+  "            (wave x 0.3 5.4 sin 0.14 z\n"
+  "              (wave y 1 7.4 cos 0.12 z\n"
+  "                (rep 15 xy (cylinder z 2.5)))))))\n"
+  "      ; holes through the bars\n"
+  "      (off\n"
+  "        (move 5.5 5.5 5.5\n"
+  "          (wave x 0.3 5.4 sin 0.14 z\n"
+  "            (wave y 1 7.4 cos 0.12 z\n"
+  "              (neg\n"
+  "                (min\n"
+  "                  (rep 10 xy (cylinder z 5.25))\n"
+  "                  (rep 10 yz (cylinder x 7.25))\n"
+  "                  (rep 10 zx (cylinder y 5.25)))))))))))\n"
+  ;
+
+inline float SdfMap(float px, float py, float pz, float time) {
+  float t4 = SdfHash(px);
+  float t5 = 0.00200000009f * t4;
+  float t6 = px + t5;
+  float t7 = py + t5;
+  float t8 = pz + t5;
+  float t11 = 0.300000012f * time;
+  float t12 = cosf(t11);
+  float t13 = sinf(t11);
+  float t14 = t7 * t13;
+  float t15 = t6 * t12;
+  float t16 = t15 - t14;
+  float t17 = t7 * t12;
+  float t18 = t6 * t13;
+  float t19 = t17 + t18;
+  float t21 = fmodf(t16, 20.0f);
+  float t22 = fabsf(t21);
+  float t24 = t22 - 10.0f;
+  float t25 = fmodf(t19, 20.0f);
+  float t26 = fabsf(t25);
+  float t27 = t26 - 10.0f;
+  float t28 = fmodf(t8, 20.0f);
+  float t29 = fabsf(t28);
+  float t30 = t29 - 10.0f;
+  float t32 = t24 * t24;
+  float t33 = t27 * t27;
+  float t34 = t32 + t33;
+  float t35 = t30 * t30;
+  float t36 = t34 + t35;
+  float t37 = sqrtf(t36);
+  float t38 = t37 - 3.0f;
+  float t40 = t6 + 5.5f;
+  float t41 = t7 + 5.5f;
+  float t42 = t8 + 5.5f;
+  float t44 = fmodf(t41, 80.0f);
+  float t45 = fabsf(t44);
+  float t47 = t45 - 40.0f;
+  float t48 = fmodf(t42, 80.0f);
+  float t49 = fabsf(t48);
+  float t50 = t49 - 40.0f;
+  float t51 = t47 * t47;
+  float t52 = t50 * t50;
+  float t53 = t51 + t52;
+  float t54 = sqrtf(t53);
+  float t55 = t54 - 5.5f;
+  float t57 = fmodf(t42, 100.0f);
+  float t58 = fabsf(t57);
+  float t60 = t58 - 50.0f;
+  float t61 = fmodf(t40, 100.0f);
+  float t62 = fabsf(t61);
+  float t63 = t62 - 50.0f;
+  float t65 = t60 * t60;
+  float t66 = t63 * t63;
+  float t67 = t65 + t66;
+  float t68 = sqrtf(t67);
+  float t69 = t68 - 20.5f;
+  float t70 = fminf(t55, t69);
+  float t72 = t42 * 0.140000001f;
+  float t73 = sinf(t72);
+  float t75 = t73 * 5.4000001f;
+  float t76 = sinf(t75);
+  float t77 = 0.300000012f * t76;
+  float t78 = t40 + t77;
+  float t80 = t42 * 0.119999997f;
+  float t81 = cosf(t80);
+  float t83 = t81 * 7.4000001f;
+  float t84 = sinf(t83);
+  float t85 = t41 + t84;
+  float t87 = fmodf(t78, 30.0f);
+  float t88 = fabsf(t87);
+  float t90 = t88 - 15.0f;
+  float t91 = fmodf(t85, 30.0f);
+  float t92 = fabsf(t91);
+  float t93 = t92 - 15.0f;
+  float t95 = t90 * t90;
+  float t96 = t93 * t93;
+  float t97 = t95 + t96;
+  float t98 = sqrtf(t97);
+  float t99 = t98 - 2.5f;
+  float t100 = fminf(t70, t99);
+  float t101 = fminf(t38, t100);
+  float t103 = px * 11.0f;
+  float t104 = sinf(t103);
+  float t105 = py * 11.0f;
+  float t106 = sinf(t105);
+  float t107 = t104 + t106;
+  float t108 = pz * 11.0f;
+  float t109 = sinf(t108);
+  float t110 = t107 + t109;
+  float t112 = t110 * 0.0125000002f;
+  float t113 = t101 + t112;
+  float t115 = px * 6.0f;
+  float t116 = sinf(t115);
+  float t117 = py * 6.0f;
+  float t118 = sinf(t117);
+  float t119 = t116 + t118;
+  float t120 = pz * 6.0f;
+  float t121 = sinf(t120);
+  float t122 = sinf(t121);
+  float t123 = t119 + t122;
+  float t125 = t123 * 0.0324999988f;
+  float t126 = t113 + t125;
+  return t126;
+}
+
+TARGET_AVX2 inline __m256 SdfMap8(__m256 px, __m256 py, __m256 pz, float time) {
+  __m256 t4 = SdfHash8(px);
+  __m256 t5 = _mm256_mul_ps(_mm256_set1_ps(0.00200000009f), t4);
+  __m256 t6 = _mm256_add_ps(px, t5);
+  __m256 t7 = _mm256_add_ps(py, t5);
+  __m256 t8 = _mm256_add_ps(pz, t5);
+  __m256 t11 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), _mm256_set1_ps(time));
+  __m256 t12 = SdfCos8(t11);
+  __m256 t13 = SdfSin8(t11);
+  __m256 t14 = _mm256_mul_ps(t7, t13);
+  __m256 t15 = _mm256_mul_ps(t6, t12);
+  __m256 t16 = _mm256_sub_ps(t15, t14);
+  __m256 t17 = _mm256_mul_ps(t7, t12);
+  __m256 t18 = _mm256_mul_ps(t6, t13);
+  __m256 t19 = _mm256_add_ps(t17, t18);
+  __m256 t21 = SdfMod8(t16, _mm256_set1_ps(20.0f));
+  __m256 t22 = SdfAbs8(t21);
+  __m256 t24 = _mm256_sub_ps(t22, _mm256_set1_ps(10.0f));
+  __m256 t25 = SdfMod8(t19, _mm256_set1_ps(20.0f));
+  __m256 t26 = SdfAbs8(t25);
+  __m256 t27 = _mm256_sub_ps(t26, _mm256_set1_ps(10.0f));
+  __m256 t28 = SdfMod8(t8, _mm256_set1_ps(20.0f));
+  __m256 t29 = SdfAbs8(t28);
+  __m256 t30 = _mm256_sub_ps(t29, _mm256_set1_ps(10.0f));
+  __m256 t32 = _mm256_mul_ps(t24, t24);
+  __m256 t33 = _mm256_mul_ps(t27, t27);
+  __m256 t34 = _mm256_add_ps(t32, t33);
+  __m256 t35 = _mm256_mul_ps(t30, t30);
+  __m256 t36 = _mm256_add_ps(t34, t35);
+  __m256 t37 = _mm256_sqrt_ps(t36);
+  __m256 t38 = _mm256_sub_ps(t37, _mm256_set1_ps(3.0f));
+  __m256 t40 = _mm256_add_ps(t6, _mm256_set1_ps(5.5f));
+  __m256 t41 = _mm256_add_ps(t7, _mm256_set1_ps(5.5f));
+  __m256 t42 = _mm256_add_ps(t8, _mm256_set1_ps(5.5f));
+  __m256 t44 = SdfMod8(t41, _mm256_set1_ps(80.0f));
+  __m256 t45 = SdfAbs8(t44);
+  __m256 t47 = _mm256_sub_ps(t45, _mm256_set1_ps(40.0f));
+  __m256 t48 = SdfMod8(t42, _mm256_set1_ps(80.0f));
+  __m256 t49 = SdfAbs8(t48);
+  __m256 t50 = _mm256_sub_ps(t49, _mm256_set1_ps(40.0f));
+  __m256 t51 = _mm256_mul_ps(t47, t47);
+  __m256 t52 = _mm256_mul_ps(t50, t50);
+  __m256 t53 = _mm256_add_ps(t51, t52);
+  __m256 t54 = _mm256_sqrt_ps(t53);
+  __m256 t55 = _mm256_sub_ps(t54, _mm256_set1_ps(5.5f));
+  __m256 t57 = SdfMod8(t42, _mm256_set1_ps(100.0f));
+  __m256 t58 = SdfAbs8(t57);
+  __m256 t60 = _mm256_sub_ps(t58, _mm256_set1_ps(50.0f));
+  __m256 t61 = SdfMod8(t40, _mm256_set1_ps(100.0f));
+  __m256 t62 = SdfAbs8(t61);
+  __m256 t63 = _mm256_sub_ps(t62, _mm256_set1_ps(50.0f));
+  __m256 t65 = _mm256_mul_ps(t60, t60);
+  __m256 t66 = _mm256_mul_ps(t63, t63);
+  __m256 t67 = _mm256_add_ps(t65, t66);
+  __m256 t68 = _mm256_sqrt_ps(t67);
+  __m256 t69 = _mm256_sub_ps(t68, _mm256_set1_ps(20.5f));
+  __m256 t70 = _mm256_min_ps(t55, t69);
+  __m256 t72 = _mm256_mul_ps(t42, _mm256_set1_ps(0.140000001f));
+  __m256 t73 = SdfSin8(t72);
+  __m256 t75 = _mm256_mul_ps(t73, _mm256_set1_ps(5.4000001f));
+  __m256 t76 = SdfSin8(t75);
+  __m256 t77 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), t76);
+  __m256 t78 = _mm256_add_ps(t40, t77);
+  __m256 t80 = _mm256_mul_ps(t42, _mm256_set1_ps(0.119999997f));
+  __m256 t81 = SdfCos8(t80);
+  __m256 t83 = _mm256_mul_ps(t81, _mm256_set1_ps(7.4000001f));
+  __m256 t84 = SdfSin8(t83);
+  __m256 t85 = _mm256_add_ps(t41, t84);
+  __m256 t87 = SdfMod8(t78, _mm256_set1_ps(30.0f));
+  __m256 t88 = SdfAbs8(t87);
+  __m256 t90 = _mm256_sub_ps(t88, _mm256_set1_ps(15.0f));
+  __m256 t91 = SdfMod8(t85, _mm256_set1_ps(30.0f));
+  __m256 t92 = SdfAbs8(t91);
+  __m256 t93 = _mm256_sub_ps(t92, _mm256_set1_ps(15.0f));
+  __m256 t95 = _mm256_mul_ps(t90, t90);
+  __m256 t96 = _mm256_mul_ps(t93, t93);
+  __m256 t97 = _mm256_add_ps(t95, t96);
+  __m256 t98 = _mm256_sqrt_ps(t97);
+  __m256 t99 = _mm256_sub_ps(t98, _mm256_set1_ps(2.5f));
+  __m256 t100 = _mm256_min_ps(t70, t99);
+  __m256 t101 = _mm256_min_ps(t38, t100);
+  __m256 t103 = _mm256_mul_ps(px, _mm256_set1_ps(11.0f));
+  __m256 t104 = SdfSin8(t103);
+  __m256 t105 = _mm256_mul_ps(py, _mm256_set1_ps(11.0f));
+  __m256 t106 = SdfSin8(t105);
+  __m256 t107 = _mm256_add_ps(t104, t106);
+  __m256 t108 = _mm256_mul_ps(pz, _mm256_set1_ps(11.0f));
+  __m256 t109 = SdfSin8(t108);
+  __m256 t110 = _mm256_add_ps(t107, t109);
+  __m256 t112 = _mm256_mul_ps(t110, _mm256_set1_ps(0.0125000002f));
+  __m256 t113 = _mm256_add_ps(t101, t112);
+  __m256 t115 = _mm256_mul_ps(px, _mm256_set1_ps(6.0f));
+  __m256 t116 = SdfSin8(t115);
+  __m256 t117 = _mm256_mul_ps(py, _mm256_set1_ps(6.0f));
+  __m256 t118 = SdfSin8(t117);
+  __m256 t119 = _mm256_add_ps(t116, t118);
+  __m256 t120 = _mm256_mul_ps(pz, _mm256_set1_ps(6.0f));
+  __m256 t121 = SdfSin8(t120);
+  __m256 t122 = SdfSin8(t121);
+  __m256 t123 = _mm256_add_ps(t119, t122);
+  __m256 t125 = _mm256_mul_ps(t123, _mm256_set1_ps(0.0324999988f));
+  __m256 t126 = _mm256_add_ps(t113, t125);
+  return t126;
+}
+
+inline float SdfMapGrad(float px, float py, float pz, float time, float *g) {
+  float t4 = SdfHash(px);
+  float qx0 = px + 0.00999999978f;
+  float qx1 = px - 0.00999999978f;
+  float qx2 = px - 0.00999999978f;
+  float qx3 = px + 0.00999999978f;
+  float s4_0 = SdfHash(qx0);
+  float s4_1 = SdfHash(qx1);
+  float s4_2 = SdfHash(qx2);
+  float s4_3 = SdfHash(qx3);
+  float g4x = (((s4_0 - s4_1) - s4_2) + s4_3) * 25.0f;
+  float g4y = (((-s4_0 - s4_1) + s4_2) + s4_3) * 25.0f;
+  float g4z = (((-s4_0 + s4_1) - s4_2) + s4_3) * 25.0f;
+  float t5 = 0.00200000009f * t4;
+  float g5x = g4x * 0.00200000009f;
+  float g5y = g4y * 0.00200000009f;
+  float g5z = g4z * 0.00200000009f;
+  float t6 = px + t5;
+  float g6x = 1.0f + g5x;
+  float t7 = py + t5;
+  float g7y = 1.0f + g5y;
+  float t8 = pz + t5;
+  float g8z = 1.0f + g5z;
+  float t11 = 0.300000012f * time;
+  float t12 = cosf(t11);
+  float t13 = sinf(t11);
+  float t14 = t7 * t13;
+  float g14x = g5x * t13;
+  float g14y = g7y * t13;
+  float g14z = g5z * t13;
+  float t15 = t6 * t12;
+  float g15x = g6x * t12;
+  float g15y = g5y * t12;
+  float g15z = g5z * t12;
+  float t16 = t15 - t14;
+  float g16x = g15x - g14x;
+  float g16y = g15y - g14y;
+  float g16z = g15z - g14z;
+  float t17 = t7 * t12;
+  float g17x = g5x * t12;
+  float g17y = g7y * t12;
+  float g17z = g5z * t12;
+  float t18 = t6 * t13;
+  float g18x = g6x * t13;
+  float g18y = g5y * t13;
+  float g18z = g5z * t13;
+  float t19 = t17 + t18;
+  float g19x = g17x + g18x;
+  float g19y = g17y + g18y;
+  float g19z = g17z + g18z;
+  float t21 = fmodf(t16, 20.0f);
+  float t22 = fabsf(t21);
+  bool m22 = t21 < 0;
+  float g22x = m22 ? -g16x : g16x;
+  float g22y = m22 ? -g16y : g16y;
+  float g22z = m22 ? -g16z : g16z;
+  float t24 = t22 - 10.0f;
+  float t25 = fmodf(t19, 20.0f);
+  float t26 = fabsf(t25);
+  bool m26 = t25 < 0;
+  float g26x = m26 ? -g19x : g19x;
+  float g26y = m26 ? -g19y : g19y;
+  float g26z = m26 ? -g19z : g19z;
+  float t27 = t26 - 10.0f;
+  float t28 = fmodf(t8, 20.0f);
+  float t29 = fabsf(t28);
+  bool m29 = t28 < 0;
+  float g29x = m29 ? -g5x : g5x;
+  float g29y = m29 ? -g5y : g5y;
+  float g29z = m29 ? -g8z : g8z;
+  float t30 = t29 - 10.0f;
+  float t32 = t24 * t24;
+  float g32x = (g22x * t24) + (g22x * t24);
+  float g32y = (g22y * t24) + (g22y * t24);
+  float g32z = (g22z * t24) + (g22z * t24);
+  float t33 = t27 * t27;
+  float g33x = (g26x * t27) + (g26x * t27);
+  float g33y = (g26y * t27) + (g26y * t27);
+  float g33z = (g26z * t27) + (g26z * t27);
+  float t34 = t32 + t33;
+  float g34x = g32x + g33x;
+  float g34y = g32y + g33y;
+  float g34z = g32z + g33z;
+  float t35 = t30 * t30;
+  float g35x = (g29x * t30) + (g29x * t30);
+  float g35y = (g29y * t30) + (g29y * t30);
+  float g35z = (g29z * t30) + (g29z * t30);
+  float t36 = t34 + t35;
+  float g36x = g34x + g35x;
+  float g36y = g34y + g35y;
+  float g36z = g34z + g35z;
+  float t37 = sqrtf(t36);
+  float c37 = 0.5f / t37;
+  float g37x = g36x * c37;
+  float g37y = g36y * c37;
+  float g37z = g36z * c37;
+  float t38 = t37 - 3.0f;
+  float t40 = t6 + 5.5f;
+  float t41 = t7 + 5.5f;
+  float t42 = t8 + 5.5f;
+  float t44 = fmodf(t41, 80.0f);
+  float t45 = fabsf(t44);
+  bool m45 = t44 < 0;
+  float g45x = m45 ? -g5x : g5x;
+  float g45y = m45 ? -g7y : g7y;
+  float g45z = m45 ? -g5z : g5z;
+  float t47 = t45 - 40.0f;
+  float t48 = fmodf(t42, 80.0f);
+  float t49 = fabsf(t48);
+  bool m49 = t48 < 0;
+  float g49x = m49 ? -g5x : g5x;
+  float g49y = m49 ? -g5y : g5y;
+  float g49z = m49 ? -g8z : g8z;
+  float t50 = t49 - 40.0f;
+  float t51 = t47 * t47;
+  float g51x = (g45x * t47) + (g45x * t47);
+  float g51y = (g45y * t47) + (g45y * t47);
+  float g51z = (g45z * t47) + (g45z * t47);
+  float t52 = t50 * t50;
+  float g52x = (g49x * t50) + (g49x * t50);
+  float g52y = (g49y * t50) + (g49y * t50);
+  float g52z = (g49z * t50) + (g49z * t50);
+  float t53 = t51 + t52;
+  float g53x = g51x + g52x;
+  float g53y = g51y + g52y;
+  float g53z = g51z + g52z;
+  float t54 = sqrtf(t53);
+  float c54 = 0.5f / t54;
+  float g54x = g53x * c54;
+  float g54y = g53y * c54;
+  float g54z = g53z * c54;
+  float t55 = t54 - 5.5f;
+  float t57 = fmodf(t42, 100.0f);
+  float t58 = fabsf(t57);
+  bool m58 = t57 < 0;
+  float g58x = m58 ? -g5x : g5x;
+  float g58y = m58 ? -g5y : g5y;
+  float g58z = m58 ? -g8z : g8z;
+  float t60 = t58 - 50.0f;
+  float t61 = fmodf(t40, 100.0f);
+  float t62 = fabsf(t61);
+  bool m62 = t61 < 0;
+  float g62x = m62 ? -g6x : g6x;
+  float g62y = m62 ? -g5y : g5y;
+  float g62z = m62 ? -g5z : g5z;
+  float t63 = t62 - 50.0f;
+  float t65 = t60 * t60;
+  float g65x = (g58x * t60) + (g58x * t60);
+  float g65y = (g58y * t60) + (g58y * t60);
+  float g65z = (g58z * t60) + (g58z * t60);
+  float t66 = t63 * t63;
+  float g66x = (g62x * t63) + (g62x * t63);
+  float g66y = (g62y * t63) + (g62y * t63);
+  float g66z = (g62z * t63) + (g62z * t63);
+  float t67 = t65 + t66;
+  float g67x = g65x + g66x;
+  float g67y = g65y + g66y;
+  float g67z = g65z + g66z;
+  float t68 = sqrtf(t67);
+  float c68 = 0.5f / t68;
+  float g68x = g67x * c68;
+  float g68y = g67y * c68;
+  float g68z = g67z * c68;
+  float t69 = t68 - 20.5f;
+  float t70 = fminf(t55, t69);
+  bool m70 = t55 < t69;
+  float g70x = m70 ? g54x : g68x;
+  float g70y = m70 ? g54y : g68y;
+  float g70z = m70 ? g54z : g68z;
+  float t72 = t42 * 0.140000001f;
+  float g72x = g5x * 0.140000001f;
+  float g72y = g5y * 0.140000001f;
+  float g72z = g8z * 0.140000001f;
+  float t73 = sinf(t72);
+  float c73 = cosf(t72);
+  float g73x = g72x * c73;
+  float g73y = g72y * c73;
+  float g73z = g72z * c73;
+  float t75 = t73 * 5.4000001f;
+  float g75x = g73x * 5.4000001f;
+  float g75y = g73y * 5.4000001f;
+  float g75z = g73z * 5.4000001f;
+  float t76 = sinf(t75);
+  float c76 = cosf(t75);
+  float g76x = g75x * c76;
+  float g76y = g75y * c76;
+  float g76z = g75z * c76;
+  float t77 = 0.300000012f * t76;
+  float g77x = g76x * 0.300000012f;
+  float g77y = g76y * 0.300000012f;
+  float g77z = g76z * 0.300000012f;
+  float t78 = t40 + t77;
+  float g78x = g6x + g77x;
+  float g78y = g5y + g77y;
+  float g78z = g5z + g77z;
+  float t80 = t42 * 0.119999997f;
+  float g80x = g5x * 0.119999997f;
+  float g80y = g5y * 0.119999997f;
+  float g80z = g8z * 0.119999997f;
+  float t81 = cosf(t80);
+  float c81 = -sinf(t80);
+  float g81x = g80x * c81;
+  float g81y = g80y * c81;
+  float g81z = g80z * c81;
+  float t83 = t81 * 7.4000001f;
+  float g83x = g81x * 7.4000001f;
+  float g83y = g81y * 7.4000001f;
+  float g83z = g81z * 7.4000001f;
+  float t84 = sinf(t83);
+  float c84 = cosf(t83);
+  float g84x = g83x * c84;
+  float g84y = g83y * c84;
+  float g84z = g83z * c84;
+  float t85 = t41 + t84;
+  float g85x = g5x + g84x;
+  float g85y = g7y + g84y;
+  float g85z = g5z + g84z;
+  float t87 = fmodf(t78, 30.0f);
+  float t88 = fabsf(t87);
+  bool m88 = t87 < 0;
+  float g88x = m88 ? -g78x : g78x;
+  float g88y = m88 ? -g78y : g78y;
+  float g88z = m88 ? -g78z : g78z;
+  float t90 = t88 - 15.0f;
+  float t91 = fmodf(t85, 30.0f);
+  float t92 = fabsf(t91);
+  bool m92 = t91 < 0;
+  float g92x = m92 ? -g85x : g85x;
+  float g92y = m92 ? -g85y : g85y;
+  float g92z = m92 ? -g85z : g85z;
+  float t93 = t92 - 15.0f;
+  float t95 = t90 * t90;
+  float g95x = (g88x * t90) + (g88x * t90);
+  float g95y = (g88y * t90) + (g88y * t90);
+  float g95z = (g88z * t90) + (g88z * t90);
+  float t96 = t93 * t93;
+  float g96x = (g92x * t93) + (g92x * t93);
+  float g96y = (g92y * t93) + (g92y * t93);
+  float g96z = (g92z * t93) + (g92z * t93);
+  float t97 = t95 + t96;
+  float g97x = g95x + g96x;
+  float g97y = g95y + g96y;
+  float g97z = g95z + g96z;
+  float t98 = sqrtf(t97);
+  float c98 = 0.5f / t98;
+  float g98x = g97x * c98;
+  float g98y = g97y * c98;
+  float g98z = g97z * c98;
+  float t99 = t98 - 2.5f;
+  float t100 = fminf(t70, t99);
+  bool m100 = t70 < t99;
+  float g100x = m100 ? g70x : g98x;
+  float g100y = m100 ? g70y : g98y;
+  float g100z = m100 ? g70z : g98z;
+  float t101 = fminf(t38, t100);
+  bool m101 = t38 < t100;
+  float g101x = m101 ? g37x : g100x;
+  float g101y = m101 ? g37y : g100y;
+  float g101z = m101 ? g37z : g100z;
+  float t103 = px * 11.0f;
+  float t104 = sinf(t103);
+  float c104 = cosf(t103);
+  float g104x = 11.0f * c104;
+  float t105 = py * 11.0f;
+  float t106 = sinf(t105);
+  float c106 = cosf(t105);
+  float g106y = 11.0f * c106;
+  float t107 = t104 + t106;
+  float t108 = pz * 11.0f;
+  float t109 = sinf(t108);
+  float c109 = cosf(t108);
+  float g109z = 11.0f * c109;
+  float t110 = t107 + t109;
+  float t112 = t110 * 0.0125000002f;
+  float g112x = g104x * 0.0125000002f;
+  float g112y = g106y * 0.0125000002f;
+  float g112z = g109z * 0.0125000002f;
+  float t113 = t101 + t112;
+  float g113x = g101x + g112x;
+  float g113y = g101y + g112y;
+  float g113z = g101z + g112z;
+  float t115 = px * 6.0f;
+  float t116 = sinf(t115);
+  float c116 = cosf(t115);
+  float g116x = 6.0f * c116;
+  float t117 = py * 6.0f;
+  float t118 = sinf(t117);
+  float c118 = cosf(t117);
+  float g118y = 6.0f * c118;
+  float t119 = t116 + t118;
+  float t120 = pz * 6.0f;
+  float t121 = sinf(t120);
+  float c121 = cosf(t120);
+  float g121z = 6.0f * c121;
+  float t122 = sinf(t121);
+  float c122 = cosf(t121);
+  float g122z = g121z * c122;
+  float t123 = t119 + t122;
+  float t125 = t123 * 0.0324999988f;
+  float g125x = g116x * 0.0324999988f;
+  float g125y = g118y * 0.0324999988f;
+  float g125z = g122z * 0.0324999988f;
+  float t126 = t113 + t125;
+  float g126x = g113x + g125x;
+  float g126y = g113y + g125y;
+  float g126z = g113z + g125z;
+  g[0] = g126x;
+  g[1] = g126y;
+  g[2] = g126z;
+  return t126;
+}
+
+TARGET_AVX2 inline __m256 SdfMapGrad8(__m256 px, __m256 py, __m256 pz, float time, __m256 *g) {
+  __m256 t4 = SdfHashGrad8(px);
+  __m256 qx0 = _mm256_add_ps(px, _mm256_set1_ps(0.00999999978f));
+  __m256 qx1 = _mm256_sub_ps(px, _mm256_set1_ps(0.00999999978f));
+  __m256 qx2 = _mm256_sub_ps(px, _mm256_set1_ps(0.00999999978f));
+  __m256 qx3 = _mm256_add_ps(px, _mm256_set1_ps(0.00999999978f));
+  __m256 s4_0 = SdfHashGrad8(qx0);
+  __m256 s4_1 = SdfHashGrad8(qx1);
+  __m256 s4_2 = SdfHashGrad8(qx2);
+  __m256 s4_3 = SdfHashGrad8(qx3);
+  __m256 g4x = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(s4_0, s4_1), s4_2), s4_3), _mm256_set1_ps(25.0f));
+  __m256 g4y = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_sub_ps(SdfNeg8(s4_0), s4_1), s4_2), s4_3), _mm256_set1_ps(25.0f));
+  __m256 g4z = _mm256_mul_ps(_mm256_add_ps(_mm256_sub_ps(_mm256_add_ps(SdfNeg8(s4_0), s4_1), s4_2), s4_3), _mm256_set1_ps(25.0f));
+  __m256 t5 = _mm256_mul_ps(_mm256_set1_ps(0.00200000009f), t4);
+  __m256 g5x = _mm256_mul_ps(g4x, _mm256_set1_ps(0.00200000009f));
+  __m256 g5y = _mm256_mul_ps(g4y, _mm256_set1_ps(0.00200000009f));
+  __m256 g5z = _mm256_mul_ps(g4z, _mm256_set1_ps(0.00200000009f));
+  __m256 t6 = _mm256_add_ps(px, t5);
+  __m256 g6x = _mm256_add_ps(_mm256_set1_ps(1.0f), g5x);
+  __m256 t7 = _mm256_add_ps(py, t5);
+  __m256 g7y = _mm256_add_ps(_mm256_set1_ps(1.0f), g5y);
+  __m256 t8 = _mm256_add_ps(pz, t5);
+  __m256 g8z = _mm256_add_ps(_mm256_set1_ps(1.0f), g5z);
+  __m256 t11 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), _mm256_set1_ps(time));
+  __m256 t12 = SdfCos8(t11);
+  __m256 t13 = SdfSin8(t11);
+  __m256 t14 = _mm256_mul_ps(t7, t13);
+  __m256 g14x = _mm256_mul_ps(g5x, t13);
+  __m256 g14y = _mm256_mul_ps(g7y, t13);
+  __m256 g14z = _mm256_mul_ps(g5z, t13);
+  __m256 t15 = _mm256_mul_ps(t6, t12);
+  __m256 g15x = _mm256_mul_ps(g6x, t12);
+  __m256 g15y = _mm256_mul_ps(g5y, t12);
+  __m256 g15z = _mm256_mul_ps(g5z, t12);
+  __m256 t16 = _mm256_sub_ps(t15, t14);
+  __m256 g16x = _mm256_sub_ps(g15x, g14x);
+  __m256 g16y = _mm256_sub_ps(g15y, g14y);
+  __m256 g16z = _mm256_sub_ps(g15z, g14z);
+  __m256 t17 = _mm256_mul_ps(t7, t12);
+  __m256 g17x = _mm256_mul_ps(g5x, t12);
+  __m256 g17y = _mm256_mul_ps(g7y, t12);
+  __m256 g17z = _mm256_mul_ps(g5z, t12);
+  __m256 t18 = _mm256_mul_ps(t6, t13);
+  __m256 g18x = _mm256_mul_ps(g6x, t13);
+  __m256 g18y = _mm256_mul_ps(g5y, t13);
+  __m256 g18z = _mm256_mul_ps(g5z, t13);
+  __m256 t19 = _mm256_add_ps(t17, t18);
+  __m256 g19x = _mm256_add_ps(g17x, g18x);
+  __m256 g19y = _mm256_add_ps(g17y, g18y);
+  __m256 g19z = _mm256_add_ps(g17z, g18z);
+  __m256 t21 = SdfMod8(t16, _mm256_set1_ps(20.0f));
+  __m256 t22 = SdfAbs8(t21);
+  __m256 m22 = _mm256_and_ps(t21, _mm256_set1_ps(-0.0f));
+  __m256 g22x = _mm256_xor_ps(g16x, m22);
+  __m256 g22y = _mm256_xor_ps(g16y, m22);
+  __m256 g22z = _mm256_xor_ps(g16z, m22);
+  __m256 t24 = _mm256_sub_ps(t22, _mm256_set1_ps(10.0f));
+  __m256 t25 = SdfMod8(t19, _mm256_set1_ps(20.0f));
+  __m256 t26 = SdfAbs8(t25);
+  __m256 m26 = _mm256_and_ps(t25, _mm256_set1_ps(-0.0f));
+  __m256 g26x = _mm256_xor_ps(g19x, m26);
+  __m256 g26y = _mm256_xor_ps(g19y, m26);
+  __m256 g26z = _mm256_xor_ps(g19z, m26);
+  __m256 t27 = _mm256_sub_ps(t26, _mm256_set1_ps(10.0f));
+  __m256 t28 = SdfMod8(t8, _mm256_set1_ps(20.0f));
+  __m256 t29 = SdfAbs8(t28);
+  __m256 m29 = _mm256_and_ps(t28, _mm256_set1_ps(-0.0f));
+  __m256 g29x = _mm256_xor_ps(g5x, m29);
+  __m256 g29y = _mm256_xor_ps(g5y, m29);
+  __m256 g29z = _mm256_xor_ps(g8z, m29);
+  __m256 t30 = _mm256_sub_ps(t29, _mm256_set1_ps(10.0f));
+  __m256 t32 = _mm256_mul_ps(t24, t24);
+  __m256 g32x = _mm256_add_ps(_mm256_mul_ps(g22x, t24), _mm256_mul_ps(g22x, t24));
+  __m256 g32y = _mm256_add_ps(_mm256_mul_ps(g22y, t24), _mm256_mul_ps(g22y, t24));
+  __m256 g32z = _mm256_add_ps(_mm256_mul_ps(g22z, t24), _mm256_mul_ps(g22z, t24));
+  __m256 t33 = _mm256_mul_ps(t27, t27);
+  __m256 g33x = _mm256_add_ps(_mm256_mul_ps(g26x, t27), _mm256_mul_ps(g26x, t27));
+  __m256 g33y = _mm256_add_ps(_mm256_mul_ps(g26y, t27), _mm256_mul_ps(g26y, t27));
+  __m256 g33z = _mm256_add_ps(_mm256_mul_ps(g26z, t27), _mm256_mul_ps(g26z, t27));
+  __m256 t34 = _mm256_add_ps(t32, t33);
+  __m256 g34x = _mm256_add_ps(g32x, g33x);
+  __m256 g34y = _mm256_add_ps(g32y, g33y);
+  __m256 g34z = _mm256_add_ps(g32z, g33z);
+  __m256 t35 = _mm256_mul_ps(t30, t30);
+  __m256 g35x = _mm256_add_ps(_mm256_mul_ps(g29x, t30), _mm256_mul_ps(g29x, t30));
+  __m256 g35y = _mm256_add_ps(_mm256_mul_ps(g29y, t30), _mm256_mul_ps(g29y, t30));
+  __m256 g35z = _mm256_add_ps(_mm256_mul_ps(g29z, t30), _mm256_mul_ps(g29z, t30));
+  __m256 t36 = _mm256_add_ps(t34, t35);
+  __m256 g36x = _mm256_add_ps(g34x, g35x);
+  __m256 g36y = _mm256_add_ps(g34y, g35y);
+  __m256 g36z = _mm256_add_ps(g34z, g35z);
+  __m256 t37 = _mm256_sqrt_ps(t36);
+  __m256 c37 = _mm256_div_ps(_mm256_set1_ps(0.5f), t37);
+  __m256 g37x = _mm256_mul_ps(g36x, c37);
+  __m256 g37y = _mm256_mul_ps(g36y, c37);
+  __m256 g37z = _mm256_mul_ps(g36z, c37);
+  __m256 t38 = _mm256_sub_ps(t37, _mm256_set1_ps(3.0f));
+  __m256 t40 = _mm256_add_ps(t6, _mm256_set1_ps(5.5f));
+  __m256 t41 = _mm256_add_ps(t7, _mm256_set1_ps(5.5f));
+  __m256 t42 = _mm256_add_ps(t8, _mm256_set1_ps(5.5f));
+  __m256 t44 = SdfMod8(t41, _mm256_set1_ps(80.0f));
+  __m256 t45 = SdfAbs8(t44);
+  __m256 m45 = _mm256_and_ps(t44, _mm256_set1_ps(-0.0f));
+  __m256 g45x = _mm256_xor_ps(g5x, m45);
+  __m256 g45y = _mm256_xor_ps(g7y, m45);
+  __m256 g45z = _mm256_xor_ps(g5z, m45);
+  __m256 t47 = _mm256_sub_ps(t45, _mm256_set1_ps(40.0f));
+  __m256 t48 = SdfMod8(t42, _mm256_set1_ps(80.0f));
+  __m256 t49 = SdfAbs8(t48);
+  __m256 m49 = _mm256_and_ps(t48, _mm256_set1_ps(-0.0f));
+  __m256 g49x = _mm256_xor_ps(g5x, m49);
+  __m256 g49y = _mm256_xor_ps(g5y, m49);
+  __m256 g49z = _mm256_xor_ps(g8z, m49);
+  __m256 t50 = _mm256_sub_ps(t49, _mm256_set1_ps(40.0f));
+  __m256 t51 = _mm256_mul_ps(t47, t47);
+  __m256 g51x = _mm256_add_ps(_mm256_mul_ps(g45x, t47), _mm256_mul_ps(g45x, t47));
+  __m256 g51y = _mm256_add_ps(_mm256_mul_ps(g45y, t47), _mm256_mul_ps(g45y, t47));
+  __m256 g51z = _mm256_add_ps(_mm256_mul_ps(g45z, t47), _mm256_mul_ps(g45z, t47));
+  __m256 t52 = _mm256_mul_ps(t50, t50);
+  __m256 g52x = _mm256_add_ps(_mm256_mul_ps(g49x, t50), _mm256_mul_ps(g49x, t50));
+  __m256 g52y = _mm256_add_ps(_mm256_mul_ps(g49y, t50), _mm256_mul_ps(g49y, t50));
+  __m256 g52z = _mm256_add_ps(_mm256_mul_ps(g49z, t50), _mm256_mul_ps(g49z, t50));
+  __m256 t53 = _mm256_add_ps(t51, t52);
+  __m256 g53x = _mm256_add_ps(g51x, g52x);
+  __m256 g53y = _mm256_add_ps(g51y, g52y);
+  __m256 g53z = _mm256_add_ps(g51z, g52z);
+  __m256 t54 = _mm256_sqrt_ps(t53);
+  __m256 c54 = _mm256_div_ps(_mm256_set1_ps(0.5f), t54);
+  __m256 g54x = _mm256_mul_ps(g53x, c54);
+  __m256 g54y = _mm256_mul_ps(g53y, c54);
+  __m256 g54z = _mm256_mul_ps(g53z, c54);
+  __m256 t55 = _mm256_sub_ps(t54, _mm256_set1_ps(5.5f));
+  __m256 t57 = SdfMod8(t42, _mm256_set1_ps(100.0f));
+  __m256 t58 = SdfAbs8(t57);
+  __m256 m58 = _mm256_and_ps(t57, _mm256_set1_ps(-0.0f));
+  __m256 g58x = _mm256_xor_ps(g5x, m58);
+  __m256 g58y = _mm256_xor_ps(g5y, m58);
+  __m256 g58z = _mm256_xor_ps(g8z, m58);
+  __m256 t60 = _mm256_sub_ps(t58, _mm256_set1_ps(50.0f));
+  __m256 t61 = SdfMod8(t40, _mm256_set1_ps(100.0f));
+  __m256 t62 = SdfAbs8(t61);
+  __m256 m62 = _mm256_and_ps(t61, _mm256_set1_ps(-0.0f));
+  __m256 g62x = _mm256_xor_ps(g6x, m62);
+  __m256 g62y = _mm256_xor_ps(g5y, m62);
+  __m256 g62z = _mm256_xor_ps(g5z, m62);
+  __m256 t63 = _mm256_sub_ps(t62, _mm256_set1_ps(50.0f));
+  __m256 t65 = _mm256_mul_ps(t60, t60);
+  __m256 g65x = _mm256_add_ps(_mm256_mul_ps(g58x, t60), _mm256_mul_ps(g58x, t60));
+  __m256 g65y = _mm256_add_ps(_mm256_mul_ps(g58y, t60), _mm256_mul_ps(g58y, t60));
+  __m256 g65z = _mm256_add_ps(_mm256_mul_ps(g58z, t60), _mm256_mul_ps(g58z, t60));
+  __m256 t66 = _mm256_mul_ps(t63, t63);
+  __m256 g66x = _mm256_add_ps(_mm256_mul_ps(g62x, t63), _mm256_mul_ps(g62x, t63));
+  __m256 g66y = _mm256_add_ps(_mm256_mul_ps(g62y, t63), _mm256_mul_ps(g62y, t63));
+  __m256 g66z = _mm256_add_ps(_mm256_mul_ps(g62z, t63), _mm256_mul_ps(g62z, t63));
+  __m256 t67 = _mm256_add_ps(t65, t66);
+  __m256 g67x = _mm256_add_ps(g65x, g66x);
+  __m256 g67y = _mm256_add_ps(g65y, g66y);
+  __m256 g67z = _mm256_add_ps(g65z, g66z);
+  __m256 t68 = _mm256_sqrt_ps(t67);
+  __m256 c68 = _mm256_div_ps(_mm256_set1_ps(0.5f), t68);
+  __m256 g68x = _mm256_mul_ps(g67x, c68);
+  __m256 g68y = _mm256_mul_ps(g67y, c68);
+  __m256 g68z = _mm256_mul_ps(g67z, c68);
+  __m256 t69 = _mm256_sub_ps(t68, _mm256_set1_ps(20.5f));
+  __m256 t70 = _mm256_min_ps(t55, t69);
+  __m256 m70 = _mm256_cmp_ps(t55, t69, _CMP_LT_OQ);
+  __m256 g70x = _mm256_blendv_ps(g68x, g54x, m70);
+  __m256 g70y = _mm256_blendv_ps(g68y, g54y, m70);
+  __m256 g70z = _mm256_blendv_ps(g68z, g54z, m70);
+  __m256 t72 = _mm256_mul_ps(t42, _mm256_set1_ps(0.140000001f));
+  __m256 g72x = _mm256_mul_ps(g5x, _mm256_set1_ps(0.140000001f));
+  __m256 g72y = _mm256_mul_ps(g5y, _mm256_set1_ps(0.140000001f));
+  __m256 g72z = _mm256_mul_ps(g8z, _mm256_set1_ps(0.140000001f));
+  __m256 t73, c73;
+  SinCos8(t72, &t73, &c73);
+  __m256 g73x = _mm256_mul_ps(g72x, c73);
+  __m256 g73y = _mm256_mul_ps(g72y, c73);
+  __m256 g73z = _mm256_mul_ps(g72z, c73);
+  __m256 t75 = _mm256_mul_ps(t73, _mm256_set1_ps(5.4000001f));
+  __m256 g75x = _mm256_mul_ps(g73x, _mm256_set1_ps(5.4000001f));
+  __m256 g75y = _mm256_mul_ps(g73y, _mm256_set1_ps(5.4000001f));
+  __m256 g75z = _mm256_mul_ps(g73z, _mm256_set1_ps(5.4000001f));
+  __m256 t76, c76;
+  SinCos8(t75, &t76, &c76);
+  __m256 g76x = _mm256_mul_ps(g75x, c76);
+  __m256 g76y = _mm256_mul_ps(g75y, c76);
+  __m256 g76z = _mm256_mul_ps(g75z, c76);
+  __m256 t77 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), t76);
+  __m256 g77x = _mm256_mul_ps(g76x, _mm256_set1_ps(0.300000012f));
+  __m256 g77y = _mm256_mul_ps(g76y, _mm256_set1_ps(0.300000012f));
+  __m256 g77z = _mm256_mul_ps(g76z, _mm256_set1_ps(0.300000012f));
+  __m256 t78 = _mm256_add_ps(t40, t77);
+  __m256 g78x = _mm256_add_ps(g6x, g77x);
+  __m256 g78y = _mm256_add_ps(g5y, g77y);
+  __m256 g78z = _mm256_add_ps(g5z, g77z);
+  __m256 t80 = _mm256_mul_ps(t42, _mm256_set1_ps(0.119999997f));
+  __m256 g80x = _mm256_mul_ps(g5x, _mm256_set1_ps(0.119999997f));
+  __m256 g80y = _mm256_mul_ps(g5y, _mm256_set1_ps(0.119999997f));
+  __m256 g80z = _mm256_mul_ps(g8z, _mm256_set1_ps(0.119999997f));
+  __m256 t81, c81;
+  SinCos8(t80, &c81, &t81);
+  c81 = SdfNeg8(c81);
+  __m256 g81x = _mm256_mul_ps(g80x, c81);
+  __m256 g81y = _mm256_mul_ps(g80y, c81);
+  __m256 g81z = _mm256_mul_ps(g80z, c81);
+  __m256 t83 = _mm256_mul_ps(t81, _mm256_set1_ps(7.4000001f));
+  __m256 g83x = _mm256_mul_ps(g81x, _mm256_set1_ps(7.4000001f));
+  __m256 g83y = _mm256_mul_ps(g81y, _mm256_set1_ps(7.4000001f));
+  __m256 g83z = _mm256_mul_ps(g81z, _mm256_set1_ps(7.4000001f));
+  __m256 t84, c84;
+  SinCos8(t83, &t84, &c84);
+  __m256 g84x = _mm256_mul_ps(g83x, c84);
+  __m256 g84y = _mm256_mul_ps(g83y, c84);
+  __m256 g84z = _mm256_mul_ps(g83z, c84);
+  __m256 t85 = _mm256_add_ps(t41, t84);
+  __m256 g85x = _mm256_add_ps(g5x, g84x);
+  __m256 g85y = _mm256_add_ps(g7y, g84y);
+  __m256 g85z = _mm256_add_ps(g5z, g84z);
+  __m256 t87 = SdfMod8(t78, _mm256_set1_ps(30.0f));
+  __m256 t88 = SdfAbs8(t87);
+  __m256 m88 = _mm256_and_ps(t87, _mm256_set1_ps(-0.0f));
+  __m256 g88x = _mm256_xor_ps(g78x, m88);
+  __m256 g88y = _mm256_xor_ps(g78y, m88);
+  __m256 g88z = _mm256_xor_ps(g78z, m88);
+  __m256 t90 = _mm256_sub_ps(t88, _mm256_set1_ps(15.0f));
+  __m256 t91 = SdfMod8(t85, _mm256_set1_ps(30.0f));
+  __m256 t92 = SdfAbs8(t91);
+  __m256 m92 = _mm256_and_ps(t91, _mm256_set1_ps(-0.0f));
+  __m256 g92x = _mm256_xor_ps(g85x, m92);
+  __m256 g92y = _mm256_xor_ps(g85y, m92);
+  __m256 g92z = _mm256_xor_ps(g85z, m92);
+  __m256 t93 = _mm256_sub_ps(t92, _mm256_set1_ps(15.0f));
+  __m256 t95 = _mm256_mul_ps(t90, t90);
+  __m256 g95x = _mm256_add_ps(_mm256_mul_ps(g88x, t90), _mm256_mul_ps(g88x, t90));
+  __m256 g95y = _mm256_add_ps(_mm256_mul_ps(g88y, t90), _mm256_mul_ps(g88y, t90));
+  __m256 g95z = _mm256_add_ps(_mm256_mul_ps(g88z, t90), _mm256_mul_ps(g88z, t90));
+  __m256 t96 = _mm256_mul_ps(t93, t93);
+  __m256 g96x = _mm256_add_ps(_mm256_mul_ps(g92x, t93), _mm256_mul_ps(g92x, t93));
+  __m256 g96y = _mm256_add_ps(_mm256_mul_ps(g92y, t93), _mm256_mul_ps(g92y, t93));
+  __m256 g96z = _mm256_add_ps(_mm256_mul_ps(g92z, t93), _mm256_mul_ps(g92z, t93));
+  __m256 t97 = _mm256_add_ps(t95, t96);
+  __m256 g97x = _mm256_add_ps(g95x, g96x);
+  __m256 g97y = _mm256_add_ps(g95y, g96y);
+  __m256 g97z = _mm256_add_ps(g95z, g96z);
+  __m256 t98 = _mm256_sqrt_ps(t97);
+  __m256 c98 = _mm256_div_ps(_mm256_set1_ps(0.5f), t98);
+  __m256 g98x = _mm256_mul_ps(g97x, c98);
+  __m256 g98y = _mm256_mul_ps(g97y, c98);
+  __m256 g98z = _mm256_mul_ps(g97z, c98);
+  __m256 t99 = _mm256_sub_ps(t98, _mm256_set1_ps(2.5f));
+  __m256 t100 = _mm256_min_ps(t70, t99);
+  __m256 m100 = _mm256_cmp_ps(t70, t99, _CMP_LT_OQ);
+  __m256 g100x = _mm256_blendv_ps(g98x, g70x, m100);
+  __m256 g100y = _mm256_blendv_ps(g98y, g70y, m100);
+  __m256 g100z = _mm256_blendv_ps(g98z, g70z, m100);
+  __m256 t101 = _mm256_min_ps(t38, t100);
+  __m256 m101 = _mm256_cmp_ps(t38, t100, _CMP_LT_OQ);
+  __m256 g101x = _mm256_blendv_ps(g100x, g37x, m101);
+  __m256 g101y = _mm256_blendv_ps(g100y, g37y, m101);
+  __m256 g101z = _mm256_blendv_ps(g100z, g37z, m101);
+  __m256 t103 = _mm256_mul_ps(px, _mm256_set1_ps(11.0f));
+  __m256 g103x = _mm256_set1_ps(11.0f);
+  __m256 t104, c104;
+  SinCos8(t103, &t104, &c104);
+  __m256 g104x = _mm256_mul_ps(g103x, c104);
+  __m256 t105 = _mm256_mul_ps(py, _mm256_set1_ps(11.0f));
+  __m256 g105y = _mm256_set1_ps(11.0f);
+  __m256 t106, c106;
+  SinCos8(t105, &t106, &c106);
+  __m256 g106y = _mm256_mul_ps(g105y, c106);
+  __m256 t107 = _mm256_add_ps(t104, t106);
+  __m256 t108 = _mm256_mul_ps(pz, _mm256_set1_ps(11.0f));
+  __m256 g108z = _mm256_set1_ps(11.0f);
+  __m256 t109, c109;
+  SinCos8(t108, &t109, &c109);
+  __m256 g109z = _mm256_mul_ps(g108z, c109);
+  __m256 t110 = _mm256_add_ps(t107, t109);
+  __m256 t112 = _mm256_mul_ps(t110, _mm256_set1_ps(0.0125000002f));
+  __m256 g112x = _mm256_mul_ps(g104x, _mm256_set1_ps(0.0125000002f));
+  __m256 g112y = _mm256_mul_ps(g106y, _mm256_set1_ps(0.0125000002f));
+  __m256 g112z = _mm256_mul_ps(g109z, _mm256_set1_ps(0.0125000002f));
+  __m256 t113 = _mm256_add_ps(t101, t112);
+  __m256 g113x = _mm256_add_ps(g101x, g112x);
+  __m256 g113y = _mm256_add_ps(g101y, g112y);
+  __m256 g113z = _mm256_add_ps(g101z, g112z);
+  __m256 t115 = _mm256_mul_ps(px, _mm256_set1_ps(6.0f));
+  __m256 g115x = _mm256_set1_ps(6.0f);
+  __m256 t116, c116;
+  SinCos8(t115, &t116, &c116);
+  __m256 g116x = _mm256_mul_ps(g115x, c116);
+  __m256 t117 = _mm256_mul_ps(py, _mm256_set1_ps(6.0f));
+  __m256 g117y = _mm256_set1_ps(6.0f);
+  __m256 t118, c118;
+  SinCos8(t117, &t118, &c118);
+  __m256 g118y = _mm256_mul_ps(g117y, c118);
+  __m256 t119 = _mm256_add_ps(t116, t118);
+  __m256 t120 = _mm256_mul_ps(pz, _mm256_set1_ps(6.0f));
+  __m256 g120z = _mm256_set1_ps(6.0f);
+  __m256 t121, c121;
+  SinCos8(t120, &t121, &c121);
+  __m256 g121z = _mm256_mul_ps(g120z, c121);
+  __m256 t122, c122;
+  SinCos8(t121, &t122, &c122);
+  __m256 g122z = _mm256_mul_ps(g121z, c122);
+  __m256 t123 = _mm256_add_ps(t119, t122);
+  __m256 t125 = _mm256_mul_ps(t123, _mm256_set1_ps(0.0324999988f));
+  __m256 g125x = _mm256_mul_ps(g116x, _mm256_set1_ps(0.0324999988f));
+  __m256 g125y = _mm256_mul_ps(g118y, _mm256_set1_ps(0.0324999988f));
+  __m256 g125z = _mm256_mul_ps(g122z, _mm256_set1_ps(0.0324999988f));
+  __m256 t126 = _mm256_add_ps(t113, t125);
+  __m256 g126x = _mm256_add_ps(g113x, g125x);
+  __m256 g126y = _mm256_add_ps(g113y, g125y);
+  __m256 g126z = _mm256_add_ps(g113z, g125z);
+  g[0] = g126x;
+  g[1] = g126y;
+  g[2] = g126z;
+  return t126;
+}
+
+inline float SdfStatic(float px, float py, float pz, float time) {
+  (void)time;
+  float t4 = SdfHash(px);
+  float t5 = 0.00200000009f * t4;
+  float t6 = px + t5;
+  float t7 = py + t5;
+  float t8 = pz + t5;
+  float t11 = t6 + 5.5f;
+  float t12 = t7 + 5.5f;
+  float t13 = t8 + 5.5f;
+  float t15 = fmodf(t12, 80.0f);
+  float t16 = fabsf(t15);
+  float t18 = t16 - 40.0f;
+  float t19 = fmodf(t13, 80.0f);
+  float t20 = fabsf(t19);
+  float t21 = t20 - 40.0f;
+  float t22 = t18 * t18;
+  float t23 = t21 * t21;
+  float t24 = t22 + t23;
+  float t25 = sqrtf(t24);
+  float t26 = t25 - 5.5f;
+  float t28 = fmodf(t13, 100.0f);
+  float t29 = fabsf(t28);
+  float t31 = t29 - 50.0f;
+  float t32 = fmodf(t11, 100.0f);
+  float t33 = fabsf(t32);
+  float t34 = t33 - 50.0f;
+  float t36 = t31 * t31;
+  float t37 = t34 * t34;
+  float t38 = t36 + t37;
+  float t39 = sqrtf(t38);
+  float t40 = t39 - 20.5f;
+  float t41 = fminf(t26, t40);
+  float t43 = t13 * 0.140000001f;
+  float t44 = sinf(t43);
+  float t46 = t44 * 5.4000001f;
+  float t47 = sinf(t46);
+  float t48 = 0.300000012f * t47;
+  float t49 = t11 + t48;
+  float t51 = t13 * 0.119999997f;
+  float t52 = cosf(t51);
+  float t54 = t52 * 7.4000001f;
+  float t55 = sinf(t54);
+  float t56 = t12 + t55;
+  float t58 = fmodf(t49, 30.0f);
+  float t59 = fabsf(t58);
+  float t61 = t59 - 15.0f;
+  float t62 = fmodf(t56, 30.0f);
+  float t63 = fabsf(t62);
+  float t64 = t63 - 15.0f;
+  float t66 = t61 * t61;
+  float t67 = t64 * t64;
+  float t68 = t66 + t67;
+  float t69 = sqrtf(t68);
+  float t70 = t69 - 2.5f;
+  float t71 = fminf(t41, t70);
+  float t73 = px * 11.0f;
+  float t74 = sinf(t73);
+  float t75 = py * 11.0f;
+  float t76 = sinf(t75);
+  float t77 = t74 + t76;
+  float t78 = pz * 11.0f;
+  float t79 = sinf(t78);
+  float t80 = t77 + t79;
+  float t82 = t80 * 0.0125000002f;
+  float t83 = t71 + t82;
+  float t85 = px * 6.0f;
+  float t86 = sinf(t85);
+  float t87 = py * 6.0f;
+  float t88 = sinf(t87);
+  float t89 = t86 + t88;
+  float t90 = pz * 6.0f;
+  float t91 = sinf(t90);
+  float t92 = sinf(t91);
+  float t93 = t89 + t92;
+  float t95 = t93 * 0.0324999988f;
+  float t96 = t83 + t95;
+  return t96;
+}
+
+TARGET_AVX2 inline __m256 SdfStatic8(__m256 px, __m256 py, __m256 pz, float time) {
+  (void)time;
+  __m256 t4 = SdfHash8(px);
+  __m256 t5 = _mm256_mul_ps(_mm256_set1_ps(0.00200000009f), t4);
+  __m256 t6 = _mm256_add_ps(px, t5);
+  __m256 t7 = _mm256_add_ps(py, t5);
+  __m256 t8 = _mm256_add_ps(pz, t5);
+  __m256 t11 = _mm256_add_ps(t6, _mm256_set1_ps(5.5f));
+  __m256 t12 = _mm256_add_ps(t7, _mm256_set1_ps(5.5f));
+  __m256 t13 = _mm256_add_ps(t8, _mm256_set1_ps(5.5f));
+  __m256 t15 = SdfMod8(t12, _mm256_set1_ps(80.0f));
+  __m256 t16 = SdfAbs8(t15);
+  __m256 t18 = _mm256_sub_ps(t16, _mm256_set1_ps(40.0f));
+  __m256 t19 = SdfMod8(t13, _mm256_set1_ps(80.0f));
+  __m256 t20 = SdfAbs8(t19);
+  __m256 t21 = _mm256_sub_ps(t20, _mm256_set1_ps(40.0f));
+  __m256 t22 = _mm256_mul_ps(t18, t18);
+  __m256 t23 = _mm256_mul_ps(t21, t21);
+  __m256 t24 = _mm256_add_ps(t22, t23);
+  __m256 t25 = _mm256_sqrt_ps(t24);
+  __m256 t26 = _mm256_sub_ps(t25, _mm256_set1_ps(5.5f));
+  __m256 t28 = SdfMod8(t13, _mm256_set1_ps(100.0f));
+  __m256 t29 = SdfAbs8(t28);
+  __m256 t31 = _mm256_sub_ps(t29, _mm256_set1_ps(50.0f));
+  __m256 t32 = SdfMod8(t11, _mm256_set1_ps(100.0f));
+  __m256 t33 = SdfAbs8(t32);
+  __m256 t34 = _mm256_sub_ps(t33, _mm256_set1_ps(50.0f));
+  __m256 t36 = _mm256_mul_ps(t31, t31);
+  __m256 t37 = _mm256_mul_ps(t34, t34);
+  __m256 t38 = _mm256_add_ps(t36, t37);
+  __m256 t39 = _mm256_sqrt_ps(t38);
+  __m256 t40 = _mm256_sub_ps(t39, _mm256_set1_ps(20.5f));
+  __m256 t41 = _mm256_min_ps(t26, t40);
+  __m256 t43 = _mm256_mul_ps(t13, _mm256_set1_ps(0.140000001f));
+  __m256 t44 = SdfSin8(t43);
+  __m256 t46 = _mm256_mul_ps(t44, _mm256_set1_ps(5.4000001f));
+  __m256 t47 = SdfSin8(t46);
+  __m256 t48 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), t47);
+  __m256 t49 = _mm256_add_ps(t11, t48);
+  __m256 t51 = _mm256_mul_ps(t13, _mm256_set1_ps(0.119999997f));
+  __m256 t52 = SdfCos8(t51);
+  __m256 t54 = _mm256_mul_ps(t52, _mm256_set1_ps(7.4000001f));
+  __m256 t55 = SdfSin8(t54);
+  __m256 t56 = _mm256_add_ps(t12, t55);
+  __m256 t58 = SdfMod8(t49, _mm256_set1_ps(30.0f));
+  __m256 t59 = SdfAbs8(t58);
+  __m256 t61 = _mm256_sub_ps(t59, _mm256_set1_ps(15.0f));
+  __m256 t62 = SdfMod8(t56, _mm256_set1_ps(30.0f));
+  __m256 t63 = SdfAbs8(t62);
+  __m256 t64 = _mm256_sub_ps(t63, _mm256_set1_ps(15.0f));
+  __m256 t66 = _mm256_mul_ps(t61, t61);
+  __m256 t67 = _mm256_mul_ps(t64, t64);
+  __m256 t68 = _mm256_add_ps(t66, t67);
+  __m256 t69 = _mm256_sqrt_ps(t68);
+  __m256 t70 = _mm256_sub_ps(t69, _mm256_set1_ps(2.5f));
+  __m256 t71 = _mm256_min_ps(t41, t70);
+  __m256 t73 = _mm256_mul_ps(px, _mm256_set1_ps(11.0f));
+  __m256 t74 = SdfSin8(t73);
+  __m256 t75 = _mm256_mul_ps(py, _mm256_set1_ps(11.0f));
+  __m256 t76 = SdfSin8(t75);
+  __m256 t77 = _mm256_add_ps(t74, t76);
+  __m256 t78 = _mm256_mul_ps(pz, _mm256_set1_ps(11.0f));
+  __m256 t79 = SdfSin8(t78);
+  __m256 t80 = _mm256_add_ps(t77, t79);
+  __m256 t82 = _mm256_mul_ps(t80, _mm256_set1_ps(0.0125000002f));
+  __m256 t83 = _mm256_add_ps(t71, t82);
+  __m256 t85 = _mm256_mul_ps(px, _mm256_set1_ps(6.0f));
+  __m256 t86 = SdfSin8(t85);
+  __m256 t87 = _mm256_mul_ps(py, _mm256_set1_ps(6.0f));
+  __m256 t88 = SdfSin8(t87);
+  __m256 t89 = _mm256_add_ps(t86, t88);
+  __m256 t90 = _mm256_mul_ps(pz, _mm256_set1_ps(6.0f));
+  __m256 t91 = SdfSin8(t90);
+  __m256 t92 = SdfSin8(t91);
+  __m256 t93 = _mm256_add_ps(t89, t92);
+  __m256 t95 = _mm256_mul_ps(t93, _mm256_set1_ps(0.0324999988f));
+  __m256 t96 = _mm256_add_ps(t83, t95);
+  return t96;
+}
+
+inline float SdfMoving(float px, float py, float pz, float time) {
+  float t4 = SdfHash(px);
+  float t5 = 0.00200000009f * t4;
+  float t6 = px + t5;
+  float t7 = py + t5;
+  float t8 = pz + t5;
+  float t11 = 0.300000012f * time;
+  float t12 = cosf(t11);
+  float t13 = sinf(t11);
+  float t14 = t7 * t13;
+  float t15 = t6 * t12;
+  float t16 = t15 - t14;
+  float t17 = t7 * t12;
+  float t18 = t6 * t13;
+  float t19 = t17 + t18;
+  float t21 = fmodf(t16, 20.0f);
+  float t22 = fabsf(t21);
+  float t24 = t22 - 10.0f;
+  float t25 = fmodf(t19, 20.0f);
+  float t26 = fabsf(t25);
+  float t27 = t26 - 10.0f;
+  float t28 = fmodf(t8, 20.0f);
+  float t29 = fabsf(t28);
+  float t30 = t29 - 10.0f;
+  float t32 = t24 * t24;
+  float t33 = t27 * t27;
+  float t34 = t32 + t33;
+  float t35 = t30 * t30;
+  float t36 = t34 + t35;
+  float t37 = sqrtf(t36);
+  float t38 = t37 - 3.0f;
+  float t40 = t38 - 0.13499999f;
+  return t40;
+}
+
+TARGET_AVX2 inline __m256 SdfMoving8(__m256 px, __m256 py, __m256 pz, float time) {
+  __m256 t4 = SdfHash8(px);
+  __m256 t5 = _mm256_mul_ps(_mm256_set1_ps(0.00200000009f), t4);
+  __m256 t6 = _mm256_add_ps(px, t5);
+  __m256 t7 = _mm256_add_ps(py, t5);
+  __m256 t8 = _mm256_add_ps(pz, t5);
+  __m256 t11 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), _mm256_set1_ps(time));
+  __m256 t12 = SdfCos8(t11);
+  __m256 t13 = SdfSin8(t11);
+  __m256 t14 = _mm256_mul_ps(t7, t13);
+  __m256 t15 = _mm256_mul_ps(t6, t12);
+  __m256 t16 = _mm256_sub_ps(t15, t14);
+  __m256 t17 = _mm256_mul_ps(t7, t12);
+  __m256 t18 = _mm256_mul_ps(t6, t13);
+  __m256 t19 = _mm256_add_ps(t17, t18);
+  __m256 t21 = SdfMod8(t16, _mm256_set1_ps(20.0f));
+  __m256 t22 = SdfAbs8(t21);
+  __m256 t24 = _mm256_sub_ps(t22, _mm256_set1_ps(10.0f));
+  __m256 t25 = SdfMod8(t19, _mm256_set1_ps(20.0f));
+  __m256 t26 = SdfAbs8(t25);
+  __m256 t27 = _mm256_sub_ps(t26, _mm256_set1_ps(10.0f));
+  __m256 t28 = SdfMod8(t8, _mm256_set1_ps(20.0f));
+  __m256 t29 = SdfAbs8(t28);
+  __m256 t30 = _mm256_sub_ps(t29, _mm256_set1_ps(10.0f));
+  __m256 t32 = _mm256_mul_ps(t24, t24);
+  __m256 t33 = _mm256_mul_ps(t27, t27);
+  __m256 t34 = _mm256_add_ps(t32, t33);
+  __m256 t35 = _mm256_mul_ps(t30, t30);
+  __m256 t36 = _mm256_add_ps(t34, t35);
+  __m256 t37 = _mm256_sqrt_ps(t36);
+  __m256 t38 = _mm256_sub_ps(t37, _mm256_set1_ps(3.0f));
+  __m256 t40 = _mm256_sub_ps(t38, _mm256_set1_ps(0.13499999f));
+  return t40;
+}
+
+inline float SdfMapPrune(float px, float py, float pz, float time, unsigned long long keep) {
+  float t4 = SdfHash(px);
+  float t5 = 0.00200000009f * t4;
+  float t6 = px + t5;
+  float t7 = py + t5;
+  float t8 = pz + t5;
+  float t11 = 0, t12 = 0, t13 = 0, t14 = 0, t15 = 0, t16 = 0, t17 = 0, t18 = 0, t19 = 0, t21 = 0, t22 = 0, t24 = 0, t25 = 0, t26 = 0, t27 = 0, t28 = 0, t29 = 0, t30 = 0, t32 = 0, t33 = 0, t34 = 0, t35 = 0, t36 = 0, t37 = 0, t38 = 0;
+  if((keep & 0x10ull) == 0x10ull) {
+    t11 = 0.300000012f * time;
+    t12 = cosf(t11);
+    t13 = sinf(t11);
+    t14 = t7 * t13;
+    t15 = t6 * t12;
+    t16 = t15 - t14;
+    t17 = t7 * t12;
+    t18 = t6 * t13;
+    t19 = t17 + t18;
+    t21 = fmodf(t16, 20.0f);
+    t22 = fabsf(t21);
+    t24 = t22 - 10.0f;
+    t25 = fmodf(t19, 20.0f);
+    t26 = fabsf(t25);
+    t27 = t26 - 10.0f;
+    t28 = fmodf(t8, 20.0f);
+    t29 = fabsf(t28);
+    t30 = t29 - 10.0f;
+    t32 = t24 * t24;
+    t33 = t27 * t27;
+    t34 = t32 + t33;
+    t35 = t30 * t30;
+    t36 = t34 + t35;
+    t37 = sqrtf(t36);
+    t38 = t37 - 3.0f;
+  }
+  float t40 = 0, t41 = 0, t42 = 0;
+  if((keep & 0x20ull) == 0x20ull) {
+    t40 = t6 + 5.5f;
+    t41 = t7 + 5.5f;
+    t42 = t8 + 5.5f;
+  }
+  float t44 = 0, t45 = 0, t47 = 0, t48 = 0, t49 = 0, t50 = 0, t51 = 0, t52 = 0, t53 = 0, t54 = 0, t55 = 0;
+  if((keep & 0x25ull) == 0x25ull) {
+    t44 = fmodf(t41, 80.0f);
+    t45 = fabsf(t44);
+    t47 = t45 - 40.0f;
+    t48 = fmodf(t42, 80.0f);
+    t49 = fabsf(t48);
+    t50 = t49 - 40.0f;
+    t51 = t47 * t47;
+    t52 = t50 * t50;
+    t53 = t51 + t52;
+    t54 = sqrtf(t53);
+    t55 = t54 - 5.5f;
+  }
+  float t57 = 0, t58 = 0, t60 = 0, t61 = 0, t62 = 0, t63 = 0, t65 = 0, t66 = 0, t67 = 0, t68 = 0, t69 = 0;
+  if((keep & 0x26ull) == 0x26ull) {
+    t57 = fmodf(t42, 100.0f);
+    t58 = fabsf(t57);
+    t60 = t58 - 50.0f;
+    t61 = fmodf(t40, 100.0f);
+    t62 = fabsf(t61);
+    t63 = t62 - 50.0f;
+    t65 = t60 * t60;
+    t66 = t63 * t63;
+    t67 = t65 + t66;
+    t68 = sqrtf(t67);
+    t69 = t68 - 20.5f;
+  }
+  float t70 = 0;
+  if((keep & 0x24ull) == 0x24ull) {
+    t70 = !(keep & 0x2ull) ? t55 : !(keep & 0x1ull) ? t69 : fminf(t55, t69);
+  }
+  float t72 = 0, t73 = 0, t75 = 0, t76 = 0, t77 = 0, t78 = 0, t80 = 0, t81 = 0, t83 = 0, t84 = 0, t85 = 0, t87 = 0, t88 = 0, t90 = 0, t91 = 0, t92 = 0, t93 = 0, t95 = 0, t96 = 0, t97 = 0, t98 = 0, t99 = 0;
+  if((keep & 0x28ull) == 0x28ull) {
+    t72 = t42 * 0.140000001f;
+    t73 = sinf(t72);
+    t75 = t73 * 5.4000001f;
+    t76 = sinf(t75);
+    t77 = 0.300000012f * t76;
+    t78 = t40 + t77;
+    t80 = t42 * 0.119999997f;
+    t81 = cosf(t80);
+    t83 = t81 * 7.4000001f;
+    t84 = sinf(t83);
+    t85 = t41 + t84;
+    t87 = fmodf(t78, 30.0f);
+    t88 = fabsf(t87);
+    t90 = t88 - 15.0f;
+    t91 = fmodf(t85, 30.0f);
+    t92 = fabsf(t91);
+    t93 = t92 - 15.0f;
+    t95 = t90 * t90;
+    t96 = t93 * t93;
+    t97 = t95 + t96;
+    t98 = sqrtf(t97);
+    t99 = t98 - 2.5f;
+  }
+  float t100 = 0;
+  if((keep & 0x20ull) == 0x20ull) {
+    t100 = !(keep & 0x8ull) ? t70 : !(keep & 0x4ull) ? t99 : fminf(t70, t99);
+  }
+  float t101 = !(keep & 0x20ull) ? t38 : !(keep & 0x10ull) ? t100 : fminf(t38, t100);
+  float t103 = px * 11.0f;
+  float t104 = sinf(t103);
+  float t105 = py * 11.0f;
+  float t106 = sinf(t105);
+  float t107 = t104 + t106;
+  float t108 = pz * 11.0f;
+  float t109 = sinf(t108);
+  float t110 = t107 + t109;
+  float t112 = t110 * 0.0125000002f;
+  float t113 = t101 + t112;
+  float t115 = px * 6.0f;
+  float t116 = sinf(t115);
+  float t117 = py * 6.0f;
+  float t118 = sinf(t117);
+  float t119 = t116 + t118;
+  float t120 = pz * 6.0f;
+  float t121 = sinf(t120);
+  float t122 = sinf(t121);
+  float t123 = t119 + t122;
+  float t125 = t123 * 0.0324999988f;
+  float t126 = t113 + t125;
+  return t126;
+}
+
+TARGET_AVX2 inline __m256 SdfMapPrune8(__m256 px, __m256 py, __m256 pz, float time, unsigned long long keep) {
+  __m256 t4 = SdfHash8(px);
+  __m256 t5 = _mm256_mul_ps(_mm256_set1_ps(0.00200000009f), t4);
+  __m256 t6 = _mm256_add_ps(px, t5);
+  __m256 t7 = _mm256_add_ps(py, t5);
+  __m256 t8 = _mm256_add_ps(pz, t5);
+  __m256 t11 = {}, t12 = {}, t13 = {}, t14 = {}, t15 = {}, t16 = {}, t17 = {}, t18 = {}, t19 = {}, t21 = {}, t22 = {}, t24 = {}, t25 = {}, t26 = {}, t27 = {}, t28 = {}, t29 = {}, t30 = {}, t32 = {}, t33 = {}, t34 = {}, t35 = {}, t36 = {}, t37 = {}, t38 = {};
+  if((keep & 0x10ull) == 0x10ull) {
+    t11 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), _mm256_set1_ps(time));
+    t12 = SdfCos8(t11);
+    t13 = SdfSin8(t11);
+    t14 = _mm256_mul_ps(t7, t13);
+    t15 = _mm256_mul_ps(t6, t12);
+    t16 = _mm256_sub_ps(t15, t14);
+    t17 = _mm256_mul_ps(t7, t12);
+    t18 = _mm256_mul_ps(t6, t13);
+    t19 = _mm256_add_ps(t17, t18);
+    t21 = SdfMod8(t16, _mm256_set1_ps(20.0f));
+    t22 = SdfAbs8(t21);
+    t24 = _mm256_sub_ps(t22, _mm256_set1_ps(10.0f));
+    t25 = SdfMod8(t19, _mm256_set1_ps(20.0f));
+    t26 = SdfAbs8(t25);
+    t27 = _mm256_sub_ps(t26, _mm256_set1_ps(10.0f));
+    t28 = SdfMod8(t8, _mm256_set1_ps(20.0f));
+    t29 = SdfAbs8(t28);
+    t30 = _mm256_sub_ps(t29, _mm256_set1_ps(10.0f));
+    t32 = _mm256_mul_ps(t24, t24);
+    t33 = _mm256_mul_ps(t27, t27);
+    t34 = _mm256_add_ps(t32, t33);
+    t35 = _mm256_mul_ps(t30, t30);
+    t36 = _mm256_add_ps(t34, t35);
+    t37 = _mm256_sqrt_ps(t36);
+    t38 = _mm256_sub_ps(t37, _mm256_set1_ps(3.0f));
+  }
+  __m256 t40 = {}, t41 = {}, t42 = {};
+  if((keep & 0x20ull) == 0x20ull) {
+    t40 = _mm256_add_ps(t6, _mm256_set1_ps(5.5f));
+    t41 = _mm256_add_ps(t7, _mm256_set1_ps(5.5f));
+    t42 = _mm256_add_ps(t8, _mm256_set1_ps(5.5f));
+  }
+  __m256 t44 = {}, t45 = {}, t47 = {}, t48 = {}, t49 = {}, t50 = {}, t51 = {}, t52 = {}, t53 = {}, t54 = {}, t55 = {};
+  if((keep & 0x25ull) == 0x25ull) {
+    t44 = SdfMod8(t41, _mm256_set1_ps(80.0f));
+    t45 = SdfAbs8(t44);
+    t47 = _mm256_sub_ps(t45, _mm256_set1_ps(40.0f));
+    t48 = SdfMod8(t42, _mm256_set1_ps(80.0f));
+    t49 = SdfAbs8(t48);
+    t50 = _mm256_sub_ps(t49, _mm256_set1_ps(40.0f));
+    t51 = _mm256_mul_ps(t47, t47);
+    t52 = _mm256_mul_ps(t50, t50);
+    t53 = _mm256_add_ps(t51, t52);
+    t54 = _mm256_sqrt_ps(t53);
+    t55 = _mm256_sub_ps(t54, _mm256_set1_ps(5.5f));
+  }
+  __m256 t57 = {}, t58 = {}, t60 = {}, t61 = {}, t62 = {}, t63 = {}, t65 = {}, t66 = {}, t67 = {}, t68 = {}, t69 = {};
+  if((keep & 0x26ull) == 0x26ull) {
+    t57 = SdfMod8(t42, _mm256_set1_ps(100.0f));
+    t58 = SdfAbs8(t57);
+    t60 = _mm256_sub_ps(t58, _mm256_set1_ps(50.0f));
+    t61 = SdfMod8(t40, _mm256_set1_ps(100.0f));
+    t62 = SdfAbs8(t61);
+    t63 = _mm256_sub_ps(t62, _mm256_set1_ps(50.0f));
+    t65 = _mm256_mul_ps(t60, t60);
+    t66 = _mm256_mul_ps(t63, t63);
+    t67 = _mm256_add_ps(t65, t66);
+    t68 = _mm256_sqrt_ps(t67);
+    t69 = _mm256_sub_ps(t68, _mm256_set1_ps(20.5f));
+  }
+  __m256 t70 = {};
+  if((keep & 0x24ull) == 0x24ull) {
+    t70 = !(keep & 0x2ull) ? t55 : !(keep & 0x1ull) ? t69 : _mm256_min_ps(t55, t69);
+  }
+  __m256 t72 = {}, t73 = {}, t75 = {}, t76 = {}, t77 = {}, t78 = {}, t80 = {}, t81 = {}, t83 = {}, t84 = {}, t85 = {}, t87 = {}, t88 = {}, t90 = {}, t91 = {}, t92 = {}, t93 = {}, t95 = {}, t96 = {}, t97 = {}, t98 = {}, t99 = {};
+  if((keep & 0x28ull) == 0x28ull) {
+    t72 = _mm256_mul_ps(t42, _mm256_set1_ps(0.140000001f));
+    t73 = SdfSin8(t72);
+    t75 = _mm256_mul_ps(t73, _mm256_set1_ps(5.4000001f));
+    t76 = SdfSin8(t75);
+    t77 = _mm256_mul_ps(_mm256_set1_ps(0.300000012f), t76);
+    t78 = _mm256_add_ps(t40, t77);
+    t80 = _mm256_mul_ps(t42, _mm256_set1_ps(0.119999997f));
+    t81 = SdfCos8(t80);
+    t83 = _mm256_mul_ps(t81, _mm256_set1_ps(7.4000001f));
+    t84 = SdfSin8(t83);
+    t85 = _mm256_add_ps(t41, t84);
+    t87 = SdfMod8(t78, _mm256_set1_ps(30.0f));
+    t88 = SdfAbs8(t87);
+    t90 = _mm256_sub_ps(t88, _mm256_set1_ps(15.0f));
+    t91 = SdfMod8(t85, _mm256_set1_ps(30.0f));
+    t92 = SdfAbs8(t91);
+    t93 = _mm256_sub_ps(t92, _mm256_set1_ps(15.0f));
+    t95 = _mm256_mul_ps(t90, t90);
+    t96 = _mm256_mul_ps(t93, t93);
+    t97 = _mm256_add_ps(t95, t96);
+    t98 = _mm256_sqrt_ps(t97);
+    t99 = _mm256_sub_ps(t98, _mm256_set1_ps(2.5f));
+  }
+  __m256 t100 = {};
+  if((keep & 0x20ull) == 0x20ull) {
+    t100 = !(keep & 0x8ull) ? t70 : !(keep & 0x4ull) ? t99 : _mm256_min_ps(t70, t99);
+  }
+  __m256 t101 = !(keep & 0x20ull) ? t38 : !(keep & 0x10ull) ? t100 : _mm256_min_ps(t38, t100);
+  __m256 t103 = _mm256_mul_ps(px, _mm256_set1_ps(11.0f));
+  __m256 t104 = SdfSin8(t103);
+  __m256 t105 = _mm256_mul_ps(py, _mm256_set1_ps(11.0f));
+  __m256 t106 = SdfSin8(t105);
+  __m256 t107 = _mm256_add_ps(t104, t106);
+  __m256 t108 = _mm256_mul_ps(pz, _mm256_set1_ps(11.0f));
+  __m256 t109 = SdfSin8(t108);
+  __m256 t110 = _mm256_add_ps(t107, t109);
+  __m256 t112 = _mm256_mul_ps(t110, _mm256_set1_ps(0.0125000002f));
+  __m256 t113 = _mm256_add_ps(t101, t112);
+  __m256 t115 = _mm256_mul_ps(px, _mm256_set1_ps(6.0f));
+  __m256 t116 = SdfSin8(t115);
+  __m256 t117 = _mm256_mul_ps(py, _mm256_set1_ps(6.0f));
+  __m256 t118 = SdfSin8(t117);
+  __m256 t119 = _mm256_add_ps(t116, t118);
+  __m256 t120 = _mm256_mul_ps(pz, _mm256_set1_ps(6.0f));
+  __m256 t121 = SdfSin8(t120);
+  __m256 t122 = SdfSin8(t121);
+  __m256 t123 = _mm256_add_ps(t119, t122);
+  __m256 t125 = _mm256_mul_ps(t123, _mm256_set1_ps(0.0324999988f));
+  __m256 t126 = _mm256_add_ps(t113, t125);
+  return t126;
+}
+
+TARGET_AVX2 inline void SdfCheck8(const float *x, const float *y, const float *z, float time, float *out, float (*grad)[8]) {
+  __m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y), pz = _mm256_loadu_ps(z), g[3];
+  _mm256_storeu_ps(out, SdfMap8(px, py, pz, time));
+  SdfMapGrad8(px, py, pz, time, g);
+  for(int k = 0; k < 3; k++) _mm256_storeu_ps(grad[k], g[k]);
+}
+
+TARGET_AVX2 inline void SdfCheckPrune8(const float *x, const float *y, const float *z, float time, unsigned long long keep,
+  float *full, float *pruned) {
+  __m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y), pz = _mm256_loadu_ps(z);
+  _mm256_storeu_ps(full, SdfMap8(px, py, pz, time));
+  _mm256_storeu_ps(pruned, SdfMapPrune8(px, py, pz, time, keep));
+}
+
+#endif //_MAP_SDF_H_
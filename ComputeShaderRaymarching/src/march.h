@@ -0,0 +1,1383 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  march.h
+//    CPU port of cs_main in main.fx : map() generated from map.sdf
+//    (map_sdf.h), inter(), getnormal() (mapgrad() or 4 map() calls as
+//    MapGrad), camera and shadow ray, scalar and
+//    8 rays per AVX2 packet, threaded
+//    over the GroupX x GroupY tiles of the Dispatch. Writes the same float4
+//    colour + depth layout as the UAV. No D3D needed. With a MarchCone
+//    every tile first marches its cones (cs_cone), split down to smaller
+//    ones where they stop if asked, and starts the primary rays at their
+//    depth. With a MarchHistory the last frame's depth, moved into this
+//    view, starts them too. With MarchSparse half or a quarter of the
+//    pixels are marched per frame and the rest rebuilt from them and the
+//    last frame. Below scale 1 the top left of the buffer is rendered as
+//    the whole screen and MarchUpscale brings it back to full size. With
+//    prune the primary rays of a tile run SdfMapPrune8 (prune.h), the
+//    min / max sides that cannot win over the tile's depth range left
+//    out. With packet they march n x n at a time behind one cone that
+//    splits where they diverge (MarchPacket8).
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _MARCH_H_
+#define _MARCH_H_
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "param.h"
+#include "../../common/simd.h"
+#include "../../common/jobs.h"
+#include "tilesched.h"
+#include "map_sdf.h"
+#include "prune.h"
+#include "brick.h"
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// shader constants
+//-----------//-----------//-----------//-----------//-----------//-----------
+#define MarchTilesX        (ScreenX / GroupX)     //as Dispatch : rows past TilesY * GroupY stay untouched
+#define MarchTilesY        (ScreenY / GroupY)
+#define MarchFar           1024.0f
+#define MarchIte           64
+#define MarchShadowIte     8
+#define MarchOmega         1.2f                   //MarchRelaxed : step = map() * omega
+#define MarchBisectMult    1.2f                   //MarchBisect : step = map() * mult, may cross
+#define MarchBisectIte     8
+#define MarchReprojKeep    0.9f                   //MarchHistory : rays start at reprojected depth * keep
+#define MarchReprojRadius  3                      //MarchHistory : nearest depth of (2 radius + 1)^2 pixels, the scene moves too
+
+//inter() of the primary rays
+enum MarchStrategy {
+  MarchClassic,              //as the shader : step map(), hit under cend
+  MarchRelaxed,              //over-relaxed steps, one back and plain ones once a step leaves the sphere
+  MarchFootprint,            //hit under the pixel's radius at the depth instead of cend
+  MarchBisect,               //longer steps, a step past the surface is bisected back to it
+  MarchStrategies
+};
+
+inline const char *MarchStrategyName(int s) {
+  static const char *name[MarchStrategies] = { "classic", "relaxed", "footprint", "bisect" };
+  return s >= 0 && s < MarchStrategies ? name[s] : "?";
+}
+
+//pixels marched per frame, Sparse in the shader
+enum MarchSparseMode {
+  MarchEvery,                //all of them
+  MarchChecker,              //checkerboard, swaps every frame
+  MarchQuad,                 //one of every 2 x 2, in turn over 4 frames
+};
+
+struct MarchColor {
+  float r, g, b, a;          //a : depth, same as the UAV
+};
+
+struct MarchTileStat {
+  unsigned steps;            //map() calls in inter(), primary + shadow
+  unsigned rays;             //primary + shadow rays
+  unsigned cone;             //map() calls of the tile's cones and of the history checks
+  unsigned reproj;           //primary rays started from the last frame's depth
+  unsigned ops;              //map() instructions run for the primary rays, 8 lanes a call (AVX2)
+  unsigned pruned;           //gate sides left out over the tile's depth ranges (AVX2, prune)
+  float    ms;
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// MarchCone
+//   Prepass of cs_cone : one cone from the camera per step x step pixels,
+//   wide enough to hold all of their rays, marched while map() clears its
+//   radius. Nothing is closer to the camera inside the cone than the depth
+//   it stops at, so the rays of the block start there instead of 0.
+//   Below leaf, a cone that stops splits in 4 that go on from its depth,
+//   down to leaf x leaf blocks, before the rays take over.
+//   step divides GroupX and GroupY, a tile marches its own cones.
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct MarchCone {
+  int                step;     //pixels per side, ConeStep in the shader
+  int                leaf;     //pixels per side of the smallest cones, step : no split
+  int                x, y;     //cones per row, rows
+  std::vector<float> start;    //depth of the step x step cones, as cs_cone writes it
+
+  //0 : off. l : power of 2 below s to split down to, 0 : cs_cone's one level
+  void Init(int s = ConeStep, int l = 0) {
+    step = s > 0 ? s : 0;
+    leaf = l > 0 && l < step ? l : step;
+    x    = step ? ScreenX / step : 0;
+    y    = step ? ScreenY / step : 0;
+    start.assign((size_t)x * y, 0);
+  }
+};
+
+//radius / depth of a w x h block : half its diagonal in the camera's
+//z = 1 plane, normalize() only narrows it
+//at a render scale (MarchFrame::scale) pixels are 1 / scale as wide
+inline float MarchSpread(int step, float scale = 1) {
+  return 0.5f * step * sqrtf((2.5f / ScreenX) * (2.5f / ScreenX) + (2.0f / ScreenY) * (2.0f / ScreenY)) / scale;
+}
+
+inline float MarchSpread(int w, int h, float scale) {
+  return 0.5f * sqrtf((w * 2.5f / ScreenX) * (w * 2.5f / ScreenX) + (h * 2.0f / ScreenY) * (h * 2.0f / ScreenY)) / scale;
+}
+
+//x, y of the centre of block bx, by as cs_main computes them from tid
+inline float MarchBlockX(int step, int bx, float scale = 1) { return -1 + 2 * ((bx + 0.5f) * step - 0.5f) / (ScreenX * scale); }
+inline float MarchBlockY(int step, int by, float scale = 1) { return -1 + 2 * ((by + 0.5f) * step - 0.5f) / (ScreenY * scale); }
+
+struct MarchHistory;
+struct MarchSparse;
+
+//first pixel of row y marched this frame, -1 : none, then every MarchRowStep
+inline int MarchRowStart(int sparse, unsigned phase, int y) {
+  switch(sparse) {
+  case MarchChecker: return (y + phase) & 1;
+  case MarchQuad:    return (unsigned)(y & 1) == ((phase >> 1) & 1) ? phase & 1 : -1;
+  }
+  return 0;
+}
+
+inline int MarchRowStep(int sparse) { return sparse == MarchEvery ? 1 : 2; }
+
+inline bool MarchMarched(int sparse, unsigned phase, int x, int y) {
+  int o = MarchRowStart(sparse, phase, y);
+  return o >= 0 && (x - o) % MarchRowStep(sparse) == 0;
+}
+
+//what runs besides the shader's own inter(), see MarchRender
+struct MarchOptions {
+  const BrickMap   *bricks = NULL;
+  MarchCone        *cone   = NULL;
+  int               strategy = MarchClassic;
+  bool              grad   = MapGrad != 0;
+  MarchHistory     *history = NULL;
+  MarchSparse      *sparse  = NULL;
+  float             scale   = 1;     //render size / ScreenX, ScreenY, see ResGovernor
+  bool              prune   = false; //primary rays of MarchClassic : map() pruned per tile and depth
+  int               packet  = 0;     //primary rays of MarchClassic as n x n packets (4, 8, AVX2), 0 : rows of 8
+};
+
+//per frame values the shader derives from Time.x
+struct MarchFrame {
+  float time;
+  float camc0, cams0;        //rot(dir.xz, time * 0.042)
+  float camc1, cams1;        //rot(dir.yz, time * 0.05)
+  float pos[3];
+  float light[3];            //L1
+  const BrickMap   *bricks;  //inter() reads the baked field where it has one
+  MarchCone        *cone;    //primary rays start at the cone depth, NULL at 0
+  int               strategy;  //MarchStrategy of the primary rays
+  bool              grad;    //normals from SdfMapGrad, else 4 map() calls
+  const MarchHistory *history;  //primary rays start at the last frame's depth, NULL at 0
+  int               sparse;  //MarchSparseMode
+  unsigned          phase;   //frame of the sparse pattern
+  float             scale;   //render size : the camera spans sizex * sizey pixels,
+  float             sizex, sizey;  //the top left tilesx * tilesy tiles of the buffer
+  int               tilesx, tilesy;
+  bool              prune;   //SdfMapPrune8 for the primary rays, see MarchPrune
+  int               packet;  //MarchPacket8 side, 0 : rows
+
+  void Set(float t, const MarchOptions &o = MarchOptions()) {
+    time   = t;
+    bricks = o.bricks && o.bricks->baked ? o.bricks : NULL;
+    cone   = o.cone && o.cone->step ? o.cone : NULL;
+    strategy = o.strategy;
+    grad   = o.grad;
+    history = NULL;            //MarchRender, once it is reprojected
+    sparse = MarchEvery;
+    phase  = 0;
+    scale  = o.scale > 0 && o.scale < 1 ? o.scale : 1;
+    sizex  = ScreenX * scale;
+    sizey  = ScreenY * scale;
+    tilesx = std::min(MarchTilesX, (int)ceilf(sizex / GroupX));
+    tilesy = std::min(MarchTilesY, (int)ceilf(sizey / GroupY));
+    prune  = o.prune && strategy == MarchClassic;
+    packet = (o.packet == 4 || o.packet == 8) && strategy == MarchClassic ? o.packet : 0;
+    camc0 = cosf(t * 0.042f);
+    cams0 = sinf(t * 0.042f);
+    camc1 = cosf(t * 0.05f);
+    cams1 = sinf(t * 0.05f);
+    pos[0] = 0;
+    pos[1] = 5;
+    pos[2] = t * 13;
+    float l[3] = { -0.7f, -0.5f, 0.3f };
+    float il = 1.0f / sqrtf(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+    for(int i = 0; i < 3; i++) light[i] = l[i] * il;
+  }
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// scalar
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct Vec3 {
+  float x, y, z;
+};
+
+inline Vec3  V3(float x, float y, float z) { Vec3 v = { x, y, z }; return v; }
+inline Vec3  operator+(Vec3 a, Vec3 b)     { return V3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Vec3  operator-(Vec3 a, Vec3 b)     { return V3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Vec3  operator*(Vec3 a, float s)    { return V3(a.x * s, a.y * s, a.z * s); }
+inline float Dot(Vec3 a, Vec3 b)           { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3  Normalize(Vec3 a)             { return a * (1.0f / sqrtf(Dot(a, a))); }
+
+//map() comes from map.sdf through sdfc (map_sdf.h)
+inline float MarchMap(const MarchFrame &f, Vec3 p) {
+  return SdfMap(p.x, p.y, p.z, f.time);
+}
+
+//map(), the bound of the bricks where they have one above bricks->exact
+inline float MarchField(const MarchFrame &f, Vec3 p) {
+  float d;
+  return f.bricks && f.bricks->Bound(p.x, p.y, p.z, f.time, &d) && d >= f.bricks->exact ? d : MarchMap(f, p);
+}
+
+inline float MarchInter(const MarchFrame &f, Vec3 ro, Vec3 dir, int ite, float cstart, float cend, float mult, unsigned *steps) {
+  float d = cstart;
+  int   i = 0;
+  for(; i < ite; i++) {
+    float temp = MarchField(f, ro + dir * d);
+    if(temp < cend) { i++; break; }
+    d += temp * mult;
+  }
+  *steps += i;
+  return d;
+}
+
+//inter() of a primary ray by strategy, MarchClassic is inter(..., cend, 1.0)
+inline float MarchTrace(const MarchFrame &f, int strategy, Vec3 ro, Vec3 dir, int ite, float cstart, float cend, unsigned *steps) {
+  float omega = strategy == MarchRelaxed ? MarchOmega : strategy == MarchBisect ? MarchBisectMult : 1;
+  float k     = strategy == MarchFootprint ? MarchSpread(1, f.scale) : 0;
+  float d = cstart, prev = 0, step = 0, out = cstart;
+  int   i = 0;
+  for(; i < ite; i++) {
+    float r = MarchField(f, ro + dir * d), eps = k > 0 ? fmaxf(k * d, 1e-3f) : cend;
+    //relaxed : the spheres of two steps no longer meet, go back and step plainly
+    if(strategy == MarchRelaxed && omega > 1 && fabsf(r) + prev < step) {
+      d    -= step * (omega - 1);
+      step -= step * (omega - 1);
+      omega = 1;
+      prev  = 0;
+      continue;
+    }
+    if(r < eps) {
+      i++;
+      //bisect between the last point outside and the one past the surface
+      if(strategy == MarchBisect && r < 0) {
+        float a = out, b = d;
+        for(int n = 0; n < MarchBisectIte; n++, i++) {
+          float m = (a + b) * 0.5f;
+          if(MarchField(f, ro + dir * m) < 0) b = m;
+          else                                a = m;
+        }
+        d = (a + b) * 0.5f;
+      }
+      break;
+    }
+    out  = d;
+    prev = fabsf(r);
+    step = r * omega;
+    d   += step;
+  }
+  *steps += i;
+  return d;
+}
+
+inline Vec3 MarchNormal(const MarchFrame &f, Vec3 ip) {
+  if(f.grad) {
+    float g[3];
+    SdfMapGrad(ip.x, ip.y, ip.z, f.time, g);
+    return Normalize(V3(g[0], g[1], g[2]));
+  }
+  float c = MarchMap(f, ip);
+  return Normalize(V3(
+    MarchMap(f, ip + V3(0.01f, 0, 0)) - c,
+    MarchMap(f, ip + V3(0, 0.01f, 0)) - c,
+    MarchMap(f, ip + V3(0, 0, 0.01f)) - c));
+}
+
+inline Vec3 MarchCamera(const MarchFrame &f, float u, float v) {
+  Vec3  dir = Normalize(V3(u * 1.25f, v, 1.0f));
+  float x = f.camc0 * dir.x - f.cams0 * dir.z;
+  float z = f.cams0 * dir.x + f.camc0 * dir.z;
+  dir.x = x;
+  dir.z = z;
+  float y = f.camc1 * dir.y - f.cams1 * dir.z;
+  z       = f.cams1 * dir.y + f.camc1 * dir.z;
+  dir.y = y;
+  dir.z = z;
+  return dir;
+}
+
+//pixel tx, ty (fractional) whose ray MarchCamera points at p, false behind the camera
+inline bool MarchProject(const MarchFrame &f, Vec3 p, float *tx, float *ty) {
+  Vec3  w  = p - V3(f.pos[0], f.pos[1], f.pos[2]);
+  float y  = f.camc1 * w.y + f.cams1 * w.z;
+  float z1 = f.camc1 * w.z - f.cams1 * w.y;
+  float x  = f.camc0 * w.x + f.cams0 * z1;
+  float z  = f.camc0 * z1 - f.cams0 * w.x;
+  if(z <= 1e-6f) return false;
+  *tx = (x / (z * 1.25f) + 1) * 0.5f * f.sizex;
+  *ty = (1 - y / z) * 0.5f * f.sizey;
+  return true;
+}
+
+//pow(dot, 2) is NaN for dot < 0 on the GPU and max() then returns 0.01
+inline float MarchDiffuse(float nl) {
+  return nl > 0 ? fmaxf(nl * nl, 0.01f) : 0.01f;
+}
+
+inline MarchColor MarchPixel(const MarchFrame &f, int tx, int ty, float start, unsigned *steps, unsigned *rays) {
+  float x = -1 + (2 * float(tx) / f.sizex);
+  float y = -1 + (2 * float(ty) / f.sizey);
+  Vec3  pos = V3(f.pos[0], f.pos[1], f.pos[2]);
+  Vec3  dir = MarchCamera(f, x, -y);
+  float d   = f.strategy == MarchClassic ? MarchInter(f, pos, dir, MarchIte, start, 0.03f, 1.0f, steps)
+                                       : MarchTrace(f, f.strategy, pos, dir, MarchIte, start, 0.03f, steps);
+  (*rays)++;
+  if(d > MarchFar) {
+    MarchColor c = { d, d, d, d };
+    return c;
+  }
+  Vec3  ip = pos + dir * d;
+  Vec3  L1 = V3(f.light[0], f.light[1], f.light[2]);
+  Vec3  N  = MarchNormal(f, ip);
+  float S  = 1;
+  float nl = Dot(N, L1);
+  if(nl < 0) {
+    S += fmaxf(MarchInter(f, ip + N * 1.5f, L1 * -1, MarchShadowIte, 0, 0.1f, 0.95f, steps), 1);
+    (*rays)++;
+  }
+  float D = MarchDiffuse(nl) * S * 0.01f;
+  MarchColor c = { D * (4 + dir.x * 0.5f), D * (2 + dir.y * 0.5f), D * (1 + dir.z * 0.5f), d };
+  return c;
+}
+
+//cs_cone : the cone of block bx, by from depth d, steps back by the radius
+//and by the growth of the cone over the step
+inline float MarchConeRay(const MarchFrame &f, int step, int bx, int by, float d, unsigned *steps) {
+  Vec3  pos = V3(f.pos[0], f.pos[1], f.pos[2]);
+  Vec3  dir = MarchCamera(f, MarchBlockX(step, bx, f.scale), -MarchBlockY(step, by, f.scale));
+  float k   = MarchSpread(step, f.scale);
+  int   i   = 0;
+  for(; i < MarchIte && d <= MarchFar; i++) {
+    float gap = MarchMap(f, pos + dir * d) - k * d;
+    if(gap < 0.03f) { i++; break; }
+    d += gap / (1 + k);
+  }
+  *steps += i;
+  return d;
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// AVX2 : 8 consecutive pixels of a row per packet
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct Vec8 {
+  __m256 x, y, z;
+};
+
+TARGET_AVX2 inline __m256 Len8(__m256 a, __m256 b) {
+  return _mm256_sqrt_ps(_mm256_fmadd_ps(a, a, _mm256_mul_ps(b, b)));
+}
+
+TARGET_AVX2 inline __m256 Len8(__m256 a, __m256 b, __m256 c) {
+  return _mm256_sqrt_ps(_mm256_fmadd_ps(a, a, _mm256_fmadd_ps(b, b, _mm256_mul_ps(c, c))));
+}
+
+//keep : bits of SdfMapPrune8, all set : SdfMap8
+TARGET_AVX2 inline __m256 MarchMap8(const MarchFrame &f, const Vec8 &p, unsigned long long keep = ~0ull) {
+  return ~keep ? SdfMapPrune8(p.x, p.y, p.z, f.time, keep) : SdfMap8(p.x, p.y, p.z, f.time);
+}
+
+//getcamera of uv = (x, -y)
+TARGET_AVX2 inline Vec8 MarchCamera8(const MarchFrame &f, __m256 x, __m256 y) {
+  __m256 dx = _mm256_mul_ps(x, _mm256_set1_ps(1.25f));
+  __m256 dy = _mm256_sub_ps(_mm256_setzero_ps(), y);
+  __m256 dz = _mm256_set1_ps(1);
+  __m256 il = _mm256_div_ps(_mm256_set1_ps(1), Len8(dx, dy, dz));
+  dx = _mm256_mul_ps(dx, il);
+  dy = _mm256_mul_ps(dy, il);
+  dz = _mm256_mul_ps(dz, il);
+  __m256 c0 = _mm256_set1_ps(f.camc0), s0 = _mm256_set1_ps(f.cams0);
+  __m256 c1 = _mm256_set1_ps(f.camc1), s1 = _mm256_set1_ps(f.cams1);
+  __m256 rx = _mm256_fmsub_ps(c0, dx, _mm256_mul_ps(s0, dz));
+  __m256 rz = _mm256_fmadd_ps(s0, dx, _mm256_mul_ps(c0, dz));
+  __m256 ry = _mm256_fmsub_ps(c1, dy, _mm256_mul_ps(s1, rz));
+  rz        = _mm256_fmadd_ps(s1, dy, _mm256_mul_ps(c1, rz));
+  Vec8 dir = { rx, ry, rz };
+  return dir;
+}
+
+//map() of the active lanes, or the bound of the bricks while all of
+//them have one above bricks->exact
+TARGET_AVX2 inline __m256 MarchField8(const MarchFrame &f, const Vec8 &p, __m256 active, unsigned long long keep = ~0ull) {
+  if(!f.bricks) return MarchMap8(f, p, keep);
+  __m256 in, d = f.bricks->Bound8(p.x, p.y, p.z, f.time, active, &in);
+  __m256 near = _mm256_and_ps(in, _mm256_cmp_ps(d, _mm256_set1_ps(f.bricks->exact), _CMP_LT_OQ));
+  if(_mm256_movemask_ps(_mm256_or_ps(near, _mm256_andnot_ps(in, active)))) return MarchMap8(f, p, keep);
+  return d;
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// MarchPrune
+//   Keep bits for the primary rays of one tile. Its pixels lie in a cone
+//   from the camera; cut along the depth into pieces about 1/8 of their
+//   distance long, each piece has a bounding box and SdfGates::Mask gives
+//   its bits the first time a packet gets there. A mask is valid over two
+//   pieces so packets with lanes spread a little still use one; wider
+//   spreads and depths past MarchFar run all of map().
+//   ops counts the instructions run either way, for the stats.
+//-----------//-----------//-----------//-----------//-----------//-----------
+//map.sdf compiled again, the gates sdfc printed SdfMapPrune8 with
+struct MarchGates {
+  SdfProgram prog;
+  SdfGates   gates;
+  int        full;             //instructions of map(), no inputs or constants
+  bool       ok;               //as map_sdf.h : same size and gates
+
+  MarchGates() {
+    std::string error;
+    ok   = SdfCompile(SdfScene, &prog, &error) && (int)prog.Code.size() == SdfMapSize;
+    if(ok) gates.Build(prog);
+    ok   = ok && gates.Count() == SdfGateCount;
+    full = ok ? gates.Cost(prog, gates.Full()) : SdfMapSize;
+  }
+
+  static const MarchGates &Get() {
+    static MarchGates g;
+    return g;
+  }
+};
+
+struct MarchPrune {
+  enum { Segments = 64 };
+
+  unsigned long long mask[Segments];  //~0 where nothing is left out : SdfMap8
+  int                cost[Segments];
+  bool               built[Segments];
+  float              edge[Segments + 2];
+  float              lo[3], hi[3];  //direction components inside the cone
+  SdfInterval        iv[SdfMapSize];
+  const MarchFrame  *frame;
+  const MarchGates  *gates;         //NULL : SdfMap8
+  int                last;          //piece of the last Pick, valid over [from, to)
+  float              from, to;
+  int                full;          //instructions of map() unpruned
+  unsigned           ops;
+  unsigned           pruned;
+
+  void Build(const MarchFrame &f, int x0, int y0) {
+    const MarchGates &g = MarchGates::Get();
+    frame  = &f;
+    gates  = f.prune && g.ok ? &g : NULL;
+    full   = g.full;
+    ops    = 0;
+    pruned = 0;
+    last   = 0;
+    from   = to = 0;
+    if(!gates) return;
+
+    //cone : axis through the corner pixels, half angle to the farthest
+    Vec3 corner[4], axis = V3(0, 0, 0);
+    for(int k = 0; k < 4; k++) {
+      float px = float(x0 + (k & 1) * (GroupX - 1)), py = float(y0 + (k >> 1) * (GroupY - 1));
+      corner[k] = MarchCamera(f, -1 + 2 * px / f.sizex, 1 - 2 * py / f.sizey);
+      axis = axis + corner[k];
+    }
+    axis = Normalize(axis);
+    float cone = 0;
+    for(int k = 0; k < 4; k++) cone = fmaxf(cone, acosf(fminf(Dot(axis, corner[k]), 1)));
+    cone += 1e-3f;
+    float c[3] = { axis.x, axis.y, axis.z };
+    for(int e = 0; e < 3; e++) {
+      float a = acosf(fmaxf(-1, fminf(1, c[e])));
+      lo[e] = cosf(fminf(3.14159265f, a + cone));
+      hi[e] = cosf(fmaxf(0, a - cone));
+    }
+    edge[0] = 0;
+    for(int s = 0; s <= Segments; s++) edge[s + 1] = s < Segments ? edge[s] + fmaxf(1.0f, edge[s] * 0.125f) : 3.0e38f;
+    for(int s = 0; s < Segments; s++) built[s] = false;
+  }
+
+  //bits valid for depths [edge[s], edge[s + 2])
+  void Segment(int s) {
+    const MarchFrame &f = *frame;
+    const SdfGates   &g = gates->gates;
+    float d0 = edge[s], d1 = fminf(edge[s + 2], MarchFar * 2);
+    SdfInterval in[4];
+    for(int e = 0; e < 3; e++) {
+      float v[4] = { d0 * lo[e], d0 * hi[e], d1 * lo[e], d1 * hi[e] };
+      float m    = 1e-3f * (1 + d1);
+      in[e] = Iv(f.pos[e] + fminf(fminf(v[0], v[1]), fminf(v[2], v[3])) - m,
+                 f.pos[e] + fmaxf(fmaxf(v[0], v[1]), fmaxf(v[2], v[3])) + m);
+    }
+    in[3] = Iv(f.time, f.time);
+    unsigned long long keep = g.Mask(gates->prog, in, iv);
+    cost[s]  = g.Cost(gates->prog, keep);
+    mask[s]  = keep == g.Full() ? ~0ull : keep;
+    pruned  += __builtin_popcountll(g.Full() & ~keep);
+    built[s] = true;
+  }
+
+  //bits for depths [dmin, dmax], ~0 : all of map(). Steps of a packet
+  //mostly stay in the piece of the one before, checked first.
+  unsigned long long Pick(float dmin, float dmax) {
+    if(dmin >= from && dmax < to) {
+      ops += cost[last];
+      return mask[last];
+    }
+    if(!gates || dmax > MarchFar) return All();
+    int s = last;
+    while(s > 0 && edge[s] > dmin) s--;
+    while(s < Segments - 1 && edge[s + 1] <= dmin) s++;
+    if(dmax >= edge[s + 2]) return All();
+    if(!built[s]) Segment(s);
+    last = s;
+    from = edge[s];
+    to   = fminf(edge[s + 2], MarchFar);
+    ops += cost[s];
+    return mask[s];
+  }
+
+  unsigned long long All() {
+    ops += full;
+    return ~0ull;
+  }
+};
+
+TARGET_AVX2 inline float HorizontalMin8(__m256 v) {
+  __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+  return _mm_cvtss_f32(m);
+}
+
+TARGET_AVX2 inline float HorizontalMax8(__m256 v) {
+  __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+  m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+  m = _mm_max_ss(m, _mm_shuffle_ps(m, m, 1));
+  return _mm_cvtss_f32(m);
+}
+
+//lanes outside active keep cstart, steps counts map() calls per lane.
+//f.bricks : the bound of the brick map steps the rays, map() near a
+//surface and outside the region.
+//prune : primary rays, keep bits per step from the tile's MarchPrune.
+TARGET_AVX2 inline __m256 MarchInter8(const MarchFrame &f, const Vec8 &ro, const Vec8 &dir, __m256 active,
+  int ite, __m256 cstart, float cend, float mult, __m256i *steps, MarchPrune *prune = NULL) {
+  __m256 d  = cstart;
+  __m256 ce = _mm256_set1_ps(cend), mu = _mm256_set1_ps(mult);
+  for(int i = 0; i < ite && _mm256_movemask_ps(active); i++) {
+    Vec8 p = {
+      _mm256_fmadd_ps(dir.x, d, ro.x),
+      _mm256_fmadd_ps(dir.y, d, ro.y),
+      _mm256_fmadd_ps(dir.z, d, ro.z),
+    };
+    unsigned long long keep = ~0ull;
+    if(prune) {
+      __m256 big = _mm256_set1_ps(3.0e38f);
+      keep = prune->Pick(HorizontalMin8(_mm256_blendv_ps(big, d, active)),
+                         HorizontalMax8(_mm256_blendv_ps(_mm256_setzero_ps(), d, active)));
+    }
+    __m256 temp = MarchField8(f, p, active, keep);
+    *steps = _mm256_sub_epi32(*steps, _mm256_castps_si256(active));
+    active = _mm256_and_ps(active, _mm256_cmp_ps(temp, ce, _CMP_GE_OQ));
+    d      = _mm256_add_ps(d, _mm256_and_ps(active, _mm256_mul_ps(temp, mu)));
+  }
+  return d;
+}
+
+//MarchTrace on 8 lanes, lanes outside active keep cstart
+TARGET_AVX2 inline __m256 MarchTrace8(const MarchFrame &f, int strategy, const Vec8 &ro, const Vec8 &dir, __m256 active,
+  int ite, __m256 cstart, float cend, __m256i *steps) {
+  __m256 zero  = _mm256_setzero_ps(), one = _mm256_set1_ps(1);
+  __m256 omega = _mm256_set1_ps(strategy == MarchRelaxed ? MarchOmega : strategy == MarchBisect ? MarchBisectMult : 1);
+  __m256 k     = _mm256_set1_ps(strategy == MarchFootprint ? MarchSpread(1, f.scale) : 0);
+  __m256 ce    = _mm256_set1_ps(cend), lo = _mm256_set1_ps(1e-3f);
+  __m256 d = cstart, prev = zero, step = zero, out = cstart, cross = zero;
+  for(int i = 0; i < ite && _mm256_movemask_ps(active); i++) {
+    Vec8 p = {
+      _mm256_fmadd_ps(dir.x, d, ro.x),
+      _mm256_fmadd_ps(dir.y, d, ro.y),
+      _mm256_fmadd_ps(dir.z, d, ro.z),
+    };
+    __m256 r   = MarchField8(f, p, active);
+    __m256 eps = strategy == MarchFootprint ? _mm256_max_ps(_mm256_mul_ps(k, d), lo) : ce;
+    *steps = _mm256_sub_epi32(*steps, _mm256_castps_si256(active));
+
+    __m256 back = zero;
+    if(strategy == MarchRelaxed) {
+      back  = _mm256_and_ps(active, _mm256_and_ps(_mm256_cmp_ps(omega, one, _CMP_GT_OQ),
+              _mm256_cmp_ps(_mm256_add_ps(SdfAbs8(r), prev), step, _CMP_LT_OQ)));
+      __m256 undo = _mm256_mul_ps(step, _mm256_sub_ps(omega, one));
+      d     = _mm256_sub_ps(d, _mm256_and_ps(back, undo));
+      omega = _mm256_blendv_ps(omega, one, back);
+    }
+    __m256 go  = _mm256_andnot_ps(back, active);
+    __m256 hit = _mm256_and_ps(go, _mm256_cmp_ps(r, eps, _CMP_LT_OQ));
+    cross  = _mm256_or_ps(cross, _mm256_and_ps(hit, _mm256_cmp_ps(r, zero, _CMP_LT_OQ)));
+    active = _mm256_andnot_ps(hit, active);
+    go     = _mm256_andnot_ps(hit, go);
+    out    = _mm256_blendv_ps(out, d, go);
+    prev   = _mm256_blendv_ps(prev, SdfAbs8(r), go);
+    step   = _mm256_blendv_ps(step, _mm256_mul_ps(r, omega), go);
+    d      = _mm256_add_ps(d, _mm256_and_ps(go, step));
+  }
+  if(strategy == MarchBisect && _mm256_movemask_ps(cross)) {
+    __m256 a = out, b = d, h = _mm256_set1_ps(0.5f);
+    for(int n = 0; n < MarchBisectIte; n++) {
+      __m256 m = _mm256_mul_ps(_mm256_add_ps(a, b), h);
+      Vec8   p = { _mm256_fmadd_ps(dir.x, m, ro.x), _mm256_fmadd_ps(dir.y, m, ro.y), _mm256_fmadd_ps(dir.z, m, ro.z) };
+      __m256 in = _mm256_cmp_ps(MarchField8(f, p, cross), zero, _CMP_LT_OQ);
+      b = _mm256_blendv_ps(b, m, in);
+      a = _mm256_blendv_ps(m, a, in);
+      *steps = _mm256_sub_epi32(*steps, _mm256_castps_si256(cross));
+    }
+    d = _mm256_blendv_ps(d, _mm256_mul_ps(_mm256_add_ps(a, b), h), cross);
+  }
+  return d;
+}
+
+//8 primary rays that stopped at d : getnormal, shadow ray, colour, to the
+//8 MarchColor of out
+TARGET_AVX2 inline void MarchShade8(const MarchFrame &f, const Vec8 &pos, const Vec8 &dir, __m256 d, __m256i *steps, int *rays,
+  MarchColor *out) {
+  __m256 hit = _mm256_cmp_ps(d, _mm256_set1_ps(MarchFar), _CMP_LE_OQ);
+
+  __m256 r = d, g = d, b = d;
+  if(_mm256_movemask_ps(hit)) {
+    Vec8 ip = { _mm256_fmadd_ps(dir.x, d, pos.x), _mm256_fmadd_ps(dir.y, d, pos.y), _mm256_fmadd_ps(dir.z, d, pos.z) };
+
+    //getnormal
+    __m256 nx, ny, nz;
+    if(f.grad) {
+      __m256 g[3];
+      SdfMapGrad8(ip.x, ip.y, ip.z, f.time, g);
+      nx = g[0];
+      ny = g[1];
+      nz = g[2];
+    } else {
+      __m256 c  = MarchMap8(f, ip);
+      __m256 e  = _mm256_set1_ps(0.01f);
+      Vec8   px = { _mm256_add_ps(ip.x, e), ip.y, ip.z };
+      Vec8   py = { ip.x, _mm256_add_ps(ip.y, e), ip.z };
+      Vec8   pz = { ip.x, ip.y, _mm256_add_ps(ip.z, e) };
+      nx = _mm256_sub_ps(MarchMap8(f, px), c);
+      ny = _mm256_sub_ps(MarchMap8(f, py), c);
+      nz = _mm256_sub_ps(MarchMap8(f, pz), c);
+    }
+    __m256 in = _mm256_div_ps(_mm256_set1_ps(1), Len8(nx, ny, nz));
+    nx = _mm256_mul_ps(nx, in);
+    ny = _mm256_mul_ps(ny, in);
+    nz = _mm256_mul_ps(nz, in);
+
+    //shadow ray where dot(N, L1) < 0
+    __m256 lx = _mm256_set1_ps(f.light[0]), ly = _mm256_set1_ps(f.light[1]), lz = _mm256_set1_ps(f.light[2]);
+    __m256 nl = _mm256_fmadd_ps(nx, lx, _mm256_fmadd_ps(ny, ly, _mm256_mul_ps(nz, lz)));
+    __m256 sh = _mm256_and_ps(hit, _mm256_cmp_ps(nl, _mm256_setzero_ps(), _CMP_LT_OQ));
+    __m256 S  = _mm256_set1_ps(1);
+    if(_mm256_movemask_ps(sh)) {
+      __m256 o  = _mm256_set1_ps(1.5f);
+      Vec8   so = { _mm256_fmadd_ps(nx, o, ip.x), _mm256_fmadd_ps(ny, o, ip.y), _mm256_fmadd_ps(nz, o, ip.z) };
+      Vec8   sd = { _mm256_sub_ps(_mm256_setzero_ps(), lx), _mm256_sub_ps(_mm256_setzero_ps(), ly), _mm256_sub_ps(_mm256_setzero_ps(), lz) };
+      __m256 t  = MarchInter8(f, so, sd, sh, MarchShadowIte, _mm256_setzero_ps(), 0.1f, 0.95f, steps);
+      S = _mm256_add_ps(S, _mm256_and_ps(sh, _mm256_max_ps(t, _mm256_set1_ps(1))));
+      for(int m = _mm256_movemask_ps(sh); m; m &= m - 1) (*rays)++;
+    }
+    __m256 pos0 = _mm256_cmp_ps(nl, _mm256_setzero_ps(), _CMP_GT_OQ);
+    __m256 D    = _mm256_blendv_ps(_mm256_set1_ps(0.01f), _mm256_max_ps(_mm256_mul_ps(nl, nl), _mm256_set1_ps(0.01f)), pos0);
+    D = _mm256_mul_ps(_mm256_mul_ps(D, S), _mm256_set1_ps(0.01f));
+    __m256 h = _mm256_set1_ps(0.5f);
+    r = _mm256_blendv_ps(d, _mm256_mul_ps(D, _mm256_fmadd_ps(dir.x, h, _mm256_set1_ps(4))), hit);
+    g = _mm256_blendv_ps(d, _mm256_mul_ps(D, _mm256_fmadd_ps(dir.y, h, _mm256_set1_ps(2))), hit);
+    b = _mm256_blendv_ps(d, _mm256_mul_ps(D, _mm256_fmadd_ps(dir.z, h, _mm256_set1_ps(1))), hit);
+  }
+
+  //SoA -> float4 per pixel
+  __m256 t0 = _mm256_unpacklo_ps(r, g), t1 = _mm256_unpackhi_ps(r, g);
+  __m256 t2 = _mm256_unpacklo_ps(b, d), t3 = _mm256_unpackhi_ps(b, d);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+  float *o = &out->r;
+  _mm256_storeu_ps(o +  0, _mm256_permute2f128_ps(u0, u1, 0x20));
+  _mm256_storeu_ps(o +  8, _mm256_permute2f128_ps(u2, u3, 0x20));
+  _mm256_storeu_ps(o + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+  _mm256_storeu_ps(o + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+}
+
+//start : depth of the 8 rays to start at, stride : pixels between them
+TARGET_AVX2 inline void MarchPixel8(const MarchFrame &f, int tx, int ty, const float *start, MarchColor *out, __m256i *steps, int *rays,
+  MarchPrune *prune, int stride = 1) {
+  __m256 x = _mm256_fmadd_ps(_mm256_set1_ps(float(stride)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(float(tx)));
+  x = _mm256_add_ps(_mm256_set1_ps(-1), _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(2), x), _mm256_set1_ps(f.sizex)));
+  float y = -1 + (2 * float(ty) / f.sizey);
+  Vec8  dir = MarchCamera8(f, x, _mm256_set1_ps(y));
+  Vec8  pos = { _mm256_set1_ps(f.pos[0]), _mm256_set1_ps(f.pos[1]), _mm256_set1_ps(f.pos[2]) };
+
+  __m256 all = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+  __m256 d   = f.strategy == MarchClassic ? MarchInter8(f, pos, dir, all, MarchIte, _mm256_loadu_ps(start), 0.03f, 1.0f, steps, prune)
+                                         : MarchTrace8(f, f.strategy, pos, dir, all, MarchIte, _mm256_loadu_ps(start), 0.03f, steps);
+  *rays += 8;
+  MarchColor spread[8];
+  MarchShade8(f, pos, dir, d, steps, rays, stride == 1 ? out : spread);
+  for(int k = 0; stride != 1 && k < 8; k++) out[k * stride] = spread[k];
+}
+
+//n blocks of the lists from in to out, 8 cones per packet as MarchConeRay
+TARGET_AVX2 inline unsigned MarchCone8(const MarchFrame &f, int step, int n, const int *bx, const int *by, const float *in, float *out) {
+  Vec8    pos   = { _mm256_set1_ps(f.pos[0]), _mm256_set1_ps(f.pos[1]), _mm256_set1_ps(f.pos[2]) };
+  __m256  k     = _mm256_set1_ps(MarchSpread(step, f.scale)), ik = _mm256_set1_ps(1 / (1 + MarchSpread(step, f.scale)));
+  __m256  ce    = _mm256_set1_ps(0.03f), far = _mm256_set1_ps(MarchFar);
+  __m256i steps = _mm256_setzero_si256();
+  for(int b = 0; b < n; b += 8) {
+    int   count = n - b < 8 ? n - b : 8;
+    float x[8], y[8], d0[8], d1[8];
+    for(int l = 0; l < 8; l++) {
+      int m = b + (l < count ? l : 0);
+      x[l]  = MarchBlockX(step, bx[m], f.scale);
+      y[l]  = MarchBlockY(step, by[m], f.scale);
+      d0[l] = in[m];
+    }
+    Vec8   dir    = MarchCamera8(f, _mm256_loadu_ps(x), _mm256_loadu_ps(y));
+    __m256 active = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+    __m256 d      = _mm256_loadu_ps(d0);
+    active = _mm256_and_ps(active, _mm256_cmp_ps(d, far, _CMP_LE_OQ));
+    for(int i = 0; i < MarchIte && _mm256_movemask_ps(active); i++) {
+      Vec8 p = {
+        _mm256_fmadd_ps(dir.x, d, pos.x),
+        _mm256_fmadd_ps(dir.y, d, pos.y),
+        _mm256_fmadd_ps(dir.z, d, pos.z),
+      };
+      __m256 gap = _mm256_fnmadd_ps(k, d, MarchMap8(f, p));
+      steps  = _mm256_sub_epi32(steps, _mm256_castps_si256(active));
+      active = _mm256_and_ps(active, _mm256_cmp_ps(gap, ce, _CMP_GE_OQ));
+      d      = _mm256_add_ps(d, _mm256_and_ps(active, _mm256_mul_ps(gap, ik)));
+      active = _mm256_and_ps(active, _mm256_cmp_ps(d, far, _CMP_LE_OQ));
+    }
+    _mm256_storeu_ps(d1, d);
+    for(int l = 0; l < count; l++) out[b + l] = d1[l];
+  }
+  unsigned s[8];
+  _mm256_storeu_si256((__m256i *)s, steps);
+  return s[0] + s[1] + s[2] + s[3] + s[4] + s[5] + s[6] + s[7];
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// MarchPacket8 : the n x n primary rays from tx, ty marched as one packet,
+//   start their depths (rows GroupX apart, as the tile's), returns the
+//   map() calls of its blocks.
+//   - top : depth of the one cone that holds all its rays, marched while
+//     map() clears its radius (MarchCone8, 8 packets of the tile at once) :
+//     a map() call steps n x n rays
+//   - where it stops they diverge : 8 blocks of n/2 x n/4 go on from its
+//     depth, one lane each
+//   - the rays from their block's depth, 8 per vector, as MarchInter8 ;
+//     the ones still marching are packed to the front after every step,
+//     so a vector only runs with a lane or two when that is all left
+//   then shaded 8 at a time. Not pruned.
+//-----------//-----------//-----------//-----------//-----------//-----------
+TARGET_AVX2 inline unsigned MarchPacket8(const MarchFrame &f, int n, int tx, int ty, float top, const float *start, MarchColor *buffer,
+  __m256i *steps, int *rays) {
+  Vec8 pos = { _mm256_set1_ps(f.pos[0]), _mm256_set1_ps(f.pos[1]), _mm256_set1_ps(f.pos[2]) };
+
+  //the 8 blocks, 2 across and 4 down
+  const int w = n / 2, h = n / 4;
+  float     bx[8], by[8], split[8];
+  for(int b = 0; b < 8; b++) {
+    bx[b] = -1 + 2 * (tx + (b & 1) * w + (w - 1) * 0.5f) / f.sizex;
+    by[b] = -1 + 2 * (ty + (b >> 1) * h + (h - 1) * 0.5f) / f.sizey;
+  }
+  Vec8    bdir  = MarchCamera8(f, _mm256_loadu_ps(bx), _mm256_loadu_ps(by));
+  float   kb    = MarchSpread(w, h, f.scale);
+  __m256  k     = _mm256_set1_ps(kb), ik = _mm256_set1_ps(1 / (1 + kb));
+  __m256  ce    = _mm256_set1_ps(0.03f), far = _mm256_set1_ps(MarchFar);
+  __m256  d     = _mm256_set1_ps(top);
+  __m256  live  = _mm256_cmp_ps(d, far, _CMP_LE_OQ);
+  __m256i calls = _mm256_setzero_si256();
+  for(int i = 0; i < MarchIte && _mm256_movemask_ps(live); i++) {
+    Vec8   p   = { _mm256_fmadd_ps(bdir.x, d, pos.x), _mm256_fmadd_ps(bdir.y, d, pos.y), _mm256_fmadd_ps(bdir.z, d, pos.z) };
+    __m256 gap = _mm256_fnmadd_ps(k, d, MarchMap8(f, p));
+    calls = _mm256_sub_epi32(calls, _mm256_castps_si256(live));
+    live  = _mm256_and_ps(live, _mm256_cmp_ps(gap, ce, _CMP_GE_OQ));
+    d     = _mm256_add_ps(d, _mm256_and_ps(live, _mm256_mul_ps(gap, ik)));
+    live  = _mm256_and_ps(live, _mm256_cmp_ps(d, far, _CMP_LE_OQ));
+  }
+  _mm256_storeu_ps(split, d);
+  unsigned c[8];
+  _mm256_storeu_si256((__m256i *)c, calls);
+
+  //the rays in packet order, then the ones marching packed in rx.. ri
+  const int nn = n * n;
+  float     ox[64], oy[64], oz[64], depth[64];
+  float     rx[64], ry[64], rz[64], rd[64];
+  int       rn[64], ri[64];
+  for(int j = 0; j < nn; j += 8) {
+    float x[8], y[8];
+    for(int l = 0; l < 8; l++) {
+      int i = j + l, u = i % n, v = i / n;
+      x[l]  = -1 + 2 * float(tx + u) / f.sizex;
+      y[l]  = -1 + 2 * float(ty + v) / f.sizey;
+      rd[i] = std::max(split[u / w + 2 * (v / h)], start[u + v * GroupX]);
+      rn[i] = 0;
+      ri[i] = i;
+    }
+    Vec8 dir = MarchCamera8(f, _mm256_loadu_ps(x), _mm256_loadu_ps(y));
+    _mm256_storeu_ps(ox + j, dir.x);
+    _mm256_storeu_ps(oy + j, dir.y);
+    _mm256_storeu_ps(oz + j, dir.z);
+  }
+  memcpy(rx, ox, sizeof(float) * nn);
+  memcpy(ry, oy, sizeof(float) * nn);
+  memcpy(rz, oz, sizeof(float) * nn);
+  __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), ite = _mm256_set1_epi32(MarchIte);
+  for(int count = nn; count;) {
+    int kept = 0;
+    for(int j = 0; j < count; j += 8) {
+      __m256  on  = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(count - j), lane));
+      Vec8    dir = { _mm256_loadu_ps(rx + j), _mm256_loadu_ps(ry + j), _mm256_loadu_ps(rz + j) };
+      __m256  t   = _mm256_loadu_ps(rd + j);
+      Vec8    p   = { _mm256_fmadd_ps(dir.x, t, pos.x), _mm256_fmadd_ps(dir.y, t, pos.y), _mm256_fmadd_ps(dir.z, t, pos.z) };
+      __m256  r   = MarchField8(f, p, on);
+      __m256i it  = _mm256_sub_epi32(_mm256_loadu_si256((__m256i *)(rn + j)), _mm256_castps_si256(on));
+      *steps = _mm256_sub_epi32(*steps, _mm256_castps_si256(on));
+      __m256 go = _mm256_and_ps(on, _mm256_cmp_ps(r, ce, _CMP_GE_OQ));
+      t  = _mm256_add_ps(t, _mm256_and_ps(go, r));
+      go = _mm256_and_ps(go, _mm256_castsi256_ps(_mm256_cmpgt_epi32(ite, it)));
+      _mm256_storeu_ps(rd + j, t);
+      _mm256_storeu_si256((__m256i *)(rn + j), it);
+      //to the front : kept <= j + l, the slots behind are read already
+      int m = _mm256_movemask_ps(go), lanes = count - j < 8 ? count - j : 8;
+      for(int l = 0; l < lanes; l++) {
+        int i = j + l;
+        if(!(m >> l & 1)) {
+          depth[ri[i]] = rd[i];
+          continue;
+        }
+        rx[kept] = rx[i];
+        ry[kept] = ry[i];
+        rz[kept] = rz[i];
+        rd[kept] = rd[i];
+        rn[kept] = rn[i];
+        ri[kept] = ri[i];
+        kept++;
+      }
+    }
+    count = kept;
+  }
+
+  for(int j = 0; j < nn; j += 8) {
+    Vec8       dir = { _mm256_loadu_ps(ox + j), _mm256_loadu_ps(oy + j), _mm256_loadu_ps(oz + j) };
+    MarchColor out[8];
+    MarchShade8(f, pos, dir, _mm256_loadu_ps(depth + j), steps, rays, out);
+    for(int l = 0; l < 8; l++) buffer[tx + (j + l) % n + (ty + (j + l) / n) * ScreenX] = out[l];
+  }
+  *rays += nn;
+  return c[0] + c[1] + c[2] + c[3] + c[4] + c[5] + c[6] + c[7];
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// MarchHistory
+//   The last frame's depth (.w) and camera. Every hit of it is moved into
+//   this frame's view and lands on the pixel it now covers, nearest wins.
+//   A pixel starts its ray at the nearest depth landed within
+//   MarchReprojRadius of it, times MarchReprojKeep. Pixels nothing landed
+//   on were hidden or sky last frame and march from the camera, as do the
+//   screen's border and a start map() finds inside a surface. The scene
+//   moves too (rotate) : the radius covers the spheres' silhouettes
+//   moving a few pixels a frame, the keep their depth.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct MarchHistory {
+  std::vector<float>                       depth;   //.w of the last frame
+  std::unique_ptr<std::atomic<unsigned>[]> landed;  //float bits of the nearest depth landed, ~0u : none
+  std::vector<unsigned>                    across;  //nearest of landed along the row's window, 0 : none
+  std::vector<float>                       start;   //this frame's start, 0 : march from the camera
+  MarchFrame                               last;
+  bool                                     valid;
+
+  void Init() {
+    depth.assign((size_t)ScreenX * ScreenY, 0);
+    start.assign((size_t)ScreenX * ScreenY, 0);
+    across.assign((size_t)ScreenX * ScreenY, 0);
+    landed.reset(new std::atomic<unsigned>[(size_t)ScreenX * ScreenY]);
+    valid = false;
+  }
+
+  //after the frame : keep its depth and camera
+  void Store(const MarchFrame &f, const MarchColor *buffer) {
+    for(size_t i = 0; i < depth.size(); i++) depth[i] = buffer[i].a;
+    last  = f;
+    valid = true;
+  }
+};
+
+//start of every pixel of f from h's last frame, jobs may be NULL
+//the frames may be at different scales
+inline void MarchReproject(JobSystem *jobs, const MarchFrame &f, MarchHistory *h) {
+  const MarchFrame &l = h->last;
+  const int w = f.tilesx * GroupX, ht = f.tilesy * GroupY;
+  auto rows = [&](int n, const std::function<void(int)> &func) {
+    if(!jobs) {
+      for(int y = 0; y < n; y++) func(y);
+      return;
+    }
+    jobs->ParallelFor(n, 8, [&](int b, int e, int) { for(int y = b; y < e; y++) func(y); });
+  };
+  rows(ht, [&](int y) {
+    for(int x = 0; x < w; x++) h->landed[x + y * ScreenX].store(~0u, std::memory_order_relaxed);
+  });
+  Vec3 lpos = V3(l.pos[0], l.pos[1], l.pos[2]), pos = V3(f.pos[0], f.pos[1], f.pos[2]);
+  rows(l.tilesy * GroupY, [&](int y) {
+    for(int x = 0; x < l.tilesx * GroupX; x++) {
+      float d = h->depth[x + y * ScreenX], tx, ty;
+      if(!(d <= MarchFar)) continue;
+      Vec3 p = lpos + MarchCamera(l, -1 + 2 * float(x) / l.sizex, 1 - 2 * float(y) / l.sizey) * d;
+      if(!MarchProject(f, p, &tx, &ty)) continue;
+      int ix = (int)floorf(tx + 0.5f), iy = (int)floorf(ty + 0.5f);
+      if(ix < 0 || iy < 0 || ix >= w || iy >= ht) continue;
+      Vec3     w = p - pos;
+      float    r = sqrtf(Dot(w, w));
+      unsigned bits;
+      memcpy(&bits, &r, 4);
+      //positive floats order as their bits
+      std::atomic<unsigned> &dst = h->landed[ix + iy * ScreenX];
+      unsigned old = dst.load(std::memory_order_relaxed);
+      while(bits < old && !dst.compare_exchange_weak(old, bits, std::memory_order_relaxed)) {}
+    }
+  });
+  //nearest over the window, a row then a column; windows off the screen
+  //may miss what comes into view and start from the camera
+  const int k = MarchReprojRadius;
+  rows(ht, [&](int y) {
+    for(int x = 0; x < w; x++) {
+      unsigned m = x < k || x >= w - k ? 0u : ~0u;
+      for(int u = x - k; m && u <= x + k; u++) {
+        unsigned n = h->landed[u + y * ScreenX].load(std::memory_order_relaxed);
+        m = n < m ? n : m;
+      }
+      h->across[x + y * ScreenX] = m;
+    }
+  });
+  rows(ht, [&](int y) {
+    for(int x = 0; x < w; x++) {
+      unsigned m = y < k || y >= ht - k || h->landed[x + y * ScreenX].load(std::memory_order_relaxed) == ~0u ? 0u : ~0u;
+      for(int v = y - k; m && v <= y + k; v++) m = h->across[x + v * ScreenX] < m ? h->across[x + v * ScreenX] : m;
+      float r = 0;
+      if(m != ~0u) memcpy(&r, &m, 4);
+      h->start[x + y * ScreenX] = r * MarchReprojKeep;
+    }
+  });
+}
+
+//the tile's starts raised to the history's where map() there is not
+//inside a surface, returns the rays raised and adds the map() calls
+inline unsigned MarchReuse(const MarchFrame &f, int x0, int y0, float *start, unsigned *steps) {
+  Vec3     pos  = V3(f.pos[0], f.pos[1], f.pos[2]);
+  unsigned used = 0;
+  for(int y = y0; y < y0 + GroupY; y++) {
+    for(int x = x0; x < x0 + GroupX; x++) {
+      float &s = start[(y - y0) * GroupX + x - x0], r = f.history->start[x + y * ScreenX];
+      if(r <= s || !MarchMarched(f.sparse, f.phase, x, y)) continue;
+      Vec3 dir = MarchCamera(f, -1 + 2 * float(x) / f.sizex, 1 - 2 * float(y) / f.sizey);
+      (*steps)++;
+      if(MarchMap(f, pos + dir * r) < 0) continue;
+      s = r;
+      used++;
+    }
+  }
+  return used;
+}
+
+TARGET_AVX2 inline unsigned MarchReuse8(const MarchFrame &f, int x0, int y0, float *start, unsigned *steps) {
+  Vec8     pos  = { _mm256_set1_ps(f.pos[0]), _mm256_set1_ps(f.pos[1]), _mm256_set1_ps(f.pos[2]) };
+  unsigned used = 0;
+  for(int y = y0; y < y0 + GroupY; y++) {
+    float ny = -1 + (2 * float(y) / f.sizey);
+    int   o  = MarchRowStart(f.sparse, f.phase, y);
+    if(o < 0) continue;
+    //lanes of the pixels marched this frame, GroupX is a multiple of 8
+    __m256 lanes = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    if(f.sparse != MarchEvery) {
+      lanes = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(1)),
+        _mm256_set1_epi32(o)));
+    }
+    for(int x = x0; x < x0 + GroupX; x += 8) {
+      float *s  = &start[(y - y0) * GroupX + x - x0];
+      __m256 a  = _mm256_loadu_ps(s), r = _mm256_loadu_ps(&f.history->start[x + y * ScreenX]);
+      __m256 up = _mm256_and_ps(lanes, _mm256_cmp_ps(r, a, _CMP_GT_OQ));
+      int    m  = _mm256_movemask_ps(up);
+      if(!m) continue;
+      __m256 nx = _mm256_add_ps(_mm256_set1_ps(float(x)), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+      nx = _mm256_add_ps(_mm256_set1_ps(-1), _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(2), nx), _mm256_set1_ps(f.sizex)));
+      Vec8 dir = MarchCamera8(f, nx, _mm256_set1_ps(ny));
+      Vec8 p   = { _mm256_fmadd_ps(dir.x, r, pos.x), _mm256_fmadd_ps(dir.y, r, pos.y), _mm256_fmadd_ps(dir.z, r, pos.z) };
+      up = _mm256_and_ps(up, _mm256_cmp_ps(MarchMap8(f, p), _mm256_setzero_ps(), _CMP_GE_OQ));
+      _mm256_storeu_ps(s, _mm256_blendv_ps(a, r, up));
+      for(; m; m &= m - 1) (*steps)++;
+      for(int k = _mm256_movemask_ps(up); k; k &= k - 1) used++;
+    }
+  }
+  return used;
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// MarchSparse
+//   Half (checkerboard) or a quarter (2 x 2 in turn) of the pixels are
+//   marched per frame, MarchResolve rebuilds the others. A pixel not
+//   marched takes the depth of the nearest marched one around it and the
+//   mean colour of the marched ones at that depth. With history it is
+//   moved at that depth into the last frame's view : colour (bilinear)
+//   and depth (nearest texel, from this camera) there are taken instead,
+//   each clamped to the range of the marched ones around it. The clamp
+//   is what rejects, a disoccluded or moved pixel lands inside their
+//   range as the mean would. The depth matters as much as the colour,
+//   ps_main fogs by it.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct MarchSparse {
+  int                     mode;     //MarchSparseMode
+  unsigned                frame;    //phase of the pattern, one up per frame
+  bool                    history;  //rebuild from the last frame too, SparseHistory
+  std::vector<MarchColor> last;     //last frame, rebuilt
+  MarchFrame              lastf;
+  bool                    valid;
+
+  void Init(int m, bool h = SparseHistory != 0) {
+    mode    = m;
+    frame   = 0;
+    history = h;
+    valid   = false;
+    last.clear();
+  }
+};
+
+inline void MarchResolve(JobSystem *jobs, const MarchFrame &f, const MarchSparse *s, MarchColor *buffer) {
+  const int         k = f.sparse == MarchQuad ? 2 : 1, w = f.tilesx * GroupX, h = f.tilesy * GroupY;
+  const MarchFrame &l = s->lastf;
+  const int         lw = l.tilesx * GroupX, lh = l.tilesy * GroupY;
+  const bool        back = s->history && s->valid && lw > 1 && lh > 1;
+  Vec3 pos = V3(f.pos[0], f.pos[1], f.pos[2]), lpos = V3(l.pos[0], l.pos[1], l.pos[2]);
+  auto rows = [&](int b, int e, int) {
+    for(int y = b; y < e; y++) {
+      for(int x = 0; x < w; x++) {
+        if(MarchMarched(f.sparse, f.phase, x, y)) continue;
+        //the marched ones around it, every 2nd pixel of their rows
+        const MarchColor *near[9];
+        int               m = 0;
+        for(int v = y - k; v <= y + k; v++) {
+          int o = v < 0 || v >= h ? -1 : MarchRowStart(f.sparse, f.phase, v);
+          if(o < 0) continue;
+          for(int u = x - k + ((x - k - o) & 1); u <= x + k; u += 2) {
+            if(u >= 0 && u < w) near[m++] = &buffer[u + v * ScreenX];
+          }
+        }
+        //their range, colour and depth
+        float lo[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX }, hi[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for(int j = 0; j < m; j++) {
+          for(int i = 0; i < 4; i++) {
+            float c = (&near[j]->r)[i];
+            lo[i]   = c < lo[i] ? c : lo[i];
+            hi[i]   = c > hi[i] ? c : hi[i];
+          }
+        }
+        float depth = lo[3];
+        //of those, the ones at the nearest depth
+        MarchColor out = { 0, 0, 0, depth };
+        int        n   = 0;
+        for(int j = 0; j < m; j++) {
+          if(near[j]->a > depth * 1.1f) continue;
+          out.r += near[j]->r;
+          out.g += near[j]->g;
+          out.b += near[j]->b;
+          n++;
+        }
+        if(n) {
+          out.r /= n;
+          out.g /= n;
+          out.b /= n;
+        }
+        //the last frame there, inside their range
+        float tx, ty;
+        if(!back || !n || depth > MarchFar) {
+          buffer[x + y * ScreenX] = out;
+          continue;
+        }
+        Vec3 p = pos + MarchCamera(f, -1 + 2 * float(x) / f.sizex, 1 - 2 * float(y) / f.sizey) * depth;
+        if(MarchProject(l, p, &tx, &ty) && tx >= 0 && ty >= 0 && tx <= lw - 1 && ty <= lh - 1) {
+          int   x0 = std::min((int)tx, lw - 2), y0 = std::min((int)ty, lh - 2);
+          float fx = tx - x0, fy = ty - y0;
+          const MarchColor *q = &s->last[x0 + y0 * ScreenX];
+          for(int i = 0; i < 3; i++) {
+            float top    = (&q[0].r)[i] + ((&q[1].r)[i] - (&q[0].r)[i]) * fx;
+            float bottom = (&q[ScreenX].r)[i] + ((&q[ScreenX + 1].r)[i] - (&q[ScreenX].r)[i]) * fx;
+            (&out.r)[i]  = std::min(std::max(top + (bottom - top) * fy, lo[i]), hi[i]);
+          }
+          int   ix = (int)(tx + 0.5f), iy = (int)(ty + 0.5f);
+          float d  = s->last[ix + iy * ScreenX].a;
+          if(d <= MarchFar) {
+            Vec3 v = lpos + MarchCamera(l, -1 + 2 * float(ix) / l.sizex, 1 - 2 * float(iy) / l.sizey) * d - pos;
+            out.a  = std::min(std::max(sqrtf(Dot(v, v)), lo[3]), hi[3]);
+          }
+        }
+        buffer[x + y * ScreenX] = out;
+      }
+    }
+  };
+  if(jobs) jobs->ParallelFor(h, 8, rows);
+  else     rows(0, h, 0);
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// tiles
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+// MarchStart : depth each primary ray of the tile starts at, returns the
+//   map() calls it took.
+//   cone : the tile's blocks of the MarchCone, kept in its buffer too,
+//   then split level by level down to cone->leaf.
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline unsigned MarchStart(const MarchFrame &f, bool simd, int x0, int y0, float *start) {
+  int step = f.cone ? f.cone->step : 0;
+  if(!step) {
+    for(int i = 0; i < GroupX * GroupY; i++) start[i] = 0;
+    return 0;
+  }
+  int      bx[GroupX * GroupY], by[GroupX * GroupY], n = 0;
+  float    in[GroupX * GroupY], out[GroupX * GroupY];
+  unsigned steps = 0;
+  for(int y = y0 / step; y < (y0 + GroupY) / step; y++) {
+    for(int x = x0 / step; x < (x0 + GroupX) / step; x++, n++) {
+      bx[n] = x;
+      by[n] = y;
+      in[n] = 0;
+    }
+  }
+  for(;;) {
+    if(simd) {
+      steps += MarchCone8(f, step, n, bx, by, in, out);
+    } else {
+      for(int i = 0; i < n; i++) out[i] = MarchConeRay(f, step, bx[i], by[i], in[i], &steps);
+    }
+    if(step == f.cone->step) {
+      for(int i = 0; i < n; i++) f.cone->start[bx[i] + by[i] * f.cone->x] = out[i];
+    }
+    if(step <= f.cone->leaf) break;
+    //children in place, from the back so no parent is overwritten before it is read
+    for(int i = n - 1; i >= 0; i--) {
+      for(int c = 3; c >= 0; c--) {
+        bx[i * 4 + c] = bx[i] * 2 + (c & 1);
+        by[i * 4 + c] = by[i] * 2 + (c >> 1);
+        in[i * 4 + c] = out[i];
+      }
+    }
+    n    *= 4;
+    step /= 2;
+  }
+  for(int i = 0; i < n; i++) {
+    for(int y = 0; y < step; y++) {
+      for(int x = 0; x < step; x++) start[(by[i] * step - y0 + y) * GroupX + bx[i] * step - x0 + x] = out[i];
+    }
+  }
+  return steps;
+}
+
+TARGET_AVX2 inline void MarchTileAVX2(const MarchFrame &f, int tile, MarchColor *buffer, MarchTileStat *stat) {
+  int x0 = (tile % f.tilesx) * GroupX, y0 = (tile / f.tilesx) * GroupY;
+  __m256i steps = _mm256_setzero_si256();
+  int     rays  = 0;
+  float   start[GroupX * GroupY];
+  stat->cone   = MarchStart(f, true, x0, y0, start);
+  stat->reproj = f.history ? MarchReuse8(f, x0, y0, start, &stat->cone) : 0;
+  MarchPrune prune;
+  prune.Build(f, x0, y0);
+  bool packets = f.packet && f.sparse == MarchEvery;
+  if(packets) {
+    //the cone of every packet, then the packets
+    int   n = f.packet, m = 0, bx[GroupX * GroupY] = {}, by[GroupX * GroupY] = {};
+    float in[GroupX * GroupY] = {}, top[GroupX * GroupY];
+    for(int y = y0 / n; y < (y0 + GroupY) / n; y++) {
+      for(int x = x0 / n; x < (x0 + GroupX) / n; x++, m++) {
+        bx[m] = x;
+        by[m] = y;
+        in[m] = 0;
+      }
+    }
+    stat->cone += MarchCone8(f, n, m, bx, by, in, top);
+    for(int i = 0; i < m; i++) {
+      int x = bx[i] * n, y = by[i] * n;
+      stat->cone += MarchPacket8(f, n, x, y, top[i], &start[(y - y0) * GroupX + x - x0], buffer, &steps, &rays);
+    }
+  }
+  for(int y = y0; !packets && y < y0 + GroupY; y++) {
+    int o = MarchRowStart(f.sparse, f.phase, y);
+    if(o < 0) continue;
+    if(f.sparse == MarchEvery) {
+      for(int x = x0; x < x0 + GroupX; x += 8) {
+        MarchPixel8(f, x, y, &start[(y - y0) * GroupX + x - x0], &buffer[x + y * ScreenX], &steps, &rays, &prune);
+      }
+      continue;
+    }
+    //every 2nd pixel : 8 rays over 16
+    for(int x = x0 + o; x < x0 + GroupX; x += 16) {
+      float s[8];
+      for(int k = 0; k < 8; k++) s[k] = start[(y - y0) * GroupX + x - x0 + k * 2];
+      MarchPixel8(f, x, y, s, &buffer[x + y * ScreenX], &steps, &rays, &prune, 2);
+    }
+  }
+  unsigned s[8];
+  _mm256_storeu_si256((__m256i *)s, steps);
+  stat->steps  = s[0] + s[1] + s[2] + s[3] + s[4] + s[5] + s[6] + s[7];
+  stat->rays   = rays;
+  stat->ops    = prune.ops * 8;
+  stat->pruned = prune.pruned;
+}
+
+inline void MarchTileScalar(const MarchFrame &f, int tile, MarchColor *buffer, MarchTileStat *stat) {
+  int x0 = (tile % f.tilesx) * GroupX, y0 = (tile / f.tilesx) * GroupY;
+  unsigned steps = 0, rays = 0;
+  float    start[GroupX * GroupY];
+  stat->cone   = MarchStart(f, false, x0, y0, start);
+  stat->reproj = f.history ? MarchReuse(f, x0, y0, start, &stat->cone) : 0;
+  for(int y = y0; y < y0 + GroupY; y++) {
+    int o = MarchRowStart(f.sparse, f.phase, y);
+    for(int x = x0 + o; o >= 0 && x < x0 + GroupX; x += MarchRowStep(f.sparse)) {
+      buffer[x + y * ScreenX] = MarchPixel(f, x, y, start[(y - y0) * GroupX + x - x0], &steps, &rays);
+    }
+  }
+  stat->steps  = steps;
+  stat->rays   = rays;
+  stat->ops    = 0;
+  stat->pruned = 0;
+}
+
+inline void MarchTile(const MarchFrame &f, int isa, int tile, MarchColor *buffer, MarchTileStat *stat) {
+  auto start = std::chrono::high_resolution_clock::now();
+  if(isa == IsaAVX2 && GroupX % 8 == 0) MarchTileAVX2(f, tile, buffer, stat);
+  else                                  MarchTileScalar(f, tile, buffer, stat);
+  stat->ms = (float)std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// MarchRender : one Dispatch worth of tiles, buffer is ScreenX * ScreenY.
+//   opt.bricks : baked still part of map() for inter() (brick.h)
+//   opt.cone : cone prepass, written with the start of every block
+//   opt.strategy : inter() of the primary rays
+//   opt.history : start from the last frame stored there, then store this one
+//   opt.sparse : march its pixels of the frame, rebuild the rest around them
+//     and from the last frame
+//   opt.scale : render the top left tiles only, stat past them is cleared
+//   opt.prune : primary rays run map() pruned to the tile's depth ranges
+//   opt.packet : primary rays as n x n packets, MarchPacket8
+//-----------//-----------//-----------//-----------//-----------//-----------
+//the stat of the tiles not rendered at f's scale
+inline void MarchClearStat(const MarchFrame &f, MarchTileStat *stat) {
+  for(int t = f.tilesx * f.tilesy; t < MarchTilesX * MarchTilesY; t++) stat[t] = MarchTileStat();
+}
+
+//the pattern of the frame, before the tiles
+inline void MarchSparseBegin(MarchFrame &f, const MarchOptions &opt) {
+  if(!opt.sparse) return;
+  f.sparse = opt.sparse->mode;
+  f.phase  = opt.sparse->frame;
+}
+
+//after the tiles : rebuild, keep for the next frame, next phase
+inline void MarchSparseEnd(JobSystem *jobs, const MarchFrame &f, const MarchOptions &opt, MarchColor *buffer) {
+  MarchSparse *s = opt.sparse;
+  if(!s) return;
+  if(s->mode != MarchEvery) MarchResolve(jobs, f, s, buffer);
+  if(s->history) {
+    s->last.assign(buffer, buffer + (size_t)ScreenX * ScreenY);
+    s->lastf = f;
+    s->valid = true;
+  }
+  s->frame++;
+}
+
+inline void MarchRender(JobSystem *jobs, int isa, float time, MarchColor *buffer, MarchTileStat *stat,
+  const MarchOptions &opt = MarchOptions()) {
+  MarchFrame f;
+  f.Set(time, opt);
+  MarchSparseBegin(f, opt);
+  if(opt.history && opt.history->valid) {
+    MarchReproject(jobs, f, opt.history);
+    f.history = opt.history;
+  }
+  int tiles = f.tilesx * f.tilesy;
+  MarchClearStat(f, stat);
+  if(!jobs) {
+    for(int t = 0; t < tiles; t++) MarchTile(f, isa, t, buffer, &stat[t]);
+  } else {
+    jobs->ParallelFor(tiles, 1, [&](int b, int e, int) {
+      for(int t = b; t < e; t++) MarchTile(f, isa, t, buffer, &stat[t]);
+    });
+  }
+  MarchSparseEnd(jobs, f, opt, buffer);
+  if(opt.history) opt.history->Store(f, buffer);
+}
+
+//same, tiles through the work stealing scheduler ordered by last frame's cost
+inline void MarchRender(TileScheduler &sched, int isa, float time, MarchColor *buffer, MarchTileStat *stat,
+  const MarchOptions &opt = MarchOptions()) {
+  MarchFrame f;
+  f.Set(time, opt);
+  MarchSparseBegin(f, opt);
+  if(opt.history && opt.history->valid) {
+    MarchReproject(NULL, f, opt.history);
+    f.history = opt.history;
+  }
+  MarchClearStat(f, stat);
+  sched.Run(f.tilesx * f.tilesy, [&](int t, int) { MarchTile(f, isa, t, buffer, &stat[t]); });
+  MarchSparseEnd(NULL, f, opt, buffer);
+  if(opt.history) opt.history->Store(f, buffer);
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// MarchUpscale : the frame rendered at scale (top left of src) to the full
+//   size of dst, bilinear in colour and depth, as ps_main reads cstex.
+//   Pixel centres line up : x of dst is (x + 0.5) * scale - 0.5 of src.
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline void MarchUpscale(JobSystem *jobs, float scale, const MarchColor *src, MarchColor *dst) {
+  MarchOptions o;
+  MarchFrame   f;
+  o.scale = scale;
+  f.Set(0, o);
+  const int w = MarchTilesX * GroupX, h = MarchTilesY * GroupY;
+  float     mx = std::min(f.sizex, float(f.tilesx * GroupX)) - 1, my = std::min(f.sizey, float(f.tilesy * GroupY)) - 1;
+  auto rows = [&](int b, int e, int) {
+    for(int y = b; y < e; y++) {
+      float sy = std::min(std::max((y + 0.5f) * f.scale - 0.5f, 0.0f), my);
+      int   y0 = (int)sy, y1 = std::min(y0 + 1, (int)my);
+      float fy = sy - y0;
+      for(int x = 0; x < w; x++) {
+        float sx = std::min(std::max((x + 0.5f) * f.scale - 0.5f, 0.0f), mx);
+        int   x0 = (int)sx, x1 = std::min(x0 + 1, (int)mx);
+        float fx = sx - x0;
+        const float *a = &src[x0 + y0 * ScreenX].r, *b = &src[x1 + y0 * ScreenX].r;
+        const float *c = &src[x0 + y1 * ScreenX].r, *d = &src[x1 + y1 * ScreenX].r;
+        float *o = &dst[x + y * ScreenX].r;
+        for(int i = 0; i < 4; i++) {
+          float top = a[i] + (b[i] - a[i]) * fx, bottom = c[i] + (d[i] - c[i]) * fx;
+          o[i] = top + (bottom - top) * fy;
+        }
+      }
+    }
+  };
+  if(jobs) jobs->ParallelFor(h, 8, rows);
+  else     rows(0, h, 0);
+}
+
+#endif //_MARCH_H_
@@ -17,6 +17,15 @@
 #define WindowY            720
 #define GroupX             32
 #define GroupY             32
+#define ConeStep           8                      //cs_cone prepass : pixels per cone side, 0 : off
+#define ConeX              (ScreenX / ConeStep)
+#define ConeY              (ScreenY / ConeStep)
+#define MapGrad            1                      //getnormal : 1 gradient of mapgrad(), 0 : 4 map() calls
+#define Sparse             0                      //cs_main marches 1 : a checkerboard, 2 : one of 2 x 2 per frame, 0 : all
+#define SparseX            (Sparse ? ScreenX / 2 : ScreenX)       //cs_main threads
+#define SparseY            (Sparse == 2 ? ScreenY / 2 : ScreenY)
+#define SparseHistory      1                      //cs_resolve : 1 the last frame reprojected, clamped to the marched pixels around, 0 those alone
+#define FrameBudget        16.6f                  //ms per frame, ResGovernor renders smaller past it, 0 : full size
 
 #define Aspect             ((float)ScreenY / (float)ScreenX)
 //#define ScreenX            1920
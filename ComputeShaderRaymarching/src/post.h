@@ -0,0 +1,479 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  post.h
+//    The post of ps_main on the CPU, colour + depth (march.h, upscale.h)
+//    to RGBA8, in stages :
+//    - blur : [1 2 1] x [1 2 1] / 16, blended in by PostOptions::blur,
+//      depth stays (off by default, as ps_main)
+//    - gamma : pow(c, 0.4545), as powf or approximated by a polynomial of
+//      the exponent and mantissa (log2, exp2) or a table of 128 entries
+//      per octave of the float, interpolated
+//    - fog, dither (hash of the colour), vignette, as ps_main
+//    - pack : clamped, * 255 + 0.5, alpha 255
+//    Post runs them fused, one pass over GroupX x GroupY tiles that only
+//    reads the buffer and writes the bytes : blurred rows go through a 3
+//    row ring on the stack. PostChain runs each stage over the whole
+//    frame through float buffers, to measure what the fusing saves.
+//    Scalar and AVX2 (8 pixels along a row).
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _POST_H_
+#define _POST_H_
+
+#include "march.h"
+
+#define PostTilesX         ((ScreenX + GroupX - 1) / GroupX)
+#define PostTilesY         ((ScreenY + GroupY - 1) / GroupY)
+#define PostGammaExp       0.4545f
+#define PostLutOctaves     28                     //2^-24 .. 16, clamped past them : 5e-4 at 0
+#define PostLutSteps       7                      //2^7 entries per octave
+#define PostLutMin         (127 - 24)             //biased exponent of the first octave
+
+enum PostGamma {
+  PostPow, PostPoly, PostLut,
+};
+
+struct PostOptions {
+  float blur     = 0;        //0 : off, 1 : the blur alone
+  int   gamma    = PostPow;
+  bool  fog      = true;
+  bool  dither   = true;
+  bool  vignette = true;
+};
+
+//log2 of the mantissa on [1, 2), t = m - 1, error 1.4e-5
+static const float PostLog2[6] = { 1.43909303e-05f, 1.44159208f, -0.707253433f, 0.411561482f, -0.189832446f, 0.0439286277f };
+//exp2 on [0, 1), error 3.8e-6
+static const float PostExp2[5] = { 1.0000036f, 0.692969551f, 0.241621323f, 0.0517177355f, 0.0136839829f };
+
+static const float PostDither[3] = { 0.015f, 0.022f, 0.031f };
+
+//c^0.4545 at 2^(i / 128 - 24) * (1 + (i % 128) / 128) : the top bits of
+//the float, one past the end for the interpolation
+inline const float *PostLutTable() {
+  static std::vector<float> lut = [] {
+    std::vector<float> t((PostLutOctaves << PostLutSteps) + 1);
+    for(size_t i = 0; i < t.size(); i++) t[i] = powf(ldexpf(1 + (i & ((1 << PostLutSteps) - 1)) / (float)(1 << PostLutSteps), (int)(i >> PostLutSteps) - 24), PostGammaExp);
+    return t;
+  }();
+  return &lut[0];
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// scalar
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline float PostGammaPoly(float c) {
+  unsigned b;
+  c = std::max(c, 0.0f);
+  memcpy(&b, &c, 4);
+  float m, t, l, y, f, p;
+  unsigned mb = (b & 0x7fffff) | 0x3f800000;
+  memcpy(&m, &mb, 4);
+  t = m - 1;
+  l = PostLog2[5];
+  for(int k = 4; k >= 0; k--) l = l * t + PostLog2[k];
+  y = std::max((l + (int)(b >> 23) - 127) * PostGammaExp, -126.0f);
+  f = floorf(y);
+  t = y - f;
+  p = PostExp2[4];
+  for(int k = 3; k >= 0; k--) p = p * t + PostExp2[k];
+  memcpy(&b, &p, 4);
+  b += (unsigned)(int)f << 23;
+  memcpy(&p, &b, 4);
+  return p;
+}
+
+inline float PostGammaLut(float c) {
+  unsigned b, lo = (unsigned)PostLutMin << 23, hi = (unsigned)(PostLutMin + PostLutOctaves) << 23;
+  c = std::max(c, 0.0f);
+  memcpy(&b, &c, 4);
+  b = std::min(std::max(b, lo), hi - 1) - lo;
+  const float *t = PostLutTable() + (b >> (23 - PostLutSteps));
+  float f = (b & ((1 << (23 - PostLutSteps)) - 1)) * (1.0f / (1 << (23 - PostLutSteps)));
+  return t[0] + (t[1] - t[0]) * f;
+}
+
+inline float PostGammaOf(float c, int gamma) {
+  if(gamma == PostPoly) return PostGammaPoly(c);
+  if(gamma == PostLut)  return PostGammaLut(c);
+  return powf(fmaxf(c, 0), PostGammaExp);
+}
+
+inline float PostVignette(int x, int y) {
+  float u = -1 + 2 * (x + 0.5f) / ScreenX, v = -1 + 2 * (y + 0.5f) / ScreenY;
+  return (1 - (u * 0.5f * u + v * 0.5f * v)) * 0.7f;
+}
+
+//the 3 x 3 blur of x, y blended in by k, edges clamp
+inline MarchColor PostBlurPixel(const MarchColor *src, int x, int y, float k) {
+  MarchColor c = src[x + y * ScreenX], s = { 0, 0, 0, 0 };
+  for(int j = -1; j <= 1; j++) {
+    const MarchColor *r = &src[std::min(std::max(y + j, 0), ScreenY - 1) * ScreenX];
+    for(int i = -1; i <= 1; i++) {
+      const MarchColor &q = r[std::min(std::max(x + i, 0), ScreenX - 1)];
+      float w = (float)((2 - abs(i)) * (2 - abs(j)));
+      s.r += q.r * w;
+      s.g += q.g * w;
+      s.b += q.b * w;
+    }
+  }
+  c.r += (s.r * (1 / 16.0f) - c.r) * k;
+  c.g += (s.g * (1 / 16.0f) - c.g) * k;
+  c.b += (s.b * (1 / 16.0f) - c.b) * k;
+  return c;
+}
+
+//gamma, fog, dither, vignette and pack of one pixel, the order of ps_main
+inline unsigned PostPixel(const MarchColor &m, int x, int y, const PostOptions &o) {
+  float vig = o.vignette ? PostVignette(x, y) : 1;
+  unsigned out = 0xff000000u;
+  for(int c = 0; c < 3; c++) {
+    float r = PostGammaOf((&m.r)[c], o.gamma);
+    if(o.fog)    r += (c + 1) * m.a * 0.004f;
+    if(o.dither) r += SdfHash(r) * PostDither[c];
+    r  = r * vig;
+    r  = r < 0 ? 0 : r > 1 ? 1 : r;
+    out |= (unsigned)(r * 255 + 0.5f) << (c * 8);
+  }
+  return out;
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// AVX2
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+//8 pixels as planes
+struct Post8 {
+  __m256 r, g, b, a;
+};
+
+//4 registers of 2 MarchColor each to planes
+TARGET_AVX2 inline Post8 PostPlanar(__m256 q0, __m256 q1, __m256 q2, __m256 q3) {
+  __m256 t0 = _mm256_permute2f128_ps(q0, q2, 0x20), t1 = _mm256_permute2f128_ps(q0, q2, 0x31);
+  __m256 t2 = _mm256_permute2f128_ps(q1, q3, 0x20), t3 = _mm256_permute2f128_ps(q1, q3, 0x31);
+  __m256 u0 = _mm256_unpacklo_ps(t0, t1), u1 = _mm256_unpackhi_ps(t0, t1);
+  __m256 u2 = _mm256_unpacklo_ps(t2, t3), u3 = _mm256_unpackhi_ps(t2, t3);
+  Post8 p;
+  p.r = _mm256_shuffle_ps(u0, u2, 0x44);
+  p.g = _mm256_shuffle_ps(u0, u2, 0xEE);
+  p.b = _mm256_shuffle_ps(u1, u3, 0x44);
+  p.a = _mm256_shuffle_ps(u1, u3, 0xEE);
+  return p;
+}
+
+TARGET_AVX2 inline Post8 PostLoad8(const MarchColor *m) {
+  const float *p = &m->r;
+  return PostPlanar(_mm256_loadu_ps(p), _mm256_loadu_ps(p + 8), _mm256_loadu_ps(p + 16), _mm256_loadu_ps(p + 24));
+}
+
+//planes back to 8 MarchColor, as UpscalePixel8
+TARGET_AVX2 inline void PostStore8(const Post8 &q, MarchColor *m) {
+  __m256 t0 = _mm256_unpacklo_ps(q.r, q.g), t1 = _mm256_unpackhi_ps(q.r, q.g);
+  __m256 t2 = _mm256_unpacklo_ps(q.b, q.a), t3 = _mm256_unpackhi_ps(q.b, q.a);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+  float *p = &m->r;
+  _mm256_storeu_ps(p +  0, _mm256_permute2f128_ps(u0, u1, 0x20));
+  _mm256_storeu_ps(p +  8, _mm256_permute2f128_ps(u2, u3, 0x20));
+  _mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+  _mm256_storeu_ps(p + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+}
+
+TARGET_AVX2 inline __m256 PostGammaPoly8(__m256 c) {
+  __m256i b = _mm256_castps_si256(_mm256_max_ps(c, _mm256_setzero_ps()));
+  __m256  t = _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(b, _mm256_set1_epi32(0x7fffff)),
+    _mm256_set1_epi32(0x3f800000))), _mm256_set1_ps(1));
+  __m256  l = _mm256_set1_ps(PostLog2[5]);
+  for(int k = 4; k >= 0; k--) l = _mm256_fmadd_ps(l, t, _mm256_set1_ps(PostLog2[k]));
+  __m256  e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(b, 23), _mm256_set1_epi32(127)));
+  __m256  y = _mm256_max_ps(_mm256_mul_ps(_mm256_add_ps(l, e), _mm256_set1_ps(PostGammaExp)), _mm256_set1_ps(-126));
+  __m256  f = _mm256_floor_ps(y);
+  t = _mm256_sub_ps(y, f);
+  __m256  p = _mm256_set1_ps(PostExp2[4]);
+  for(int k = 3; k >= 0; k--) p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(PostExp2[k]));
+  return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(_mm256_cvtps_epi32(f), 23)));
+}
+
+TARGET_AVX2 inline __m256 PostGammaLut8(__m256 c) {
+  const int   lo = PostLutMin << 23, hi = (PostLutMin + PostLutOctaves) << 23;
+  const float *lut = PostLutTable();
+  __m256i b = _mm256_castps_si256(_mm256_max_ps(c, _mm256_setzero_ps()));
+  b = _mm256_sub_epi32(_mm256_min_epi32(_mm256_max_epi32(b, _mm256_set1_epi32(lo)), _mm256_set1_epi32(hi - 1)), _mm256_set1_epi32(lo));
+  __m256i i  = _mm256_srli_epi32(b, 23 - PostLutSteps);
+  __m256  f  = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(b, _mm256_set1_epi32((1 << (23 - PostLutSteps)) - 1))),
+    _mm256_set1_ps(1.0f / (1 << (23 - PostLutSteps))));
+  __m256  t0 = _mm256_i32gather_ps(lut, i, 4), t1 = _mm256_i32gather_ps(lut + 1, i, 4);
+  return _mm256_fmadd_ps(_mm256_sub_ps(t1, t0), f, t0);
+}
+
+TARGET_AVX2 inline __m256 PostGamma8(__m256 c, int gamma) {
+  if(gamma == PostPoly) return PostGammaPoly8(c);
+  if(gamma == PostLut)  return PostGammaLut8(c);
+  alignas(32) float v[8];
+  _mm256_store_ps(v, c);
+  for(int k = 0; k < 8; k++) v[k] = powf(fmaxf(v[k], 0), PostGammaExp);
+  return _mm256_load_ps(v);
+}
+
+TARGET_AVX2 inline void PostFog8(Post8 &p) {
+  __m256 d = _mm256_mul_ps(p.a, _mm256_set1_ps(0.004f));
+  p.r = _mm256_add_ps(p.r, d);
+  p.g = _mm256_fmadd_ps(d, _mm256_set1_ps(2), p.g);
+  p.b = _mm256_fmadd_ps(d, _mm256_set1_ps(3), p.b);
+}
+
+TARGET_AVX2 inline void PostDither8(Post8 &p) {
+  p.r = _mm256_fmadd_ps(SdfHash8(p.r), _mm256_set1_ps(PostDither[0]), p.r);
+  p.g = _mm256_fmadd_ps(SdfHash8(p.g), _mm256_set1_ps(PostDither[1]), p.g);
+  p.b = _mm256_fmadd_ps(SdfHash8(p.b), _mm256_set1_ps(PostDither[2]), p.b);
+}
+
+//pixels x.. of row y
+TARGET_AVX2 inline void PostVignette8(Post8 &p, int x, int y) {
+  __m256 u = _mm256_fmadd_ps(_mm256_add_ps(_mm256_set1_ps(x + 0.5f), _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7)),
+    _mm256_set1_ps(2.0f / ScreenX), _mm256_set1_ps(-1));
+  float  v = -1 + 2 * (y + 0.5f) / ScreenY;
+  __m256 w = _mm256_mul_ps(_mm256_fnmadd_ps(_mm256_mul_ps(u, _mm256_set1_ps(0.5f)), u, _mm256_set1_ps(1 - v * 0.5f * v)), _mm256_set1_ps(0.7f));
+  p.r = _mm256_mul_ps(p.r, w);
+  p.g = _mm256_mul_ps(p.g, w);
+  p.b = _mm256_mul_ps(p.b, w);
+}
+
+TARGET_AVX2 inline void PostPack8(const Post8 &p, unsigned *out) {
+  __m256  zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1), s = _mm256_set1_ps(255), h = _mm256_set1_ps(0.5f);
+  __m256i r = _mm256_cvttps_epi32(_mm256_fmadd_ps(_mm256_min_ps(_mm256_max_ps(p.r, zero), one), s, h));
+  __m256i g = _mm256_cvttps_epi32(_mm256_fmadd_ps(_mm256_min_ps(_mm256_max_ps(p.g, zero), one), s, h));
+  __m256i b = _mm256_cvttps_epi32(_mm256_fmadd_ps(_mm256_min_ps(_mm256_max_ps(p.b, zero), one), s, h));
+  __m256i c = _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_set1_epi32((int)0xff000000)));
+  _mm256_storeu_si256((__m256i *)out, c);
+}
+
+TARGET_AVX2 inline void PostPixel8(Post8 &p, int x, int y, const PostOptions &o, unsigned *out) {
+  p.r = PostGamma8(p.r, o.gamma);
+  p.g = PostGamma8(p.g, o.gamma);
+  p.b = PostGamma8(p.b, o.gamma);
+  if(o.fog)      PostFog8(p);
+  if(o.dither)   PostDither8(p);
+  if(o.vignette) PostVignette8(p, x, y);
+  PostPack8(p, out);
+}
+
+//[1 2 1] / 4 along the row, 2 pixels a register : line[-1 .. n] read
+TARGET_AVX2 inline void PostBlurRow(const MarchColor *line, int n, MarchColor *out) {
+  __m256 quarter = _mm256_set1_ps(0.25f);
+  for(int x = 0; x < n; x += 2) {
+    __m256 a = _mm256_loadu_ps(&line[x - 1].r), b = _mm256_loadu_ps(&line[x].r), c = _mm256_loadu_ps(&line[x + 1].r);
+    _mm256_storeu_ps(&out[x].r, _mm256_mul_ps(_mm256_fmadd_ps(b, _mm256_set1_ps(2), _mm256_add_ps(a, c)), quarter));
+  }
+}
+
+//row c blended toward [1 2 1] / 4 of the blurred rows u, m, d by k, 2
+//pixels a register, the lanes of a keep c's depth
+TARGET_AVX2 inline __m256 PostBlend2(const MarchColor *c, const MarchColor *u, const MarchColor *m, const MarchColor *d, __m256 k) {
+  __m256 keep = _mm256_castsi256_ps(_mm256_setr_epi32(0, 0, 0, -1, 0, 0, 0, -1));
+  __m256 v = _mm256_loadu_ps(&c->r);
+  __m256 s = _mm256_mul_ps(_mm256_fmadd_ps(_mm256_loadu_ps(&m->r), _mm256_set1_ps(2), _mm256_add_ps(_mm256_loadu_ps(&u->r), _mm256_loadu_ps(&d->r))),
+    _mm256_set1_ps(0.25f));
+  return _mm256_blendv_ps(_mm256_fmadd_ps(_mm256_sub_ps(s, v), k, v), v, keep);
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// Post : src (ScreenX * ScreenY) to dst RGBA8, fused, tile by tile. jobs
+//   may be NULL.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline void PostTileScalar(const MarchColor *src, int tile, const PostOptions &o, unsigned *dst) {
+  int x0 = (tile % PostTilesX) * GroupX, y0 = (tile / PostTilesX) * GroupY;
+  int x1 = std::min(x0 + GroupX, ScreenX), y1 = std::min(y0 + GroupY, ScreenY);
+  for(int y = y0; y < y1; y++) {
+    for(int x = x0; x < x1; x++) {
+      MarchColor c = o.blur > 0 ? PostBlurPixel(src, x, y, o.blur) : src[x + y * ScreenX];
+      dst[x + y * ScreenX] = PostPixel(c, x, y, o);
+    }
+  }
+}
+
+//the blur keeps the rows y - 1 .. y + 1 along x in a ring, each row of
+//src is read once and blurred once per tile (its border rows twice)
+TARGET_AVX2 inline void PostTileAVX2(const MarchColor *src, int tile, const PostOptions &o, unsigned *dst) {
+  int x0 = (tile % PostTilesX) * GroupX, y0 = (tile / PostTilesX) * GroupY;
+  int y1 = std::min(y0 + GroupY, ScreenY);
+  if(o.blur <= 0) {
+    for(int y = y0; y < y1; y++) {
+      for(int x = x0; x < x0 + GroupX; x += 8) {
+        Post8 p = PostLoad8(&src[x + y * ScreenX]);
+        PostPixel8(p, x, y, o, &dst[x + y * ScreenX]);
+      }
+    }
+    return;
+  }
+  MarchColor ring[3][GroupX], pad[GroupX + 2];
+  bool edge = x0 == 0 || x0 + GroupX == ScreenX;
+  auto Blur = [&](int y) {
+    const MarchColor *line = &src[std::min(std::max(y, 0), ScreenY - 1) * ScreenX + x0];
+    if(edge) {
+      memcpy(&pad[1], line, sizeof(MarchColor) * GroupX);
+      pad[0]          = line[x0 > 0 ? -1 : 0];
+      pad[GroupX + 1] = line[x0 + GroupX < ScreenX ? GroupX : GroupX - 1];
+      line            = &pad[1];
+    }
+    PostBlurRow(line, GroupX, ring[(y + 3) % 3]);
+  };
+  __m256 k = _mm256_set1_ps(o.blur);
+  Blur(y0 - 1);
+  Blur(y0);
+  for(int y = y0; y < y1; y++) {
+    Blur(y + 1);
+    const MarchColor *c = &src[x0 + y * ScreenX], *u = ring[(y + 2) % 3], *m = ring[y % 3], *d = ring[(y + 1) % 3];
+    for(int x = 0; x < GroupX; x += 8) {
+      Post8 p = PostPlanar(PostBlend2(c + x, u + x, m + x, d + x, k), PostBlend2(c + x + 2, u + x + 2, m + x + 2, d + x + 2, k),
+                           PostBlend2(c + x + 4, u + x + 4, m + x + 4, d + x + 4, k), PostBlend2(c + x + 6, u + x + 6, m + x + 6, d + x + 6, k));
+      PostPixel8(p, x0 + x, y, o, &dst[x0 + x + y * ScreenX]);
+    }
+  }
+}
+
+inline bool PostSimd(int isa) { return isa == IsaAVX2 && GroupX % 8 == 0 && ScreenX % GroupX == 0; }
+
+inline void Post(JobSystem *jobs, int isa, const PostOptions &o, const MarchColor *src, unsigned *dst) {
+  bool simd  = PostSimd(isa);
+  int  tiles = PostTilesX * PostTilesY;
+  if(simd && o.gamma == PostLut) PostLutTable();
+  auto run = [&](int b, int e, int) {
+    for(int t = b; t < e; t++) {
+      if(simd) PostTileAVX2(src, t, o, dst);
+      else     PostTileScalar(src, t, o, dst);
+    }
+  };
+  if(jobs) jobs->ParallelFor(tiles, 1, run);
+  else     run(0, tiles, 0);
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// PostChain : the same stages one after the other over the whole frame,
+//   through the float buffers tmp[0], tmp[1] (ScreenX * ScreenY each) :
+//   blur along x, along y + blend, then gamma, fog, dither and vignette
+//   in place, then pack. PostChainBytes is the memory each pixel moves.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+enum PostStage {
+  PostStageBlurX, PostStageBlurY, PostStageGamma, PostStageFog, PostStageDither, PostStageVignette, PostStagePack,
+};
+
+//bytes read and written per pixel
+inline int PostChainBytes(const PostOptions &o) {
+  int f = sizeof(MarchColor), n = 2 * f + f + 4;                  //gamma to tmp, pack
+  if(o.blur > 0) n += 2 * f + 3 * f;                              //along x, along y reads the source too
+  return n + ((int)o.fog + (int)o.dither + (int)o.vignette) * 2 * f;
+}
+
+inline int PostFusedBytes() { return sizeof(MarchColor) + 4; }
+
+//one stage on row y of src to out, c : the frame before the blur
+inline void PostStageScalar(int stage, const PostOptions &o, const MarchColor *src, const MarchColor *c, void *out, int y) {
+  const MarchColor *s = &src[y * ScreenX];
+  MarchColor       *d = (MarchColor *)out + y * ScreenX;
+  for(int x = 0; x < ScreenX; x++) {
+    MarchColor m = s[x];
+    float      vig = stage == PostStageVignette ? PostVignette(x, y) : 1;
+    if(stage == PostStageBlurX) {
+      const MarchColor &l = s[std::max(x - 1, 0)], &r = s[std::min(x + 1, ScreenX - 1)];
+      for(int i = 0; i < 3; i++) (&m.r)[i] = ((&l.r)[i] + 2 * (&m.r)[i] + (&r.r)[i]) * 0.25f;
+    }
+    if(stage == PostStageBlurY) {
+      const MarchColor &u = src[x + std::max(y - 1, 0) * ScreenX], &w = src[x + std::min(y + 1, ScreenY - 1) * ScreenX];
+      const MarchColor &v = c[x + y * ScreenX];
+      for(int i = 0; i < 3; i++) (&m.r)[i] = (&v.r)[i] + (((&u.r)[i] + 2 * (&m.r)[i] + (&w.r)[i]) * 0.25f - (&v.r)[i]) * o.blur;
+      m.a = v.a;
+    }
+    for(int i = 0; i < 3; i++) {
+      float &r = (&m.r)[i];
+      if(stage == PostStageGamma)    r  = PostGammaOf(r, o.gamma);
+      if(stage == PostStageFog)      r += (i + 1) * m.a * 0.004f;
+      if(stage == PostStageDither)   r += SdfHash(r) * PostDither[i];
+      if(stage == PostStageVignette) r *= vig;
+    }
+    if(stage != PostStagePack) {
+      d[x] = m;
+      continue;
+    }
+    unsigned p = 0xff000000u;
+    for(int i = 0; i < 3; i++) {
+      float r = (&m.r)[i];
+      r  = r < 0 ? 0 : r > 1 ? 1 : r;
+      p |= (unsigned)(r * 255 + 0.5f) << (i * 8);
+    }
+    ((unsigned *)out)[x + y * ScreenX] = p;
+  }
+}
+
+TARGET_AVX2 inline void PostStageAVX2(int stage, const PostOptions &o, const MarchColor *src, const MarchColor *c, void *out, int y) {
+  const MarchColor *s = &src[y * ScreenX];
+  MarchColor       *d = (MarchColor *)out + y * ScreenX;
+  if(stage == PostStageBlurX) {
+    //the ends clamp, the rest 2 pixels a register
+    const MarchColor &l = s[0], &r = s[ScreenX - 1], &l1 = s[1], &r1 = s[ScreenX - 2];
+    d[0]           = { (3 * l.r + l1.r) * 0.25f, (3 * l.g + l1.g) * 0.25f, (3 * l.b + l1.b) * 0.25f, l.a };
+    d[ScreenX - 1] = { (3 * r.r + r1.r) * 0.25f, (3 * r.g + r1.g) * 0.25f, (3 * r.b + r1.b) * 0.25f, r.a };
+    PostBlurRow(s + 1, ScreenX - 2, d + 1);
+    return;
+  }
+  if(stage == PostStageBlurY) {
+    const MarchColor *u = &src[std::max(y - 1, 0) * ScreenX], *w = &src[std::min(y + 1, ScreenY - 1) * ScreenX];
+    const MarchColor *v = &c[y * ScreenX];
+    __m256 k = _mm256_set1_ps(o.blur);
+    for(int x = 0; x < ScreenX; x += 2) _mm256_storeu_ps(&d[x].r, PostBlend2(v + x, u + x, s + x, w + x, k));
+    return;
+  }
+  for(int x = 0; x < ScreenX; x += 8) {
+    Post8 p = PostLoad8(&s[x]);
+    if(stage == PostStagePack) {
+      PostPack8(p, (unsigned *)out + x + y * ScreenX);
+      continue;
+    }
+    if(stage == PostStageGamma) {
+      p.r = PostGamma8(p.r, o.gamma);
+      p.g = PostGamma8(p.g, o.gamma);
+      p.b = PostGamma8(p.b, o.gamma);
+    }
+    if(stage == PostStageFog)      PostFog8(p);
+    if(stage == PostStageDither)   PostDither8(p);
+    if(stage == PostStageVignette) PostVignette8(p, x, y);
+    PostStore8(p, &d[x]);
+  }
+}
+
+inline void PostChain(JobSystem *jobs, int isa, const PostOptions &o, const MarchColor *src, MarchColor *tmp[2], unsigned *dst) {
+  bool simd = PostSimd(isa) && ScreenX % 8 == 0;
+  auto Stage = [&](int stage, const MarchColor *from, void *to) {
+    auto run = [&](int b, int e, int) {
+      for(int y = b; y < e; y++) {
+        if(simd) PostStageAVX2(stage, o, from, src, to, y);
+        else     PostStageScalar(stage, o, from, src, to, y);
+      }
+    };
+    if(jobs) jobs->ParallelFor(ScreenY, GroupY, run);
+    else     run(0, ScreenY, 0);
+  };
+  const MarchColor *in = src;
+  if(o.blur > 0) {
+    Stage(PostStageBlurX, src, tmp[0]);
+    Stage(PostStageBlurY, tmp[0], tmp[1]);
+    in = tmp[1];
+  }
+  if(simd && o.gamma == PostLut) PostLutTable();
+  Stage(PostStageGamma, in, tmp[1]);
+  if(o.fog)      Stage(PostStageFog, tmp[1], tmp[1]);
+  if(o.dither)   Stage(PostStageDither, tmp[1], tmp[1]);
+  if(o.vignette) Stage(PostStageVignette, tmp[1], tmp[1]);
+  Stage(PostStagePack, tmp[1], dst);
+}
+
+#endif //_POST_H_
@@ -0,0 +1,275 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  prune.h
+//    Interval arithmetic over an SdfProgram and gates on the compiled code :
+//    given bounds of x, y, z and time, a min / max whose operand intervals
+//    do not overlap always returns the same side, and whatever feeds only
+//    the other side need not run. SdfGates picks the min / max worth a
+//    branch, sdfc prints SdfMapPrune / SdfMapPrune8 with the code under
+//    each side behind its keep bit, and Mask gives the bits of a box. With
+//    every bit set it is SdfMap bit for bit, inside the box too.
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _PRUNE_H_
+#define _PRUNE_H_
+
+#include <float.h>
+#include <algorithm>
+#include <iterator>
+#include "sdf.h"
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// SdfInterval
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct SdfInterval {
+  float lo, hi;
+};
+
+inline SdfInterval Iv(float lo, float hi) {
+  SdfInterval r = { lo, hi };
+  return r;
+}
+
+inline SdfInterval IvAll() {
+  return Iv(-FLT_MAX, FLT_MAX);
+}
+
+//float rounding and the polynomial sin of the AVX2 path : grow every result a little
+inline SdfInterval IvWiden(SdfInterval a) {
+  if(!(a.lo <= a.hi)) return IvAll();
+  a.lo -= 1e-5f * (1 + fabsf(a.lo));
+  a.hi += 1e-5f * (1 + fabsf(a.hi));
+  return a;
+}
+
+//sin over [lo, hi] : endpoints, plus 1 / -1 if a peak lies inside
+inline SdfInterval IvSin(SdfInterval a) {
+  const float pi = 3.14159265f;
+  if(!(a.hi - a.lo < 2 * pi) || fabsf(a.lo) > 1e5f || fabsf(a.hi) > 1e5f) return Iv(-1, 1);
+  float s0 = sinf(a.lo), s1 = sinf(a.hi);
+  SdfInterval r = Iv(fminf(s0, s1), fmaxf(s0, s1));
+  if(ceilf((a.lo - pi / 2) / (2 * pi)) * 2 * pi + pi / 2 <= a.hi) r.hi = 1;
+  if(ceilf((a.lo + pi / 2) / (2 * pi)) * 2 * pi - pi / 2 <= a.hi) r.lo = -1;
+  return r;
+}
+
+inline SdfInterval IvApply(int op, SdfInterval a, SdfInterval b) {
+  switch(op) {
+  case SdfAdd: return Iv(a.lo + b.lo, a.hi + b.hi);
+  case SdfSub: return Iv(a.lo - b.hi, a.hi - b.lo);
+  case SdfMul: {
+    float p[4] = { a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi };
+    return Iv(fminf(fminf(p[0], p[1]), fminf(p[2], p[3])), fmaxf(fmaxf(p[0], p[1]), fmaxf(p[2], p[3])));
+  }
+  case SdfDiv: {
+    if(b.lo <= 0 && b.hi >= 0) return IvAll();
+    float p[4] = { a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi };
+    return Iv(fminf(fminf(p[0], p[1]), fminf(p[2], p[3])), fmaxf(fmaxf(p[0], p[1]), fmaxf(p[2], p[3])));
+  }
+  case SdfMod: {
+    //fmod keeps the sign of a, |result| < |b|
+    float m = fmaxf(fabsf(b.lo), fabsf(b.hi));
+    if(b.lo == b.hi && m > 0 && fabsf(a.lo) < 1e7f && fabsf(a.hi) < 1e7f) {
+      float q0 = truncf(a.lo / m), q1 = truncf(a.hi / m);
+      if(q0 == q1) return Iv(a.lo - q0 * m, a.hi - q0 * m);
+    }
+    return Iv(a.lo >= 0 ? 0 : fmaxf(-m, a.lo), a.hi <= 0 ? 0 : fminf(m, a.hi));
+  }
+  case SdfMin:    return Iv(fminf(a.lo, b.lo), fminf(a.hi, b.hi));
+  case SdfMax:    return Iv(fmaxf(a.lo, b.lo), fmaxf(a.hi, b.hi));
+  case SdfNeg:    return Iv(-a.hi, -a.lo);
+  case SdfAbs:    return a.lo >= 0 ? a : a.hi <= 0 ? Iv(-a.hi, -a.lo) : Iv(0, fmaxf(-a.lo, a.hi));
+  case SdfSqrt:   return Iv(sqrtf(fmaxf(a.lo, 0)), sqrtf(fmaxf(a.hi, 0)));
+  case SdfSin:    return IvSin(a);
+  case SdfCos:    return IvSin(Iv(a.lo + 1.57079633f, a.hi + 1.57079633f));
+  case SdfHashOp: return Iv(0, 1);
+  }
+  return IvAll();
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// SdfBound : interval of every instruction, in = x, y, z, time
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline void SdfBound(const SdfProgram &prog, const SdfInterval in[4], SdfInterval *out) {
+  for(size_t i = 0; i < prog.Code.size(); i++) {
+    const SdfInst &c = prog.Code[i];
+    switch(c.op) {
+    case SdfConst: out[i] = Iv(c.value, c.value); break;
+    case SdfInX:   out[i] = in[0]; break;
+    case SdfInY:   out[i] = in[1]; break;
+    case SdfInZ:   out[i] = in[2]; break;
+    case SdfTime:  out[i] = in[3]; break;
+    default:       out[i] = IvWiden(IvApply(c.op, out[c.a], c.b >= 0 ? out[c.b] : Iv(0, 0))); break;
+    }
+    //x * x : both sides are the same value, never negative
+    if(c.op == SdfMul && c.a == c.b) {
+      SdfInterval a = IvApply(SdfAbs, out[c.a], out[c.a]);
+      out[i] = IvWiden(Iv(a.lo * a.lo, a.hi * a.hi));
+    }
+  }
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// SdfGates
+//   Gate g is a min / max, keep bit 2g its a side, 2g + 1 its b side. An
+//   instruction runs when every bit of Need is set : the sides all of its
+//   uses go through. A use through no gate needs nothing, so shared code
+//   always runs. A min / max is a gate when one side alone holds at least
+//   GateMin instructions, at most GateMax of them, first come.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct SdfGates {
+  enum { GateMax = 32, GateMin = 4 };
+
+  std::vector<int>                Node;   //instruction of gate g
+  std::vector<int>                Gate;   //gate of instruction i, -1 : none
+  std::vector<unsigned long long> Need;   //keep bits instruction i runs under
+
+  int                Count() const { return (int)Node.size(); }
+  unsigned long long Full() const  { return Count() >= 32 ? ~0ull : (1ull << (2 * Count())) - 1; }
+
+  //bit sets as sorted bit numbers, a candidate gate per min / max first
+  void Build(const SdfProgram &prog) {
+    int n = (int)prog.Code.size();
+    std::vector<int> cand(n, -1);
+    int c = 0;
+    for(int i = 0; i < n; i++) {
+      const SdfInst &in = prog.Code[i];
+      if((in.op == SdfMin || in.op == SdfMax) && in.a != in.b) cand[i] = c++;
+    }
+    std::vector<std::vector<int> > need;
+    Needs(prog, cand, &need);
+    std::vector<int> size(c * 2, 0);
+    for(int i = 0; i < n; i++) {
+      for(size_t k = 0; k < need[i].size(); k++) size[need[i][k]] += prog.Code[i].op > SdfTime;
+    }
+    Node.clear();
+    Gate.assign(n, -1);
+    for(int i = 0; i < n && Count() < GateMax; i++) {
+      if(cand[i] < 0 || std::max(size[cand[i] * 2], size[cand[i] * 2 + 1]) < GateMin) continue;
+      Gate[i] = Count();
+      Node.push_back(i);
+    }
+    Needs(prog, Gate, &need);
+    Need.assign(n, 0);
+    for(int i = 0; i < n; i++) {
+      for(size_t k = 0; k < need[i].size(); k++) Need[i] |= 1ull << need[i][k];
+    }
+  }
+
+  //need[i] : bits of gate[] all uses of i go through, from the result down
+  static void Needs(const SdfProgram &prog, const std::vector<int> &gate, std::vector<std::vector<int> > *need) {
+    int n = (int)prog.Code.size();
+    std::vector<char> seen(n, 0);
+    need->assign(n, std::vector<int>());
+    seen[prog.Result] = 1;
+    for(int i = prog.Result; i >= 0; i--) {
+      if(!seen[i]) continue;
+      const SdfInst &in = prog.Code[i];
+      int ops[2] = { in.a, in.b };
+      for(int k = 0; k < 2; k++) {
+        int r = ops[k];
+        if(r < 0) continue;
+        std::vector<int> c = (*need)[i];
+        if(gate[i] >= 0) {
+          c.push_back(gate[i] * 2 + k);
+          std::sort(c.begin(), c.end());
+        }
+        if(!seen[r]) {
+          (*need)[r] = c;
+          seen[r] = 1;
+          continue;
+        }
+        std::vector<int> both;
+        std::set_intersection(c.begin(), c.end(), (*need)[r].begin(), (*need)[r].end(), std::back_inserter(both));
+        (*need)[r].swap(both);
+      }
+    }
+  }
+
+  //keep bits inside the box : the side that always wins alone.
+  //iv : room for prog's intervals, NULL : allocated here
+  unsigned long long Mask(const SdfProgram &prog, const SdfInterval in[4], SdfInterval *iv = NULL) const {
+    std::vector<SdfInterval> own(iv ? 0 : prog.Code.size());
+    if(!iv) iv = &own[0];
+    SdfBound(prog, in, iv);
+    unsigned long long keep = Full();
+    for(int g = 0; g < Count(); g++) {
+      const SdfInst     &c = prog.Code[Node[g]];
+      const SdfInterval &a = iv[c.a], &b = iv[c.b];
+      bool amin = a.hi < b.lo, bmin = b.hi < a.lo;
+      if(amin || bmin) keep &= ~(1ull << (2 * g + ((amin == (c.op == SdfMin)) ? 1 : 0)));
+    }
+    return keep;
+  }
+
+  //instructions that run under keep
+  int Cost(const SdfProgram &prog, unsigned long long keep) const {
+    int ops = 0;
+    for(size_t i = 0; i < prog.Code.size(); i++) ops += prog.Code[i].op > SdfTime && (Need[i] & ~keep) == 0;
+    return ops;
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Print : SdfMapPrune / SdfMapPrune8, prog's code in blocks of one Need,
+  //   the values of a block declared before it, a gate picks by its bits
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  std::string Print(const SdfProgram &prog, int target) const {
+    static const char *head[3] = {
+      "inline float SdfMapPrune(float px, float py, float pz, float time, unsigned long long keep) {\n",
+      "",
+      "TARGET_AVX2 inline __m256 SdfMapPrune8(__m256 px, __m256 py, __m256 pz, float time, unsigned long long keep) {\n",
+    };
+    bool        avx2 = target == SdfAVX2;
+    std::string type = avx2 ? "__m256 " : "float ", s = head[target];
+    if(!prog.Timed()) s += "  (void)time;\n";
+    char bits[64];
+    int  n = (int)prog.Code.size();
+    for(int i = 0; i < n;) {
+      if(prog.Code[i].op <= SdfTime) {
+        i++;
+        continue;
+      }
+      int e = i;
+      while(e < n && (prog.Code[e].op <= SdfTime || Need[e] == Need[i])) e++;
+      std::string body, decl;
+      for(int k = i; k < e; k++) {
+        if(prog.Code[k].op <= SdfTime) continue;
+        std::string line = Gate[k] >= 0 ? Select(prog, k, target) : prog.Line(k, target);
+        if(!Need[i]) {
+          body += line;
+          continue;
+        }
+        decl += (decl.empty() ? "  " + type : ", ") + prog.Operand(k, target) + (avx2 ? " = {}" : " = 0");
+        body += "    " + line.substr(2 + type.size());
+      }
+      if(Need[i]) {
+        snprintf(bits, sizeof(bits), "0x%llxull", Need[i]);
+        s += decl + ";\n  if((keep & " + bits + ") == " + bits + ") {\n" + body + "  }\n";
+      } else {
+        s += body;
+      }
+      i = e;
+    }
+    s += "  return " + prog.Operand(prog.Result, target) + ";\n}\n";
+    return s;
+  }
+
+  //gate k : one side where the other is not kept
+  std::string Select(const SdfProgram &prog, int k, int target) const {
+    const SdfInst &in = prog.Code[k];
+    std::string a = prog.Operand(in.a, target), b = prog.Operand(in.b, target), both = prog.Line(k, target);
+    size_t eq = both.find(" = ");
+    char bits[96];
+    snprintf(bits, sizeof(bits), "!(keep & 0x%llxull) ? %s : !(keep & 0x%llxull) ? %s : ", 1ull << (2 * Gate[k] + 1), a.c_str(),
+      1ull << (2 * Gate[k]), b.c_str());
+    return both.substr(0, eq + 3) + bits + both.substr(eq + 3);
+  }
+};
+
+#endif //_PRUNE_H_
@@ -4,6 +4,7 @@
 //
 //-----------//-----------//-----------//-----------//-----------//-----------
 #include "common.h"
+#include "governor.h"
 
 struct Color {
   float r, g, b, a;
@@ -18,7 +19,15 @@ struct Color {
 static ID3D11ComputeShader       *pCShader       = NULL;
 static ID3D11Buffer              *pCSBuffer      = NULL;
 static ID3D11UnorderedAccessView *pCSUAV         = NULL;
+static ID3D11ComputeShader       *pConeShader    = NULL;
+static ID3D11Buffer              *pConeBuffer    = NULL;
+static ID3D11UnorderedAccessView *pConeUAV       = NULL;
+static ID3D11ComputeShader       *pResolveShader = NULL;
+static ID3D11Buffer              *pHistBuffer    = NULL;
+static ID3D11UnorderedAccessView *pHistUAV       = NULL;
 static ShaderConst                constant[4];
+static ResGovernor                governor;      //render scale, Const.w
+static bool                       rescaled = true;  //no history at the scale rendered
 
 static const char *fxfilename = SHADER_FILENAME;
 
@@ -27,6 +36,12 @@ void TermScene() {
   RELEASE(pCShader);
   RELEASE(pCSBuffer);
   RELEASE(pCSUAV);
+  RELEASE(pConeShader);
+  RELEASE(pConeBuffer);
+  RELEASE(pConeUAV);
+  RELEASE(pResolveShader);
+  RELEASE(pHistBuffer);
+  RELEASE(pHistUAV);
 }
 
 //-----------//-----------//-----------//-----------//-----------//-----------
@@ -46,12 +61,36 @@ void InitScene() {
   //Create UAV
   UINT Stride = sizeof(Color);
   S_RETURN("D3DCreateBufferUAV CS", D3DCreateBufferUAV(&pCSBuffer, &pCSUAV, ScreenX * ScreenY * Stride, Stride));
+
+#if ConeStep
+  //Cone prepass : start depth per ConeStep x ConeStep pixels
+  S_RETURN("CompileShaderFromFile Cone", D3DCompileShaderFromFile(fxfilename, "cs_cone", "cs_5_0", &pBlob));
+  S_RETURN("CreateComputeShader Cone",   d3ddevice->CreateComputeShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), NULL, &pConeShader));
+  RELEASE(pBlob);
+  S_RETURN("D3DCreateBufferUAV Cone",    D3DCreateBufferUAV(&pConeBuffer, &pConeUAV, ConeX * ConeY * sizeof(float), sizeof(float)));
+#endif
+
+#if Sparse
+  //Sparse resolve : the pixels cs_main left, from the marched ones around them and
+  //SparseHistory the last frame kept in pHistBuffer
+  S_RETURN("CompileShaderFromFile Resolve", D3DCompileShaderFromFile(fxfilename, "cs_resolve", "cs_5_0", &pBlob));
+  S_RETURN("CreateComputeShader Resolve",   d3ddevice->CreateComputeShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), NULL, &pResolveShader));
+  RELEASE(pBlob);
+#if SparseHistory
+  S_RETURN("D3DCreateBufferUAV History",    D3DCreateBufferUAV(&pHistBuffer, &pHistUAV, ScreenX * ScreenY * Stride, Stride));
+#endif
+#endif
   printf("Loaded.\n");
   
   //--------------------------------------------------------------------------------------------------------------
   //Create pConstant Buffer
   //--------------------------------------------------------------------------------------------------------------
   S_RETURN("D3DCreateBuffer:pConstant", D3DCreateBuffer(&pConstant, D3D11_BIND_CONSTANT_BUFFER, sizeof(constant)));
+  
+  //the buffers stay at ScreenX * ScreenY, the governor renders their top left
+  governor.Init(FrameBudget);
+  constant[0].Const.w = governor.Scale();
+  rescaled = true;
 
 }
 
@@ -65,7 +104,13 @@ void UpdateScene() {
   unsigned long tt = timeGetTime();
   FLOAT delta = (FLOAT)(tt - t) / 1000.0f;
   t = tt;
+  FLOAT last = constant[0].Const.x;
+  constant[0].Const.z += 1;                    //frame, phase of the Sparse pattern
   constant[0].Const.x += delta;
+  if(governor.Update(delta * 1000.0f)) rescaled = true;
+  constant[0].Const.w  = governor.Scale();
+  constant[0].Const.y  = rescaled ? -1 : last; //last frame's, SparseHistory reprojects into it, -1 : none
+  rescaled             = false;
   //constant[0].Const.x += 0.0166666666666666666666666;
   
 }
@@ -73,15 +118,46 @@ void UpdateScene() {
 //-----------//-----------//-----------//-----------//-----------//-----------
 // RenderScene
 //-----------//-----------//-----------//-----------//-----------//-----------
+//tiles of the render at scale, as MarchFrame::Set : no more than the full Dispatch
+static UINT RenderTiles(int size, int group, float scale) {
+  UINT n = (UINT)ceilf(size * scale / group);
+  return n < (UINT)(size / group) ? n : (UINT)(size / group);
+}
+
 void RenderScene() {
   HRESULT hRet = 0;
+  float   scale = constant[0].Const.w;
   d3dcontext->UpdateSubresource(pConstant, 0, NULL, constant, 0, 0);
   d3dcontext->CSSetConstantBuffers(0, 1, &pConstant);
-  d3dcontext->CSSetShader(pCShader, NULL, 0);
   d3dcontext->CSSetUnorderedAccessViews(0, 1, &pCSUAV, NULL);
   
-  printf("Dispatch X=%d,  y=%d\r", ScreenX / GroupX, ScreenY / GroupY);
-  d3dcontext->Dispatch(ScreenX / GroupX, ScreenY / GroupY, 1 );
+#if ConeStep
+  //the runtime orders the two Dispatch on the UAV, no barrier to add
+  d3dcontext->CSSetUnorderedAccessViews(2, 1, &pConeUAV, NULL);
+  d3dcontext->CSSetShader(pConeShader, NULL, 0);
+  d3dcontext->Dispatch(((UINT)ceilf(ConeX * scale) + 7) / 8, ((UINT)ceilf(ConeY * scale) + 7) / 8, 1);
+#endif
+  d3dcontext->CSSetShader(pCShader, NULL, 0);
+#if Sparse
+  UINT sx = (UINT)ceilf(SparseX * scale / GroupX), sy = (UINT)ceilf(SparseY * scale / GroupY);
+  printf("Dispatch X=%d,  y=%d  scale %.3f\r", sx, sy, scale);
+  d3dcontext->Dispatch(sx, sy, 1);
+#if SparseHistory
+  d3dcontext->CSSetUnorderedAccessViews(3, 1, &pHistUAV, NULL);
+#endif
+  d3dcontext->CSSetShader(pResolveShader, NULL, 0);
+  d3dcontext->Dispatch((UINT)ceilf(ScreenX * scale / GroupX), (UINT)ceilf(ScreenY * scale / GroupY), 1);
+#if SparseHistory
+  //next frame's history, unbound first
+  ID3D11UnorderedAccessView *pNull = NULL;
+  d3dcontext->CSSetUnorderedAccessViews(3, 1, &pNull, NULL);
+  d3dcontext->CopyResource(pHistBuffer, pCSBuffer);
+#endif
+#else
+  UINT tx = RenderTiles(ScreenX, GroupX, scale), ty = RenderTiles(ScreenY, GroupY, scale);
+  printf("Dispatch X=%d,  y=%d  scale %.3f\r", tx, ty, scale);
+  d3dcontext->Dispatch(tx, ty, 1 );
+#endif
   
   d3dcontext->OMSetRenderTargetsAndUnorderedAccessViews( 1, &pBackRTV, NULL, 1, 1, &pCSUAV, NULL);
   D3DPresent(0);
@@ -98,7 +174,7 @@ void DoScene() {
   if(GetAsyncKeyState(VK_F5)) {
     InitScene();
   }
-  if(pVShader && pPShader && pConstant && pCShader) {
+  if(pVShader && pPShader && pConstant && pCShader && (pConeShader || !ConeStep) && (pResolveShader || !Sparse)) {
     RenderScene();
   }
 }
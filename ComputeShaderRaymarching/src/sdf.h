@@ -0,0 +1,1027 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  sdf.h
+//    Scene description for map(). A .sdf file is a tree of s-expressions
+//    (grammar below), lowered to one straight line program of scalar ops
+//    with constant folding, identity removal, common subexpressions and
+//    dead code removed. The program is printed as HLSL (map.fxh, included
+//    by main.fx) and as scalar and AVX2 C++ (map_sdf.h, used by march.h),
+//    and runs as is through SdfProgram::Eval. The same program carries
+//    its gradient along as dual numbers (mapgrad / SdfMapGrad, EvalGrad)
+//    for the normals.
+//
+//    distance :
+//      (sphere r)                    length(p) - r
+//      (cylinder a r)                length of the two axes other than a - r
+//      (min d ...) (max d ...)       (smin k d d)   (neg d)
+//    point, then one child :
+//      (move x y z d)                p + (x, y, z)
+//      (rep k axes d) (irep k axes d)  abs(p % 2k) - k, without abs
+//      (rotate uv angle speed d)     rot(p.uv, angle + speed * Time.x)
+//      (wave a amp f sin|cos g b d)  p.a += sin(f * sin|cos(p.b * g)) * amp
+//      (jitter amp d)                p + hash(p.x) * amp
+//      (displace (noise amp f axes) ... d)
+//                                    d + amp * (sin(p.x * f) + ...), "z2" : sin(sin())
+//      (off d)                       removed, as the old if(0) blocks
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _SDF_H_
+#define _SDF_H_
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "../../common/simd.h"
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// helper : hash() of main.fx, and the ops SdfMap8 needs beyond intrinsics
+//-----------//-----------//-----------//-----------//-----------//-----------
+//sin in double, rounded : sinf is off by an ulp now and then, the
+//43758 makes that a different hash, SdfHashGrad8 rounds the same way
+inline float SdfHash(float n) {
+  float h = (float)sin((double)n) * 43758.5453123f;
+  return h - floorf(h);
+}
+
+TARGET_AVX2 inline __m256 SdfSin8(__m256 x) {
+  __m256 s, c;
+  SinCos8(x, &s, &c);
+  return s;
+}
+
+TARGET_AVX2 inline __m256 SdfCos8(__m256 x) {
+  __m256 s, c;
+  SinCos8(x, &s, &c);
+  return c;
+}
+
+TARGET_AVX2 inline __m256 SdfAbs8(__m256 x) {
+  return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+TARGET_AVX2 inline __m256 SdfNeg8(__m256 x) {
+  return _mm256_xor_ps(_mm256_set1_ps(-0.0f), x);
+}
+
+//HLSL % : a - trunc(a / b) * b
+TARGET_AVX2 inline __m256 SdfMod8(__m256 a, __m256 b) {
+  __m256 q = _mm256_round_ps(_mm256_div_ps(a, b), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  return _mm256_fnmadd_ps(q, b, a);
+}
+
+//sin in double, kernels of fdlibm : rounded, the float nearest sin
+TARGET_AVX2 inline __m256d SdfSinD4(__m256d x) {
+  __m256d q = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(6.36619772367581382433e-01)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256d r = _mm256_fnmadd_pd(q, _mm256_set1_pd(1.57079632673412561417e+00), x);
+  r = _mm256_fnmadd_pd(q, _mm256_set1_pd(6.07710050630396597660e-11), r);
+  r = _mm256_fnmadd_pd(q, _mm256_set1_pd(2.02226624879595063154e-21), r);
+  __m256d z = _mm256_mul_pd(r, r);
+  __m256d s = _mm256_fmadd_pd(z, _mm256_set1_pd(1.58969099521155010221e-10), _mm256_set1_pd(-2.50507602534068634195e-08));
+  s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(2.75573137070700676789e-06));
+  s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(-1.98412698298579493134e-04));
+  s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(8.33333333332248946124e-03));
+  s = _mm256_fmadd_pd(z, s, _mm256_set1_pd(-1.66666666666666324348e-01));
+  s = _mm256_fmadd_pd(_mm256_mul_pd(z, r), s, r);
+  __m256d c = _mm256_fmadd_pd(z, _mm256_set1_pd(-1.13596475577881948265e-11), _mm256_set1_pd(2.08757232129817482790e-09));
+  c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(-2.75573143513906633035e-07));
+  c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(2.48015872894767294178e-05));
+  c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(-1.38888888888741095749e-03));
+  c = _mm256_fmadd_pd(z, c, _mm256_set1_pd(4.16666666666666019037e-02));
+  c = _mm256_fmadd_pd(_mm256_mul_pd(z, z), c, _mm256_fnmadd_pd(z, _mm256_set1_pd(0.5), _mm256_set1_pd(1)));
+  //quadrant : odd takes cos, 2 and 3 flip the sign
+  __m256i k = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(q));
+  __m256d odd = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(k, _mm256_set1_epi64x(1)), _mm256_set1_epi64x(1)));
+  __m256d neg = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_srli_epi64(k, 1), 63));
+  return _mm256_xor_pd(_mm256_blendv_pd(s, c, odd), neg);
+}
+
+TARGET_AVX2 inline __m256 SdfHash8(__m256 n) {
+  __m256 h = _mm256_mul_ps(SdfSin8(n), _mm256_set1_ps(43758.5453123f));
+  return _mm256_sub_ps(h, _mm256_floor_ps(h));
+}
+
+//hash() of SdfMapGrad8. It scales sin by 43758 : an ulp off moves it by
+//3e-3 and now and then across a whole unit, at taps 0.01 apart a slope
+//of 25. Its sin is taken in double as SdfHash's, the march keeps the
+//cheaper SdfHash8.
+TARGET_AVX2 inline __m256 SdfHashGrad8(__m256 n) {
+  __m128 lo = _mm256_cvtpd_ps(SdfSinD4(_mm256_cvtps_pd(_mm256_castps256_ps128(n))));
+  __m128 hi = _mm256_cvtpd_ps(SdfSinD4(_mm256_cvtps_pd(_mm256_extractf128_ps(n, 1))));
+  __m256 h  = _mm256_mul_ps(_mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1), _mm256_set1_ps(43758.5453123f));
+  return _mm256_sub_ps(h, _mm256_floor_ps(h));
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// SdfNode : parsed s-expression
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct SdfNode {
+  std::string          atom;       //empty for a list
+  std::vector<SdfNode> item;
+  int                  line;
+
+  bool IsList() const { return atom.empty(); }
+  const char *Name() const { return !item.empty() && !item[0].IsList() ? item[0].atom.c_str() : ""; }
+};
+
+struct SdfParser {
+  const char  *s;
+  int          line;
+  std::string  error;
+
+  void Skip() {
+    for(;;) {
+      while(*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') line += *s++ == '\n';
+      if(*s != ';') return;
+      while(*s && *s != '\n') s++;
+    }
+  }
+
+  bool Parse(SdfNode &node) {
+    Skip();
+    node.line = line;
+    if(*s == '(') {
+      s++;
+      for(;;) {
+        Skip();
+        if(*s == ')') { s++; break; }
+        if(!*s) { error = "missing )"; return false; }
+        node.item.push_back(SdfNode());
+        if(!Parse(node.item.back())) return false;
+      }
+      if(node.item.empty()) { error = "empty ()"; return false; }
+      return true;
+    }
+    const char *b = s;
+    while(*s && !strchr(" \t\r\n();", *s)) s++;
+    if(s == b) { error = *s ? "unexpected )" : "unexpected end"; return false; }
+    node.atom.assign(b, s);
+    return true;
+  }
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// SdfProgram
+//   Code[i] = op(Code[a], Code[b]). Inputs and constants are instructions
+//   too, the printers inline them.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+enum SdfOp {
+  SdfConst, SdfInX, SdfInY, SdfInZ, SdfTime,
+  SdfAdd, SdfSub, SdfMul, SdfDiv, SdfMod, SdfMin, SdfMax,
+  SdfNeg, SdfAbs, SdfSqrt, SdfSin, SdfCos, SdfHashOp,
+  SdfOpMax,
+};
+
+enum SdfTarget {
+  SdfCpp, SdfHLSL, SdfAVX2,
+};
+
+struct SdfInst {
+  int   op;
+  int   a, b;
+  float value;
+};
+
+#define SdfTap             0.01f                  //tetrahedral taps of ops without a derivative, getnormal's step
+
+inline bool SdfBinary(int op) { return op >= SdfAdd && op <= SdfMax; }
+inline bool SdfUnary(int op)  { return op >= SdfNeg && op <= SdfHashOp; }
+
+//hash() has one, but at ~40000 / unit it is noise : difference it over SdfTap instead
+inline bool SdfDerivable(int op) { return op != SdfHashOp; }
+
+//tetrahedron corners for the taps, gradient = sum(corner * value) / (4 * SdfTap)
+static const float SdfCorner[4][3] = { { 1, -1, -1 }, { -1, -1, 1 }, { -1, 1, -1 }, { 1, 1, 1 } };
+
+inline float SdfApply(int op, float a, float b) {
+  switch(op) {
+  case SdfAdd:    return a + b;
+  case SdfSub:    return a - b;
+  case SdfMul:    return a * b;
+  case SdfDiv:    return a / b;
+  case SdfMod:    return fmodf(a, b);
+  case SdfMin:    return fminf(a, b);
+  case SdfMax:    return fmaxf(a, b);
+  case SdfNeg:    return -a;
+  case SdfAbs:    return fabsf(a);
+  case SdfSqrt:   return sqrtf(a);
+  case SdfSin:    return sinf(a);
+  case SdfCos:    return cosf(a);
+  case SdfHashOp: return SdfHash(a);
+  }
+  return 0;
+}
+
+struct SdfProgram {
+  enum { InstMax = 4096 };
+
+  std::vector<SdfInst>       Code;
+  int                        Result;
+  std::map<std::string, int> Cse;
+
+  SdfProgram() : Result(-1) {}
+
+  bool IsConst(int r, float v) const { return Code[r].op == SdfConst && Code[r].value == v; }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Emit : folds constants, drops identities and reuses equal instructions
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  int Emit(int op, int a = -1, int b = -1, float value = 0) {
+    bool bin = SdfBinary(op), un = SdfUnary(op);
+    if((bin || un) && Code[a].op == SdfConst && (un || Code[b].op == SdfConst)) {
+      return Const(SdfApply(op, Code[a].value, bin ? Code[b].value : 0));
+    }
+    switch(op) {
+    case SdfAdd: if(IsConst(b, 0)) return a; if(IsConst(a, 0)) return b; break;
+    case SdfSub: if(IsConst(b, 0)) return a; break;
+    case SdfMul: if(IsConst(b, 1)) return a; if(IsConst(a, 1)) return b; break;
+    case SdfDiv: if(IsConst(b, 1)) return a; break;
+    case SdfMin:
+    case SdfMax: if(a == b) return a; break;
+    case SdfNeg: if(Code[a].op == SdfNeg) return Code[a].a; break;
+    }
+    //commutative ops are exact either way round, one order for the lookup
+    if((op == SdfAdd || op == SdfMul || op == SdfMin || op == SdfMax) && a > b) {
+      int t = a; a = b; b = t;
+    }
+    char key[64];
+    unsigned bits;
+    memcpy(&bits, &value, 4);
+    snprintf(key, sizeof(key), "%d:%d:%d:%08x", op, a, b, bits);
+    std::map<std::string, int>::iterator it = Cse.find(key);
+    if(it != Cse.end()) return it->second;
+    SdfInst in = { op, a, b, value };
+    Code.push_back(in);
+    Cse[key] = (int)Code.size() - 1;
+    return (int)Code.size() - 1;
+  }
+
+  int Const(float v) { return Emit(SdfConst, -1, -1, v); }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Strip : drop what Result does not use, renumber
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  void Strip() {
+    std::vector<int> live(Code.size(), 0), remap(Code.size(), -1);
+    live[Result] = 1;
+    for(int i = Result; i >= 0; i--) {
+      if(!live[i]) continue;
+      if(Code[i].a >= 0) live[Code[i].a] = 1;
+      if(Code[i].b >= 0) live[Code[i].b] = 1;
+    }
+    std::vector<SdfInst> out;
+    for(size_t i = 0; i < Code.size(); i++) {
+      if(!live[i]) continue;
+      SdfInst in = Code[i];
+      if(in.a >= 0) in.a = remap[in.a];
+      if(in.b >= 0) in.b = remap[in.b];
+      remap[i] = (int)out.size();
+      out.push_back(in);
+    }
+    Result = remap[Result];
+    Code.swap(out);
+    Cse.clear();
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Eval : the C++ evaluator, same op order as the printed code
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  float Eval(float x, float y, float z, float time, int last = -1) const {
+    float r[InstMax];
+    if(last < 0) last = Result;
+    for(int i = 0; i <= last; i++) {
+      const SdfInst &in = Code[i];
+      switch(in.op) {
+      case SdfConst: r[i] = in.value; break;
+      case SdfInX:   r[i] = x;        break;
+      case SdfInY:   r[i] = y;        break;
+      case SdfInZ:   r[i] = z;        break;
+      case SdfTime:  r[i] = time;     break;
+      default:       r[i] = SdfApply(in.op, r[in.a], in.b >= 0 ? r[in.b] : 0); break;
+      }
+    }
+    return r[last];
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // EvalGrad : value, gradient g[3] as dual numbers, same order as the
+  //   printed SdfMapGrad. Ops without a derivative take theirs from 4 taps
+  //   of their own value, taps false holds them constant instead.
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  float EvalGrad(float x, float y, float z, float time, float *g, bool taps = true) const {
+    float r[InstMax], d[InstMax][3];
+    for(int i = 0; i <= Result; i++) {
+      const SdfInst &in = Code[i];
+      float a = in.a >= 0 ? r[in.a] : 0, b = in.b >= 0 ? r[in.b] : 0;
+      const float *ga = in.a >= 0 ? d[in.a] : d[i], *gb = in.b >= 0 ? d[in.b] : d[i];
+      switch(in.op) {
+      case SdfConst: r[i] = in.value; break;
+      case SdfInX:   r[i] = x;        break;
+      case SdfInY:   r[i] = y;        break;
+      case SdfInZ:   r[i] = z;        break;
+      case SdfTime:  r[i] = time;     break;
+      default:       r[i] = SdfApply(in.op, a, b); break;
+      }
+      float v = r[i], s[4];
+      bool  tap = in.op == SdfHashOp && taps && (ga[0] != 0 || ga[1] != 0 || ga[2] != 0);
+      for(int k = 0; tap && k < 4; k++) {
+        s[k] = Eval(x + SdfTap * SdfCorner[k][0], y + SdfTap * SdfCorner[k][1], z + SdfTap * SdfCorner[k][2], time, i);
+      }
+      for(int k = 0; k < 3; k++) {
+        float o = 0;
+        switch(in.op) {
+        case SdfInX:    o = k == 0; break;
+        case SdfInY:    o = k == 1; break;
+        case SdfInZ:    o = k == 2; break;
+        case SdfAdd:    o = ga[k] + gb[k]; break;
+        case SdfSub:    o = ga[k] - gb[k]; break;
+        case SdfMul:    o = ga[k] * b + gb[k] * a; break;
+        case SdfDiv:    o = (ga[k] - gb[k] * v) / b; break;
+        case SdfMod:    o = ga[k] - gb[k] * ((a - v) / b); break;
+        case SdfMin:    o = a < b ? ga[k] : gb[k]; break;
+        case SdfMax:    o = a > b ? ga[k] : gb[k]; break;
+        case SdfNeg:    o = -ga[k]; break;
+        case SdfAbs:    o = a < 0 ? -ga[k] : ga[k]; break;
+        case SdfSqrt:   o = ga[k] * (0.5f / v); break;
+        case SdfSin:    o = ga[k] * cosf(a); break;
+        case SdfCos:    o = ga[k] * -sinf(a); break;
+        case SdfHashOp:
+          if(tap) o = (SdfCorner[0][k] * s[0] + SdfCorner[1][k] * s[1] + SdfCorner[2][k] * s[2] + s[3]) * (0.25f / SdfTap);
+          break;
+        }
+        d[i][k] = o;
+      }
+    }
+    for(int k = 0; k < 3; k++) g[k] = d[Result][k];
+    return r[Result];
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Print : map() for main.fx, SdfMap / SdfMap8 for the CPU
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  static std::string Float(float v, int target) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    if(!strpbrk(buf, ".en")) strcat(buf, ".0");
+    strcat(buf, "f");
+    if(target == SdfAVX2) return std::string("_mm256_set1_ps(") + buf + ")";
+    if(v < 0) return std::string("(") + buf + ")";
+    return buf;
+  }
+
+  //tap >= 0 : the inputs moved to tetrahedron corner tap, t names s<i>_<tap>
+  std::string Operand(int r, int target, int tap = -1) const {
+    static const char *input[4][3] = {
+      { "px",  "p.x", "px" }, { "py", "p.y", "py" }, { "pz", "p.z", "pz" },
+      { "time", "Time.x", "_mm256_set1_ps(time)" },
+    };
+    static const char *moved[3][3] = {
+      { "qx%d", "q%d.x", "qx%d" }, { "qy%d", "q%d.y", "qy%d" }, { "qz%d", "q%d.z", "qz%d" },
+    };
+    char buf[64];
+    const SdfInst &in = Code[r];
+    if(in.op == SdfConst) return Float(in.value, target);
+    if(in.op < SdfTime && tap >= 0) snprintf(buf, sizeof(buf), moved[in.op - SdfInX][target], tap);
+    else if(in.op <= SdfTime)       return input[in.op - SdfInX][target];
+    else if(tap >= 0)               snprintf(buf, sizeof(buf), "s%d_%d", r, tap);
+    else                            snprintf(buf, sizeof(buf), "t%d", r);
+    return buf;
+  }
+
+  //one line of the program, "" for inputs and constants, grad : of PrintGrad
+  std::string Line(int i, int target, int tap = -1, bool grad = false) const {
+    static const char *func[SdfOpMax][3] = {
+      { "", "", "" }, { "", "", "" }, { "", "", "" }, { "", "", "" }, { "", "", "" },
+      { "+", "+", "_mm256_add_ps" }, { "-", "-", "_mm256_sub_ps" },
+      { "*", "*", "_mm256_mul_ps" }, { "/", "/", "_mm256_div_ps" },
+      { "fmodf", "fmod", "SdfMod8" }, { "fminf", "min", "_mm256_min_ps" }, { "fmaxf", "max", "_mm256_max_ps" },
+      { "-", "-", "SdfNeg8" }, { "fabsf", "abs", "SdfAbs8" }, { "sqrtf", "sqrt", "_mm256_sqrt_ps" },
+      { "sinf", "sin", "SdfSin8" }, { "cosf", "cos", "SdfCos8" }, { "SdfHash", "hash", "SdfHash8" },
+    };
+    const SdfInst &in = Code[i];
+    if(in.op <= SdfTime) return "";
+    const char *f = grad && target == SdfAVX2 && in.op == SdfHashOp ? "SdfHashGrad8" : func[in.op][target];
+    std::string a = Operand(in.a, target, tap), e;
+    if(target != SdfAVX2 && in.op <= SdfDiv)  e = a + " " + f + " " + Operand(in.b, target, tap);
+    else if(target != SdfAVX2 && in.op == SdfNeg) e = "-" + a;
+    else if(SdfBinary(in.op))                 e = std::string(f) + "(" + a + ", " + Operand(in.b, target, tap) + ")";
+    else                                      e = std::string(f) + "(" + a + ")";
+    return "  " + std::string(target == SdfAVX2 ? "__m256 " : "float ") + Operand(i, target, tap) + " = " + e + ";\n";
+  }
+
+  //Time.x feeds the result, else the C++ heads leave time unused
+  bool Timed() const {
+    for(size_t i = 0; i < Code.size(); i++) {
+      const SdfInst &in = Code[i];
+      if(in.op <= SdfTime) continue;
+      if(Code[in.a].op == SdfTime || (in.b >= 0 && Code[in.b].op == SdfTime)) return true;
+    }
+    return Result >= 0 && Code[Result].op == SdfTime;
+  }
+
+  //name : SdfMap / map by default, the AVX2 one gets an 8 after it
+  std::string Print(int target, std::string name = "") const {
+    static const char *head[3] = {
+      "inline float %s(float px, float py, float pz, float time) {\n",
+      "float %s(in float3 p) {\n",
+      "TARGET_AVX2 inline __m256 %s8(__m256 px, __m256 py, __m256 pz, float time) {\n",
+    };
+    if(name.empty()) name = target == SdfHLSL ? "map" : "SdfMap";
+    char buf[256];
+    snprintf(buf, sizeof(buf), head[target], name.c_str());
+    std::string s = buf;
+    if(target != SdfHLSL && !Timed()) s += "  (void)time;\n";
+    for(size_t i = 0; i < Code.size(); i++) s += Line((int)i, target);
+    s += "  return " + Operand(Result, target) + ";\n}\n";
+    return s;
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // PrintGrad : mapgrad() for main.fx, SdfMapGrad / SdfMapGrad8 for the
+  //   CPU. Every line gets its gradient next to it, per axis in C++ and
+  //   as a float3 in HLSL; "" stands for 0 and "1" for 1 so what does not
+  //   move with p costs nothing. Ops without a derivative re-run what feeds
+  //   them at the 4 taps.
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  static std::string GLit(const std::string &a, int target) {
+    if(a != "1") return a;
+    return target == SdfAVX2 ? "_mm256_set1_ps(1.0f)" : "1.0f";
+  }
+
+  static std::string GOp(char op, const std::string &a, const std::string &b, int target) {
+    if(target != SdfAVX2) return "(" + GLit(a, target) + " " + op + " " + GLit(b, target) + ")";
+    const char *f = op == '+' ? "_mm256_add_ps" : op == '-' ? "_mm256_sub_ps" : op == '*' ? "_mm256_mul_ps" : "_mm256_div_ps";
+    return std::string(f) + "(" + GLit(a, target) + ", " + GLit(b, target) + ")";
+  }
+
+  static std::string GNeg(const std::string &a, int target) {
+    if(a.empty()) return a;
+    return target == SdfAVX2 ? "SdfNeg8(" + GLit(a, target) + ")" : "-" + GLit(a, target);
+  }
+
+  static std::string GAdd(const std::string &a, const std::string &b, int target) {
+    return a.empty() ? b : b.empty() ? a : GOp('+', a, b, target);
+  }
+
+  static std::string GSub(const std::string &a, const std::string &b, int target) {
+    return b.empty() ? a : a.empty() ? GNeg(b, target) : GOp('-', a, b, target);
+  }
+
+  static std::string GMul(const std::string &g, const std::string &v, int target) {
+    return g.empty() ? g : g == "1" ? v : GOp('*', g, v, target);
+  }
+
+  //(a + b) -> a + b for the right hand side of a line
+  static std::string GBare(const std::string &e) {
+    if(e.empty() || e[0] != '(') return e;
+    int depth = 0;
+    for(size_t c = 0; c < e.size(); c++) {
+      depth += e[c] == '(' ? 1 : e[c] == ')' ? -1 : 0;
+      if(depth == 0) return c == e.size() - 1 ? e.substr(1, e.size() - 2) : e;
+    }
+    return e;
+  }
+
+  //m ? a : b
+  static std::string GSel(const std::string &m, const std::string &a, const std::string &b, int target) {
+    if(a.empty() && b.empty()) return a;
+    if(target != SdfAVX2) {
+      return "(" + m + " ? " + (a.empty() ? "0.0f" : GLit(a, target)) + " : " + (b.empty() ? "0.0f" : GLit(b, target)) + ")";
+    }
+    if(a.empty()) return "_mm256_andnot_ps(" + m + ", " + GLit(b, target) + ")";
+    if(b.empty()) return "_mm256_and_ps(" + m + ", " + GLit(a, target) + ")";
+    return "_mm256_blendv_ps(" + GLit(b, target) + ", " + GLit(a, target) + ", " + m + ")";
+  }
+
+  //gradient of instruction i along axis k, aux names the mask or factor of the line
+  std::string GExpr(int i, int k, const std::string *grad, const std::string &aux, int target) const {
+    const SdfInst &in = Code[i];
+    const std::string *ga = in.a >= 0 ? &grad[in.a * 3] : NULL, *gb = in.b >= 0 ? &grad[in.b * 3] : NULL;
+    std::string a = in.a >= 0 ? Operand(in.a, target) : "", b = in.b >= 0 ? Operand(in.b, target) : "", v = Operand(i, target);
+    switch(in.op) {
+    case SdfAdd:  return GAdd(ga[k], gb[k], target);
+    case SdfSub:  return GSub(ga[k], gb[k], target);
+    case SdfMul:  return GAdd(GMul(ga[k], b, target), GMul(gb[k], a, target), target);
+    case SdfDiv:  return ga[k].empty() && gb[k].empty() ? "" : GOp('/', GSub(ga[k], GMul(gb[k], v, target), target), b, target);
+    case SdfMod:  return GSub(ga[k], GMul(gb[k], GOp('/', GOp('-', a, v, target), b, target), target), target);
+    case SdfMin:
+    case SdfMax:  return GSel(aux, ga[k], gb[k], target);
+    case SdfNeg:  return GNeg(ga[k], target);
+    case SdfAbs:
+      if(ga[k].empty()) return "";
+      if(target == SdfAVX2) return "_mm256_xor_ps(" + GLit(ga[k], target) + ", " + aux + ")";
+      return GSel(aux, GNeg(ga[k], target), ga[k], target);
+    case SdfSqrt:
+    case SdfSin:
+    case SdfCos:  return GMul(ga[k], aux, target);
+    }
+    return "";
+  }
+
+  std::string PrintGrad(int target) const {
+    static const char *head[3] = {
+      "inline float SdfMapGrad(float px, float py, float pz, float time, float *g) {\n",
+      "float mapgrad(in float3 p, out float3 g) {\n",
+      "TARGET_AVX2 inline __m256 SdfMapGrad8(__m256 px, __m256 py, __m256 pz, float time, __m256 *g) {\n",
+    };
+    static const char *axis[3] = { "x", "y", "z" };
+    bool        avx2 = target == SdfAVX2, hlsl = target == SdfHLSL;
+    int         axes = hlsl ? 1 : 3;
+    const char *type = avx2 ? "__m256" : "float";
+    std::vector<std::string> grad(Code.size() * 3);
+    std::string s = head[target];
+    bool        corner[3] = { false, false, false };
+    for(int i = 0; i < (int)Code.size(); i++) {
+      const SdfInst &in = Code[i];
+      std::string *o = &grad[i * 3], n = Operand(i, target), aux;
+      if(in.op >= SdfInX && in.op < SdfTime) {
+        int c = in.op - SdfInX;
+        if(hlsl) o[0] = c == 0 ? "float3(1, 0, 0)" : c == 1 ? "float3(0, 1, 0)" : "float3(0, 0, 1)";
+        else     o[c] = "1";
+        continue;
+      }
+      if(in.op <= SdfTime) continue;
+      bool moves = false;
+      for(int k = 0; k < 3; k++) moves |= (in.a >= 0 && !grad[in.a * 3 + k].empty()) || (in.b >= 0 && !grad[in.b * 3 + k].empty());
+      std::string a = Operand(in.a, target), b = in.b >= 0 ? Operand(in.b, target) : "";
+      char id[32];
+      snprintf(id, sizeof(id), "%d", i);
+
+      //the line itself, sin / cos together with their derivative
+      if(moves && avx2 && (in.op == SdfSin || in.op == SdfCos)) {
+        aux = std::string("c") + id;
+        s += "  __m256 " + n + ", " + aux + ";\n";
+        if(in.op == SdfSin) s += "  SinCos8(" + a + ", &" + n + ", &" + aux + ");\n";
+        else                s += "  SinCos8(" + a + ", &" + aux + ", &" + n + ");\n  " + aux + " = SdfNeg8(" + aux + ");\n";
+      } else {
+        s += Line(i, target, -1, true);
+      }
+      if(!moves) continue;
+
+      //what the gradient of the line needs
+      std::string decl = avx2 ? "  __m256 " : "  bool ";
+      switch(in.op) {
+      case SdfMin:
+      case SdfMax:
+        aux = std::string("m") + id;
+        if(avx2) s += decl + aux + " = _mm256_cmp_ps(" + a + ", " + b + (in.op == SdfMin ? ", _CMP_LT_OQ);\n" : ", _CMP_GT_OQ);\n");
+        else     s += decl + aux + " = " + a + (in.op == SdfMin ? " < " : " > ") + b + ";\n";
+        break;
+      case SdfAbs:
+        aux = std::string("m") + id;
+        if(avx2) s += decl + aux + " = _mm256_and_ps(" + a + ", _mm256_set1_ps(-0.0f));\n";
+        else     s += decl + aux + " = " + a + " < 0;\n";
+        break;
+      case SdfSqrt:
+        aux = std::string("c") + id;
+        s += std::string("  ") + type + " " + aux + " = " + GBare(GOp('/', Float(0.5f, target), n, target)) + ";\n";
+        break;
+      case SdfSin:
+      case SdfCos:
+        if(avx2) break;
+        aux = std::string("c") + id;
+        if(in.op == SdfSin) s += std::string("  float ") + aux + (hlsl ? " = cos(" : " = cosf(") + a + ");\n";
+        else                s += std::string("  float ") + aux + (hlsl ? " = -sin(" : " = -sinf(") + a + ");\n";
+        break;
+      }
+
+      //ops without a derivative : what feeds them at the 4 corners
+      if(!SdfDerivable(in.op)) {
+        std::vector<char> live(i + 1, 0);
+        live[i] = 1;
+        for(int j = i; j >= 0; j--) {
+          if(!live[j]) continue;
+          if(Code[j].a >= 0) live[Code[j].a] = 1;
+          if(Code[j].b >= 0) live[Code[j].b] = 1;
+        }
+        for(int j = 0; j <= i; j++) {
+          int k = Code[j].op - SdfInX;
+          if(!live[j] || k < 0 || k > 2 || corner[hlsl ? 0 : k]) continue;
+          corner[hlsl ? 0 : k] = true;
+          for(int c = 0; c < 4; c++) {
+            char q[32];
+            if(hlsl) {
+              snprintf(q, sizeof(q), "q%d", c);
+              s += std::string("  float3 ") + q + " = p + float3(" + Float(SdfTap * SdfCorner[c][0], target) + ", " +
+                Float(SdfTap * SdfCorner[c][1], target) + ", " + Float(SdfTap * SdfCorner[c][2], target) + ");\n";
+            } else {
+              snprintf(q, sizeof(q), "q%s%d", axis[k], c);
+              s += std::string("  ") + type + " " + q + " = " +
+                GBare(GOp(SdfCorner[c][k] > 0 ? '+' : '-', std::string("p") + axis[k], Float(SdfTap, target), target)) + ";\n";
+            }
+          }
+        }
+        for(int c = 0; c < 4; c++) {
+          for(int j = 0; j <= i; j++) if(live[j]) s += Line(j, target, c, true);
+        }
+        std::string t[4], scale = Float(0.25f / SdfTap, target);
+        for(int c = 0; c < 4; c++) t[c] = Operand(i, target, c);
+        for(int k = 0; k < axes; k++) {
+          std::string e;
+          if(hlsl) {
+            for(int c = 0; c < 4; c++) {
+              char f[64];
+              snprintf(f, sizeof(f), "float3(%g, %g, %g) * ", SdfCorner[c][0], SdfCorner[c][1], SdfCorner[c][2]);
+              e = c == 0 ? f + t[c] : e + " + " + (c == 3 ? "" : f) + t[c];
+            }
+            e = "(" + e + ") * " + scale;
+          } else {
+            e = SdfCorner[0][k] > 0 ? t[0] : GNeg(t[0], target);
+            for(int c = 1; c < 4; c++) e = GOp(SdfCorner[c][k] > 0 ? '+' : '-', e, t[c], target);
+            e = GOp('*', e, scale, target);
+          }
+          o[k] = e;
+        }
+      } else {
+        for(int k = 0; k < axes; k++) o[k] = GExpr(i, k, &grad[0], aux, target);
+      }
+
+      //name what is more than a name
+      for(int k = 0; k < axes; k++) {
+        if(o[k].empty() || o[k] == "1" || o[k].find_first_of("(-") == std::string::npos) continue;
+        std::string g = "g" + std::string(id) + (hlsl ? "" : axis[k]);
+        s += std::string("  ") + (hlsl ? "float3" : type) + " " + g + " = " + GBare(o[k]) + ";\n";
+        o[k] = g;
+      }
+    }
+    const std::string *r = &grad[Result * 3];
+    if(hlsl) {
+      s += "  g = " + (r[0].empty() ? std::string("float3(0, 0, 0)") : r[0]) + ";\n";
+    } else {
+      for(int k = 0; k < 3; k++) {
+        std::string e = r[k].empty() ? (avx2 ? "_mm256_setzero_ps()" : "0.0f") : GLit(r[k], target);
+        char buf[32];
+        snprintf(buf, sizeof(buf), "  g[%d] = ", k);
+        s += buf + e + ";\n";
+      }
+    }
+    s += "  return " + Operand(Result, target) + ";\n}\n";
+    return s;
+  }
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// SdfCompiler : SdfNode tree -> SdfProgram
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct SdfCompiler {
+  enum { Off = -2 };
+
+  struct Point {
+    int c[3];
+  };
+
+  SdfProgram  *prog;
+  std::string  error;
+
+  bool Fail(const SdfNode &n, const char *msg) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "line %d : %s %s", n.line, n.Name(), msg);
+    if(error.empty()) error = buf;
+    return false;
+  }
+
+  bool Number(const SdfNode &n, int i, float *v) {
+    if(i >= (int)n.item.size() || n.item[i].IsList()) return Fail(n, "missing number");
+    char *end;
+    *v = strtof(n.item[i].atom.c_str(), &end);
+    if(*end) return Fail(n, "bad number");
+    return true;
+  }
+
+  bool Axes(const SdfNode &n, int i, std::string *axes) {
+    if(i >= (int)n.item.size() || n.item[i].IsList()) return Fail(n, "missing axes");
+    *axes = n.item[i].atom;
+    for(size_t k = 0; k < axes->size(); k++) {
+      if((*axes)[k] < 'x' || (*axes)[k] > 'z') return Fail(n, "bad axes");
+    }
+    return true;
+  }
+
+  bool Arity(const SdfNode &n, int count) {
+    if((int)n.item.size() != count) return Fail(n, "wrong argument count");
+    return true;
+  }
+
+  int Length(const int *c, int count) {
+    int s = prog->Emit(SdfMul, c[0], c[0]);
+    for(int k = 1; k < count; k++) s = prog->Emit(SdfAdd, s, prog->Emit(SdfMul, c[k], c[k]));
+    return prog->Emit(SdfSqrt, s);
+  }
+
+  //distance of n at p, Off when switched off, -1 on error
+  int Lower(const SdfNode &n, Point p) {
+    SdfProgram &g = *prog;
+    if(!n.IsList()) return Fail(n, "expected a list"), -1;
+    std::string op = n.Name();
+    const SdfNode &last = n.item.back();
+
+    if(op == "off") return Off;
+    if(op == "sphere") {
+      float r;
+      if(!Arity(n, 2) || !Number(n, 1, &r)) return -1;
+      return g.Emit(SdfSub, Length(p.c, 3), g.Const(r));
+    }
+    if(op == "cylinder") {
+      std::string a;
+      float r;
+      if(!Arity(n, 3) || !Axes(n, 1, &a) || a.size() != 1 || !Number(n, 2, &r)) return Fail(n, "expects (cylinder x|y|z r)"), -1;
+      int k = a[0] - 'x', c[2] = { p.c[(k + 1) % 3], p.c[(k + 2) % 3] };
+      return g.Emit(SdfSub, Length(c, 2), g.Const(r));
+    }
+    if(op == "min" || op == "max") {
+      int d = Off;
+      for(size_t i = 1; i < n.item.size(); i++) {
+        int c = Lower(n.item[i], p);
+        if(c == -1) return -1;
+        if(c == Off) continue;
+        d = d == Off ? c : g.Emit(op == "min" ? SdfMin : SdfMax, c, d);
+      }
+      return d;
+    }
+    if(op == "smin") {
+      float k;
+      if(!Arity(n, 4) || !Number(n, 1, &k)) return -1;
+      int a = Lower(n.item[2], p), b = Lower(n.item[3], p);
+      if(a == -1 || b == -1) return -1;
+      if(a == Off || b == Off) return a == Off ? b : a;
+      //h = clamp(0.5 + 0.5 * (b - a) / k, 0, 1), lerp(b, a, h) - k * h * (1 - h)
+      int h  = g.Emit(SdfAdd, g.Const(0.5f), g.Emit(SdfDiv, g.Emit(SdfMul, g.Const(0.5f), g.Emit(SdfSub, b, a)), g.Const(k)));
+      h      = g.Emit(SdfMin, g.Emit(SdfMax, h, g.Const(0)), g.Const(1));
+      int ab = g.Emit(SdfAdd, b, g.Emit(SdfMul, g.Emit(SdfSub, a, b), h));
+      return g.Emit(SdfSub, ab, g.Emit(SdfMul, g.Emit(SdfMul, g.Const(k), h), g.Emit(SdfSub, g.Const(1), h)));
+    }
+    if(op == "neg") {
+      if(!Arity(n, 2)) return -1;
+      int d = Lower(last, p);
+      return d < 0 ? d : g.Emit(SdfNeg, d);
+    }
+    if(op == "move") {
+      float o[3];
+      if(!Arity(n, 5) || !Number(n, 1, &o[0]) || !Number(n, 2, &o[1]) || !Number(n, 3, &o[2])) return -1;
+      for(int k = 0; k < 3; k++) p.c[k] = g.Emit(SdfAdd, p.c[k], g.Const(o[k]));
+      return Lower(last, p);
+    }
+    if(op == "rep" || op == "irep") {
+      float k;
+      std::string a;
+      if(!Arity(n, 4) || !Number(n, 1, &k) || !Axes(n, 2, &a)) return -1;
+      for(size_t i = 0; i < a.size(); i++) {
+        int &c = p.c[a[i] - 'x'];
+        c = g.Emit(SdfMod, c, g.Const(k * 2));
+        if(op == "rep") c = g.Emit(SdfAbs, c);
+        c = g.Emit(SdfSub, c, g.Const(k));
+      }
+      return Lower(last, p);
+    }
+    if(op == "rotate") {
+      std::string a;
+      float angle, speed;
+      if(!Arity(n, 5) || !Axes(n, 1, &a) || a.size() != 2 || !Number(n, 2, &angle) || !Number(n, 3, &speed)) return Fail(n, "expects (rotate uv angle speed d)"), -1;
+      int t  = g.Emit(SdfAdd, g.Const(angle), g.Emit(SdfMul, g.Emit(SdfTime), g.Const(speed)));
+      int co = g.Emit(SdfCos, t), si = g.Emit(SdfSin, t);
+      int &u = p.c[a[0] - 'x'], &v = p.c[a[1] - 'x'];
+      if(!g.IsConst(si, 0) || !g.IsConst(co, 1)) {
+        int nu = g.Emit(SdfSub, g.Emit(SdfMul, co, u), g.Emit(SdfMul, si, v));
+        int nv = g.Emit(SdfAdd, g.Emit(SdfMul, si, u), g.Emit(SdfMul, co, v));
+        u = nu;
+        v = nv;
+      }
+      return Lower(last, p);
+    }
+    if(op == "wave") {
+      std::string a, fn, b;
+      float amp, f, fb;
+      if(!Arity(n, 8) || !Axes(n, 1, &a) || !Number(n, 2, &amp) || !Number(n, 3, &f) || !Number(n, 5, &fb) || !Axes(n, 6, &b)) return -1;
+      fn = n.item[4].atom;
+      if(a.size() != 1 || b.size() != 1 || (fn != "sin" && fn != "cos")) return Fail(n, "expects (wave a amp f sin|cos g b d)"), -1;
+      if(amp != 0) {
+        int w = g.Emit(fn == "sin" ? SdfSin : SdfCos, g.Emit(SdfMul, p.c[b[0] - 'x'], g.Const(fb)));
+        w = g.Emit(SdfMul, g.Emit(SdfSin, g.Emit(SdfMul, g.Const(f), w)), g.Const(amp));
+        p.c[a[0] - 'x'] = g.Emit(SdfAdd, p.c[a[0] - 'x'], w);
+      }
+      return Lower(last, p);
+    }
+    if(op == "jitter") {
+      float amp;
+      if(!Arity(n, 3) || !Number(n, 1, &amp)) return -1;
+      if(amp != 0) {
+        int h = g.Emit(SdfMul, g.Emit(SdfHashOp, p.c[0]), g.Const(amp));
+        for(int k = 0; k < 3; k++) p.c[k] = g.Emit(SdfAdd, p.c[k], h);
+      }
+      return Lower(last, p);
+    }
+    if(op == "displace") {
+      int d = Lower(last, p);
+      if(d < 0) return d;
+      for(size_t i = 1; i + 1 < n.item.size(); i++) {
+        const SdfNode &t = n.item[i];
+        float amp, f;
+        if(std::string(t.Name()) != "noise" || !Number(t, 1, &amp) || !Number(t, 2, &f)) return Fail(t, "expects (noise amp f axes ...)"), -1;
+        if(amp == 0) continue;
+        int sum = -1;
+        for(size_t k = 3; k < t.item.size(); k++) {
+          std::string a = t.item[k].atom;
+          if(a.empty() || a[0] < 'x' || a[0] > 'z' || a.size() > 2 || (a.size() == 2 && a[1] != '2')) return Fail(t, "bad axis"), -1;
+          int s = g.Emit(SdfSin, g.Emit(SdfMul, p.c[a[0] - 'x'], g.Const(f)));
+          if(a.size() == 2) s = g.Emit(SdfSin, s);
+          sum = sum < 0 ? s : g.Emit(SdfAdd, sum, s);
+        }
+        if(sum >= 0) d = g.Emit(SdfAdd, d, g.Emit(SdfMul, g.Const(amp), sum));
+      }
+      return d;
+    }
+    return Fail(n, "unknown"), -1;
+  }
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// SdfCompile : text -> prog, false with error set
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline bool SdfCompile(const char *text, SdfProgram *prog, std::string *error) {
+  SdfParser parser = { text, 1, "" };
+  SdfNode   root;
+  if(!parser.Parse(root)) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "line %d : ", parser.line);
+    *error = buf + parser.error;
+    return false;
+  }
+  *prog = SdfProgram();
+  SdfCompiler c = { prog, "" };
+  SdfCompiler::Point p = { { prog->Emit(SdfInX), prog->Emit(SdfInY), prog->Emit(SdfInZ) } };
+  int d = c.Lower(root, p);
+  if(d < 0) {
+    *error = d == SdfCompiler::Off ? "everything is off" : c.error;
+    return false;
+  }
+  prog->Result = d;
+  prog->Strip();
+  if(prog->Code.size() > SdfProgram::InstMax) {
+    *error = "scene too large";
+    return false;
+  }
+  return true;
+}
+
+inline bool SdfLoad(const char *name, SdfProgram *prog, std::string *error) {
+  FILE *fp = fopen(name, "rb");
+  if(!fp) {
+    *error = std::string("can't open ") + name;
+    return false;
+  }
+  std::string text;
+  char buf[4096];
+  size_t n;
+  while((n = fread(buf, 1, sizeof(buf), fp)) > 0) text.append(buf, n);
+  fclose(fp);
+  return SdfCompile(text.c_str(), prog, error);
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// SdfRange : interval of every instruction, p and Time.x anywhere
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline float SdfRangeMul(float a, float b) { return a == 0 || b == 0 ? 0 : a * b; }
+
+inline void SdfRange(const SdfProgram &prog, std::vector<float> *lo, std::vector<float> *hi) {
+  const float inf = INFINITY;
+  lo->assign(prog.Code.size(), -inf);
+  hi->assign(prog.Code.size(), inf);
+  for(size_t i = 0; i < prog.Code.size(); i++) {
+    const SdfInst &in = prog.Code[i];
+    float la = in.a >= 0 ? (*lo)[in.a] : 0, ha = in.a >= 0 ? (*hi)[in.a] : 0;
+    float lb = in.b >= 0 ? (*lo)[in.b] : 0, hb = in.b >= 0 ? (*hi)[in.b] : 0;
+    float l = -inf, h = inf, m;
+    switch(in.op) {
+    case SdfConst: l = h = in.value; break;
+    case SdfAdd:   l = la + lb; h = ha + hb; break;
+    case SdfSub:   l = la - hb; h = ha - lb; break;
+    case SdfMul:
+    case SdfDiv:
+      if(in.op == SdfDiv && (lb <= 0 && hb >= 0)) break;
+      {
+        float c[4];
+        for(int k = 0; k < 4; k++) {
+          float a = k & 1 ? ha : la, b = k & 2 ? hb : lb;
+          c[k] = in.op == SdfMul ? SdfRangeMul(a, b) : isinf(b) ? 0 : a / b;
+        }
+        l = fminf(fminf(c[0], c[1]), fminf(c[2], c[3]));
+        h = fmaxf(fmaxf(c[0], c[1]), fmaxf(c[2], c[3]));
+      }
+      break;
+    case SdfMod:   //sign of a, under |b|
+      m = fmaxf(fabsf(lb), fabsf(hb));
+      l = la >= 0 ? 0 : -m;
+      h = ha <= 0 ? 0 : m;
+      break;
+    case SdfMin:   l = fminf(la, lb); h = fminf(ha, hb); break;
+    case SdfMax:   l = fmaxf(la, lb); h = fmaxf(ha, hb); break;
+    case SdfNeg:   l = -ha; h = -la; break;
+    case SdfAbs:   l = la >= 0 ? la : ha <= 0 ? -ha : 0; h = fmaxf(-la, ha); break;
+    case SdfSqrt:  l = sqrtf(fmaxf(la, 0)); h = sqrtf(fmaxf(ha, 0)); break;
+    case SdfSin:
+    case SdfCos:   l = -1; h = 1; break;
+    case SdfHashOp: l = 0; h = 1; break;
+    }
+    (*lo)[i] = l == l ? l : -inf;
+    (*hi)[i] = h == h ? h : inf;
+  }
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// SdfSplit : the part of map() Time.x does not move, to bake (brick.h)
+//   A min with one operand on Time.x and one not, on a path to the result
+//   of min, max and + or - of operands that do not move, is cut : fixed
+//   keeps the still operand. moving is the cut operand less what the path
+//   can take off it (the ranges of what it adds), so
+//     map() >= min(fixed, moving)
+//   at any time : the path is monotone, where the cut operand is the
+//   smaller one moving bounds it, where a min of the path takes over,
+//   fixed goes through the same min. false if Time.x is left in fixed.
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline bool SdfSplit(const SdfProgram &prog, SdfProgram *fixed, SdfProgram *moving, float *slack) {
+  const std::vector<SdfInst> &code = prog.Code;
+  int n = (int)code.size();
+  std::vector<float> lo, hi;
+  SdfRange(prog, &lo, &hi);
+  std::vector<char> dep(n, 0), path(n, 0);
+  std::vector<int>  uses(n, 0), user(n, -1), cut(n, -1);
+  for(int i = 0; i < n; i++) {
+    const SdfInst &in = code[i];
+    dep[i] = in.op == SdfTime || (in.a >= 0 && dep[in.a]) || (in.b >= 0 && dep[in.b]);
+    if(in.a >= 0) { uses[in.a]++; user[in.a] = i; }
+    if(in.b >= 0 && in.b != in.a) { uses[in.b]++; user[in.b] = i; }
+  }
+  *slack = 0;
+  *moving = SdfProgram();
+  moving->Result = moving->Const(FLT_MAX);
+  *fixed = prog;
+  if(!dep[prog.Result]) return true;
+
+  //cut[i] : the moving operand of a cut min, slack[i] what the path takes off
+  std::vector<float> off(n, 0);
+  for(int i = 0; i < n; i++) {
+    const SdfInst &in = code[i];
+    if(in.op != SdfMin || dep[in.a] == dep[in.b]) continue;
+    int d = dep[in.a] ? in.a : in.b;
+    if(path[d]) continue;    //under a min cut already
+    float s = 0;
+    bool  ok = true;
+    for(int v = i; v != prog.Result && ok; v = user[v]) {
+      const SdfInst &u = code[user[v]];
+      int o = u.a == v ? u.b : u.a;
+      ok = uses[v] == 1 && !dep[o];
+      if(u.op == SdfAdd)                   s += fmaxf(0, -lo[o]);
+      else if(u.op == SdfSub && u.a == v)  s += fmaxf(0, hi[o]);
+      else if(u.op != SdfMin && u.op != SdfMax) ok = false;
+    }
+    if(!ok || isinf(s)) continue;
+    cut[i] = d;
+    off[i] = s;
+    for(int v = i; v != prog.Result; v = user[v]) path[user[v]] = 1;
+  }
+
+  //fixed : the cut mins forward their still operand
+  SdfProgram f;
+  std::vector<int> to(n, -1);
+  for(int i = 0; i < n; i++) {
+    const SdfInst &in = code[i];
+    if(cut[i] >= 0)              to[i] = to[in.a == cut[i] ? in.b : in.a];
+    else if(in.op == SdfConst)   to[i] = f.Const(in.value);
+    else if(in.op <= SdfTime)    to[i] = f.Emit(in.op);
+    else                         to[i] = f.Emit(in.op, to[in.a], in.b >= 0 ? to[in.b] : -1);
+  }
+  f.Result = to[prog.Result];
+  f.Strip();
+  for(size_t i = 0; i < f.Code.size(); i++) {
+    if(f.Code[i].op == SdfTime) return false;
+  }
+
+  //moving : min of the cut operands less their slack
+  SdfProgram m = prog;
+  int r = -1;
+  for(int i = 0; i < n; i++) {
+    if(cut[i] < 0) continue;
+    int d = m.Emit(SdfSub, cut[i], m.Const(off[i]));
+    r = r < 0 ? d : m.Emit(SdfMin, r, d);
+    *slack = fmaxf(*slack, off[i]);
+  }
+  m.Result = r;
+  m.Strip();
+  *fixed  = f;
+  *moving = m;
+  return true;
+}
+
+#endif //_SDF_H_
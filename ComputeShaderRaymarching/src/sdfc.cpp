@@ -0,0 +1,262 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  sdfc.cpp
+//    sdfc scene.sdf [out.fxh] [out.h]
+//    Compiles a scene (sdf.h) to map() / mapgrad() for main.fx and SdfMap /
+//    SdfMap8 / SdfMapGrad / SdfMapGrad8 for march.h, and the split of
+//    SdfSplit for brick.h : SdfStatic / SdfStatic8 to bake and SdfMoving /
+//    SdfMoving8 to evaluate as they move, and SdfMapPrune / SdfMapPrune8
+//    gated per min / max for march.h's pruning. Then checks the build's own
+//    map_sdf.h and map.fxh against the evaluator on random points : the
+//    scalar map must match bit for bit, the AVX2 code within the error of
+//    its sin, the gradients within float rounding of the dual numbers
+//    (1e-4, AVX2 too : SdfHashGrad8 rounds sin as SdfHash), the split never
+//    above map(), the pruned map bit for bit on map() inside the box its
+//    bits came from. map.fxh is built as C++ on a small HLSL shim (float3,
+//    fmod as trunc, frac), so the shader backend runs too.
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#include <stdio.h>
+#include <string>
+#include "prune.h"
+#include "map_sdf.h"
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// hlsl : what map.fxh needs of HLSL, with its semantics
+//-----------//-----------//-----------//-----------//-----------//-----------
+namespace hlsl {
+struct float3 {
+  float x, y, z;
+  float3() : x(0), y(0), z(0) {}
+  float3(float a, float b, float c) : x(a), y(b), z(c) {}
+  float3(const float3 &o) : x(o.x), y(o.y), z(o.z) {}
+  float3 &operator=(const float3 &o);
+};
+struct float4 { float x, y, z, w; };
+
+static float4 Time;
+static float3 Out;   //mapgrad's out g : the only float3 the generated code assigns
+
+inline float3 &float3::operator=(const float3 &o) {
+  x = Out.x = o.x;
+  y = Out.y = o.y;
+  z = Out.z = o.z;
+  return *this;
+}
+
+inline float3 operator+(const float3 &a, const float3 &b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline float3 operator-(const float3 &a, const float3 &b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline float3 operator+(const float3 &a, float b)         { return float3(a.x + b, a.y + b, a.z + b); }
+inline float3 operator*(const float3 &a, float b)         { return float3(a.x * b, a.y * b, a.z * b); }
+inline float3 operator*(float a, const float3 &b)         { return b * a; }
+inline float3 operator-(const float3 &a)                  { return float3(-a.x, -a.y, -a.z); }
+
+inline float abs(float a)            { return fabsf(a); }
+inline float sqrt(float a)           { return sqrtf(a); }
+inline float sin(float a)            { return sinf(a); }
+inline float cos(float a)            { return cosf(a); }
+inline float min(float a, float b)   { return fminf(a, b); }
+inline float max(float a, float b)   { return fmaxf(a, b); }
+inline float fmod(float a, float b)  { return a - truncf(a / b) * b; }
+inline float frac(float a)           { return a - floorf(a); }
+inline float hash(float n)           { return SdfHash(n); }   //sin rounded as the reference, the GPU's is its own
+
+#define in const
+#define out
+#include "map.fxh"
+#undef out
+#undef in
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// file
+//-----------//-----------//-----------//-----------//-----------//-----------
+static bool WriteText(const char *name, const std::string &text) {
+  FILE *fp = fopen(name, "wb");
+  if(!fp) return false;
+  fwrite(text.data(), 1, text.size(), fp);
+  fclose(fp);
+  return true;
+}
+
+//the scene itself, so march.h can compile the same program at run time
+static std::string Quote(const char *name) {
+  std::string s = "static const char SdfScene[] =\n", line;
+  FILE *fp = fopen(name, "rb");
+  for(int c; fp && (c = fgetc(fp)) != EOF;) {
+    if(c == '\r') continue;
+    if(c == '\n') {
+      s += "  \"" + line + "\\n\"\n";
+      line.clear();
+    } else {
+      if(c == '"' || c == '\\') line += '\\';
+      line += char(c);
+    }
+  }
+  if(fp) fclose(fp);
+  if(!line.empty()) s += "  \"" + line + "\"\n";
+  return s + "  ;\n\n";
+}
+
+static std::string Banner(const char *src) {
+  return std::string("//generated by sdfc from ") + src + ", do not edit\n";
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+// check
+//-----------//-----------//-----------//-----------//-----------//-----------
+//pruned map() inside random boxes : bit for bit SdfMap, scalar and AVX2
+static int CheckPrune(const SdfProgram &prog, const SdfGates &gates, int *pruned) {
+  unsigned seed = 54321;
+  auto rnd = [&](float range) {
+    seed = seed * 1664525u + 1013904223u;
+    return ((seed >> 8) * (1.0f / 16777216.0f) * 2 - 1) * range;
+  };
+  bool avx2 = DetectIsa() == IsaAVX2;
+  int  differ = 0;
+  *pruned = 0;
+  for(int box = 0; box < 512; box++) {
+    float time = rnd(100) + 100, c[3] = { rnd(200), rnd(200), rnd(200) + time * 13 }, r = fabsf(rnd(8)) + 0.01f;
+    SdfInterval in[4] = { Iv(c[0] - r, c[0] + r), Iv(c[1] - r, c[1] + r), Iv(c[2] - r, c[2] + r), Iv(time, time) };
+    unsigned long long keep = box ? gates.Mask(prog, in) : gates.Full();
+    for(unsigned long long k = ~keep & gates.Full(); k; k &= k - 1) (*pruned)++;
+    float x[8], y[8], z[8], a[8], b[8];
+    for(int k = 0; k < 8; k++) {
+      x[k] = c[0] + rnd(r);
+      y[k] = c[1] + rnd(r);
+      z[k] = c[2] + rnd(r);
+      float m = SdfMap(x[k], y[k], z[k], time), p = SdfMapPrune(x[k], y[k], z[k], time, keep);
+      differ += memcmp(&m, &p, 4) != 0;
+    }
+    if(avx2) SdfCheckPrune8(x, y, z, time, keep, a, b);
+    for(int k = 0; avx2 && k < 8; k++) differ += memcmp(&a[k], &b[k], 4) != 0;
+  }
+  return differ;
+}
+
+static bool Check(const SdfProgram &prog, const SdfProgram &fixed, const SdfProgram &moving, bool split) {
+  unsigned seed = 12345;
+  auto rnd = [&](float range) {
+    seed = seed * 1664525u + 1013904223u;
+    return ((seed >> 8) * (1.0f / 16777216.0f) * 2 - 1) * range;
+  };
+  int    count = 1 << 16, differ = 0, above = 0;
+  double err = 0, gerr = 0, gerr8 = 0, herr = 0, hgerr = 0;
+  bool   avx2 = DetectIsa() == IsaAVX2;
+  for(int i = 0; i < count; i += 8) {
+    float x[8], y[8], z[8], r[8] = {}, g8[3][8] = {};
+    float time = rnd(100) + 100;
+    for(int k = 0; k < 8; k++) {
+      x[k] = rnd(200);
+      y[k] = rnd(200);
+      z[k] = rnd(200) + time * 13;
+    }
+    if(avx2) SdfCheck8(x, y, z, time, r, g8);
+    for(int k = 0; k < 8; k++) {
+      float a = prog.Eval(x[k], y[k], z[k], time), b = SdfMap(x[k], y[k], z[k], time);
+      float ga[3], gb[3], c = SdfMapGrad(x[k], y[k], z[k], time, gb);
+      prog.EvalGrad(x[k], y[k], z[k], time, ga);
+      differ += memcmp(&a, &b, 4) != 0 || memcmp(&a, &c, 4) != 0;
+      if(split) {
+        float s = fixed.Eval(x[k], y[k], z[k], time), m = moving.Eval(x[k], y[k], z[k], time);
+        float gs = SdfStatic(x[k], y[k], z[k], time), gm = SdfMoving(x[k], y[k], z[k], time);
+        differ += memcmp(&s, &gs, 4) != 0 || memcmp(&m, &gm, 4) != 0;
+        above  += fminf(s, m) > a;
+      }
+      if(avx2) err = fmax(err, fabs(a - r[k]));
+
+      hlsl::float3 hp(x[k], y[k], z[k]), hg;
+      hlsl::Time.x = time;
+      float ha = hlsl::map(hp), hc = hlsl::mapgrad(hp, hg);
+      float gh[3] = { hlsl::Out.x, hlsl::Out.y, hlsl::Out.z };
+      herr = fmax(herr, fmax(fabs(a - ha), fabs(a - hc)));
+      for(int n = 0; n < 3; n++) {
+        //relative to the size of the gradient, hash taps are ~100 where the field is ~1
+        double scale = 1 + fabs(ga[0]) + fabs(ga[1]) + fabs(ga[2]);
+        gerr  = fmax(gerr, fabs(ga[n] - gb[n]) / scale);
+        hgerr = fmax(hgerr, fabs(ga[n] - gh[n]) / scale);
+        if(avx2) gerr8 = fmax(gerr8, fabs(ga[n] - g8[n][k]) / scale);
+      }
+    }
+  }
+  printf("check   %d points : %d differ from map_sdf.h", count, differ);
+  if(avx2) printf(", AVX2 max error %.2e", err);
+  printf("%s\n", differ ? " (rebuild sdfc after regenerating)" : "");
+  printf("check   gradient max error %.2e", gerr);
+  if(avx2) printf(", AVX2 %.2e", gerr8);
+  printf("\n");
+  printf("check   map.fxh as C++ : max error %.2e, gradient %.2e\n", herr, hgerr);
+  if(split) printf("check   min(SdfStatic, SdfMoving) above map() at %d points\n", above);
+  SdfGates gates;
+  gates.Build(prog);
+  int pruned, pdiffer = CheckPrune(prog, gates, &pruned);
+  printf("check   pruned map() in 512 boxes, %d sides off : %d differ%s\n", pruned, pdiffer,
+    pdiffer ? " (rebuild sdfc after regenerating)" : "");
+  return differ == 0 && above == 0 && pdiffer == 0 && gerr < 1e-4 && (!avx2 || gerr8 < 1e-4) && herr < 1e-3 && hgerr < 1e-3;
+}
+
+int main(int argc, char *argv[]) {
+  if(argc < 2) {
+    printf("sdfc scene.sdf [out.fxh] [out.h]\n");
+    return 1;
+  }
+  SdfProgram  prog;
+  std::string error;
+  if(!SdfLoad(argv[1], &prog, &error)) {
+    printf("%s : %s\n", argv[1], error.c_str());
+    return 1;
+  }
+  int count[SdfOpMax] = {};
+  for(size_t i = 0; i < prog.Code.size(); i++) count[prog.Code[i].op]++;
+  printf("%s : %d instructions, %d sin/cos, %d mod, %d sqrt\n", argv[1], (int)prog.Code.size(),
+    count[SdfSin] + count[SdfCos] + count[SdfHashOp], count[SdfMod], count[SdfSqrt]);
+  int taps = 0;
+  for(size_t i = 0; i < prog.Code.size(); i++) taps += !SdfDerivable(prog.Code[i].op);
+  printf("%s : gradient as dual numbers, %d ops on tetrahedral taps\n", argv[1], taps);
+
+  SdfGates gates;
+  gates.Build(prog);
+  printf("%s : %d min / max gated for pruning\n", argv[1], gates.Count());
+
+  SdfProgram fixed, moving;
+  float      slack;
+  bool       split = SdfSplit(prog, &fixed, &moving, &slack);
+  if(split) {
+    printf("%s : %d instructions do not move with Time.x, %d do, less %g\n", argv[1], (int)fixed.Code.size(),
+      (int)moving.Code.size(), slack);
+  } else {
+    printf("%s : no part without Time.x to bake\n", argv[1]);
+  }
+
+  std::string guard = "#ifndef _MAP_SDF_H_\n#define _MAP_SDF_H_\n\n#include \"sdf.h\"\n\n";
+  char size[256];
+  snprintf(size, sizeof(size), "enum { SdfMapSize = %d, SdfStaticSize = %d, SdfGateCount = %d };   //0 : SdfStatic is map(), nothing to bake\n"
+    "static const float SdfMovingSlack = %.9gf;\n\n", (int)prog.Code.size(), split ? (int)fixed.Code.size() : 0, gates.Count(), slack);
+  guard += size + Quote(argv[1]);
+  if(argc > 2 && !WriteText(argv[2], Banner(argv[1]) + prog.Print(SdfHLSL) + "\n" + prog.PrintGrad(SdfHLSL))) {
+    printf("can't write %s\n", argv[2]);
+    return 1;
+  }
+  if(argc > 3 && !WriteText(argv[3], Banner(argv[1]) + guard + prog.Print(SdfCpp) + "\n" + prog.Print(SdfAVX2) +
+    "\n" + prog.PrintGrad(SdfCpp) + "\n" + prog.PrintGrad(SdfAVX2) +
+    "\n" + fixed.Print(SdfCpp, "SdfStatic") + "\n" + fixed.Print(SdfAVX2, "SdfStatic") +
+    "\n" + moving.Print(SdfCpp, "SdfMoving") + "\n" + moving.Print(SdfAVX2, "SdfMoving") +
+    "\n" + gates.Print(prog, SdfCpp) + "\n" + gates.Print(prog, SdfAVX2) +
+    "\nTARGET_AVX2 inline void SdfCheck8(const float *x, const float *y, const float *z, float time, float *out, float (*grad)[8]) {\n"
+    "  __m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y), pz = _mm256_loadu_ps(z), g[3];\n"
+    "  _mm256_storeu_ps(out, SdfMap8(px, py, pz, time));\n"
+    "  SdfMapGrad8(px, py, pz, time, g);\n"
+    "  for(int k = 0; k < 3; k++) _mm256_storeu_ps(grad[k], g[k]);\n}\n"
+    "\nTARGET_AVX2 inline void SdfCheckPrune8(const float *x, const float *y, const float *z, float time, unsigned long long keep,\n"
+    "  float *full, float *pruned) {\n"
+    "  __m256 px = _mm256_loadu_ps(x), py = _mm256_loadu_ps(y), pz = _mm256_loadu_ps(z);\n"
+    "  _mm256_storeu_ps(full, SdfMap8(px, py, pz, time));\n"
+    "  _mm256_storeu_ps(pruned, SdfMapPrune8(px, py, pz, time, keep));\n}\n"
+    "\n#endif //_MAP_SDF_H_\n")) {
+    printf("can't write %s\n", argv[3]);
+    return 1;
+  }
+  return Check(prog, fixed, moving, split) ? 0 : 1;
+}
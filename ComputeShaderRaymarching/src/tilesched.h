@@ -0,0 +1,285 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  tilesched.h
+//    Work stealing over tiles. Every thread owns a Chase-Lev deque : it
+//    pops its own tiles from the bottom, idle threads steal from the top
+//    of the others. Before a run the tiles are sorted by last run's cost
+//    and dealt longest first to the least loaded deque, pushed so the
+//    owner starts with its most expensive tile and thieves take the cheap
+//    tail. Busy time per thread is kept for the utilization report.
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _TILESCHED_H_
+#define _TILESCHED_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// TileDeque
+//   Chase-Lev with a fixed power of two ring (no growth : a run never
+//   pushes more than the tile count). Push / Pop by the owner only, Steal
+//   from any thread.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct TileDeque {
+  enum {
+    Empty = -1,
+    Abort = -2,              //lost the race for the last tile, try again
+  };
+
+  std::unique_ptr<std::atomic<int>[]> Buf;
+  int                                 Mask;
+  alignas(64) std::atomic<long long>  Top;
+  alignas(64) std::atomic<long long>  Bottom;
+
+  TileDeque() : Mask(0), Top(0), Bottom(0) {}
+
+  void Init(int capacity) {
+    int size = 1;
+    while(size < capacity) size *= 2;
+    Buf.reset(new std::atomic<int>[size]);
+    Mask = size - 1;
+    Reset();
+  }
+
+  //only while no thread is running
+  void Reset() {
+    Top.store(0);
+    Bottom.store(0);
+  }
+
+  void Push(int tile) {
+    long long b = Bottom.load(std::memory_order_relaxed);
+    Buf[b & Mask].store(tile, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Bottom.store(b + 1, std::memory_order_relaxed);
+  }
+
+  int Pop() {
+    long long b = Bottom.load(std::memory_order_relaxed) - 1;
+    Bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long t = Top.load(std::memory_order_relaxed);
+    if(t > b) {
+      Bottom.store(b + 1, std::memory_order_relaxed);
+      return Empty;
+    }
+    int tile = Buf[b & Mask].load(std::memory_order_relaxed);
+    if(t == b) {
+      //last one : race the thieves for it
+      if(!Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) tile = Empty;
+      Bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return tile;
+  }
+
+  int Steal() {
+    long long t = Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    long long b = Bottom.load(std::memory_order_acquire);
+    if(t >= b) return Empty;
+    int tile = Buf[t & Mask].load(std::memory_order_relaxed);
+    if(!Top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return Abort;
+    return tile;
+  }
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// TileScheduler
+//   Thread 0 is the caller, Init(n) starts n - 1 workers that sleep
+//   between runs. Run(count, func) calls func(tile, thread) once per tile
+//   and returns when all are done. Cost[] is refreshed from the measured
+//   time of every tile and orders the next run.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+struct TileScheduler {
+  struct ThreadStat {
+    double busy;             //ms inside func
+    int    tiles;
+    int    steals;
+    int    aborts;
+  };
+
+  std::vector<std::thread>                  Worker;
+  std::unique_ptr<TileDeque[]>              Deque;
+  std::vector<ThreadStat>                   Stat;
+  std::vector<float>                        Cost;      //ms of each tile, last run
+  std::vector<int>                          Order;
+  std::vector<double>                       Load;
+  std::function<void(int, int)>             Func;
+  std::atomic<int>                          Left;
+  std::mutex                                Lock;
+  std::condition_variable                   Wake;
+  std::condition_variable                   Done;
+  unsigned                                  Serial;
+  int                                       Busy;
+  int                                       Count;
+  bool                                      Quit;
+  bool                                      Sorted;    //false : equal contiguous blocks
+  bool                                      Stealing;  //false : every thread runs its own deque only
+  double                                    Wall;      //ms of the last run
+
+  TileScheduler() : Left(0), Serial(0), Busy(0), Count(0), Quit(false), Sorted(true), Stealing(true), Wall(0) {}
+
+  ~TileScheduler() {
+    Term();
+  }
+
+  //threads <= 0 : one per hardware thread, caller included
+  void Init(int threads = 0) {
+    Term();
+    if(threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if(threads <= 0) threads = 1;
+    Quit = false;
+    Deque.reset(new TileDeque[threads]);
+    Stat.assign(threads, ThreadStat());
+    //workers start level with the current run, or a second Init would wake them on the last one
+    for(int i = 1; i < threads; i++) Worker.push_back(std::thread(&TileScheduler::Main, this, i, Serial));
+  }
+
+  void Term() {
+    {
+      std::lock_guard<std::mutex> lk(Lock);
+      Quit = true;
+    }
+    Wake.notify_all();
+    for(size_t i = 0; i < Worker.size(); i++) Worker[i].join();
+    Worker.clear();
+  }
+
+  int Threads() const {
+    return (int)Worker.size() + 1;
+  }
+
+  //busy / wall of the last run
+  double Utilization(int thread) const {
+    return Wall > 0 ? Stat[thread].busy / Wall : 0;
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Deal : longest processing time first onto the least loaded deque.
+  //   Sorted == false deals contiguous blocks of the same size instead.
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  void Deal(int count) {
+    int threads = Threads();
+    if((int)Cost.size() != count) Cost.assign(count, 1.0f);
+    Order.resize(count);
+    for(int i = 0; i < count; i++) Order[i] = i;
+    for(int t = 0; t < threads; t++) {
+      if(Deque[t].Mask + 1 < count) Deque[t].Init(count);
+      Deque[t].Reset();
+    }
+    if(!Sorted) {
+      //pushed back to front so the owner walks its block in order
+      for(int t = 0; t < threads; t++) {
+        int b = count * t / threads, e = count * (t + 1) / threads;
+        for(int i = e - 1; i >= b; i--) Deque[t].Push(i);
+      }
+      return;
+    }
+    std::stable_sort(Order.begin(), Order.end(), [&](int a, int b) { return Cost[a] > Cost[b]; });
+    Load.assign(threads, 0.0);
+    std::vector<std::vector<int> > list(threads);
+    for(int i = 0; i < count; i++) {
+      int t = (int)(std::min_element(Load.begin(), Load.end()) - Load.begin());
+      Load[t] += Cost[Order[i]];
+      list[t].push_back(Order[i]);
+    }
+    //cheapest at the top for the thieves, most expensive at the bottom for the owner
+    for(int t = 0; t < threads; t++) {
+      for(int i = (int)list[t].size() - 1; i >= 0; i--) Deque[t].Push(list[t][i]);
+    }
+  }
+
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  // Run : func(tile, thread) for every tile of [0, count)
+  //-----------//-----------//-----------//-----------//-----------//-----------
+  void Run(int count, const std::function<void(int, int)> &func) {
+    if(count <= 0) return;
+    auto start = std::chrono::high_resolution_clock::now();
+    Deal(count);
+    for(size_t t = 0; t < Stat.size(); t++) Stat[t] = ThreadStat();
+    {
+      std::lock_guard<std::mutex> lk(Lock);
+      Func  = func;
+      Count = count;
+      Left.store(count);
+      Busy  = (int)Worker.size();
+      Serial++;
+    }
+    Wake.notify_all();
+    Work(0);
+    {
+      std::unique_lock<std::mutex> lk(Lock);
+      Done.wait(lk, [&] { return Busy == 0; });
+    }
+    Wall = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  }
+
+  void Work(int thread) {
+    int       threads = Threads();
+    unsigned  seed    = 0x9E3779B9u * unsigned(thread + 1);
+    ThreadStat &st    = Stat[thread];
+    while(Left.load(std::memory_order_acquire) > 0) {
+      int tile = Deque[thread].Pop();
+      if(tile < 0 && !Stealing) break;
+      if(tile < 0) {
+        //random victim first, then the rest in order
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        int first = int(seed % unsigned(threads));
+        for(int k = 0; k < threads && tile < 0; k++) {
+          int v = (first + k) % threads;
+          if(v == thread) continue;
+          tile = Deque[v].Steal();
+          if(tile == TileDeque::Abort) {
+            st.aborts++;
+            k--;             //same victim again
+            tile = TileDeque::Empty;
+          }
+        }
+        if(tile < 0) {
+          std::this_thread::yield();
+          continue;
+        }
+        st.steals++;
+      }
+      auto t0 = std::chrono::high_resolution_clock::now();
+      Func(tile, thread);
+      double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+      Cost[tile] = (float)ms;
+      st.busy   += ms;
+      st.tiles++;
+      Left.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  void Main(int thread, unsigned seen) {
+    for(;;) {
+      {
+        std::unique_lock<std::mutex> lk(Lock);
+        Wake.wait(lk, [&] { return Quit || Serial != seen; });
+        if(Quit) return;
+        seen = Serial;
+      }
+      Work(thread);
+      std::lock_guard<std::mutex> lk(Lock);
+      if(--Busy == 0) Done.notify_all();
+    }
+  }
+};
+
+#endif //_TILESCHED_H_
@@ -0,0 +1,162 @@
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+//
+//  upscale.h
+//    Upscale of the colour + depth buffer rendered at a scale (march.h,
+//    top left of it) to the full screen : upscale() in main.fx on the CPU.
+//    Bilinear over the 2 x 2 texels around the point, as MarchUpscale but
+//    scalar and AVX2 (8 pixels along a row, gathered texels), threaded over
+//    GroupX x GroupY tiles. An edge adaptive blend (luma steepening, texels
+//    weighed or dropped off the nearest one's depth) and a sharpen after it
+//    both scored under plain bilinear in cpumarch and are gone. At full
+//    size nothing is upscaled, ps_main keeps its 5 taps (UpscaleNative).
+//
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+#ifndef _UPSCALE_H_
+#define _UPSCALE_H_
+
+#include "march.h"
+
+#define UpscaleTilesX      ((ScreenX + GroupX - 1) / GroupX)
+#define UpscaleTilesY      ((ScreenY + GroupY - 1) / GroupY)
+
+//the render at scale in src, ps_main's rendersize()
+struct UpscaleSource {
+  const MarchColor *src;
+  float             scale;
+  float             mx, my;  //last texel, rendersize() - 1
+
+  void Set(const MarchColor *s, float sc) {
+    src   = s;
+    scale = sc;
+    mx    = ScreenX * sc - 1;
+    my    = ScreenY * sc - 1;
+  }
+};
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// scalar
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+//pixel x, y of the full screen
+inline MarchColor UpscalePixel(const UpscaleSource &s, int x, int y) {
+  float sx = std::min(std::max((x + 0.5f) * s.scale - 0.5f, 0.0f), s.mx);
+  float sy = std::min(std::max((y + 0.5f) * s.scale - 0.5f, 0.0f), s.my);
+  int   x0 = (int)sx, y0 = (int)sy, x1 = std::min(x0 + 1, (int)s.mx), y1 = std::min(y0 + 1, (int)s.my);
+  float fx = sx - x0, fy = sy - y0;
+  const MarchColor *q[4] = { &s.src[x0 + y0 * ScreenX], &s.src[x1 + y0 * ScreenX], &s.src[x0 + y1 * ScreenX], &s.src[x1 + y1 * ScreenX] };
+
+  float w[4] = { (1 - fx) * (1 - fy), fx * (1 - fy), (1 - fx) * fy, fx * fy };
+  MarchColor out = { 0, 0, 0, 0 };
+  for(int k = 0; k < 4; k++) {
+    out.r += q[k]->r * w[k];
+    out.g += q[k]->g * w[k];
+    out.b += q[k]->b * w[k];
+    out.a += q[k]->a * w[k];
+  }
+  return out;
+}
+
+//ps_main at full size, nothing to upscale : the pixel half way to the
+//average of its 4 diagonals, depth as it is, clamped at the borders
+inline void UpscaleNative(const MarchColor *src, MarchColor *dst) {
+  for(int y = 0; y < ScreenY; y++) {
+    int u = std::max(y - 1, 0), d = std::min(y + 1, ScreenY - 1);
+    for(int x = 0; x < ScreenX; x++) {
+      int l = std::max(x - 1, 0), r = std::min(x + 1, ScreenX - 1);
+      const MarchColor &c = src[x + y * ScreenX];
+      const MarchColor *n[4] = { &src[l + u * ScreenX], &src[r + u * ScreenX], &src[l + d * ScreenX], &src[r + d * ScreenX] };
+      MarchColor &o = dst[x + y * ScreenX];
+      o = c;
+      for(int i = 0; i < 3; i++) {
+        float a = ((&n[0]->r)[i] + (&n[1]->r)[i] + (&n[2]->r)[i] + (&n[3]->r)[i]) * 0.25f;
+        (&o.r)[i] = a + ((&c.r)[i] - a) * 0.5f;
+      }
+    }
+  }
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// AVX2
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+//8 pixels x.. of row y as UpscalePixel
+TARGET_AVX2 inline void UpscalePixel8(const UpscaleSource &s, int x, int y, MarchColor *out) {
+  float  sy = std::min(std::max((y + 0.5f) * s.scale - 0.5f, 0.0f), s.my);
+  int    y0 = (int)sy, y1 = std::min(y0 + 1, (int)s.my);
+  __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+  __m256 sx = _mm256_fmsub_ps(_mm256_add_ps(_mm256_set1_ps(x + 0.5f), lane), _mm256_set1_ps(s.scale), _mm256_set1_ps(0.5f));
+  sx = _mm256_min_ps(_mm256_max_ps(sx, _mm256_setzero_ps()), _mm256_set1_ps(s.mx));
+  __m256i x0 = _mm256_cvttps_epi32(sx);
+  __m256i x1 = _mm256_min_epi32(_mm256_add_epi32(x0, _mm256_set1_epi32(1)), _mm256_set1_epi32((int)s.mx));
+  __m256  fx = _mm256_sub_ps(sx, _mm256_cvtepi32_ps(x0));
+  __m256  fy = _mm256_set1_ps(sy - y0);
+
+  //float index of the r of each texel
+  __m256i idx[4] = {
+    _mm256_slli_epi32(_mm256_add_epi32(x0, _mm256_set1_epi32(y0 * ScreenX)), 2),
+    _mm256_slli_epi32(_mm256_add_epi32(x1, _mm256_set1_epi32(y0 * ScreenX)), 2),
+    _mm256_slli_epi32(_mm256_add_epi32(x0, _mm256_set1_epi32(y1 * ScreenX)), 2),
+    _mm256_slli_epi32(_mm256_add_epi32(x1, _mm256_set1_epi32(y1 * ScreenX)), 2),
+  };
+  const float *base = &s.src->r;
+  __m256 one = _mm256_set1_ps(1), ex = _mm256_sub_ps(one, fx), ey = _mm256_sub_ps(one, fy);
+  __m256 w[4] = { _mm256_mul_ps(ex, ey), _mm256_mul_ps(fx, ey), _mm256_mul_ps(ex, fy), _mm256_mul_ps(fx, fy) };
+  __m256 o[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+  for(int k = 0; k < 4; k++) {
+    for(int c = 0; c < 4; c++) o[c] = _mm256_fmadd_ps(_mm256_i32gather_ps(base + c, idx[k], 4), w[k], o[c]);
+  }
+
+  //r g b a planes to 8 MarchColor, as MarchPixel8
+  __m256 t0 = _mm256_unpacklo_ps(o[0], o[1]), t1 = _mm256_unpackhi_ps(o[0], o[1]);
+  __m256 t2 = _mm256_unpacklo_ps(o[2], o[3]), t3 = _mm256_unpackhi_ps(o[2], o[3]);
+  __m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+  __m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+  float *p = &out->r;
+  _mm256_storeu_ps(p +  0, _mm256_permute2f128_ps(u0, u1, 0x20));
+  _mm256_storeu_ps(p +  8, _mm256_permute2f128_ps(u2, u3, 0x20));
+  _mm256_storeu_ps(p + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+  _mm256_storeu_ps(p + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+}
+
+//-----------//-----------//-----------//-----------//-----------//-----------
+//
+// Upscale : src rendered at scale to the ScreenX * ScreenY of dst (not src),
+//   bilinear, tile by tile. jobs may be NULL.
+//
+//-----------//-----------//-----------//-----------//-----------//-----------
+inline void UpscaleTileScalar(const UpscaleSource &s, int tile, MarchColor *dst) {
+  int x0 = (tile % UpscaleTilesX) * GroupX, y0 = (tile / UpscaleTilesX) * GroupY;
+  int x1 = std::min(x0 + GroupX, ScreenX), y1 = std::min(y0 + GroupY, ScreenY);
+  for(int y = y0; y < y1; y++) {
+    for(int x = x0; x < x1; x++) dst[x + y * ScreenX] = UpscalePixel(s, x, y);
+  }
+}
+
+TARGET_AVX2 inline void UpscaleTileAVX2(const UpscaleSource &s, int tile, MarchColor *dst) {
+  int x0 = (tile % UpscaleTilesX) * GroupX, y0 = (tile / UpscaleTilesX) * GroupY;
+  int y1 = std::min(y0 + GroupY, ScreenY);
+  for(int y = y0; y < y1; y++) {
+    for(int x = 0; x < GroupX; x += 8) UpscalePixel8(s, x0 + x, y, &dst[x0 + x + y * ScreenX]);
+  }
+}
+
+inline void Upscale(JobSystem *jobs, int isa, float scale, const MarchColor *src, MarchColor *dst) {
+  UpscaleSource s;
+  s.Set(src, scale);
+  bool simd  = isa == IsaAVX2 && GroupX % 8 == 0 && ScreenX % GroupX == 0;
+  int  tiles = UpscaleTilesX * UpscaleTilesY;
+  auto run   = [&](int b, int e, int) {
+    for(int t = b; t < e; t++) {
+      if(simd) UpscaleTileAVX2(s, t, dst);
+      else     UpscaleTileScalar(s, t, dst);
+    }
+  };
+  if(jobs) jobs->ParallelFor(tiles, 1, run);
+  else     run(0, tiles, 0);
+}
+
+#endif //_UPSCALE_H_
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+//
+// JOBS.H
+//
+//------------------------------------------------------------------------------
+#ifndef _JOBS_H_
+#define _JOBS_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+//
+// JobSystem
+//   Persistent worker threads for ParallelFor. The calling thread takes
+//   chunks too and returns once every chunk is done.
+//
+//------------------------------------------------------------------------------
+struct JobSystem
+{
+	std::vector<std::thread>              Worker;
+	std::mutex                            Lock;
+	std::condition_variable               Wake;
+	std::condition_variable               Done;
+	std::function<void(int, int, int)>    Func;
+	std::atomic<int>                      Next;
+	int                                   Count;
+	int                                   Chunk;
+	int                                   Ack;
+	int                                   Busy;
+	unsigned                              Serial;
+	bool                                  Quit;
+
+	JobSystem() : Next(0), Count(0), Chunk(1), Ack(0), Busy(0), Serial(0), Quit(false) {}
+
+	~JobSystem()
+	{
+		Term();
+	}
+
+	//threads <= 0 : one per hardware thread, caller included
+	void Init(int threads = 0)
+	{
+		Term();
+		if(threads <= 0) threads = (int)std::thread::hardware_concurrency();
+		Quit = false;
+		//workers start level with the current job, or a second Init would wake them on the last one
+		for(int i = 1; i < threads; i++)
+		{
+			Worker.push_back(std::thread(&JobSystem::Main, this, i, Serial));
+		}
+	}
+
+	void Term()
+	{
+		{
+			std::lock_guard<std::mutex> lk(Lock);
+			Quit = true;
+		}
+		Wake.notify_all();
+		for(size_t i = 0; i < Worker.size(); i++) Worker[i].join();
+		Worker.clear();
+	}
+
+	int Threads() const
+	{
+		return (int)Worker.size() + 1;
+	}
+
+	//------------------------------------------------------------------------------
+	// ParallelFor : func(begin, end, thread) over [0, count) in chunk sized pieces
+	//------------------------------------------------------------------------------
+	void ParallelFor(int count, int chunk, const std::function<void(int, int, int)> &func)
+	{
+		if(count <= 0) return;
+		if(chunk <= 0) chunk = 1;
+		if(Worker.empty() || count <= chunk)
+		{
+			for(int i = 0; i < count; i += chunk) func(i, i + chunk < count ? i + chunk : count, 0);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lk(Lock);
+			Func  = func;
+			Count = count;
+			Chunk = chunk;
+			Ack   = 0;
+			Next.store(0);
+			Serial++;
+		}
+		Wake.notify_all();
+		Run(0);
+
+		//wait until every worker has seen this job so Func can be replaced safely
+		std::unique_lock<std::mutex> lk(Lock);
+		Done.wait(lk, [&] { return Ack == (int)Worker.size() && Busy == 0; });
+	}
+
+	void Run(int thread)
+	{
+		for(;;)
+		{
+			int begin = Next.fetch_add(Chunk);
+			if(begin >= Count) break;
+			int end = begin + Chunk < Count ? begin + Chunk : Count;
+			Func(begin, end, thread);
+		}
+	}
+
+	void Main(int thread, unsigned seen)
+	{
+		for(;;)
+		{
+			std::unique_lock<std::mutex> lk(Lock);
+			Wake.wait(lk, [&] { return Quit || Serial != seen; });
+			if(Quit) return;
+			seen = Serial;
+			Ack++;
+			Busy++;
+			lk.unlock();
+
+			Run(thread);
+
+			lk.lock();
+			Busy--;
+			if(Ack == (int)Worker.size() && Busy == 0) Done.notify_all();
+		}
+	}
+};
+
+#endif //_JOBS_H_
@@ -0,0 +1,230 @@
+//------------------------------------------------------------------------------
+//
+// RNG.H
+//   Philox4x32-10 counter based generator. Word i of (seed, stream) depends
+//   on nothing but i, so an array can be filled in any order, by any number
+//   of threads, and still come out the same for a given seed.
+//
+//------------------------------------------------------------------------------
+#ifndef _RNG_H_
+#define _RNG_H_
+
+#include "simd.h"
+#include "jobs.h"
+
+//------------------------------------------------------------------------------
+// Philox4x32-10 : counter = (block lo, block hi, stream, 0), key = seed
+//------------------------------------------------------------------------------
+enum
+{
+	PhiloxM0 = 0xD2511F53u,
+	PhiloxM1 = 0xCD9E8D57u,
+	PhiloxW0 = 0x9E3779B9u,
+	PhiloxW1 = 0xBB67AE85u,
+};
+
+inline void Philox4x32(const unsigned in[4], const unsigned key[2], unsigned out[4])
+{
+	unsigned c0 = in[0], c1 = in[1], c2 = in[2], c3 = in[3];
+	unsigned k0 = key[0], k1 = key[1];
+	for(int r = 0; r < 10; r++)
+	{
+		unsigned long long p0 = (unsigned long long)PhiloxM0 * c0;
+		unsigned long long p1 = (unsigned long long)PhiloxM1 * c2;
+		unsigned hi0 = unsigned(p0 >> 32), lo0 = unsigned(p0);
+		unsigned hi1 = unsigned(p1 >> 32), lo1 = unsigned(p1);
+		c0 = hi1 ^ c1 ^ k0;
+		c1 = lo1;
+		c2 = hi0 ^ c3 ^ k1;
+		c3 = lo0;
+		k0 += PhiloxW0;
+		k1 += PhiloxW1;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+inline void PhiloxBlock(unsigned long long seed, unsigned stream, unsigned long long block, unsigned out[4])
+{
+	unsigned key[2] = { unsigned(seed), unsigned(seed >> 32) };
+	unsigned in[4]  = { unsigned(block), unsigned(block >> 32), stream, 0 };
+	Philox4x32(in, key, out);
+}
+
+//------------------------------------------------------------------------------
+// RandomFillScalar : out[k] = word (offset + k)
+//------------------------------------------------------------------------------
+inline void RandomFillScalar(unsigned long long seed, unsigned stream, long long offset, int count, unsigned *out)
+{
+	unsigned w[4];
+	for(int k = 0; k < count;)
+	{
+		long long i     = offset + k;
+		int       first = int(i & 3);
+		PhiloxBlock(seed, stream, (unsigned long long)i >> 2, w);
+		for(int j = first; j < 4 && k < count; j++) out[k++] = w[j];
+	}
+}
+
+//------------------------------------------------------------------------------
+// RandomFillAVX2 : 8 blocks (32 words) per step, same stream as the scalar
+//------------------------------------------------------------------------------
+TARGET_AVX2 inline void PhiloxMulHiLo(__m256i a, __m256i m, __m256i *hi, __m256i *lo)
+{
+	__m256i even = _mm256_mul_epu32(a, m);
+	__m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+	*hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+	*lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+}
+
+TARGET_AVX2 inline void RandomFillAVX2(unsigned long long seed, unsigned stream, long long offset, int count, unsigned *out)
+{
+	//scalar up to a block boundary
+	int head = int((4 - (offset & 3)) & 3);
+	head = head < count ? head : count;
+	RandomFillScalar(seed, stream, offset, head, out);
+
+	const __m256i m0 = _mm256_set1_epi32(int(PhiloxM0));
+	const __m256i m1 = _mm256_set1_epi32(int(PhiloxM1));
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	unsigned long long block = (unsigned long long)(offset + head) >> 2;
+	int k = head;
+	for(; k + 32 <= count; k += 32, block += 8)
+	{
+		//carry into the high word where the low word wraps inside these 8 blocks
+		__m256i lo32 = _mm256_add_epi32(_mm256_set1_epi32(int(unsigned(block))), lane);
+		__m256i carry = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32(int(unsigned(block))), _mm256_set1_epi32(int(0x80000000))),
+		                                   _mm256_xor_si256(lo32, _mm256_set1_epi32(int(0x80000000))));
+		__m256i c0 = lo32;
+		__m256i c1 = _mm256_sub_epi32(_mm256_set1_epi32(int(unsigned(block >> 32))), carry);
+		__m256i c2 = _mm256_set1_epi32(int(stream));
+		__m256i c3 = _mm256_setzero_si256();
+		unsigned k0 = unsigned(seed), k1 = unsigned(seed >> 32);
+		for(int r = 0; r < 10; r++)
+		{
+			__m256i hi0, lo0, hi1, lo1;
+			PhiloxMulHiLo(c0, m0, &hi0, &lo0);
+			PhiloxMulHiLo(c2, m1, &hi1, &lo1);
+			c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(int(k0)));
+			c1 = lo1;
+			c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(int(k1)));
+			c3 = lo0;
+			k0 += PhiloxW0;
+			k1 += PhiloxW1;
+		}
+
+		//lane j holds block j : transpose back to word order
+		__m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+		__m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+		__m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+		__m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+		__m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+		__m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+		__m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+		__m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+		__m256i *dst = (__m256i *)(out + k);
+		_mm256_storeu_si256(dst + 0, _mm256_permute2x128_si256(u0, u1, 0x20));
+		_mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(u2, u3, 0x20));
+		_mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(u0, u1, 0x31));
+		_mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(u2, u3, 0x31));
+	}
+	RandomFillScalar(seed, stream, offset + k, count - k, out + k);
+}
+
+//------------------------------------------------------------------------------
+// RandomFill / RandomFloat
+//   words [offset, offset + count) of (seed, stream), chunked over jobs (may
+//   be null). RandomFloat maps each word to [lo, hi) with 24 bits.
+//------------------------------------------------------------------------------
+inline void RandomFill(JobSystem *jobs, int isa, unsigned long long seed, unsigned stream, long long offset, int count, unsigned *out)
+{
+	enum { Chunk = 16384 };
+	void (*kernel)(unsigned long long, unsigned, long long, int, unsigned *) =
+		isa == IsaAVX2 ? RandomFillAVX2 : RandomFillScalar;
+
+	if(!jobs)
+	{
+		kernel(seed, stream, offset, count, out);
+		return;
+	}
+	jobs->ParallelFor(count, Chunk, [&](int b, int e, int)
+	{
+		kernel(seed, stream, offset + b, e - b, out + b);
+	});
+}
+
+inline void RandomToFloat(const unsigned *in, int count, float lo, float hi, float *out)
+{
+	float scale = (hi - lo) * (1.0f / 16777216.0f);
+	int k = 0;
+	__m128 vs = _mm_set1_ps(scale), vl = _mm_set1_ps(lo);
+	for(; k + 4 <= count; k += 4)
+	{
+		__m128i x = _mm_srli_epi32(_mm_loadu_si128((const __m128i *)(in + k)), 8);
+		_mm_storeu_ps(out + k, _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(x), vs), vl));
+	}
+	for(; k < count; k++) out[k] = float(in[k] >> 8) * scale + lo;
+}
+
+inline void RandomFloat(JobSystem *jobs, int isa, unsigned long long seed, unsigned stream, long long offset, int count, float *out, float lo = 0, float hi = 1)
+{
+	//words go through a small stack buffer and are converted while in L1
+	enum { Chunk = 16384, Block = 1024 };
+	void (*kernel)(unsigned long long, unsigned, long long, int, unsigned *) =
+		isa == IsaAVX2 ? RandomFillAVX2 : RandomFillScalar;
+
+	auto func = [&](int b, int e, int)
+	{
+		unsigned u[Block];
+		for(int i = b; i < e; i += Block)
+		{
+			int n = e - i < Block ? e - i : Block;
+			kernel(seed, stream, offset + i, n, u);
+			RandomToFloat(u, n, lo, hi, out + i);
+		}
+	};
+	if(!jobs)
+	{
+		for(int b = 0; b < count; b += Chunk) func(b, b + Chunk < count ? b + Chunk : count, 0);
+		return;
+	}
+	jobs->ParallelFor(count, Chunk, func);
+}
+
+//------------------------------------------------------------------------------
+//
+// Random [sequential front end, 4 words per Philox block]
+//
+//------------------------------------------------------------------------------
+struct Random
+{
+	unsigned long long Seed;
+	unsigned           Stream;
+	long long          Counter;
+	unsigned           Word[4];
+
+	Random() : Seed(1), Stream(0), Counter(0) {}
+
+	void Set(unsigned long long seed, unsigned stream = 0)
+	{
+		Seed    = seed;
+		Stream  = stream;
+		Counter = 0;
+	}
+
+	unsigned Int()
+	{
+		if((Counter & 3) == 0) PhiloxBlock(Seed, Stream, (unsigned long long)Counter >> 2, Word);
+		return Word[Counter++ & 3];
+	}
+
+	//[-1, 1)
+	float Float()
+	{
+		return -1 + 2 * float(Int() >> 8) * (1.0f / 16777216.0f);
+	}
+};
+
+#endif //_RNG_H_
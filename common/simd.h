@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------
+//
+// SIMD.H
+//
+//------------------------------------------------------------------------------
+#ifndef _SIMD_H_
+#define _SIMD_H_
+
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+//------------------------------------------------------------------------------
+// TARGET_AVX2 : cl accepts AVX2 intrinsics anywhere, gcc/clang need the
+// function to be tagged so the rest of the file stays SSE2.
+//------------------------------------------------------------------------------
+#if defined(_MSC_VER)
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+//------------------------------------------------------------------------------
+// Isa
+//------------------------------------------------------------------------------
+enum
+{
+	IsaScalar,
+	IsaSSE,
+	IsaAVX2,
+};
+
+inline const char *IsaName(int isa)
+{
+	static const char *name[] = { "scalar", "sse", "avx2" };
+	return name[isa];
+}
+
+inline int DetectIsa()
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool fma     = (info[2] & (1 << 12)) != 0;
+	bool ymm     = osxsave && (_xgetbv(0) & 6) == 6;
+	__cpuidex(info, 7, 0);
+	bool avx2    = (info[1] & (1 << 5)) != 0;
+	return (avx2 && fma && ymm) ? IsaAVX2 : IsaSSE;
+#else
+	__builtin_cpu_init();
+	return (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) ? IsaAVX2 : IsaSSE;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// SinCos : cephes style, |x| < 8192. q = round(x * 2/pi), r = x - q * pi/2
+//------------------------------------------------------------------------------
+inline void SinCos4(__m128 x, __m128 *psin, __m128 *pcos)
+{
+	__m128  sign = _mm_set1_ps(-0.0f);
+	__m128i q    = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236f)));
+	__m128  qf   = _mm_cvtepi32_ps(q);
+	__m128  r    = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5703125f)));
+	r            = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(4.837512969970703125e-4f)));
+	r            = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(7.54978995489188216e-8f)));
+	__m128  r2   = _mm_mul_ps(r, r);
+
+	__m128  ps   = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+	ps           = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(-1.6666654611e-1f));
+	ps           = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+	__m128  pc   = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+	pc           = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(4.166664568298827e-2f));
+	pc           = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(pc, r2), r2), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	//quadrant : swap on odd q, sin negative on q&2, cos negative on (q+1)&2
+	__m128i one  = _mm_set1_epi32(1);
+	__m128i two  = _mm_set1_epi32(2);
+	__m128  odd  = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+	__m128  s    = _mm_or_ps(_mm_and_ps(odd, pc), _mm_andnot_ps(odd, ps));
+	__m128  c    = _mm_or_ps(_mm_and_ps(odd, ps), _mm_andnot_ps(odd, pc));
+	__m128  ssgn = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, two), two));
+	__m128  csgn = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), two));
+	*psin        = _mm_xor_ps(s, _mm_and_ps(ssgn, sign));
+	*pcos        = _mm_xor_ps(c, _mm_and_ps(csgn, sign));
+}
+
+TARGET_AVX2 inline void SinCos8(__m256 x, __m256 *psin, __m256 *pcos)
+{
+	__m256  sign = _mm256_set1_ps(-0.0f);
+	__m256i q    = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(0.63661977236f)));
+	__m256  qf   = _mm256_cvtepi32_ps(q);
+	__m256  r    = _mm256_fnmadd_ps(qf, _mm256_set1_ps(1.5703125f), x);
+	r            = _mm256_fnmadd_ps(qf, _mm256_set1_ps(4.837512969970703125e-4f), r);
+	r            = _mm256_fnmadd_ps(qf, _mm256_set1_ps(7.54978995489188216e-8f), r);
+	__m256  r2   = _mm256_mul_ps(r, r);
+
+	__m256  ps   = _mm256_fmadd_ps(_mm256_set1_ps(-1.9515295891e-4f), r2, _mm256_set1_ps(8.3321608736e-3f));
+	ps           = _mm256_fmadd_ps(ps, r2, _mm256_set1_ps(-1.6666654611e-1f));
+	ps           = _mm256_fmadd_ps(_mm256_mul_ps(ps, r2), r, r);
+	__m256  pc   = _mm256_fmadd_ps(_mm256_set1_ps(2.443315711809948e-5f), r2, _mm256_set1_ps(-1.388731625493765e-3f));
+	pc           = _mm256_fmadd_ps(pc, r2, _mm256_set1_ps(4.166664568298827e-2f));
+	pc           = _mm256_fmadd_ps(_mm256_mul_ps(pc, r2), r2, _mm256_fnmadd_ps(r2, _mm256_set1_ps(0.5f), _mm256_set1_ps(1.0f)));
+
+	__m256i one  = _mm256_set1_epi32(1);
+	__m256i two  = _mm256_set1_epi32(2);
+	__m256  odd  = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+	__m256  s    = _mm256_blendv_ps(ps, pc, odd);
+	__m256  c    = _mm256_blendv_ps(pc, ps, odd);
+	__m256  ssgn = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, two), two));
+	__m256  csgn = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), two));
+	*psin        = _mm256_xor_ps(s, _mm256_and_ps(ssgn, sign));
+	*pcos        = _mm256_xor_ps(c, _mm256_and_ps(csgn, sign));
+}
+
+#endif //_SIMD_H_
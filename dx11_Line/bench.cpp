@@ -0,0 +1,1476 @@
+//------------------------------------------------------------------------------
+//
+// BENCH.CPP
+//   Headless benchmarks for the CPU side of Render (no D3D device needed).
+//   usage : bench [name]
+//
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <thread>
+#include <mutex>
+
+#include "instance.h"
+#include "transform.h"
+#include "ring.h"
+#include "../common/rng.h"
+#include "polyline.h"
+#include "series.h"
+#include "stream.h"
+#include "cull.h"
+#include "sort.h"
+
+//------------------------------------------------------------------------------
+//
+// Timer
+//
+//------------------------------------------------------------------------------
+struct Timer
+{
+	std::chrono::high_resolution_clock::time_point start;
+	Timer() : start(std::chrono::high_resolution_clock::now()) {}
+
+	double Ms() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+};
+
+//------------------------------------------------------------------------------
+// helper
+//------------------------------------------------------------------------------
+static float Uniform(std::mt19937 &rnd)
+{
+	return -1 + (2 * float(rnd()) / float(0xFFFFFFFF));
+}
+
+static RectBatch MakeRect(std::mt19937 &rnd)
+{
+	RectBatch rect =
+	{
+		Uniform(rnd) * 20, Uniform(rnd), Uniform(rnd) * 20,
+		0.5, 1.0, 0.5,
+		0, Uniform(rnd), 0,
+		Uniform(rnd), Uniform(rnd), Uniform(rnd), 1,
+	};
+	return rect;
+}
+
+static void MakeViewProj(float *vp, float eyex = -10, float eyey = 1, float eyez = 0)
+{
+	//LookAtLH(eye -> 0,0,0, up 0,1,0) * PerspectiveFovLH(60deg, 16:9, 0.1, 256)
+	float z[3] = { -eyex, -eyey, -eyez };
+	float zl = sqrtf(z[0] * z[0] + z[1] * z[1] + z[2] * z[2]);
+	for(int i = 0; i < 3; i++) z[i] /= zl;
+	float x[3] = { z[2], 0, -z[0] };
+	float xl = sqrtf(x[0] * x[0] + x[2] * x[2]);
+	for(int i = 0; i < 3; i++) x[i] /= xl;
+	float y[3] = { z[1] * x[2] - z[2] * x[1], z[2] * x[0] - z[0] * x[2], z[0] * x[1] - z[1] * x[0] };
+	float e[3] = { eyex, eyey, eyez };
+	float view[16] =
+	{
+		x[0], y[0], z[0], 0,
+		x[1], y[1], z[1], 0,
+		x[2], y[2], z[2], 0,
+		-(x[0] * e[0] + x[1] * e[1] + x[2] * e[2]),
+		-(y[0] * e[0] + y[1] * e[1] + y[2] * e[2]),
+		-(z[0] * e[0] + z[1] * e[1] + z[2] * e[2]), 1,
+	};
+	float nearz = 0.1f, farz = 256.0f;
+	float h = 1.0f / tanf(30.0f * 3.14159265f / 180.0f);
+	float w = h / (1280.0f / 720.0f);
+	float q = farz / (farz - nearz);
+	float proj[16] =
+	{
+		w, 0, 0,           0,
+		0, h, 0,           0,
+		0, 0, q,           1,
+		0, 0, -q * nearz,  0,
+	};
+	for(int i = 0; i < 4; i++)
+	{
+		for(int j = 0; j < 4; j++)
+		{
+			vp[i * 4 + j] = 0;
+			for(int k = 0; k < 4; k++) vp[i * 4 + j] += view[i * 4 + k] * proj[k * 4 + j];
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// pool : full rebuild every frame vs retained pool with partial churn
+//
+//------------------------------------------------------------------------------
+static void BenchPool()
+{
+	const int count  = 20000;
+	const int frames = 200;
+	float vp[16];
+	MakeViewProj(vp);
+
+	std::mt19937 rnd(1);
+	std::vector<RectBatch> src(count);
+	for(int i = 0; i < count; i++) src[i] = MakeRect(rnd);
+	std::vector<InstanceData> buffer(count);
+
+	printf("pool : %d instances, %d frames, %d bytes/instance\n", count, frames, (int)sizeof(InstanceData));
+
+	//PushRect path : rebuild the batch and transform everything each frame
+	{
+		std::vector<RectBatch> batch;
+		Timer t;
+		for(int f = 0; f < frames; f++)
+		{
+			for(int i = 0; i < count; i++) batch.push_back(src[i]);
+			for(int i = 0; i < count; i++) TransformInstance(batch[i], vp, &buffer[i]);
+			batch.clear();
+		}
+		double ms = t.Ms() / frames;
+		printf("  %-20s %8.3f ms/frame  %8.2f MB/frame uploaded\n", "full rebuild", ms, count * sizeof(InstanceData) / (1024.0 * 1024.0));
+	}
+
+	//retained pool
+	const float churn[] = { 0.01f, 0.10f, 1.00f };
+	for(int c = 0; c < int(sizeof(churn) / sizeof(churn[0])); c++)
+	{
+		InstancePool pool;
+		std::vector<InstancePool::Handle> handle(count);
+		std::vector<InstancePool::Range>  ranges;
+		for(int i = 0; i < count; i++) handle[i] = pool.Create(src[i]);
+		pool.Transform(vp, &buffer[0], ranges);
+
+		int changes = int(count * churn[c]);
+		long long uploaded = 0;
+		std::mt19937 pick(2);
+		Timer t;
+		for(int f = 0; f < frames; f++)
+		{
+			for(int k = 0; k < changes; k++)
+			{
+				int i = churn[c] >= 1.0f ? k : int(pick() % count);
+				RectBatch rect = src[i];
+				rect.ry += 0.02f * f;
+				pool.Update(handle[i], rect);
+			}
+			pool.Transform(vp, &buffer[0], ranges);
+			for(size_t r = 0; r < ranges.size(); r++) uploaded += ranges[r].count;
+		}
+		double ms = t.Ms() / frames;
+		char name[64];
+		sprintf(name, "retained %3d%% churn", int(churn[c] * 100));
+		printf("  %-20s %8.3f ms/frame  %8.2f MB/frame uploaded\n", name, ms, uploaded * sizeof(InstanceData) / (1024.0 * 1024.0 * frames));
+	}
+
+	//every slot taken with its generation wrapped around : no handle may be InvalidHandle
+	{
+		InstancePool pool;
+		int  slots = 0, bad = 0;
+		for(;;)
+		{
+			InstancePool::Handle h = pool.Create(src[0]);
+			if(h == InstancePool::InvalidHandle) break;
+			slots++;
+		}
+		for(int g = 0; g < (int)(0xFFFFFFFF >> InstancePool::IndexBits); g++)
+		{
+			pool.Destroy(((unsigned int)g << InstancePool::IndexBits) | InstancePool::SlotMax);
+			InstancePool::Handle h = pool.Create(src[0]);
+			bad += h == InstancePool::InvalidHandle || !pool.IsValid(h);
+		}
+		printf("  handles : %d slots, %d bad after the generation wrapped %s\n", slots, bad, slots == InstancePool::SlotMax + 1 && bad == 0 ? "ok" : "FAILED");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// transform : XMMatrix style chain vs SoA kernels
+//
+//------------------------------------------------------------------------------
+static void Mul4x4(const float *a, const float *b, float *out)
+{
+	float t[16];
+	for(int i = 0; i < 4; i++)
+	{
+		for(int j = 0; j < 4; j++)
+		{
+			t[i * 4 + j] = a[i * 4 + 0] * b[0 * 4 + j] + a[i * 4 + 1] * b[1 * 4 + j] + a[i * 4 + 2] * b[2 * 4 + j] + a[i * 4 + 3] * b[3 * 4 + j];
+		}
+	}
+	memcpy(out, t, sizeof(t));
+}
+
+//what Render::Draw did per instance : R, T, S, three multiplies and a transpose
+static void TransformReference(const RectBatch &rect, const float *vp, InstanceData *out)
+{
+	float cp = cosf(rect.rx), sp = sinf(rect.rx);
+	float cy = cosf(rect.ry), sy = sinf(rect.ry);
+	float cr = cosf(rect.rz), sr = sinf(rect.rz);
+	float rotate[16] =
+	{
+		cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy, 0,
+		cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy, 0,
+		cp * sy,                -sp,     cp * cy,                0,
+		0,                      0,       0,                      1,
+	};
+	float trans[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  rect.px, rect.py, rect.pz, 1 };
+	float scale[16] = { rect.sx, 0, 0, 0,  0, rect.sy, 0, 0,  0, 0, rect.sz, 0,  0, 0, 0, 1 };
+	float m[16];
+	Mul4x4(scale, rotate, m);
+	Mul4x4(m, trans, m);
+	Mul4x4(m, vp, m);
+	for(int i = 0; i < 4; i++)
+	{
+		for(int j = 0; j < 4; j++) out->M[j * 4 + i] = m[i * 4 + j];
+	}
+	out->Col[0] = rect.r;
+	out->Col[1] = rect.g;
+	out->Col[2] = rect.b;
+	out->Col[3] = rect.a;
+}
+
+static float MaxError(const std::vector<InstanceData> &a, const std::vector<InstanceData> &b)
+{
+	float e = 0;
+	for(size_t i = 0; i < a.size(); i++)
+	{
+		const float *pa = a[i].Col, *pb = b[i].Col;
+		for(int k = 0; k < 20; k++) e = std::max(e, fabsf(pa[k] - pb[k]));
+	}
+	return e;
+}
+
+static void BenchTransform()
+{
+	const int count  = 1 << 20;
+	const int frames = 10;
+	float vp[16];
+	MakeViewProj(vp);
+
+	std::mt19937 rnd(1);
+	std::vector<RectBatch> aos(count);
+	RectSoA soa;
+	for(int i = 0; i < count; i++)
+	{
+		aos[i] = MakeRect(rnd);
+		aos[i].rx = Uniform(rnd) * 3.14159265f;
+		aos[i].rz = Uniform(rnd) * 3.14159265f;
+		soa.Push(aos[i]);
+	}
+	std::vector<InstanceData> ref(count), out(count);
+
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	printf("transform : %d instances, detected isa=%s, threads=%d\n", count, IsaName(isa), jobs.Threads());
+
+	Timer t0;
+	for(int f = 0; f < frames; f++)
+	{
+		for(int i = 0; i < count; i++) TransformReference(aos[i], vp, &ref[i]);
+	}
+	double base = count * double(frames) / (t0.Ms() / 1000.0);
+	printf("  %-20s %8.2f Minstances/s\n", "reference (AoS)", base / 1e6);
+
+	struct
+	{
+		const char *name;
+		int         isa;
+		JobSystem  *jobs;
+	} mode[] =
+	{
+		{ "scalar SoA",   IsaScalar, nullptr },
+		{ "sse",          IsaSSE,    nullptr },
+		{ "avx2",         IsaAVX2,   nullptr },
+		{ "avx2 + jobs",  IsaAVX2,   &jobs   },
+	};
+	for(int k = 0; k < int(sizeof(mode) / sizeof(mode[0])); k++)
+	{
+		if(mode[k].isa > isa) continue;
+		Timer t;
+		for(int f = 0; f < frames; f++)
+		{
+			TransformBatch(mode[k].jobs, mode[k].isa, soa, 0, count, vp, &out[0]);
+		}
+		double rate = count * double(frames) / (t.Ms() / 1000.0);
+		printf("  %-20s %8.2f Minstances/s  x%.2f  maxerr=%g\n", mode[k].name, rate / 1e6, rate / base, MaxError(ref, out));
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// compact : 80 byte matrices vs 32 byte TRS instances (vs_compact)
+//
+//------------------------------------------------------------------------------
+static void UnpackReference(const CompactInstance &in, const float *vp, InstanceData *out)
+{
+	//what vs_compact rebuilds on the GPU
+	RectBatch rect =
+	{
+		in.Pos[0], in.Pos[1], in.Pos[2],
+		HalfToFloat(in.Scale[0]), HalfToFloat(in.Scale[1]), HalfToFloat(in.Scale[2]),
+		HalfToFloat(in.Rot[0]), HalfToFloat(in.Rot[1]), HalfToFloat(in.Rot[2]),
+		(in.Col & 0xFF) / 255.0f, ((in.Col >> 8) & 0xFF) / 255.0f, ((in.Col >> 16) & 0xFF) / 255.0f, (in.Col >> 24) / 255.0f,
+	};
+	TransformInstance(rect, vp, out);
+}
+
+static void BenchCompact()
+{
+	const int count  = 20000;
+	const int frames = 200;
+	float vp[16];
+	MakeViewProj(vp);
+
+	std::mt19937 rnd(1);
+	InstancePool pool;
+	std::vector<InstancePool::Handle> handle(count);
+	for(int i = 0; i < count; i++)
+	{
+		RectBatch rect = MakeRect(rnd);
+		rect.rx = Uniform(rnd) * 3.14159265f;
+		rect.rz = Uniform(rnd) * 3.14159265f;
+		handle[i] = pool.Create(rect);
+	}
+	std::vector<InstanceData>        full(count);
+	std::vector<CompactInstance>     compact(count);
+	std::vector<InstancePool::Range> ranges;
+
+	printf("compact : %d instances, %d frames, %d vs %d bytes/instance\n", count, frames, (int)sizeof(InstanceData), (int)sizeof(CompactInstance));
+
+	//camera moves every frame, 1% of the rects change
+	const int changes = count / 100;
+	for(int mode = 0; mode < 2; mode++)
+	{
+		std::mt19937 pick(2);
+		long long uploaded = 0;
+		pool.MarkAllDirty();
+		mode ? pool.Pack(&compact[0], ranges) : pool.Transform(vp, &full[0], ranges);
+		Timer t;
+		for(int f = 0; f < frames; f++)
+		{
+			float fvp[16];
+			MakeViewProj(fvp, -cosf(f * 0.003f) * 10, sinf(f * 0.003f), sinf(f * 0.003f) * 10);
+			for(int k = 0; k < changes; k++)
+			{
+				int i = int(pick() % count);
+				RectBatch rect = pool.Data.Get(pool.SlotToDense[handle[i] & InstancePool::IndexMask]);
+				rect.ry += 0.02f;
+				pool.Update(handle[i], rect);
+			}
+			int size = mode ? (int)sizeof(CompactInstance) : (int)sizeof(InstanceData);
+			mode ? pool.Pack(&compact[0], ranges) : pool.Transform(fvp, &full[0], ranges);
+			for(size_t r = 0; r < ranges.size(); r++) uploaded += (long long)ranges[r].count * size;
+		}
+		double ms = t.Ms() / frames;
+		printf("  %-20s %8.3f ms/frame  %8.3f MB/frame uploaded\n", mode ? "compact (TRS)" : "full (matrix)", ms, uploaded / (1024.0 * 1024.0 * frames));
+	}
+
+	//pack cost alone
+	{
+		std::vector<RectBatch> src(count);
+		for(int i = 0; i < count; i++) src[i] = pool.Data.Get(i);
+		Timer t;
+		for(int f = 0; f < frames; f++)
+		{
+			for(int i = 0; i < count; i++) PackInstance(src[i], &compact[i]);
+		}
+		printf("  %-20s %8.2f ns/instance\n", "PackInstance", t.Ms() * 1e6 / (double(count) * frames));
+	}
+
+	//precision : half angles and scale, unorm8 colour vs the full matrix
+	{
+		pool.MarkAllDirty();
+		pool.Transform(vp, &full[0], ranges);
+		pool.MarkAllDirty();
+		pool.Pack(&compact[0], ranges);
+		float emat = 0, ecol = 0;
+		for(int i = 0; i < count; i++)
+		{
+			InstanceData d;
+			UnpackReference(compact[i], vp, &d);
+			for(int k = 0; k < 4; k++)
+			{
+				//render target is UNORM, out of range colours clamp either way
+				float c = full[i].Col[k] < 0 ? 0 : full[i].Col[k] > 1 ? 1 : full[i].Col[k];
+				ecol = std::max(ecol, fabsf(d.Col[k] - c));
+			}
+			for(int k = 0; k < 16; k++) emat = std::max(emat, fabsf(d.M[k] - full[i].M[k]));
+		}
+		printf("  %-20s matrix %g  colour %g\n", "maxerr", emat, ecol);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// ring : one DISCARD per chunk vs NO_OVERWRITE spans in a ring
+//
+//------------------------------------------------------------------------------
+static bool CheckRing()
+{
+	//spans handed out since the last discard must never overlap
+	std::mt19937 rnd(3);
+	InstanceRing ring;
+	ring.Init(1000);
+	std::vector<int> owner(ring.Capacity, -1);
+	for(int f = 0; f < 10000; f++)
+	{
+		int remain = 1 + int(rnd() % 2500);
+		while(remain > 0)
+		{
+			InstanceRing::Span span = ring.Alloc(remain);
+			if(span.count <= 0 || span.first < 0 || span.first + span.count > ring.Capacity) return false;
+			if(span.discard) std::fill(owner.begin(), owner.end(), -1);
+			for(int i = span.first; i < span.first + span.count; i++)
+			{
+				if(owner[i] >= 0) return false;
+				owner[i] = f;
+			}
+			remain -= span.count;
+		}
+	}
+	return true;
+}
+
+static void BenchRing()
+{
+	const int instance = 32768;
+	const int capacity = instance * 4;
+	const int frames   = 50;
+	const int counts[] = { 10000, 100000, 1000000 };
+	float vp[16];
+	MakeViewProj(vp);
+
+	printf("ring : capacity %d instances, self check %s\n", capacity, CheckRing() ? "ok" : "FAILED");
+
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	std::vector<InstanceData> buffer(capacity);
+	for(int c = 0; c < int(sizeof(counts) / sizeof(counts[0])); c++)
+	{
+		std::mt19937 rnd(1);
+		RectSoA soa;
+		for(int i = 0; i < counts[c]; i++) soa.Push(MakeRect(rnd));
+
+		//old path : Map(DISCARD) + DrawInstanced per InstanceMax chunk
+		long long maps = 0, discards = 0;
+		Timer t0;
+		for(int f = 0; f < frames; f++)
+		{
+			for(int index = 0; index < counts[c]; index += instance)
+			{
+				int temp = counts[c] - index < instance ? counts[c] - index : instance;
+				TransformBatch(&jobs, isa, soa, index, temp, vp, &buffer[0]);
+				maps++;
+				discards++;
+			}
+		}
+		double ms0 = t0.Ms() / frames;
+		printf("  %8d chunked      %8.3f ms/frame  %6.2f maps/frame  %6.2f discards/frame\n",
+			counts[c], ms0, maps / double(frames), discards / double(frames));
+
+		//ring
+		InstanceRing ring;
+		ring.Init(capacity);
+		maps = discards = 0;
+		Timer t1;
+		for(int f = 0; f < frames; f++)
+		{
+			for(int index = 0; index < counts[c];)
+			{
+				InstanceRing::Span span = ring.Alloc(counts[c] - index);
+				TransformBatch(&jobs, isa, soa, index, span.count, vp, &buffer[span.first]);
+				maps++;
+				discards += span.discard;
+				index    += span.count;
+			}
+		}
+		double ms1 = t1.Ms() / frames;
+		printf("  %8d ring         %8.3f ms/frame  %6.2f maps/frame  %6.2f discards/frame\n",
+			counts[c], ms1, maps / double(frames), discards / double(frames));
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// jobs : Init again on a JobSystem that already ran, as the benches do
+//
+//------------------------------------------------------------------------------
+static void BenchJobs()
+{
+	//every index once per run, and no worker woken on the old run : it
+	//would count in Ack (release Done early) and run with Func unlocked
+	JobSystem jobs;
+	const int count = 64;
+	std::atomic<int> hit[count];
+	int bad = 0;
+	for(int k = 0; k < 50; k++)
+	{
+		jobs.Init(4);
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		for(int r = 0; r < 2; r++)
+		{
+			{
+				std::lock_guard<std::mutex> lk(jobs.Lock);
+				bad += jobs.Busy != 0 || jobs.Ack > (int)jobs.Worker.size();
+			}
+			for(int i = 0; i < count; i++) hit[i].store(0);
+			jobs.ParallelFor(count, 1, [&](int b, int e, int)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+				for(int i = b; i < e; i++) hit[i].fetch_add(1);
+			});
+			for(int i = 0; i < count; i++) bad += hit[i].load() != 1;
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+	printf("jobs : re-init, 100 runs, %d bad %s\n", bad, bad ? "FAILED" : "ok");
+}
+
+//------------------------------------------------------------------------------
+//
+// rng : mt19937 vs Philox4x32-10, reproducibility across kernels and threads
+//
+//------------------------------------------------------------------------------
+static bool CheckRng(int isa)
+{
+	//Random123 known answer : counter 0, key 0
+	unsigned zero[4] = { 0, 0, 0, 0 }, key[2] = { 0, 0 }, out[4];
+	Philox4x32(zero, key, out);
+	if(out[0] != 0x6627e8d5u || out[1] != 0xe169c58du || out[2] != 0xbc57ac4cu || out[3] != 0x9b00dbd8u) return false;
+
+	//any offset / count / thread count gives the same words
+	const int count = 100003;
+	std::vector<unsigned> ref(count), out0(count);
+	RandomFill(nullptr, IsaScalar, 7, 3, 0, count, &ref[0]);
+	for(int threads = 1; threads <= 4; threads++)
+	{
+		JobSystem jobs;
+		jobs.Init(threads);
+		for(int offset = 0; offset < 5; offset++)
+		{
+			RandomFill(&jobs, isa, 7, 3, offset, count - offset, &out0[0]);
+			if(memcmp(&ref[offset], &out0[0], (count - offset) * sizeof(unsigned)) != 0) return false;
+		}
+	}
+
+	//carry from the low into the high block word
+	unsigned long long base = 0xFFFFFFFCull * 4;
+	RandomFill(nullptr, IsaScalar, 7, 3, base, 64, &ref[0]);
+	RandomFill(nullptr, isa,       7, 3, base, 64, &out0[0]);
+	if(memcmp(&ref[0], &out0[0], 64 * sizeof(unsigned)) != 0) return false;
+
+	//sequential front end
+	Random rnd;
+	rnd.Set(7, 3);
+	RandomFill(nullptr, IsaScalar, 7, 3, 0, 10, &ref[0]);
+	for(int i = 0; i < 10; i++) if(rnd.Int() != ref[i]) return false;
+	return true;
+}
+
+static void BenchRng()
+{
+	const int count  = 1 << 24;
+	const int frames = 5;
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	printf("rng : %d words, detected isa=%s, threads=%d, self check %s\n", count, IsaName(isa), jobs.Threads(), CheckRng(isa) ? "ok" : "FAILED");
+
+	std::vector<unsigned> out(count);
+	std::vector<float>    outf(count);
+	double gb = double(count) * sizeof(unsigned) * frames / (1024.0 * 1024.0 * 1024.0);
+
+	std::mt19937 mt(1);
+	Timer t0;
+	for(int f = 0; f < frames; f++)
+	{
+		for(int i = 0; i < count; i++) out[i] = mt();
+	}
+	double base = gb / (t0.Ms() / 1000.0);
+	printf("  %-20s %8.3f GB/s\n", "mt19937", base);
+
+	struct
+	{
+		const char *name;
+		int         isa;
+		JobSystem  *jobs;
+		bool        real;
+	} mode[] =
+	{
+		{ "philox scalar",       IsaScalar, nullptr, false },
+		{ "philox avx2",         IsaAVX2,   nullptr, false },
+		{ "philox avx2 + jobs",  IsaAVX2,   &jobs,   false },
+		{ "float avx2 + jobs",   IsaAVX2,   &jobs,   true  },
+	};
+	for(int k = 0; k < int(sizeof(mode) / sizeof(mode[0])); k++)
+	{
+		if(mode[k].isa > isa) continue;
+		Timer t;
+		for(int f = 0; f < frames; f++)
+		{
+			if(mode[k].real) RandomFloat(mode[k].jobs, mode[k].isa, 1, 0, 0, count, &outf[0], -1, 1);
+			else             RandomFill(mode[k].jobs, mode[k].isa, 1, 0, 0, count, &out[0]);
+		}
+		double rate = gb / (t.Ms() / 1000.0);
+		printf("  %-20s %8.3f GB/s  x%.2f\n", mode[k].name, rate, rate / base);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// polyline : tessellator checks, Msegments/s scalar vs SIMD vs jobs
+//
+//------------------------------------------------------------------------------
+static bool SamePos(const LineVertex &a, const LineVertex &b)
+{
+	return a.Pos[0] == b.Pos[0] && a.Pos[1] == b.Pos[1] && a.Pos[2] == b.Pos[2];
+}
+
+static bool Near(float a, float b, float eps = 1e-4f)
+{
+	return fabsf(a - b) <= eps * (1 + fabsf(a) + fabsf(b));
+}
+
+static bool CheckPolyline(int isa)
+{
+	//screen px = world xy with identity VP and a 200 x 200 viewport
+	LineView view;
+	memset(&view, 0, sizeof(view));
+	view.vp[0] = view.vp[5] = view.vp[10] = view.vp[15] = 1;
+	view.hx = view.hy = 100;
+	std::vector<LineVertex> out;
+	auto run = [&](const float *xyz, int count, float width, int cap)
+	{
+		PolylineBatch batch;
+		batch.Push(xyz, count, width, 0xFFFFFFFF, cap);
+		PolylinePrepare(nullptr, isa, batch, view);
+		out.resize(count * LineSlotVertex);
+		PolylineEmit(nullptr, isa, batch, 0, count, view, &out[0]);
+	};
+	const float hwf = 5 + LineFringe;
+
+	//straight : butt cap extends by the fringe only, miter corners are shared
+	float straight[] = { 0, 0, 0.5f,  0.5f, 0, 0.5f,  1, 0, 0.5f };
+	run(straight, 3, 10, LineCapButt);
+	if(!Near(out[0].Pos[0] * 100, -LineFringe) || !Near(out[0].Pos[1] * 100, hwf) || !Near(out[1].Pos[1] * 100, -hwf)) return false;
+	if(!Near(out[0].Edge[0], hwf) || !Near(out[1].Edge[0], -hwf) || !Near(out[0].Edge[1], hwf)) return false;
+	if(!SamePos(out[2], out[6]) || !SamePos(out[3], out[7])) return false;
+	if(!SamePos(out[4], out[2]) || !SamePos(out[5], out[3])) return false;
+	for(int k = 12; k < 18; k++) if(!SamePos(out[k], out[12])) return false;
+
+	//right angle : miter at sqrt(2) * hwf
+	float corner[] = { 0, 0, 0.5f,  0.5f, 0, 0.5f,  0.5f, 0.5f, 0.5f };
+	run(corner, 3, 10, LineCapRound);
+	if(!SamePos(out[2], out[6]) || !SamePos(out[3], out[7]) || !SamePos(out[4], out[2])) return false;
+	float dx = out[2].Pos[0] * 100 - 50, dy = out[2].Pos[1] * 100;
+	if(!Near(sqrtf(dx * dx + dy * dy), hwf * sqrtf(2.0f)) || out[0].Width >= 0) return false;
+
+	//hairpin : over the miter limit -> bevel quad
+	float hairpin[] = { 0, 0, 0.5f,  0.5f, 0, 0.5f,  0, 0.02f, 0.5f };
+	run(hairpin, 3, 10, LineCapSquare);
+	if(SamePos(out[4], out[2]) || SamePos(out[5], out[3])) return false;
+	if(!Near(fabsf(out[4].Edge[0]), hwf) || !Near(out[4].Edge[1], -LineFar)) return false;
+	if(!SamePos(out[4], out[6]) && !SamePos(out[4], out[7])) return false;
+
+	//crossing the near plane : finite, clipped end has no cap
+	float behind[] = { 0, 0, 0.5f,  0.5f, 0, 0.5f,  1, 0, 0.5f };
+	{
+		LineView v = view;
+		v.vp[11] = 1;    //w = z + 0 ... z of point 2 goes behind below
+		v.vp[15] = 0;
+		behind[8] = -1;
+		PolylineBatch batch;
+		batch.Push(behind, 3, 10, 0xFFFFFFFF, LineCapRound);
+		PolylinePrepare(nullptr, isa, batch, v);
+		out.resize(3 * LineSlotVertex);
+		PolylineEmit(nullptr, isa, batch, 0, 3, v, &out[0]);
+		for(size_t k = 0; k < out.size(); k++)
+		{
+			for(int c = 0; c < 3; c++) if(!(fabsf(out[k].Pos[c]) < 1e30f)) return false;
+		}
+		if(!Near(out[8].Edge[2], -LineFar)) return false;
+	}
+
+	//SIMD prepare and any emit split match the scalar path
+	{
+		float vp[16];
+		MakeViewProj(vp);
+		LineView v;
+		memcpy(v.vp, vp, sizeof(vp));
+		v.hx = 640;
+		v.hy = 360;
+		std::mt19937 rnd(5);
+		PolylineBatch batch;
+		std::vector<float> xyz;
+		for(int l = 0; l < 200; l++)
+		{
+			int count = 2 + int(rnd() % 40);
+			xyz.resize(count * 3);
+			for(int i = 0; i < count * 3; i++) xyz[i] = Uniform(rnd) * 20;
+			batch.Push(&xyz[0], count, 1 + 8 * fabsf(Uniform(rnd)), rnd(), int(rnd() % 3) * 4);
+		}
+		int n = batch.Size();
+		std::vector<LineVertex> ref(n * LineSlotVertex), simd(n * LineSlotVertex);
+		PolylinePrepare(nullptr, IsaScalar, batch, v);
+		PolylineEmit(nullptr, IsaScalar, batch, 0, n, v, &ref[0]);
+		JobSystem jobs;
+		jobs.Init(3);
+		PolylinePrepare(&jobs, isa, batch, v);
+		PolylineEmit(nullptr, isa, batch, 0, n / 3, v, &simd[0]);
+		PolylineEmit(&jobs, isa, batch, n / 3, n - n / 3, v, &simd[(n / 3) * LineSlotVertex]);
+		//some segments have to cross the near plane, those lanes go scalar
+		int crossing = 0;
+		for(int i = 0; i + 1 < n; i++) crossing += !(batch.Flag[i] & LineLast) && (batch.SW[i] > LineNearW) != (batch.SW[i + 1] > LineNearW);
+		if(crossing == 0) return false;
+		for(size_t k = 0; k < ref.size(); k++)
+		{
+			const float *a = ref[k].Pos, *c = simd[k].Pos;
+			for(int j = 0; j < 7; j++) if(!Near(a[j], c[j], 1e-3f)) return false;
+			if(ref[k].Col != simd[k].Col) return false;
+		}
+	}
+	return true;
+}
+
+static void BenchPolyline()
+{
+	const int lines  = 4096;
+	const int points = 257;
+	const int frames = 10;
+	float vp[16];
+	MakeViewProj(vp);
+	LineView view;
+	memcpy(view.vp, vp, sizeof(vp));
+	view.hx = 640;
+	view.hy = 360;
+
+	//random walks around the rect field
+	std::mt19937 rnd(1);
+	PolylineBatch batch;
+	std::vector<float> xyz(points * 3);
+	for(int l = 0; l < lines; l++)
+	{
+		float x = Uniform(rnd) * 20, y = Uniform(rnd) * 2, z = Uniform(rnd) * 20;
+		for(int i = 0; i < points; i++)
+		{
+			xyz[i * 3 + 0] = x += Uniform(rnd) * 0.2f;
+			xyz[i * 3 + 1] = y += Uniform(rnd) * 0.05f;
+			xyz[i * 3 + 2] = z += Uniform(rnd) * 0.2f;
+		}
+		batch.Push(&xyz[0], points, 2, 0xFF000000 | rnd(), LineCapRound);
+	}
+	int n = batch.Size();
+	int segments = n - lines;
+	std::vector<LineVertex> out(n * LineSlotVertex);
+
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	printf("polyline : %d segments, %d bytes/segment, detected isa=%s, threads=%d, self check %s\n",
+		segments, (int)(sizeof(LineVertex) * LineSlotVertex), IsaName(isa), jobs.Threads(), CheckPolyline(isa) ? "ok" : "FAILED");
+
+	struct
+	{
+		const char *name;
+		int         isa;
+		JobSystem  *jobs;
+	} mode[] =
+	{
+		{ "scalar",       IsaScalar, nullptr },
+		{ "avx2",         IsaAVX2,   nullptr },
+		{ "avx2 + jobs",  IsaAVX2,   &jobs   },
+	};
+	double base = 0;
+	for(int k = 0; k < int(sizeof(mode) / sizeof(mode[0])); k++)
+	{
+		if(mode[k].isa > isa) continue;
+		double prepare = 0, emit = 0;
+		for(int f = 0; f < frames; f++)
+		{
+			Timer t0;
+			PolylinePrepare(mode[k].jobs, mode[k].isa, batch, view);
+			prepare += t0.Ms();
+			Timer t1;
+			PolylineEmit(mode[k].jobs, mode[k].isa, batch, 0, n, view, &out[0]);
+			emit += t1.Ms();
+		}
+		double rate = segments * double(frames) / ((prepare + emit) / 1000.0);
+		if(!base) base = rate;
+		printf("  %-20s %8.2f Msegments/s  x%.2f  prepare %6.3f ms  emit %6.3f ms  %7.2f MB/frame\n",
+			mode[k].name, rate / 1e6, rate / base, prepare / frames, emit / frames, out.size() * sizeof(LineVertex) / (1024.0 * 1024.0));
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// series : min/max pyramid build GB/s, append cost, decimation per zoom
+//
+//------------------------------------------------------------------------------
+static bool SameLevel(const SeriesLevel &a, const SeriesLevel &b)
+{
+	if(a.Count != b.Count) return false;
+	for(int i = 0; i < a.Count; i++)
+	{
+		if(a.Min[i] != b.Min[i] || a.Max[i] != b.Max[i] || a.MinFirst(i) != b.MinFirst(i)) return false;
+	}
+	return true;
+}
+
+static bool CheckSeries(int isa)
+{
+	//plateaus give ties, which have to resolve to the first index everywhere
+	std::mt19937 rnd(7);
+	std::vector<float> v(100000 + 13);
+	for(size_t i = 0; i < v.size(); i++) v[i] = float(int(Uniform(rnd) * 8));
+
+	Series ref;
+	ref.Append(nullptr, IsaScalar, &v[0], (int)v.size());
+
+	//brute force against the samples
+	for(int k = 0; k < (int)ref.Level.size(); k++)
+	{
+		const SeriesLevel &lv = ref.Level[k];
+		int size = 1 << (SeriesBaseLevel + k);
+		if(lv.Count != (int)v.size() / size) return false;
+		for(int i = 0; i < lv.Count; i++)
+		{
+			const float *s = &v[(size_t)i * size];
+			int imn = 0, imx = 0;
+			for(int j = 1; j < size; j++)
+			{
+				if(s[j] < s[imn]) imn = j;
+				if(s[j] > s[imx]) imx = j;
+			}
+			if(lv.Min[i] != s[imn] || lv.Max[i] != s[imx] || lv.MinFirst(i) != (imn < imx)) return false;
+		}
+	}
+
+	//SIMD + jobs in one go, and ragged appends, build the same pyramid
+	JobSystem jobs;
+	jobs.Init(3);
+	Series all, part;
+	all.Append(&jobs, isa, &v[0], (int)v.size());
+	for(size_t i = 0; i < v.size();)
+	{
+		int n = 1 + int(rnd() % 5000);
+		n = n < int(v.size() - i) ? n : int(v.size() - i);
+		part.Append(&jobs, isa, &v[i], n);
+		i += n;
+	}
+	if(all.Level.size() != ref.Level.size() || part.Level.size() != ref.Level.size()) return false;
+	for(size_t k = 0; k < ref.Level.size(); k++)
+	{
+		if(!SameLevel(ref.Level[k], all.Level[k]) || !SameLevel(ref.Level[k], part.Level[k])) return false;
+	}
+
+	//decimated line keeps every extreme of the window and stays in x order
+	std::vector<float> xy;
+	ref.Decimate(1000.5, 90000.25, 640, xy);
+	if(xy.size() > 640 * 4 * 2 + 8) return false;
+	float mn = 1e30f, mx = -1e30f;
+	for(int i = 1001; i <= 90000; i++) mn = v[i] < mn ? v[i] : mn, mx = v[i] > mx ? v[i] : mx;
+	float dmn = 1e30f, dmx = -1e30f;
+	for(size_t i = 0; i < xy.size(); i += 2)
+	{
+		if(i && xy[i] <= xy[i - 2]) return false;
+		dmn = xy[i + 1] < dmn ? xy[i + 1] : dmn;
+		dmx = xy[i + 1] > dmx ? xy[i + 1] : dmx;
+	}
+	return dmn <= mn && dmx >= mx;
+}
+
+static void BenchSeries()
+{
+	const int count  = 100 * 1000 * 1000;
+	const int pixels = 1920;
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	printf("series : %d samples (%.0f MB), detected isa=%s, threads=%d, self check %s\n",
+		count, count * 4.0 / (1024 * 1024), IsaName(isa), jobs.Threads(), CheckSeries(isa) ? "ok" : "FAILED");
+
+	//random walk with rare spikes, the spikes must survive every zoom
+	Series s;
+	s.Value.resize(count);
+	RandomFloat(&jobs, isa, 3, 0, 0, count, &s.Value[0], -1, 1);
+	float y = 0;
+	for(int i = 0; i < count; i++)
+	{
+		float r = s.Value[i];
+		y += r * 0.01f;
+		s.Value[i] = fabsf(r) > 0.999999f ? y + r * 100 : y;
+	}
+
+	struct
+	{
+		const char *name;
+		int         isa;
+		JobSystem  *jobs;
+	} mode[] =
+	{
+		{ "scalar",       IsaScalar, nullptr },
+		{ "avx2",         IsaAVX2,   nullptr },
+		{ "avx2 + jobs",  IsaAVX2,   &jobs   },
+	};
+	double base = 0;
+	for(int k = 0; k < int(sizeof(mode) / sizeof(mode[0])); k++)
+	{
+		if(mode[k].isa > isa) continue;
+		Timer t;
+		s.Rebuild(mode[k].jobs, mode[k].isa);
+		double ms   = t.Ms();
+		double rate = count * 4.0 / (ms / 1000.0) / 1e9;
+		if(!base) base = rate;
+		printf("  build %-14s %8.2f ms  %6.2f GB/s  x%.2f  %d levels\n", mode[k].name, ms, rate, rate / base, (int)s.Level.size());
+	}
+
+	//streaming : 1000 samples a frame on top of the 100M
+	{
+		std::vector<float> add(1000);
+		for(int i = 0; i < 1000; i++) add[i] = y;
+		const int frames = 1000;
+		Timer t;
+		for(int f = 0; f < frames; f++) s.Append(&jobs, isa, &add[0], (int)add.size());
+		printf("  append 1000 samples     %8.4f ms/frame\n", t.Ms() / frames);
+	}
+
+	//plot windows from the whole series down to a few thousand samples
+	std::vector<float> xy;
+	xy.reserve(pixels * 8 + 64);
+	for(double span = s.Size(); span >= 1000; span /= 16)
+	{
+		double x0 = (s.Size() - span) * 0.5;
+		const int frames = 100;
+		Timer t;
+		for(int f = 0; f < frames; f++) s.Decimate(x0, x0 + span, pixels, xy);
+		int  level = s.Choose(x0, x0 + span, pixels);
+		char name[16];
+		if(level < 0) snprintf(name, sizeof(name), "raw");
+		else          snprintf(name, sizeof(name), "2^%d", level + SeriesBaseLevel);
+		printf("  window %11.0f samples  bucket %-4s  %5d vertices  %8.4f ms\n", span, name, (int)xy.size() / 2, t.Ms() / frames);
+	}
+
+	//far end of the series : raw x must come back as exact offsets from x0
+	double x0 = double(s.Size() - 1000);
+	s.Decimate(x0, x0 + 999, pixels, xy);
+	int off = 0;
+	for(size_t i = 0; i < xy.size(); i += 2) off += xy[i] != float(i / 2);
+	printf("  x past 2^24 : %d of %d off %s\n", off, (int)xy.size() / 2, off || xy.size() != 2000 ? "FAILED" : "ok");
+}
+
+//------------------------------------------------------------------------------
+//
+// stream : ingest Msamples/s per producer count, upload bytes vs a rebuild
+//
+//------------------------------------------------------------------------------
+static bool CheckStream()
+{
+	//producers tag samples id * 2^22 + k (exact in float), consumer sees each id in order
+	{
+		const int producers = 3, each = 200000;
+		SampleQueue q;
+		q.Init(1 << 12);
+		std::vector<std::thread> th;
+		for(int p = 0; p < producers; p++)
+		{
+			th.push_back(std::thread([&q, p]()
+			{
+				float v[64];
+				for(int k = 0; k < each;)
+				{
+					int n = 1 + (k % 61);
+					n = n < each - k ? n : each - k;
+					for(int i = 0; i < n; i++) v[i] = float(p * (1 << 22) + k + i);
+					if(q.Push(v, n)) k += n;
+					else std::this_thread::yield();
+				}
+			}));
+		}
+		int next[producers] = {};
+		int total = 0;
+		float out[512];
+		bool ok = true;
+		while(total < producers * each)
+		{
+			int n = q.Pop(out, 512);
+			if(!n) std::this_thread::yield();
+			for(int i = 0; i < n; i++)
+			{
+				int p = int(out[i]) >> 22, k = int(out[i]) & ((1 << 22) - 1);
+				if(p < 0 || p >= producers || k != next[p]) ok = false;
+				else next[p]++;
+			}
+			total += n;
+		}
+		for(size_t i = 0; i < th.size(); i++) th[i].join();
+		if(!ok || q.Pop(out, 1) != 0 || q.Pending() != 0) return false;
+
+		//full queue refuses and counts, never splits a batch
+		q.Init(8);
+		float v[8] = {};
+		if(!q.Push(v, 6) || q.Pending() != 6 || q.Push(v, 3) || q.Dropped.load() != 3) return false;
+		if(q.Pop(out, 8) != 6 || q.Pending() != 0) return false;
+	}
+
+	//mirrored ring : the drawn run is the newest samples, and no slot is rewritten
+	//while one of the last StreamLatency frames could still read it
+	{
+		StreamRing ring;
+		ring.Init(1000, 400);
+		std::vector<long long> gpu(ring.Capacity * 2, -1);
+		std::vector<long long> last[StreamLatency + 1];
+		std::mt19937 rnd(3);
+		long long t = 0;
+		for(int f = 0; f < 2000; f++)
+		{
+			int count = int(rnd() % (ring.Budget() + 1));
+			StreamRing::Run run[2];
+			int runs = ring.Plan(count, run);
+			for(int r = 0; r < runs; r++)
+			{
+				for(int i = 0; i < run[r].count; i++)
+				{
+					for(int m = 0; m < 2; m++)
+					{
+						long long &slot = gpu[run[r].slot + i + m * ring.Capacity];
+						for(int j = 0; j < StreamLatency; j++)
+						{
+							for(size_t k = 0; k < last[j].size(); k++) if(last[j][k] == slot) return false;
+						}
+						slot = t + run[r].src + i;
+					}
+				}
+			}
+			ring.Commit(count);
+			t += count;
+			for(int j = StreamLatency - 1; j > 0; j--) last[j].swap(last[j - 1]);
+			last[0].clear();
+			int first = ring.First(), drawn = ring.Drawn();
+			for(int i = 0; i < drawn; i++)
+			{
+				if(gpu[first + i] != t - drawn + i) return false;
+				last[0].push_back(gpu[first + i]);
+			}
+		}
+	}
+	return true;
+}
+
+static void BenchStream()
+{
+	const int total = 1 << 23;
+	printf("stream : %d samples, self check %s\n", total, CheckStream() ? "ok" : "FAILED");
+
+	//producers push in batches while this thread drains
+	const int batch[] = { 1, 64 };
+	for(int b = 0; b < 2; b++)
+	{
+		for(int producers = 1; producers <= 4; producers *= 2)
+		{
+			for(int locked = 0; locked < 2; locked++)
+			{
+				SampleQueue q;
+				q.Init(1 << 16);
+				std::mutex lock;
+				std::vector<float> shared;
+				int each = total / producers;
+				int n = batch[b];
+				Timer t;
+				std::vector<std::thread> th;
+				for(int p = 0; p < producers; p++)
+				{
+					th.push_back(std::thread([&, n]()
+					{
+						float v[64] = {};
+						for(int k = 0; k < each; k += n)
+						{
+							if(locked)
+							{
+								std::lock_guard<std::mutex> lk(lock);
+								shared.insert(shared.end(), v, v + n);
+							}
+							else while(!q.Push(v, n)) std::this_thread::yield();
+						}
+					}));
+				}
+				std::vector<float> out(1 << 16);
+				for(int got = 0; got < each * producers;)
+				{
+					int c = 0;
+					if(locked)
+					{
+						std::lock_guard<std::mutex> lk(lock);
+						c = (int)shared.size();
+						shared.clear();
+					}
+					else c = q.Pop(&out[0], (int)out.size());
+					if(!c) std::this_thread::yield();
+					got += c;
+				}
+				for(size_t i = 0; i < th.size(); i++) th[i].join();
+				double rate = each * double(producers) / (t.Ms() / 1000.0);
+				printf("  %-14s batch %2d  producers %d  %8.2f Msamples/s\n", locked ? "mutex + vector" : "lock-free", n, producers, rate / 1e6);
+			}
+		}
+	}
+
+	//per frame upload at 60 fps : new samples twice (mirror) vs the whole window again
+	const int rate[] = { 1000, 60000, 600000 };
+	for(int i = 0; i < 3; i++)
+	{
+		int window = 1 << 18;
+		double fresh = rate[i] / 60.0 * 2 * sizeof(float);
+		double whole = window * sizeof(float);
+		printf("  %7d samples/s  window %d  stream %9.1f KB/frame  rebuild %9.1f KB/frame\n", rate[i], window, fresh / 1024, whole / 1024);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// cull : frustum test + compaction per stage, visible / total at 1M
+//
+//------------------------------------------------------------------------------
+static void MakeField(std::mt19937 &rnd, int count, RectSoA &soa)
+{
+	soa.Clear();
+	for(int i = 0; i < count; i++)
+	{
+		RectBatch rect = MakeRect(rnd);
+		rect.px = Uniform(rnd) * 64;
+		rect.pz = Uniform(rnd) * 64;
+		rect.sx = 0.1f + fabsf(Uniform(rnd));
+		soa.Push(rect);
+	}
+}
+
+static bool CheckCull(int isa)
+{
+	float vp[16];
+	MakeViewProj(vp);
+	std::mt19937 rnd(9);
+	RectSoA soa;
+	MakeField(rnd, 100000 + 5, soa);
+	int n = soa.Size();
+
+	//SIMD masks match the scalar one except right on a plane (fma rounding)
+	Frustum f;
+	f.Set(vp);
+	std::vector<unsigned char> ref(n + 8), mask(n + 8);
+	int count = CullScalar(soa, 0, n, f, &ref[0]);
+	for(int k = IsaSSE; k <= isa; k++)
+	{
+		int c = k == IsaAVX2 ? CullAVX2(soa, 3, n, f, &mask[0]) : CullSSE(soa, 3, n, f, &mask[0]);
+		c += CullScalar(soa, 0, 3, f, &mask[0]);
+		int diff = 0;
+		for(int i = 0; i < n; i++) diff += ref[i] != mask[i];
+		if(diff > 2 || abs(c - count) > 2) return false;
+		for(int i = 0; i < n; i++)
+		{
+			if(ref[i] == mask[i]) continue;
+			float r = RectRadius(soa.Field[RectSoA::SX][i], soa.Field[RectSoA::SZ][i]);
+			float closest = 1e30f;
+			for(int p = 0; p < 6; p++)
+			{
+				float d = f.Plane[p][0] * soa.Field[RectSoA::PX][i] + f.Plane[p][1] * soa.Field[RectSoA::PY][i] + f.Plane[p][2] * soa.Field[RectSoA::PZ][i] + f.Plane[p][3] + r;
+				closest = fabsf(d) < closest ? fabsf(d) : closest;
+			}
+			if(closest > 1e-4f) return false;
+		}
+	}
+
+	//every survivor really is inside, every rejected one really outside a plane
+	for(int i = 0; i < n; i++)
+	{
+		float r = RectRadius(soa.Field[RectSoA::SX][i], soa.Field[RectSoA::SZ][i]);
+		bool in = true;
+		for(int p = 0; p < 6; p++)
+		{
+			float d = f.Plane[p][0] * soa.Field[RectSoA::PX][i] + f.Plane[p][1] * soa.Field[RectSoA::PY][i] + f.Plane[p][2] * soa.Field[RectSoA::PZ][i] + f.Plane[p][3];
+			in = in && d >= -r;
+		}
+		if(in != (ref[i] != 0)) return false;
+	}
+	if(count == 0 || count == n) return false;
+
+	//compaction over jobs : same rects, same order as a serial filter
+	JobSystem jobs;
+	jobs.Init(3);
+	RectCull cull;
+	RectSoA dst;
+	cull.Run(&jobs, IsaScalar, soa, vp, dst);
+	if(cull.Visible != count || cull.Total != n || dst.Size() != count) return false;
+	for(int i = 0, k = 0; i < n; i++)
+	{
+		if(!ref[i]) continue;
+		for(int fi = 0; fi < RectSoA::FieldMax; fi++) if(dst.Field[fi][k] != soa.Field[fi][i]) return false;
+		k++;
+	}
+
+	//nothing visible : dst ends empty and no chunk writes to it
+	RectSoA gone = soa;
+	for(int i = 0; i < n; i++) gone.Field[RectSoA::PX][i] += 1e6f;
+	if(cull.Run(&jobs, isa, gone, vp, dst) != 0 || dst.Size() != 0) return false;
+	return true;
+}
+
+static void BenchCull()
+{
+	const int count  = 1 << 20;
+	const int frames = 10;
+	float vp[16];
+	MakeViewProj(vp);
+	std::mt19937 rnd(1);
+	RectSoA soa;
+	MakeField(rnd, count, soa);
+
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	printf("cull : %d instances, detected isa=%s, threads=%d, self check %s\n", count, IsaName(isa), jobs.Threads(), CheckCull(isa) ? "ok" : "FAILED");
+
+	struct
+	{
+		const char *name;
+		int         isa;
+		JobSystem  *jobs;
+	} mode[] =
+	{
+		{ "scalar",       IsaScalar, nullptr },
+		{ "sse",          IsaSSE,    nullptr },
+		{ "avx2",         IsaAVX2,   nullptr },
+		{ "avx2 + jobs",  IsaAVX2,   &jobs   },
+	};
+	std::vector<InstanceData> out(count);
+	Frustum f;
+	f.Set(vp);
+	std::vector<unsigned char> mask(count + 8);
+	for(int k = 0; k < int(sizeof(mode) / sizeof(mode[0])); k++)
+	{
+		if(mode[k].isa > isa) continue;
+		RectCull cull;
+		RectSoA  visible;
+		int (*kernel)(const RectSoA &, int, int, const Frustum &, unsigned char *) =
+			mode[k].isa == IsaAVX2 ? CullAVX2 : mode[k].isa == IsaSSE ? CullSSE : CullScalar;
+
+		//stage by stage : test alone, test + scan + scatter, transform of the survivors vs all
+		double test = 0, run = 0, xsurv = 0, xall = 0;
+		for(int fr = 0; fr < frames; fr++)
+		{
+			Timer t0;
+			kernel(soa, 0, count, f, &mask[0]);
+			test += t0.Ms();
+			Timer t1;
+			cull.Run(mode[k].jobs, mode[k].isa, soa, vp, visible);
+			run += t1.Ms();
+			Timer t2;
+			TransformBatch(mode[k].jobs, mode[k].isa, visible, 0, visible.Size(), vp, &out[0]);
+			xsurv += t2.Ms();
+			Timer t3;
+			TransformBatch(mode[k].jobs, mode[k].isa, soa, 0, count, vp, &out[0]);
+			xall += t3.Ms();
+		}
+		printf("  %-14s test %6.3f ms  cull+compact %6.3f ms  transform visible %6.3f ms  all %6.3f ms  upload %5.1f / %5.1f MB  (%d / %d visible)\n",
+			mode[k].name, test / frames, run / frames, xsurv / frames, xall / frames,
+			cull.Visible * sizeof(InstanceData) / (1024.0 * 1024.0), count * sizeof(InstanceData) / (1024.0 * 1024.0), cull.Visible, cull.Total);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// sort : back to front order, radix vs std::sort, coherent frames
+//
+//------------------------------------------------------------------------------
+static bool SortedFarFirst(const DepthSort &sort)
+{
+	int n = (int)sort.Order.size();
+	std::vector<unsigned char> seen(n, 0);
+	for(int i = 0; i < n; i++)
+	{
+		unsigned o = sort.Order[i];
+		if(o >= unsigned(n) || seen[o]) return false;
+		seen[o] = 1;
+		if(i && sort.Key[sort.Order[i - 1]] > sort.Key[o]) return false;
+	}
+	return true;
+}
+
+static float KeyDepth(unsigned key)
+{
+	unsigned u = ~key;
+	u ^= (u >> 31) ? 0x80000000u : 0xFFFFFFFFu;
+	float w;
+	memcpy(&w, &u, 4);
+	return w;
+}
+
+static bool CheckSort(int isa)
+{
+	//key order : larger w first, sign handled
+	const float w[] = { 1e30f, 100.0f, 1.5f, 0.0f, -0.0f, -2.0f, -1e30f };
+	for(int i = 0; i < int(sizeof(w) / sizeof(w[0])); i++)
+	{
+		if(KeyDepth(DepthKey(w[i])) != w[i] || (i && DepthKey(w[i - 1]) > DepthKey(w[i]))) return false;
+	}
+
+	float vp[16];
+	MakeViewProj(vp);
+	std::mt19937 rnd(11);
+	RectSoA soa;
+	MakeField(rnd, 300000 + 3, soa);
+	int n = soa.Size();
+
+	//SIMD keys decode to the scalar depth up to fma rounding
+	std::vector<unsigned> ks(n), kv(n);
+	DepthKeyScalar(soa, 0, n, vp, &ks[0]);
+	if(isa == IsaAVX2)
+	{
+		DepthKeyAVX2(soa, 0, n, vp, &kv[0]);
+		for(int i = 0; i < n; i++) if(!Near(KeyDepth(ks[i]), KeyDepth(kv[i]), 1e-5f)) return false;
+	}
+
+	//radix over jobs is the stable sort of the keys
+	JobSystem jobs;
+	jobs.Init(3);
+	DepthSort sort;
+	sort.Run(&jobs, isa, soa, vp);
+	if(!sort.Radix || !SortedFarFirst(sort)) return false;
+	std::vector<unsigned> ref(n);
+	for(int i = 0; i < n; i++) ref[i] = unsigned(i);
+	std::stable_sort(ref.begin(), ref.end(), [&](unsigned a, unsigned b) { return sort.Key[a] < sort.Key[b]; });
+	if(ref != sort.Order) return false;
+
+	//same instances, camera nudged : insertion on last order, still sorted
+	float vp2[16];
+	MakeViewProj(vp2, -10, 1, 0.00001f);
+	sort.Run(&jobs, isa, soa, vp2);
+	if(sort.Radix || !SortedFarFirst(sort)) return false;
+
+	//shuffled instances : insertion gives up, radix again
+	RectSoA shuffled;
+	shuffled.Resize(n);
+	for(int i = 0; i < n; i++) shuffled.Set(i, soa.Get(n - 1 - i));
+	sort.Run(nullptr, IsaScalar, shuffled, vp2);
+	if(!sort.Radix || !SortedFarFirst(sort)) return false;
+
+	//gather follows Order
+	RectSoA dst;
+	sort.Gather(&jobs, shuffled, dst);
+	for(int i = 0; i < n; i += 97)
+	{
+		for(int f = 0; f < RectSoA::FieldMax; f++) if(dst.Field[f][i] != shuffled.Field[f][sort.Order[i]]) return false;
+	}
+	return true;
+}
+
+static void BenchSort()
+{
+	const int frames = 10;
+	JobSystem jobs;
+	jobs.Init();
+	int isa = DetectIsa();
+	printf("sort : detected isa=%s, threads=%d, self check %s\n", IsaName(isa), jobs.Threads(), CheckSort(isa) ? "ok" : "FAILED");
+
+	const int sizes[] = { 100000, 250000, 500000, 1000000 };
+	for(int s = 0; s < int(sizeof(sizes) / sizeof(sizes[0])); s++)
+	{
+		int n = sizes[s];
+		std::mt19937 rnd(1);
+		RectSoA soa;
+		MakeField(rnd, n, soa);
+
+		//std::sort on (key, index) as the baseline
+		float vp[16];
+		MakeViewProj(vp);
+		std::vector<unsigned> key(n);
+		std::vector<unsigned long long> pair(n);
+		DepthKeyScalar(soa, 0, n, vp, &key[0]);
+		double stl = 0;
+		for(int f = 0; f < frames; f++)
+		{
+			for(int i = 0; i < n; i++) pair[i] = ((unsigned long long)key[i] << 32) | unsigned(i);
+			Timer t;
+			std::sort(pair.begin(), pair.end());
+			stl += t.Ms();
+		}
+
+		//radix from scratch every frame, then a camera creeping / orbiting as in the demo
+		double radix[2] = {}, coherent[2] = {};
+		int    insertion[2] = {};
+		for(int j = 0; j < 2; j++)
+		{
+			JobSystem *jp = j ? &jobs : nullptr;
+			for(int f = 0; f < frames; f++)
+			{
+				DepthSort sort;
+				Timer t;
+				sort.Run(jp, isa, soa, vp);
+				radix[j] += t.Ms();
+			}
+		}
+		const float speed[2] = { 0.000001f, 0.003f };
+		for(int j = 0; j < 2; j++)
+		{
+			DepthSort sort;
+			for(int f = 0; f <= frames; f++)
+			{
+				float a = f * speed[j];
+				MakeViewProj(vp, -cosf(a) * 10, 1, sinf(a) * 10);
+				Timer t;
+				sort.Run(&jobs, isa, soa, vp);
+				if(f)
+				{
+					coherent[j]  += t.Ms();
+					insertion[j] += !sort.Radix;
+				}
+			}
+		}
+		printf("  %8d  std::sort %7.3f ms  radix %7.3f ms  + jobs %7.3f ms  creep %7.3f ms (%2d/%d insertion)  orbit %7.3f ms (%2d/%d insertion)\n",
+			n, stl / frames, radix[0] / frames, radix[1] / frames,
+			coherent[0] / frames, insertion[0], frames, coherent[1] / frames, insertion[1], frames);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// entry
+//
+//------------------------------------------------------------------------------
+struct Bench
+{
+	const char *name;
+	void (*func)();
+};
+
+static const Bench bench[] =
+{
+	{ "jobs",      BenchJobs      },
+	{ "pool",      BenchPool      },
+	{ "transform", BenchTransform },
+	{ "compact",   BenchCompact   },
+	{ "ring",      BenchRing      },
+	{ "rng",       BenchRng       },
+	{ "polyline",  BenchPolyline  },
+	{ "series",    BenchSeries    },
+	{ "stream",    BenchStream    },
+	{ "cull",      BenchCull      },
+	{ "sort",      BenchSort      },
+};
+
+int main(int argc, char *argv[])
+{
+	for(int i = 0; i < int(sizeof(bench) / sizeof(bench[0])); i++)
+	{
+		if(argc > 1 && strcmp(argv[1], bench[i].name) != 0) continue;
+		bench[i].func();
+	}
+	return 0;
+}
@@ -0,0 +1,238 @@
+//------------------------------------------------------------------------------
+//
+// CULL.H
+//   Bounding sphere vs view frustum for RectSoA, and the compaction of the
+//   survivors into a second RectSoA. Compaction is a two pass prefix sum
+//   over fixed chunks : count per chunk, exclusive scan, scatter, so every
+//   chunk writes its own disjoint range and the order is kept.
+//
+//------------------------------------------------------------------------------
+#ifndef _CULL_H_
+#define _CULL_H_
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#include "../common/simd.h"
+#include "../common/jobs.h"
+#include "instance.h"
+
+//------------------------------------------------------------------------------
+// Frustum : 6 normalized planes, inside when dot(n, p) + d >= -radius.
+//   Row vector VP (clip = p * VP), D3D depth 0..w.
+//------------------------------------------------------------------------------
+struct Frustum
+{
+	float Plane[6][4];
+
+	void Set(const float *vp)
+	{
+		static const float sign[6][2] =
+		{
+			//column, sign : w + x, w - x, w + y, w - y, z, w - z
+			{ 0,  1 }, { 0, -1 }, { 1,  1 }, { 1, -1 }, { 2, 0 }, { 2, -1 },
+		};
+		for(int p = 0; p < 6; p++)
+		{
+			int   c = int(sign[p][0]);
+			float s = sign[p][1];
+			for(int k = 0; k < 4; k++)
+			{
+				float w = vp[k * 4 + 3], v = vp[k * 4 + c];
+				Plane[p][k] = p == 4 ? v : w + s * v;
+			}
+			float len = sqrtf(Plane[p][0] * Plane[p][0] + Plane[p][1] * Plane[p][1] + Plane[p][2] * Plane[p][2]);
+			float inv = len > 0 ? 1 / len : 0;
+			for(int k = 0; k < 4; k++) Plane[p][k] *= inv;
+		}
+	}
+};
+
+//the quad spans (+-sx, 0, +-sz) before rotation
+inline float RectRadius(float sx, float sz)
+{
+	return sqrtf(sx * sx + sz * sz);
+}
+
+//------------------------------------------------------------------------------
+// CullScalar / CullSSE / CullAVX2 : mask[i] = visible, returns the count
+//------------------------------------------------------------------------------
+inline int CullScalar(const RectSoA &soa, int begin, int end, const Frustum &f, unsigned char *mask)
+{
+	const float *px = &soa.Field[RectSoA::PX][0], *py = &soa.Field[RectSoA::PY][0], *pz = &soa.Field[RectSoA::PZ][0];
+	const float *sx = &soa.Field[RectSoA::SX][0], *sz = &soa.Field[RectSoA::SZ][0];
+	int count = 0;
+	for(int i = begin; i < end; i++)
+	{
+		float r  = RectRadius(sx[i], sz[i]);
+		bool  in = true;
+		for(int p = 0; p < 6 && in; p++)
+		{
+			const float *pl = f.Plane[p];
+			in = pl[0] * px[i] + pl[1] * py[i] + pl[2] * pz[i] + pl[3] >= -r;
+		}
+		mask[i] = in;
+		count  += in;
+	}
+	return count;
+}
+
+inline int CullSSE(const RectSoA &soa, int begin, int end, const Frustum &f, unsigned char *mask)
+{
+	const float *px = &soa.Field[RectSoA::PX][0], *py = &soa.Field[RectSoA::PY][0], *pz = &soa.Field[RectSoA::PZ][0];
+	const float *sx = &soa.Field[RectSoA::SX][0], *sz = &soa.Field[RectSoA::SZ][0];
+	int count = 0;
+	int i = begin;
+	for(; i + 4 <= end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(px + i), y = _mm_loadu_ps(py + i), z = _mm_loadu_ps(pz + i);
+		__m128 a = _mm_loadu_ps(sx + i), c = _mm_loadu_ps(sz + i);
+		__m128 nr = _mm_sub_ps(_mm_setzero_ps(), _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(c, c))));
+		__m128 in = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for(int p = 0; p < 6; p++)
+		{
+			const float *pl = f.Plane[p];
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl[0]), x), _mm_mul_ps(_mm_set1_ps(pl[1]), y)),
+			                      _mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl[2]), z), _mm_set1_ps(pl[3])));
+			in = _mm_and_ps(in, _mm_cmpge_ps(d, nr));
+		}
+		int bits = _mm_movemask_ps(in);
+		for(int k = 0; k < 4; k++) mask[i + k] = (bits >> k) & 1;
+		count += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+	}
+	return count + CullScalar(soa, i, end, f, mask);
+}
+
+TARGET_AVX2 inline int CullAVX2(const RectSoA &soa, int begin, int end, const Frustum &f, unsigned char *mask)
+{
+	const float *px = &soa.Field[RectSoA::PX][0], *py = &soa.Field[RectSoA::PY][0], *pz = &soa.Field[RectSoA::PZ][0];
+	const float *sx = &soa.Field[RectSoA::SX][0], *sz = &soa.Field[RectSoA::SZ][0];
+	__m256 plane[6][4];
+	for(int p = 0; p < 6; p++)
+	{
+		for(int k = 0; k < 4; k++) plane[p][k] = _mm256_set1_ps(f.Plane[p][k]);
+	}
+	//bit k of the movemask -> byte k : bits 0..6 by one multiply (bit k lands on 8k), bit 7 apart
+	const unsigned long long spread = 0x0002040810204081ULL;
+	int count = 0;
+	int i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(px + i), y = _mm256_loadu_ps(py + i), z = _mm256_loadu_ps(pz + i);
+		__m256 a = _mm256_loadu_ps(sx + i), c = _mm256_loadu_ps(sz + i);
+		__m256 nr = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_sqrt_ps(_mm256_fmadd_ps(a, a, _mm256_mul_ps(c, c))));
+		__m256 in = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for(int p = 0; p < 6; p++)
+		{
+			__m256 d = _mm256_fmadd_ps(plane[p][0], x, _mm256_fmadd_ps(plane[p][1], y, _mm256_fmadd_ps(plane[p][2], z, plane[p][3])));
+			in = _mm256_and_ps(in, _mm256_cmp_ps(d, nr, _CMP_GE_OQ));
+		}
+		unsigned bits = unsigned(_mm256_movemask_ps(in));
+		unsigned long long bytes = (((bits & 0x7F) * spread) & 0x0101010101010101ULL) | ((unsigned long long)(bits >> 7) << 56);
+		memcpy(mask + i, &bytes, 8);
+		count += int((bytes * 0x0101010101010101ULL) >> 56);
+	}
+	return count + CullScalar(soa, i, end, f, mask);
+}
+
+//------------------------------------------------------------------------------
+//
+// RectCull
+//   Per frame scratch (mask, chunk offsets) kept across frames.
+//
+//------------------------------------------------------------------------------
+struct RectCull
+{
+	enum { Chunk = 16384 };
+
+	std::vector<unsigned char>  Mask;
+	std::vector<int>            Offset;    //per chunk : visible count, then exclusive scan
+	std::vector<int>            Index;     //Chunk survivor indices per thread
+	int                         Total;
+	int                         Visible;
+
+	RectCull() : Total(0), Visible(0) {}
+
+	//------------------------------------------------------------------------------
+	// Run : survivors of src -> dst (resized), order kept. jobs may be null.
+	//------------------------------------------------------------------------------
+	int Run(JobSystem *jobs, int isa, const RectSoA &src, const float *vp, RectSoA &dst)
+	{
+		Total = src.Size();
+		if(Total <= 0)
+		{
+			Visible = 0;
+			dst.Resize(0);
+			return 0;
+		}
+		int chunks = (Total + Chunk - 1) / Chunk;
+		Mask.resize(Total + 8);
+		Offset.resize(chunks + 1);
+		Frustum f;
+		f.Set(vp);
+
+		int (*kernel)(const RectSoA &, int, int, const Frustum &, unsigned char *) =
+			isa == IsaAVX2 ? CullAVX2 : isa == IsaSSE ? CullSSE : CullScalar;
+		auto test = [&](int b, int e, int)
+		{
+			for(int c = b; c < e; c++)
+			{
+				int end = (c + 1) * Chunk < Total ? (c + 1) * Chunk : Total;
+				Offset[c] = kernel(src, c * Chunk, end, f, &Mask[0]);
+			}
+		};
+		if(jobs) jobs->ParallelFor(chunks, 1, test);
+		else     test(0, chunks, 0);
+
+		//exclusive scan over the chunk counts
+		int sum = 0;
+		for(int c = 0; c < chunks; c++)
+		{
+			int n = Offset[c];
+			Offset[c] = sum;
+			sum += n;
+		}
+		Offset[chunks] = sum;
+		Visible = sum;
+
+		dst.Resize(Visible);
+		Index.resize((jobs ? jobs->Threads() : 1) * Chunk);
+		auto scatter = [&](int b, int e, int thread)
+		{
+			for(int c = b; c < e; c++)
+			{
+				int end = (c + 1) * Chunk < Total ? (c + 1) * Chunk : Total;
+				Compact(src, c * Chunk, end, dst, Offset[c], &Index[thread * Chunk]);
+			}
+		};
+		if(jobs) jobs->ParallelFor(chunks, 1, scatter);
+		else     scatter(0, chunks, 0);
+		return Visible;
+	}
+
+	//survivors of [begin, end) -> dst[at, ...) : index list first, then one pass per field
+	void Compact(const RectSoA &src, int begin, int end, RectSoA &dst, int at, int *index) const
+	{
+		int n = 0;
+		for(int i = begin; i < end; i++)
+		{
+			index[n] = i;
+			n += Mask[i];
+		}
+		if(n == 0) return;
+		if(n == end - begin)
+		{
+			for(int fi = 0; fi < RectSoA::FieldMax; fi++) memcpy(dst.Field[fi].data() + at, src.Field[fi].data() + begin, sizeof(float) * n);
+			return;
+		}
+		for(int fi = 0; fi < RectSoA::FieldMax; fi++)
+		{
+			const float *s = src.Field[fi].data();
+			float       *d = dst.Field[fi].data() + at;
+			for(int k = 0; k < n; k++) d[k] = s[index[k]];
+		}
+	}
+};
+
+#endif //_CULL_H_
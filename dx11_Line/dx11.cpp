@@ -12,6 +12,7 @@
 //++
 #include <random>
 #include <vector>
+#include <chrono>
 #include <iostream>
 
 #include <windows.h>
@@ -27,6 +28,17 @@
 //for ComPtr
 #include <wrl/client.h>
 
+//local
+#include "instance.h"
+#include "transform.h"
+#include "ring.h"
+#include "../common/rng.h"
+#include "polyline.h"
+#include "series.h"
+#include "stream.h"
+#include "cull.h"
+#include "sort.h"
+
 //------------------------------------------------------------------------------
 //
 // pragma
@@ -79,43 +91,6 @@ void show_fps() {
   }
 }
 
-//------------------------------------------------------------------------------
-//
-// Random
-//
-//------------------------------------------------------------------------------
-struct Random
-{
-	std::mt19937 rnd;
-	unsigned long a, b, c;
-	Random() : a(1), b(234567), c(890123) {}
-
-	void Set(unsigned long  x,unsigned long  y, unsigned long z)
-	{
-		std::mt19937 t(x);
-		rnd = t;
-		
-		a = x;
-		b = y;
-		c = z;
-	}
-
-	unsigned long Int()
-	{
-		return rnd();
-		a += b;
-		b += c;
-		c += a;
-		return (a >> 16);
-	}
-	
-	float Float()
-	{
-		return -1 + (2 * float(Int()) / float(0xFFFFFFFF));
-	}
-};
-
-
 //------------------------------------------------------------------------------
 //
 // Render
@@ -141,21 +116,62 @@ struct Render
 		XMFLOAT4 Col;
 		XMMATRIX M;
 	};
+	static_assert(sizeof(VIData) == sizeof(InstanceData), "VIData layout");
 	
-	struct RectBatch
+	RectSoA vRectBatch;
+
+	//Transform kernel [selected at Init] and its workers
+	int       Isa;
+	JobSystem Jobs;
+
+	//Retained rects [Compact : 32 byte TRS instances, VP in cbViewProj]
+	InstancePool                     Pool;
+	std::vector<InstanceData>        vPoolCache;
+	std::vector<CompactInstance>     vPoolCompact;
+	std::vector<InstancePool::Range> vPoolRange;
+	int                              PoolUploaded;
+	bool                             Compact;
+
+	//Immediate rects [VRectIBuffer is used as a ring, Culling : only the survivors go in]
+	InstanceRing                     Ring;
+	RectCull                         Cull;
+	RectSoA                          vRectVisible;
+	bool                             Culling;
+
+	//Transparent : immediate rects drawn back to front
+	DepthSort                        Sort;
+	RectSoA                          vRectSorted;
+	bool                             Transparent;
+
+	//Polylines [VLineBuffer is a ring of LineSlotVertex slots]
+	PolylineBatch                    vLine;
+	InstanceRing                     LineRing;
+	std::vector<float>               vSeriesXY;
+	std::vector<float>               vSeriesXYZ;
+
+	//Live stream [StreamPush from any thread, VStreamBuffer gets only the new samples]
+	SampleQueue                      Stream;
+	StreamRing                       StreamPos;
+	std::vector<float>               vStream;
+	struct
 	{
-		float px, py, pz;
-		float sx, sy, sz;
-		float rx, ry, rz;
-		float r, g, b, a;
-	};
-	std::vector<RectBatch> vRectBatch;
+		float Org[4];
+		float U[4];
+		float V[4];
+		float Col[4];
+		float Range[4];        //1 / (Window - 1), ymin, 1 / (ymax - ymin)
+	} StreamPlot;
 
 	//Constant
 	enum
 	{
 		VertexNum   = 6,
 		InstanceMax = 32768,
+		RingMax     = InstanceMax * 4,
+		LineRingMax = 65536,
+		StreamQueueMax = 1 << 18,
+		StreamWindow   = 1 << 18,
+		StreamSlack    = 1 << 16,
 	};
 	
 	//------------------------------------------------------------------------------
@@ -179,13 +195,29 @@ struct Render
 
 		ID3D11InputLayout       *IL;
 		ID3D11VertexShader      *VS;
+		ID3D11InputLayout       *ILCompact;
+		ID3D11VertexShader      *VSCompact;
+		ID3D11Buffer            *CBViewProj;
 		ID3D11PixelShader       *PS;
 		ID3D11GeometryShader    *GS;
+		ID3D11InputLayout       *ILLine;
+		ID3D11VertexShader      *VSLine;
+		ID3D11PixelShader       *PSLine;
+		ID3D11InputLayout       *ILStream;
+		ID3D11VertexShader      *VSStream;
+		ID3D11PixelShader       *PSStream;
+		ID3D11Buffer            *CBStream;
 
 		ID3D11BlendState        *BS;
 		ID3D11RasterizerState   *RS;
+		ID3D11RasterizerState   *RSLine;
 		ID3D11Buffer            *VRect;
 		ID3D11Buffer            *VRectIBuffer;
+		ID3D11Buffer            *VPoolIBuffer;
+		int                     PoolCapacity;
+		ID3D11Buffer            *VLineBuffer;
+		ID3D11Buffer            *LineIBuffer;
+		ID3D11Buffer            *VStreamBuffer;
 		Matrix                  matrix;
 	} Var;
 
@@ -206,17 +238,33 @@ struct Render
 		printf("ID3D11Texture2D         *pDepthTexBuffer;      %08X\n", Var.pDepthTexBuffer);
 		printf("ID3D11InputLayout       *IL;                   %08X\n", Var.IL);
 		printf("ID3D11VertexShader      *VS;                   %08X\n", Var.VS);
+		printf("ID3D11InputLayout       *ILCompact;            %08X\n", Var.ILCompact);
+		printf("ID3D11VertexShader      *VSCompact;            %08X\n", Var.VSCompact);
+		printf("ID3D11Buffer            *CBViewProj;           %08X\n", Var.CBViewProj);
 		printf("ID3D11PixelShader       *PS;                   %08X\n", Var.PS);
 		printf("ID3D11GeometryShader    *GS;                   %08X\n", Var.GS);
+		printf("ID3D11InputLayout       *ILLine;               %08X\n", Var.ILLine);
+		printf("ID3D11VertexShader      *VSLine;               %08X\n", Var.VSLine);
+		printf("ID3D11PixelShader       *PSLine;               %08X\n", Var.PSLine);
+		printf("ID3D11InputLayout       *ILStream;             %08X\n", Var.ILStream);
+		printf("ID3D11VertexShader      *VSStream;             %08X\n", Var.VSStream);
+		printf("ID3D11PixelShader       *PSStream;             %08X\n", Var.PSStream);
+		printf("ID3D11Buffer            *CBStream;             %08X\n", Var.CBStream);
 		printf("ID3D11BlendState        *BS;                   %08X\n", Var.BS);
 		printf("ID3D11RasterizerState   *RS;                   %08X\n", Var.RS);
+		printf("ID3D11RasterizerState   *RSLine;               %08X\n", Var.RSLine);
 		printf("ID3D11Buffer            *VRect;                %08X\n", Var.VRect);
 		printf("ID3D11Buffer            *VRectIBuffer;         %08X\n", Var.VRectIBuffer);
+		printf("ID3D11Buffer            *VPoolIBuffer;         %08X\n", Var.VPoolIBuffer);
+		printf("ID3D11Buffer            *VLineBuffer;          %08X\n", Var.VLineBuffer);
+		printf("ID3D11Buffer            *LineIBuffer;          %08X\n", Var.LineIBuffer);
+		printf("ID3D11Buffer            *VStreamBuffer;        %08X\n", Var.VStreamBuffer);
 	}
 
-	Render()
+	Render() : Isa(IsaScalar), PoolUploaded(0), Compact(true), Culling(true), Transparent(true)
 	{
 		memset(&Var, 0, sizeof(Var));
+		memset(&StreamPlot, 0, sizeof(StreamPlot));
 	}
 
 	~Render()
@@ -226,10 +274,19 @@ struct Render
 
 	void Term()
 	{
+		Jobs.Term();
 		DiscardShader();
+		RELEASE(Var.VPoolIBuffer);
+		Var.PoolCapacity = 0;
+		RELEASE(Var.CBViewProj);
+		RELEASE(Var.CBStream);
+		RELEASE(Var.VStreamBuffer);
+		RELEASE(Var.LineIBuffer);
+		RELEASE(Var.VLineBuffer);
 		RELEASE(Var.VRectIBuffer);
 		RELEASE(Var.VRect);
 		RELEASE(Var.BS);
+		RELEASE(Var.RSLine);
 		RELEASE(Var.RS);
 		RELEASE(Var.pDepthTexBuffer);
 		RELEASE(Var.DSV);
@@ -324,6 +381,14 @@ struct Render
 		RELEASE(Var.GS);
 		RELEASE(Var.VS);
 		RELEASE(Var.IL);
+		RELEASE(Var.VSCompact);
+		RELEASE(Var.ILCompact);
+		RELEASE(Var.PSLine);
+		RELEASE(Var.VSLine);
+		RELEASE(Var.ILLine);
+		RELEASE(Var.PSStream);
+		RELEASE(Var.VSStream);
+		RELEASE(Var.ILStream);
 	}
 	
 	//------------------------------------------------------------------------------
@@ -333,6 +398,11 @@ struct Render
 	{
 		LPCWSTR filename = L"shader.hlsl";
 		LPCSTR  vsentry  = "vs_main";
+		LPCSTR  vcentry  = "vs_compact";
+		LPCSTR  vlentry  = "vs_line";
+		LPCSTR  plentry  = "ps_line";
+		LPCSTR  vtentry  = "vs_stream";
+		LPCSTR  ptentry  = "ps_stream";
 		LPCSTR  psentry  = "ps_main";
 		LPCSTR  gsentry  = "gs_main";
 		LPCSTR  pprofile = "ps_5_0";
@@ -369,6 +439,32 @@ struct Render
 			}
 			RELEASE(pBlob);
 		}
+
+		//------------------------------------------------------------------------------
+		// CreateVertexShader and Layout [CompactInstance]
+		//------------------------------------------------------------------------------
+		{
+			ID3DBlob* pBlob = nullptr;
+			D3D11_INPUT_ELEMENT_DESC layout[] =
+			{
+				{"POSITION",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 16 * 0, D3D11_INPUT_PER_VERTEX_DATA,   0},
+				{"TEXCOORD",  0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 16 * 1, D3D11_INPUT_PER_VERTEX_DATA,   0},
+				
+				//For instancing
+				{"INSTPOS",   0, DXGI_FORMAT_R32G32B32_FLOAT,    1,      0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+				{"COLOR",     0, DXGI_FORMAT_R8G8B8A8_UNORM,     1,     12, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+				{"SCALE",     0, DXGI_FORMAT_R16G16B16A16_FLOAT, 1,     16, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+				{"ROTATION",  0, DXGI_FORMAT_R16G16B16A16_FLOAT, 1,     24, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+			};
+			UINT numElements = ARRAYSIZE( layout );
+			CompileShaderFromFile(filename, vcentry, vprofile, &pBlob);
+			if(pBlob)
+			{
+				Var.dev->CreateVertexShader( pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &Var.VSCompact );
+				Var.dev->CreateInputLayout(layout, numElements, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &Var.ILCompact );
+			}
+			RELEASE(pBlob);
+		}
 		
 		//------------------------------------------------------------------------------
 		//Geometry
@@ -396,6 +492,73 @@ struct Render
 			RELEASE(pBlob);
 		}
 		
+		//------------------------------------------------------------------------------
+		// CreateVertexShader and Layout [LineVertex]
+		//------------------------------------------------------------------------------
+		{
+			ID3DBlob* pBlob = nullptr;
+			D3D11_INPUT_ELEMENT_DESC layout[] =
+			{
+				{"POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT,    0,  0, D3D11_INPUT_PER_VERTEX_DATA,   0},
+				{"EDGE",      0, DXGI_FORMAT_R32G32B32_FLOAT,    0, 12, D3D11_INPUT_PER_VERTEX_DATA,   0},
+				{"WIDTH",     0, DXGI_FORMAT_R32_FLOAT,          0, 24, D3D11_INPUT_PER_VERTEX_DATA,   0},
+				{"COLOR",     0, DXGI_FORMAT_R8G8B8A8_UNORM,     0, 28, D3D11_INPUT_PER_VERTEX_DATA,   0},
+			};
+			UINT numElements = ARRAYSIZE( layout );
+			CompileShaderFromFile(filename, vlentry, vprofile, &pBlob);
+			if(pBlob)
+			{
+				Var.dev->CreateVertexShader( pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &Var.VSLine );
+				Var.dev->CreateInputLayout(layout, numElements, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &Var.ILLine );
+			}
+			RELEASE(pBlob);
+		}
+
+		//------------------------------------------------------------------------------
+		//Pixel [LineVertex]
+		//------------------------------------------------------------------------------
+		{
+			ID3DBlob* pBlob = nullptr;
+			CompileShaderFromFile(filename, plentry, pprofile, &pBlob);
+			if(pBlob)
+			{
+				Var.dev->CreatePixelShader( pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &Var.PSLine );
+			}
+			RELEASE(pBlob);
+		}
+
+		//------------------------------------------------------------------------------
+		// CreateVertexShader and Layout [stream : one float per sample]
+		//------------------------------------------------------------------------------
+		{
+			ID3DBlob* pBlob = nullptr;
+			D3D11_INPUT_ELEMENT_DESC layout[] =
+			{
+				{"VALUE",     0, DXGI_FORMAT_R32_FLOAT,          0,  0, D3D11_INPUT_PER_VERTEX_DATA,   0},
+			};
+			UINT numElements = ARRAYSIZE( layout );
+			CompileShaderFromFile(filename, vtentry, vprofile, &pBlob);
+			if(pBlob)
+			{
+				Var.dev->CreateVertexShader( pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &Var.VSStream );
+				Var.dev->CreateInputLayout(layout, numElements, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &Var.ILStream );
+			}
+			RELEASE(pBlob);
+		}
+
+		//------------------------------------------------------------------------------
+		//Pixel [stream]
+		//------------------------------------------------------------------------------
+		{
+			ID3DBlob* pBlob = nullptr;
+			CompileShaderFromFile(filename, ptentry, pprofile, &pBlob);
+			if(pBlob)
+			{
+				Var.dev->CreatePixelShader( pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &Var.PSStream );
+			}
+			RELEASE(pBlob);
+		}
+		
 		printf("Done . \n");
 	}
 	
@@ -407,6 +570,13 @@ struct Render
 		Var.hWnd = handle;
 		Var.Width = w;
 		Var.Height = h;
+
+		//------------------------------------------------------------------------------
+		//Select transform kernel
+		//------------------------------------------------------------------------------
+		Isa = DetectIsa();
+		Jobs.Init();
+		printf("Transform : %s, threads=%d\n", IsaName(Isa), Jobs.Threads());
 		
 		//------------------------------------------------------------------------------
 		//CreateDevice
@@ -434,6 +604,7 @@ struct Render
 		//Create Swap Chain
 		//------------------------------------------------------------------------------
 		Var.dev->QueryInterface(__uuidof(IDXGIDevice1), (void**)&Var.dxgi);
+		Var.dxgi->SetMaximumFrameLatency(StreamLatency); //StreamRing reuses NO_OVERWRITE slots after that many frames
 		Var.dxgi->GetAdapter(&Var.adapter);
 		Var.adapter->GetParent(__uuidof(IDXGIFactory), (void**)&Var.dxgiFactory);
 
@@ -538,11 +709,71 @@ struct Render
 		{
 			D3D11_BUFFER_DESC bd;
 			ZeroMemory( &bd, sizeof(bd) );
-			bd.ByteWidth       = sizeof(VIData) * InstanceMax,
+			bd.ByteWidth       = sizeof(VIData) * RingMax,
 			bd.Usage           = D3D11_USAGE_DYNAMIC;
 			bd.BindFlags       = D3D11_BIND_VERTEX_BUFFER;
 			bd.CPUAccessFlags  = D3D11_CPU_ACCESS_WRITE;
 			Var.dev->CreateBuffer( &bd, nullptr, &Var.VRectIBuffer );
+			Ring.Init(RingMax);
+		}
+
+		//------------------------------------------------------------------------------
+		//Create Line Buffer [ring] and its static slot index pattern
+		//------------------------------------------------------------------------------
+		{
+			D3D11_BUFFER_DESC bd;
+			ZeroMemory( &bd, sizeof(bd) );
+			bd.ByteWidth       = sizeof(LineVertex) * LineSlotVertex * LineRingMax,
+			bd.Usage           = D3D11_USAGE_DYNAMIC;
+			bd.BindFlags       = D3D11_BIND_VERTEX_BUFFER;
+			bd.CPUAccessFlags  = D3D11_CPU_ACCESS_WRITE;
+			Var.dev->CreateBuffer( &bd, nullptr, &Var.VLineBuffer );
+			LineRing.Init(LineRingMax);
+
+			std::vector<unsigned> index(LineSlotIndex * LineRingMax);
+			LineIndex(&index[0], LineRingMax);
+			D3D11_SUBRESOURCE_DATA InitData;
+			ZeroMemory( &InitData, sizeof(InitData) );
+			InitData.pSysMem   = &index[0];
+			bd.ByteWidth       = sizeof(unsigned) * LineSlotIndex * LineRingMax;
+			bd.Usage           = D3D11_USAGE_IMMUTABLE;
+			bd.BindFlags       = D3D11_BIND_INDEX_BUFFER;
+			bd.CPUAccessFlags  = 0;
+			Var.dev->CreateBuffer( &bd, &InitData, &Var.LineIBuffer );
+		}
+
+		//------------------------------------------------------------------------------
+		//Create View Proj Constant [vs_compact]
+		//------------------------------------------------------------------------------
+		{
+			D3D11_BUFFER_DESC bd;
+			ZeroMemory( &bd, sizeof(bd) );
+			bd.ByteWidth       = sizeof(XMMATRIX);
+			bd.Usage           = D3D11_USAGE_DEFAULT;
+			bd.BindFlags       = D3D11_BIND_CONSTANT_BUFFER;
+			bd.CPUAccessFlags  = 0;
+			Var.dev->CreateBuffer( &bd, nullptr, &Var.CBViewProj );
+		}
+
+		//------------------------------------------------------------------------------
+		//Create Stream Buffer [mirrored ring, see StreamRing] and its constant
+		//------------------------------------------------------------------------------
+		{
+			D3D11_BUFFER_DESC bd;
+			ZeroMemory( &bd, sizeof(bd) );
+			bd.ByteWidth       = sizeof(float) * 2 * (StreamWindow + StreamSlack);
+			bd.Usage           = D3D11_USAGE_DYNAMIC;
+			bd.BindFlags       = D3D11_BIND_VERTEX_BUFFER;
+			bd.CPUAccessFlags  = D3D11_CPU_ACCESS_WRITE;
+			Var.dev->CreateBuffer( &bd, nullptr, &Var.VStreamBuffer );
+			Stream.Init(StreamQueueMax);
+			StreamPos.Init(StreamWindow, StreamSlack);
+
+			bd.ByteWidth       = sizeof(StreamPlot);
+			bd.Usage           = D3D11_USAGE_DEFAULT;
+			bd.BindFlags       = D3D11_BIND_CONSTANT_BUFFER;
+			bd.CPUAccessFlags  = 0;
+			Var.dev->CreateBuffer( &bd, nullptr, &Var.CBStream );
 		}
 
 		//------------------------------------------------------------------------------
@@ -580,6 +811,11 @@ struct Render
 		rsd.SlopeScaledDepthBias  = 0.0f;
 		Var.dev->CreateRasterizerState(&rsd, &Var.RS);
 
+		//Polyline : solid, AA comes from ps_line
+		rsd.FillMode              = D3D11_FILL_SOLID;
+		rsd.MultisampleEnable     = false;
+		Var.dev->CreateRasterizerState(&rsd, &Var.RSLine);
+
 		//------------------------------------------------------------------------------
 		// Setup View port 
 		//------------------------------------------------------------------------------
@@ -653,7 +889,198 @@ struct Render
 		 rx,  ry,  rz,
 		 r,  g,  b,  a
 		};
-		vRectBatch.push_back(data);
+		vRectBatch.Push(data);
+	}
+
+	//------------------------------------------------------------------------------
+	// PushLine [xyz[count * 3], width in pixels, cap : LineCapButt/Square/Round]
+	//------------------------------------------------------------------------------	
+	void PushLine(const float *xyz, int count, float width,
+		float r, float g, float b, float a, int cap = LineCapButt)
+	{
+		vLine.Push(xyz, count, width, PackUnorm8(r, g, b, a), cap);
+	}
+
+	//------------------------------------------------------------------------------
+	// PushSeries [samples x0..x1 as a line over pixels columns, plotted in the
+	//             rect org + u * (x - x0) / (x1 - x0) + v * (y - ymin) / (ymax - ymin)]
+	//------------------------------------------------------------------------------	
+	void PushSeries(const Series &series, double x0, double x1, int pixels,
+		float ymin, float ymax, const float *org, const float *u, const float *v, float width,
+		float r, float g, float b, float a)
+	{
+		series.Decimate(x0, x1, pixels, vSeriesXY);
+		int count = (int)vSeriesXY.size() / 2;
+		if(count < 2 || x1 <= x0 || ymax <= ymin) return;
+		vSeriesXYZ.resize(count * 3);
+		float sx = float(1 / (x1 - x0)), sy = 1 / (ymax - ymin);
+		for(int i = 0; i < count; i++)
+		{
+			float tx = vSeriesXY[i * 2 + 0] * sx;
+			float ty = (vSeriesXY[i * 2 + 1] - ymin) * sy;
+			for(int c = 0; c < 3; c++) vSeriesXYZ[i * 3 + c] = org[c] + u[c] * tx + v[c] * ty;
+		}
+		PushLine(&vSeriesXYZ[0], count, width, r, g, b, a, LineCapButt);
+	}
+
+	//------------------------------------------------------------------------------
+	// StreamPush [any thread, lock-free : false when the queue is full]
+	// SetStream  [newest StreamWindow samples over org + u * t + v * (y - ymin) / (ymax - ymin)]
+	//------------------------------------------------------------------------------	
+	bool StreamPush(const float *v, int count)
+	{
+		return Stream.Push(v, count);
+	}
+
+	void SetStream(const float *org, const float *u, const float *v, float ymin, float ymax,
+		float r, float g, float b, float a)
+	{
+		for(int c = 0; c < 3; c++)
+		{
+			StreamPlot.Org[c] = org[c];
+			StreamPlot.U[c]   = u[c];
+			StreamPlot.V[c]   = v[c];
+		}
+		StreamPlot.Org[3] = 1;
+		StreamPlot.Col[0] = r;
+		StreamPlot.Col[1] = g;
+		StreamPlot.Col[2] = b;
+		StreamPlot.Col[3] = a;
+		StreamPlot.Range[1] = ymin;
+		StreamPlot.Range[2] = ymax > ymin ? 1 / (ymax - ymin) : 0;
+	}
+
+	//------------------------------------------------------------------------------
+	// CreateRect / UpdateRect / DestroyRect [retained, drawn every frame]
+	//------------------------------------------------------------------------------	
+	InstancePool::Handle CreateRect(
+		float px, float py, float pz,
+		float sx, float sy, float sz,
+		float rx, float ry, float rz,
+		float r, float g, float b, float a)
+	{
+		RectBatch data =
+		{
+		 px,  py,  pz,
+		 sx,  sy,  sz,
+		 rx,  ry,  rz,
+		 r,  g,  b,  a
+		};
+		return Pool.Create(data);
+	}
+
+	bool UpdateRect(InstancePool::Handle h,
+		float px, float py, float pz,
+		float sx, float sy, float sz,
+		float rx, float ry, float rz,
+		float r, float g, float b, float a)
+	{
+		RectBatch data =
+		{
+		 px,  py,  pz,
+		 sx,  sy,  sz,
+		 rx,  ry,  rz,
+		 r,  g,  b,  a
+		};
+		return Pool.Update(h, data);
+	}
+
+	void DestroyRect(InstancePool::Handle h)
+	{
+		Pool.Destroy(h);
+	}
+
+	//------------------------------------------------------------------------------
+	// SetCompact [retained rects as CompactInstance or full VIData]
+	//------------------------------------------------------------------------------	
+	void SetCompact(bool enable)
+	{
+		if(Compact != enable)
+		{
+			Compact = enable;
+			Pool.MarkAllDirty();
+			printf("Compact = %d\n", Compact);
+		}
+	}
+
+	//------------------------------------------------------------------------------
+	// SetCulling [immediate rects : frustum test + compaction before upload]
+	//------------------------------------------------------------------------------	
+	void SetCulling(bool enable)
+	{
+		Culling = enable;
+		printf("Culling = %d\n", Culling);
+	}
+
+	//------------------------------------------------------------------------------
+	// SetTransparent [immediate rects : depth sort far to near before upload]
+	//------------------------------------------------------------------------------	
+	void SetTransparent(bool enable)
+	{
+		Transparent = enable;
+		printf("Transparent = %d\n", Transparent);
+	}
+
+	//------------------------------------------------------------------------------
+	// UploadPool [re-transform and upload dirty ranges only]
+	//   Compact : camera motion alone uploads nothing
+	//------------------------------------------------------------------------------	
+	int UploadPool(const float *vp)
+	{
+		int count = Pool.Count();
+		PoolUploaded = 0;
+		if(count <= 0)
+		{
+			return 0;
+		}
+
+		if(count > Var.PoolCapacity)
+		{
+			int capacity = Var.PoolCapacity ? Var.PoolCapacity : InstanceMax;
+			while(capacity < count) capacity *= 2;
+			RELEASE(Var.VPoolIBuffer);
+			Var.PoolCapacity = 0;
+
+			D3D11_BUFFER_DESC bd;
+			ZeroMemory( &bd, sizeof(bd) );
+			bd.ByteWidth       = sizeof(VIData) * capacity;
+			bd.Usage           = D3D11_USAGE_DEFAULT;
+			bd.BindFlags       = D3D11_BIND_VERTEX_BUFFER;
+			bd.CPUAccessFlags  = 0;
+			if(FAILED(Var.dev->CreateBuffer( &bd, nullptr, &Var.VPoolIBuffer )))
+			{
+				return 0;
+			}
+			Var.PoolCapacity = capacity;
+			Pool.MarkAllDirty();
+		}
+
+		UINT  stride = sizeof(VIData);
+		char *cache  = nullptr;
+		if(Compact)
+		{
+			vPoolCompact.resize(count);
+			PoolUploaded = Pool.Pack(&vPoolCompact[0], vPoolRange);
+			stride = sizeof(CompactInstance);
+			cache  = (char *)&vPoolCompact[0];
+		}
+		else
+		{
+			vPoolCache.resize(count);
+			PoolUploaded = Pool.Transform(vp, &vPoolCache[0], vPoolRange);
+			cache  = (char *)&vPoolCache[0];
+		}
+		for(size_t i = 0; i < vPoolRange.size(); i++)
+		{
+			const InstancePool::Range &range = vPoolRange[i];
+			D3D11_BOX box =
+			{
+				UINT(range.first * stride), 0, 0,
+				UINT((range.first + range.count) * stride), 1, 1,
+			};
+			Var.ctx->UpdateSubresource(Var.VPoolIBuffer, 0, &box, cache + range.first * stride, 0, 0);
+		}
+		return count;
 	}
 
 	//------------------------------------------------------------------------------
@@ -661,19 +1088,19 @@ struct Render
 	//------------------------------------------------------------------------------	
 	void Draw()
 	{
-		int remain = vRectBatch.size();
-		if(remain <= 0 || !Var.IL || !Var.RS || !Var.VS || !Var.PS || !Var.GS )
+		int remain = vRectBatch.Size();
+		bool stream = StreamPos.Total > 0 || Stream.Pending() != 0;
+		if((remain <= 0 && Pool.Count() <= 0 && vLine.Size() <= 0 && !stream) || !Var.IL || !Var.RS || !Var.VS || !Var.PS || !Var.GS )
 		{
+			vRectBatch.Clear();
+			vLine.Clear();
 			return;
 		}
-		int temp  = 0;
 		int index = 0;
 
 		//Setup IA -> 0:Vertex, 1:Tex,Color,WorldMatrix
-		ID3D11Buffer *bptr[2] = { Var.VRect, Var.VRectIBuffer };
 		UINT strides[2] = { sizeof(VData), sizeof(VIData) };
 		UINT offsets[2] = { 0, 0 };
-		Var.ctx->IASetVertexBuffers(0, 2, bptr, strides, offsets);
 		Var.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		Var.ctx->IASetInputLayout(Var.IL);
 		Var.ctx->IASetIndexBuffer( nullptr, DXGI_FORMAT_UNKNOWN, 0 );
@@ -693,40 +1120,180 @@ struct Render
 
 		//Create View Proj M
 		XMMATRIX vp  = XMMatrixMultiply(Var.matrix.View, Var.matrix.Proj);
+		XMFLOAT4X4 vpf;
+		XMStoreFloat4x4(&vpf, vp);
+		XMMATRIX vpt = XMMatrixTranspose(vp);
+		if(Var.CBViewProj) Var.ctx->UpdateSubresource(Var.CBViewProj, 0, nullptr, &vpt, 0, 0);
 
-		//Draw
+		//Retained
+		if(Compact && (!Var.VSCompact || !Var.ILCompact || !Var.CBViewProj))
+		{
+			SetCompact(false);
+		}
+		int poolcount = UploadPool(&vpf.m[0][0]);
+		if(poolcount > 0)
+		{
+			ID3D11Buffer *bptr[2] = { Var.VRect, Var.VPoolIBuffer };
+			if(Compact)
+			{
+				UINT cstrides[2] = { sizeof(VData), sizeof(CompactInstance) };
+				Var.ctx->VSSetConstantBuffers(3, 1, &Var.CBViewProj);
+				Var.ctx->IASetInputLayout(Var.ILCompact);
+				Var.ctx->VSSetShader(Var.VSCompact, 0, NULL);
+				Var.ctx->IASetVertexBuffers(0, 2, bptr, cstrides, offsets);
+				Var.ctx->DrawInstanced(VertexNum, poolcount, 0, 0);
+				Var.ctx->IASetInputLayout(Var.IL);
+				Var.ctx->VSSetShader(Var.VS, 0, NULL);
+			}
+			else
+			{
+				Var.ctx->IASetVertexBuffers(0, 2, bptr, strides, offsets);
+				Var.ctx->DrawInstanced(VertexNum, poolcount, 0, 0);
+			}
+		}
+
+		//Immediate : cull, then append to the ring NO_OVERWRITE, DISCARD only on wrap
+		const RectSoA *batch = &vRectBatch;
+		if(Culling && remain > 0)
+		{
+			remain = Cull.Run(&Jobs, Isa, vRectBatch, &vpf.m[0][0], vRectVisible);
+			batch  = &vRectVisible;
+		}
+		if(Transparent && remain > 1)
+		{
+			Sort.Run(&Jobs, Isa, *batch, &vpf.m[0][0]);
+			Sort.Gather(&Jobs, *batch, vRectSorted);
+			batch = &vRectSorted;
+		}
+		ID3D11Buffer *bptr[2] = { Var.VRect, Var.VRectIBuffer };
+		Var.ctx->IASetVertexBuffers(0, 2, bptr, strides, offsets);
 		while(remain > 0)
 		{
-			//Setup Primitive Num
-			temp = remain > InstanceMax ? InstanceMax : remain;
+			//Alloc Span
+			InstanceRing::Span span = Ring.Alloc(remain);
 			
-			//Make Instance Buffer
+			//Make Instance Buffer [span is filled by the workers]
 			D3D11_MAPPED_SUBRESOURCE m;
-			if(Var.ctx->Map(Var.VRectIBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &m) == S_OK)
+			D3D11_MAP type = span.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+			if(Var.ctx->Map(Var.VRectIBuffer, 0, type, 0, &m) == S_OK)
 			{
-				VIData *buffer = (VIData *)m.pData;
-				RectBatch *rect = &(vRectBatch[index]);
-#pragma omp parallel for
-				for(int i = 0; i < temp; i++)
-				{
-					XMMATRIX rotate = XMMatrixRotationRollPitchYawFromVector(XMLoadFloat3(&XMFLOAT3(rect[i].rx, rect[i].ry, rect[i].rz)));
-					XMMATRIX trans  = XMMatrixTranslation(rect[i].px, rect[i].py, rect[i].pz);
-					XMMATRIX scale  = XMMatrixScaling(rect[i].sx, rect[i].sy, rect[i].sz);
-					XMMATRIX wvp    = XMMatrixMultiply(scale, rotate);
-					buffer[i].Col   = XMFLOAT4(rect[i].r, rect[i].g, rect[i].b, rect[i].a);
-					buffer[i].M     = XMMatrixTranspose( XMMatrixMultiply( XMMatrixMultiply( XMMatrixMultiply(scale, rotate), trans), vp));
-				}
+				InstanceData *dst = (InstanceData *)m.pData + span.first;
+				TransformBatch(&Jobs, Isa, *batch, index, span.count, &vpf.m[0][0], dst);
 				Var.ctx->Unmap(Var.VRectIBuffer, 0);
 			}
 
 			//Draw
-			Var.ctx->DrawInstanced(VertexNum, temp, 0, 0);
+			Var.ctx->DrawInstanced(VertexNum, span.count, 0, span.first);
 
 			//update
-			remain -= temp;
-			index  += temp;
+			remain -= span.count;
+			index  += span.count;
+		}
+		vRectBatch.Clear();
+
+		//Polylines
+		DrawLine(&vpf.m[0][0]);
+
+		//Live stream
+		DrawStream();
+	}
+
+	//------------------------------------------------------------------------------
+	// DrawLine [tessellate into the line ring, one slot per point]
+	//------------------------------------------------------------------------------	
+	void DrawLine(const float *vp)
+	{
+		int remain = vLine.Size();
+		if(remain <= 0 || !Var.ILLine || !Var.VSLine || !Var.PSLine || !Var.RSLine)
+		{
+			vLine.Clear();
+			return;
+		}
+
+		LineView view;
+		memcpy(view.vp, vp, sizeof(view.vp));
+		view.hx = Var.Width  * 0.5f;
+		view.hy = Var.Height * 0.5f;
+		PolylinePrepare(&Jobs, Isa, vLine, view);
+
+		UINT stride = sizeof(LineVertex);
+		UINT offset = 0;
+		Var.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		Var.ctx->IASetInputLayout(Var.ILLine);
+		Var.ctx->IASetIndexBuffer(Var.LineIBuffer, DXGI_FORMAT_R32_UINT, 0);
+		Var.ctx->IASetVertexBuffers(0, 1, &Var.VLineBuffer, &stride, &offset);
+		Var.ctx->RSSetState(Var.RSLine);
+		Var.ctx->VSSetShader(Var.VSLine, 0, NULL);
+		Var.ctx->GSSetShader(nullptr, 0, NULL);
+		Var.ctx->PSSetShader(Var.PSLine, 0, NULL);
+
+		int index = 0;
+		while(remain > 0)
+		{
+			InstanceRing::Span span = LineRing.Alloc(remain);
+			D3D11_MAPPED_SUBRESOURCE m;
+			D3D11_MAP type = span.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+			if(Var.ctx->Map(Var.VLineBuffer, 0, type, 0, &m) == S_OK)
+			{
+				LineVertex *dst = (LineVertex *)m.pData + span.first * LineSlotVertex;
+				PolylineEmit(&Jobs, Isa, vLine, index, span.count, view, dst);
+				Var.ctx->Unmap(Var.VLineBuffer, 0);
+			}
+			Var.ctx->DrawIndexed(span.count * LineSlotIndex, 0, span.first * LineSlotVertex);
+			remain -= span.count;
+			index  += span.count;
+		}
+		Var.ctx->IASetIndexBuffer(nullptr, DXGI_FORMAT_UNKNOWN, 0);
+		vLine.Clear();
+	}
+
+	//------------------------------------------------------------------------------
+	// DrawStream [new samples only, NO_OVERWRITE, one strip over the mirrored ring]
+	//   Needs cbViewProj : set by Draw before the retained rects.
+	//------------------------------------------------------------------------------	
+	void DrawStream()
+	{
+		if(!Var.ILStream || !Var.VSStream || !Var.PSStream || !Var.VStreamBuffer || !Var.CBStream) return;
+
+		vStream.resize(StreamPos.Budget());
+		int count = Stream.Pop(vStream.data(), (int)vStream.size());
+		if(count > 0 || StreamPos.Fresh)
+		{
+			D3D11_MAPPED_SUBRESOURCE m;
+			D3D11_MAP type = StreamPos.Fresh ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+			if(Var.ctx->Map(Var.VStreamBuffer, 0, type, 0, &m) == S_OK)
+			{
+				float *dst = (float *)m.pData;
+				if(StreamPos.Fresh) memset(dst, 0, sizeof(float) * 2 * StreamPos.Capacity);
+				StreamRing::Run run[2];
+				int runs = StreamPos.Plan(count, run);
+				for(int i = 0; i < runs; i++)
+				{
+					memcpy(dst + run[i].slot,                      &vStream[run[i].src], sizeof(float) * run[i].count);
+					memcpy(dst + run[i].slot + StreamPos.Capacity, &vStream[run[i].src], sizeof(float) * run[i].count);
+				}
+				Var.ctx->Unmap(Var.VStreamBuffer, 0);
+				StreamPos.Commit(count);
+			}
 		}
-		vRectBatch.clear();
+
+		int drawn = StreamPos.Drawn();
+		if(drawn < 2) return;
+		StreamPlot.Range[0] = 1.0f / (StreamPos.Window - 1);
+		Var.ctx->UpdateSubresource(Var.CBStream, 0, nullptr, &StreamPlot, 0, 0);
+		UINT stride = sizeof(float);
+		UINT offset = sizeof(float) * StreamPos.First();
+		Var.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
+		Var.ctx->IASetInputLayout(Var.ILStream);
+		Var.ctx->IASetVertexBuffers(0, 1, &Var.VStreamBuffer, &stride, &offset);
+		Var.ctx->RSSetState(Var.RSLine);
+		Var.ctx->VSSetShader(Var.VSStream, 0, NULL);
+		Var.ctx->VSSetConstantBuffers(3, 1, &Var.CBViewProj);
+		Var.ctx->VSSetConstantBuffers(4, 1, &Var.CBStream);
+		Var.ctx->GSSetShader(nullptr, 0, NULL);
+		Var.ctx->PSSetShader(Var.PSStream, 0, NULL);
+		Var.ctx->Draw(drawn, 0);
+		Var.ctx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	}
 };
 
@@ -831,17 +1398,60 @@ int main(int argc, char *argv[])
 	Render dx;
 	dx.Init(Win::Init("DX11", ScreenX, ScreenY), ScreenX, ScreenY);
 	Random rnd;
+
+	//live stream : a producer thread feeding the lock-free queue at ~256k samples/s
+	std::atomic<bool> quit(false);
+	std::thread producer([&dx, &quit]()
+	{
+		Random noise;
+		noise.Set(2);
+		float data[256];
+		long long t = 0;
+		while(!quit.load())
+		{
+			for(int i = 0; i < 256; i++, t++)
+			{
+				data[i] = sinf(t * 0.0005f) + sinf(t * 0.013f) * 0.3f + noise.Float() * 0.05f;
+			}
+			dx.StreamPush(data, 256);
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	{
+		static const float org[3] = { -8, -4, 0 }, u[3] = { 16, 0, 0 }, v[3] = { 0, 2, 0 };
+		dx.SetStream(org, u, v, -1.5, 1.5, 0.8, 0.2, 0.1, 1);
+	}
+
 	while(!Win::DoAppEvent())
 	{
 		if(GetAsyncKeyState(VK_F5) & 0x8000)
 		{
 			dx.ReloadShader();
 		}
+		if(GetAsyncKeyState(VK_F6) & 0x0001)
+		{
+			dx.SetCompact(!dx.Compact);
+		}
+		if(GetAsyncKeyState(VK_F7) & 0x0001)
+		{
+			dx.SetCulling(!dx.Culling);
+		}
+		if(GetAsyncKeyState(VK_F8) & 0x0001)
+		{
+			dx.SetTransparent(!dx.Transparent);
+		}
+		//F9 : camera and spin stop, so the retained rects only upload what changes
+		static bool still = false;
+		if(GetAsyncKeyState(VK_F9) & 0x0001)
+		{
+			still = !still;
+			printf("Still = %d\n", still);
+		}
 		//dx.Clear(0.01, 0.02, 0.03, 1.0);
 		dx.Clear(1, 1, 1, 1);
 		//dx.DrawRect(0, 0, 1, 1);
 		static float kkk = 0;
-		kkk += 0.003;
+		if(!still) kkk += 0.003;
 		dx.View(
 			//0, 2, -10,
 				-cos(kkk) * 10, sin(kkk), sin(kkk) * 10,
@@ -852,41 +1462,64 @@ int main(int argc, char *argv[])
 			float(WindowX)/float(WindowY), 0.1f, 256.0f);
 
 		static float kk = 0;
-		kk += 0.02;
+		if(!still) kk += 0.02;
 		if(1)
 		{
+			//retained : the spin goes through UpdateRect, so every rect is dirty
+			//while it turns (and, F6 off, while the camera orbits). F9 stops both :
+			//then only newly added rects are transformed and uploaded
+			//rect n always takes words [n * 8, n * 8 + 8), upper and lower field mirror
 			static int count = 10000; //96700 x 6 
+			static int created = 0;
+			static std::vector<float> rnd8;
+			static std::vector<InstancePool::Handle> handle;
 			if(GetAsyncKeyState(VK_RIGHT) & 0x8000)
 			{
 				printf("count = %d\n", count);
 				count += 100;
 			}
-
-			rnd.Set(1, 2, 3);
-			for(int i = 0;  i < count; i++)
+			if(created < count)
 			{
-				float scale = 0.5;
-				dx.PushRect(
-					rnd.Float() * 20, 2 + rnd.Float() * 0.5, rnd.Float() * 20,
-					0.5, 1.0, 0.5,
-					//rnd.Float() + kk,rnd.Float() + kk,rnd.Float() + kk,
-					0, rnd.Float() + kk,0,
-					rnd.Float(),rnd.Float(),rnd.Float(), 1);
+				int num = count - created;
+				rnd8.resize(count * 8);
+				RandomFloat(&dx.Jobs, dx.Isa, 1, 0, created * 8LL, num * 8, &rnd8[created * 8], -1, 1);
 			}
-			rnd.Set(1, 2, 3);
-			for(int i = 0;  i < count; i++)
+
+			for(int i = 0; i < count; i++)
 			{
-				float scale = 0.5;
-				dx.PushRect(
-					rnd.Float() * 20,
-					-2 + rnd.Float() * 0.5,
-					rnd.Float() * 20,
+				const float *hi = &rnd8[i * 8];
+				const float *lo = &rnd8[i * 8];
+				if(i < created && still) continue;
+				if(i >= created)
+				{
+					handle.push_back(dx.CreateRect(
+						hi[0] * 20, 2 + hi[1] * 0.5, hi[2] * 20,
+						0.5, 1.0, 0.5,
+						//rnd.Float() + kk,rnd.Float() + kk,rnd.Float() + kk,
+						0, hi[3] + kk,0,
+						hi[4],hi[5],hi[6], 1));
+					handle.push_back(dx.CreateRect(
+						lo[0] * 20,
+						-2 + lo[1] * 0.5,
+						lo[2] * 20,
+						0.5, 01.0, 0.5,
+						//rnd.Float() + kk,rnd.Float() + kk,rnd.Float() + kk,
+						0, lo[3] + kk,0,
+						lo[4],lo[5],lo[6],  1));
+					continue;
+				}
+				dx.UpdateRect(handle[i * 2 + 0],
+					hi[0] * 20, 2 + hi[1] * 0.5, hi[2] * 20,
+					0.5, 1.0, 0.5,
+					0, hi[3] + kk,0,
+					hi[4],hi[5],hi[6], 1);
+				dx.UpdateRect(handle[i * 2 + 1],
+					lo[0] * 20, -2 + lo[1] * 0.5, lo[2] * 20,
 					0.5, 01.0, 0.5,
-					//rnd.Float() + kk,rnd.Float() + kk,rnd.Float() + kk,
-					0, rnd.Float() + kk,0,
-					rnd.Float(),rnd.Float(),rnd.Float(),  1);
+					0, lo[3] + kk,0,
+					lo[4],lo[5],lo[6],  1);
 			}
-			
+			created = count;
 		}
 		
 		if(1)
@@ -902,11 +1535,81 @@ int main(int argc, char *argv[])
 				kk + 0.5, 0, 0,
 				0.1, 0.2, 0.3, 0.5);
 		}
+
+		if(1)
+		{
+			//immediate field around the orbit, most of it outside the frustum (F7 : culling)
+			static const int field = 65536;
+			static std::vector<float> rnd4;
+			if(rnd4.empty())
+			{
+				rnd4.resize(field * 4);
+				RandomFloat(&dx.Jobs, dx.Isa, 1, 1, 0, field * 4, &rnd4[0], -1, 1);
+			}
+			for(int i = 0; i < field; i++)
+			{
+				const float *f = &rnd4[i * 4];
+				dx.PushRect(
+					f[0] * 64, f[1] * 0.5 - 5, f[2] * 64,
+					0.2, 1, 0.2,
+					0, f[3] * 3 + kk, 0,
+					0.3, 0.6, f[3] * 0.5 + 0.5, 0.8);
+			}
+			static int frame = 0;
+			if(++frame % 120 == 0) printf("cull : %d / %d visible, sort : %s, pool : %d / %d uploaded\n", dx.Cull.Visible, dx.Cull.Total, dx.Sort.Radix ? "radix" : "insertion", dx.PoolUploaded, dx.Pool.Count());
+		}
+		
+		if(1)
+		{
+			//polylines : helix per cap style, and a zigzag for miter / bevel joins
+			static const int caps[3] = { LineCapButt, LineCapSquare, LineCapRound };
+			float xyz[256 * 3];
+			for(int c = 0; c < 3; c++)
+			{
+				for(int i = 0; i < 256; i++)
+				{
+					float t = i / 255.0f;
+					xyz[i * 3 + 0] = cos(t * 12 + kk + c * 2.1f) * 6;
+					xyz[i * 3 + 1] = -1.5 + t * 3;
+					xyz[i * 3 + 2] = sin(t * 12 + kk + c * 2.1f) * 6;
+				}
+				dx.PushLine(xyz, 256, 2 + c * 4, c == 0, c == 1, c == 2, 0.8, caps[c]);
+			}
+			for(int i = 0; i < 16; i++)
+			{
+				xyz[i * 3 + 0] = -7.5 + i;
+				xyz[i * 3 + 1] = 3 + ((i & 1) ? 0.5 : -0.5) * (1 + i * 0.2);
+				xyz[i * 3 + 2] = 0;
+			}
+			dx.PushLine(xyz, 16, 10, 0.1, 0.1, 0.1, 1, LineCapRound);
+		}
+
+		if(1)
+		{
+			//time series : random walk growing every frame, always drawn whole through the pyramid
+			static Series series;
+			static float  walk = 0, lo = -1, hi = 1;
+			float add[4096];
+			for(int i = 0; i < 4096; i++)
+			{
+				walk += rnd.Float() * 0.02f;
+				lo = walk < lo ? walk : lo;
+				hi = walk > hi ? walk : hi;
+				add[i] = walk;
+			}
+			series.Append(&dx.Jobs, dx.Isa, add, 4096);
+			//4096 a frame : past 2^24 samples (64 MB) the oldest half goes
+			if(series.Size() > (1 << 24)) series.Trim(&dx.Jobs, dx.Isa, 1 << 23);
+			static const float org[3] = { -8, 4, 0 }, u[3] = { 16, 0, 0 }, v[3] = { 0, 2, 0 };
+			dx.PushSeries(series, 0, series.Size() - 1, WindowX, lo, hi, org, u, v, 1, 0.1, 0.3, 0.8, 1);
+		}
 		
 		dx.Draw();
 		dx.Swap( (GetAsyncKeyState(VK_F3) & 0x8000) ? 0 : 1);
 		show_fps();
 	}
+	quit.store(true);
+	producer.join();
 	dx.Term();
 	return 0;
 }
@@ -0,0 +1,442 @@
+//------------------------------------------------------------------------------
+//
+// INSTANCE.H
+//
+//------------------------------------------------------------------------------
+#ifndef _INSTANCE_H_
+#define _INSTANCE_H_
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+
+//------------------------------------------------------------------------------
+//
+// RectBatch
+//
+//------------------------------------------------------------------------------
+struct RectBatch
+{
+	float px, py, pz;
+	float sx, sy, sz;
+	float rx, ry, rz;
+	float r, g, b, a;
+};
+
+//------------------------------------------------------------------------------
+// InstanceData [same layout as Render::VIData]
+//------------------------------------------------------------------------------
+struct InstanceData
+{
+	float Col[4];
+	float M[16];
+};
+
+//------------------------------------------------------------------------------
+// TransformInstance
+//   M = transpose(Scale * RollPitchYaw * Translate * VP), row vector convention
+//   like XMMatrix*. vp is a row-major 4x4.
+//------------------------------------------------------------------------------
+inline void TransformInstance(const RectBatch &rect, const float *vp, InstanceData *out)
+{
+	float cp = cosf(rect.rx), sp = sinf(rect.rx);
+	float cy = cosf(rect.ry), sy = sinf(rect.ry);
+	float cr = cosf(rect.rz), sr = sinf(rect.rz);
+	float w[4][4] =
+	{
+		{ (cr * cy + sr * sp * sy) * rect.sx, (sr * cp) * rect.sx, (sr * sp * cy - cr * sy) * rect.sx, 0 },
+		{ (cr * sp * sy - sr * cy) * rect.sy, (cr * cp) * rect.sy, (sr * sy + cr * sp * cy) * rect.sy, 0 },
+		{ (cp * sy) * rect.sz,                (-sp) * rect.sz,     (cp * cy) * rect.sz,                0 },
+		{ rect.px,                            rect.py,             rect.pz,                            1 },
+	};
+	for(int i = 0; i < 4; i++)
+	{
+		for(int j = 0; j < 4; j++)
+		{
+			out->M[j * 4 + i] = w[i][0] * vp[0 * 4 + j] + w[i][1] * vp[1 * 4 + j] + w[i][2] * vp[2 * 4 + j] + w[i][3] * vp[3 * 4 + j];
+		}
+	}
+	out->Col[0] = rect.r;
+	out->Col[1] = rect.g;
+	out->Col[2] = rect.b;
+	out->Col[3] = rect.a;
+}
+
+//------------------------------------------------------------------------------
+// CompactInstance [32 bytes, world matrix is composed in vs_compact]
+//   Pos   : R32G32B32_FLOAT
+//   Col   : R8G8B8A8_UNORM
+//   Scale : R16G16B16A16_FLOAT (w unused)
+//   Rot   : R16G16B16A16_FLOAT pitch, yaw, roll wrapped to [-pi, pi]
+//------------------------------------------------------------------------------
+struct CompactInstance
+{
+	float          Pos[3];
+	unsigned int   Col;
+	unsigned short Scale[4];
+	unsigned short Rot[4];
+};
+
+inline unsigned short FloatToHalf(float f)
+{
+	unsigned int x;
+	memcpy(&x, &f, sizeof(x));
+	unsigned int sign = (x >> 16) & 0x8000;
+	unsigned int bits = (x >> 23) & 0xFF;
+	unsigned int mant = x & 0x7FFFFF;
+	int          exp  = int(bits) - 127 + 15;
+	if(bits == 0xFF) return (unsigned short)(sign | 0x7C00 | (mant ? 0x200 : 0));
+	if(exp >= 31)    return (unsigned short)(sign | 0x7C00);
+	if(exp <= 0)
+	{
+		//denormal half
+		if(exp < -10) return (unsigned short)sign;
+		mant |= 0x800000;
+		int shift = 14 - exp;
+		unsigned int h    = mant >> shift;
+		unsigned int rem  = mant & ((1u << shift) - 1);
+		unsigned int half = 1u << (shift - 1);
+		if(rem > half || (rem == half && (h & 1))) h++;
+		return (unsigned short)(sign | h);
+	}
+	//round to nearest even, a carry into the exponent is still correct
+	unsigned int h   = (unsigned int)(exp << 10) | (mant >> 13);
+	unsigned int rem = mant & 0x1FFF;
+	if(rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+	return (unsigned short)(sign | h);
+}
+
+inline float HalfToFloat(unsigned short h)
+{
+	unsigned int sign = (h & 0x8000) << 16;
+	unsigned int exp  = (h >> 10) & 0x1F;
+	unsigned int mant = h & 0x3FF;
+	unsigned int x;
+	if(exp == 0x1F)
+	{
+		x = sign | 0x7F800000 | (mant << 13);
+	}
+	else if(exp == 0)
+	{
+		float f = ldexpf(float(mant), -24);
+		return sign ? -f : f;
+	}
+	else
+	{
+		x = sign | ((exp - 15 + 127) << 23) | (mant << 13);
+	}
+	float f;
+	memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+inline float WrapAngle(float a)
+{
+	const float pi2 = 6.28318530718f;
+	return a - pi2 * floorf((a + 3.14159265359f) / pi2);
+}
+
+inline unsigned int PackUnorm8(float r, float g, float b, float a)
+{
+	float c[4] = { r, g, b, a };
+	unsigned int v = 0;
+	for(int i = 0; i < 4; i++)
+	{
+		float x = c[i] < 0 ? 0 : c[i] > 1 ? 1 : c[i];
+		v |= (unsigned int)(x * 255.0f + 0.5f) << (i * 8);
+	}
+	return v;
+}
+
+inline void PackInstance(const RectBatch &rect, CompactInstance *out)
+{
+	out->Pos[0]   = rect.px;
+	out->Pos[1]   = rect.py;
+	out->Pos[2]   = rect.pz;
+	out->Col      = PackUnorm8(rect.r, rect.g, rect.b, rect.a);
+	out->Scale[0] = FloatToHalf(rect.sx);
+	out->Scale[1] = FloatToHalf(rect.sy);
+	out->Scale[2] = FloatToHalf(rect.sz);
+	out->Scale[3] = 0;
+	out->Rot[0]   = FloatToHalf(WrapAngle(rect.rx));
+	out->Rot[1]   = FloatToHalf(WrapAngle(rect.ry));
+	out->Rot[2]   = FloatToHalf(WrapAngle(rect.rz));
+	out->Rot[3]   = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+// RectSoA [one array per RectBatch member]
+//
+//------------------------------------------------------------------------------
+struct RectSoA
+{
+	enum
+	{
+		PX, PY, PZ,
+		SX, SY, SZ,
+		RX, RY, RZ,
+		R, G, B, A,
+		FieldMax,
+	};
+	std::vector<float> Field[FieldMax];
+
+	int Size() const
+	{
+		return (int)Field[0].size();
+	}
+
+	void Resize(int n)
+	{
+		for(int f = 0; f < FieldMax; f++) Field[f].resize(n);
+	}
+
+	void Clear()
+	{
+		Resize(0);
+	}
+
+	void Push(const RectBatch &rect)
+	{
+		const float *src = &rect.px;
+		for(int f = 0; f < FieldMax; f++) Field[f].push_back(src[f]);
+	}
+
+	void Set(int i, const RectBatch &rect)
+	{
+		const float *src = &rect.px;
+		for(int f = 0; f < FieldMax; f++) Field[f][i] = src[f];
+	}
+
+	RectBatch Get(int i) const
+	{
+		RectBatch rect;
+		float *dst = &rect.px;
+		for(int f = 0; f < FieldMax; f++) dst[f] = Field[f][i];
+		return rect;
+	}
+
+	void Move(int dst, int src)
+	{
+		for(int f = 0; f < FieldMax; f++) Field[f][dst] = Field[f][src];
+	}
+};
+
+//------------------------------------------------------------------------------
+//
+// InstancePool
+//   Retained rects addressed by handle. Live instances are kept dense in
+//   [0, Count()) so the instance buffer can be drawn with one call; only the
+//   dirty ones are re-transformed by Transform().
+//
+//------------------------------------------------------------------------------
+struct InstancePool
+{
+	typedef unsigned int Handle;
+
+	enum
+	{
+		IndexBits     = 20,
+		IndexMask     = (1 << IndexBits) - 1,
+		InvalidHandle = 0xFFFFFFFF,          //slot IndexMask is never handed out, so no live handle is this
+		SlotMax       = IndexMask - 1,
+	};
+
+	struct Range
+	{
+		int first;
+		int count;
+	};
+
+	RectSoA                    Data;
+	std::vector<int>           DenseToSlot;
+	std::vector<int>           SlotToDense;
+	std::vector<unsigned int>  Generation;
+	std::vector<int>           FreeSlot;
+	std::vector<unsigned char> Dirty;
+	std::vector<int>           DirtyList;
+	bool                       AllDirty;
+	float                      LastVP[16];
+
+	InstancePool() : AllDirty(true)
+	{
+		memset(LastVP, 0, sizeof(LastVP));
+	}
+
+	int Count() const
+	{
+		return Data.Size();
+	}
+
+	bool IsValid(Handle h) const
+	{
+		unsigned int slot = h & IndexMask;
+		return h != InvalidHandle && slot < Generation.size() && Generation[slot] == (h >> IndexBits) && SlotToDense[slot] >= 0;
+	}
+
+	Handle Create(const RectBatch &rect)
+	{
+		int slot;
+		if(!FreeSlot.empty())
+		{
+			slot = FreeSlot.back();
+			FreeSlot.pop_back();
+		}
+		else
+		{
+			slot = (int)Generation.size();
+			if(slot > (int)SlotMax) return InvalidHandle;
+			Generation.push_back(0);
+			SlotToDense.push_back(-1);
+		}
+		int index = Count();
+		Data.Resize(index + 1);
+		Data.Set(index, rect);
+		DenseToSlot.push_back(slot);
+		Dirty.push_back(0);
+		SlotToDense[slot] = index;
+		MarkDirty(index);
+		return (Generation[slot] << IndexBits) | slot;
+	}
+
+	bool Update(Handle h, const RectBatch &rect)
+	{
+		if(!IsValid(h)) return false;
+		int index = SlotToDense[h & IndexMask];
+		Data.Set(index, rect);
+		MarkDirty(index);
+		return true;
+	}
+
+	void Destroy(Handle h)
+	{
+		if(!IsValid(h)) return;
+		int slot  = h & IndexMask;
+		int index = SlotToDense[slot];
+		int last  = Count() - 1;
+
+		//swap remove : the last instance moves into the hole
+		if(index != last)
+		{
+			Data.Move(index, last);
+			DenseToSlot[index] = DenseToSlot[last];
+			SlotToDense[DenseToSlot[index]] = index;
+			MarkDirty(index);
+		}
+		Data.Resize(last);
+		DenseToSlot.pop_back();
+		Dirty.pop_back();
+		SlotToDense[slot] = -1;
+		Generation[slot] = (Generation[slot] + 1) & (0xFFFFFFFF >> IndexBits);
+		FreeSlot.push_back(slot);
+	}
+
+	void Clear()
+	{
+		for(int i = Count() - 1; i >= 0; i--)
+		{
+			int slot = DenseToSlot[i];
+			Destroy((Generation[slot] << IndexBits) | slot);
+		}
+		DirtyList.clear();
+	}
+
+	void MarkDirty(int index)
+	{
+		if(!Dirty[index])
+		{
+			Dirty[index] = 1;
+			DirtyList.push_back(index);
+		}
+	}
+
+	void MarkAllDirty()
+	{
+		AllDirty = true;
+	}
+
+	//------------------------------------------------------------------------------
+	// Flush
+	//   Calls write(i) for every dirty instance and returns the contiguous
+	//   ranges of [0, Count()) that have to be re-uploaded.
+	//------------------------------------------------------------------------------
+	template<class Write>
+	int Flush(Write write, std::vector<Range> &ranges)
+	{
+		int count = Count();
+		ranges.clear();
+
+		//mostly dirty : a straight pass is cheaper than walking the list
+		if(DirtyList.size() * 2 >= (size_t)count)
+		{
+			AllDirty = true;
+		}
+
+		int done = 0;
+		if(AllDirty)
+		{
+			for(int i = 0; i < count; i++)
+			{
+				write(i);
+			}
+			if(count > 0)
+			{
+				Range range = { 0, count };
+				ranges.push_back(range);
+			}
+			done = count;
+		}
+		else
+		{
+			std::sort(DirtyList.begin(), DirtyList.end());
+			for(size_t k = 0; k < DirtyList.size(); k++)
+			{
+				int i = DirtyList[k];
+				if(i >= count || (k > 0 && DirtyList[k - 1] == i)) continue;
+				write(i);
+				if(!ranges.empty() && ranges.back().first + ranges.back().count == i)
+				{
+					ranges.back().count++;
+				}
+				else
+				{
+					Range range = { i, 1 };
+					ranges.push_back(range);
+				}
+				done++;
+			}
+		}
+
+		for(size_t k = 0; k < DirtyList.size(); k++)
+		{
+			if(DirtyList[k] < count) Dirty[DirtyList[k]] = 0;
+		}
+		DirtyList.clear();
+		AllDirty = false;
+		return done;
+	}
+
+	//------------------------------------------------------------------------------
+	// Transform : full matrices, a new vp dirties everything
+	//------------------------------------------------------------------------------
+	int Transform(const float *vp, InstanceData *cache, std::vector<Range> &ranges)
+	{
+		if(memcmp(vp, LastVP, sizeof(LastVP)) != 0)
+		{
+			memcpy(LastVP, vp, sizeof(LastVP));
+			AllDirty = true;
+		}
+		return Flush([&](int i) { TransformInstance(Data.Get(i), vp, &cache[i]); }, ranges);
+	}
+
+	//------------------------------------------------------------------------------
+	// Pack : compact TRS, camera independent
+	//------------------------------------------------------------------------------
+	int Pack(CompactInstance *cache, std::vector<Range> &ranges)
+	{
+		return Flush([&](int i) { PackInstance(Data.Get(i), &cache[i]); }, ranges);
+	}
+};
+
+#endif //_INSTANCE_H_
@@ -1,2 +1,3 @@
 REM cl dx11.cpp /EHsc /Ox /GS- /openmp
 cl dx11.cpp /EHsc /Ox /GS-
+cl bench.cpp /EHsc /Ox /GS-
@@ -0,0 +1,625 @@
+//------------------------------------------------------------------------------
+//
+// POLYLINE.H
+//   CPU tessellation of world space polylines into screen space quads.
+//   Every point owns a slot of LineSlotVertex vertices (body quad of the
+//   segment starting there + bevel quad towards the next segment), so slots
+//   are written independently and drawn with one static index pattern.
+//   ps_line turns Edge into an analytic coverage, no MSAA needed.
+//
+//------------------------------------------------------------------------------
+#ifndef _POLYLINE_H_
+#define _POLYLINE_H_
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "../common/simd.h"
+#include "../common/jobs.h"
+
+enum
+{
+	//PolylineBatch::Flag
+	LineFirst      = 1,
+	LineLast       = 2,
+	LineRound      = 4,
+	LineSquare     = 8,
+
+	//caps
+	LineCapButt    = 0,
+	LineCapSquare  = LineSquare,
+	LineCapRound   = LineRound,
+
+	//slot : 0,1 start corners  2,3 end corners  4,5 start corners of the next segment
+	LineSlotVertex = 6,
+	LineSlotIndex  = 12,
+};
+
+static const float LineFringe     = 1.0f;     //AA ramp outside the half width [px]
+static const float LineMiterLimit = 4.0f;     //miter length / half width, longer -> bevel
+static const float LineNearW      = 1e-3f;    //clip w below this is behind the eye
+static const float LineFar        = 1e4f;     //along distance for ends without a cap
+
+//------------------------------------------------------------------------------
+// LineVertex [32 bytes]
+//   Pos   : ndc x, y, z
+//   Edge  : distance across the centre line, beyond start, beyond end [px]
+//   Width : half width [px], negative for round caps
+//------------------------------------------------------------------------------
+struct LineVertex
+{
+	float    Pos[3];
+	float    Edge[3];
+	float    Width;
+	unsigned Col;
+};
+
+struct LineView
+{
+	float vp[16];
+	float hx;       //half viewport size [px]
+	float hy;
+};
+
+inline void LineIndex(unsigned *out, int slots)
+{
+	static const unsigned pattern[LineSlotIndex] = { 0, 1, 2,  2, 1, 3,  2, 4, 3,  3, 5, 2 };
+	for(int s = 0; s < slots; s++)
+	{
+		for(int k = 0; k < LineSlotIndex; k++) out[s * LineSlotIndex + k] = s * LineSlotVertex + pattern[k];
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+// PolylineBatch [SoA, one entry per point]
+//
+//------------------------------------------------------------------------------
+struct PolylineBatch
+{
+	std::vector<float>          X, Y, Z, Width;
+	std::vector<unsigned>       Col;
+	std::vector<unsigned char>  Flag;
+
+	//per frame [PolylinePrepare] : screen px, ndc z, clip w, segment direction and length
+	std::vector<float>          SX, SY, SZ, SW, TX, TY, Len;
+
+	int Size() const
+	{
+		return (int)X.size();
+	}
+
+	void Clear()
+	{
+		X.clear();
+		Y.clear();
+		Z.clear();
+		Width.clear();
+		Col.clear();
+		Flag.clear();
+	}
+
+	//xyz[count * 3], width [px], col : RGBA8
+	void Push(const float *xyz, int count, float width, unsigned col, int cap)
+	{
+		if(count < 2) return;
+		for(int i = 0; i < count; i++)
+		{
+			X.push_back(xyz[i * 3 + 0]);
+			Y.push_back(xyz[i * 3 + 1]);
+			Z.push_back(xyz[i * 3 + 2]);
+			Width.push_back(width * 0.5f);
+			Col.push_back(col);
+			Flag.push_back((unsigned char)((i == 0 ? LineFirst : 0) | (i == count - 1 ? LineLast : 0) | cap));
+		}
+	}
+};
+
+//------------------------------------------------------------------------------
+// Project : world -> screen px (y up, centre 0), ndc z, clip w
+//------------------------------------------------------------------------------
+inline void LineProjectScalar(PolylineBatch &b, int begin, int end, const LineView &view)
+{
+	const float *vp = view.vp;
+	for(int i = begin; i < end; i++)
+	{
+		float x  = b.X[i], y = b.Y[i], z = b.Z[i];
+		float cx = x * vp[0] + y * vp[4] + z * vp[8]  + vp[12];
+		float cy = x * vp[1] + y * vp[5] + z * vp[9]  + vp[13];
+		float cz = x * vp[2] + y * vp[6] + z * vp[10] + vp[14];
+		float cw = x * vp[3] + y * vp[7] + z * vp[11] + vp[15];
+		float iw = cw > LineNearW ? 1.0f / cw : 0.0f;
+		b.SX[i] = cx * iw * view.hx;
+		b.SY[i] = cy * iw * view.hy;
+		b.SZ[i] = cz * iw;
+		b.SW[i] = cw;
+	}
+}
+
+TARGET_AVX2 inline void LineProjectAVX2(PolylineBatch &b, int begin, int end, const LineView &view)
+{
+	const float *vp = view.vp;
+	__m256 nearw = _mm256_set1_ps(LineNearW);
+	__m256 hx    = _mm256_set1_ps(view.hx);
+	__m256 hy    = _mm256_set1_ps(view.hy);
+	int i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&b.X[i]);
+		__m256 y = _mm256_loadu_ps(&b.Y[i]);
+		__m256 z = _mm256_loadu_ps(&b.Z[i]);
+		__m256 c[4];
+		for(int k = 0; k < 4; k++)
+		{
+			c[k] = _mm256_fmadd_ps(x, _mm256_broadcast_ss(vp + k),
+			       _mm256_fmadd_ps(y, _mm256_broadcast_ss(vp + 4 + k),
+			       _mm256_fmadd_ps(z, _mm256_broadcast_ss(vp + 8 + k), _mm256_broadcast_ss(vp + 12 + k))));
+		}
+		__m256 iw = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), c[3]), _mm256_cmp_ps(c[3], nearw, _CMP_GT_OQ));
+		_mm256_storeu_ps(&b.SX[i], _mm256_mul_ps(_mm256_mul_ps(c[0], iw), hx));
+		_mm256_storeu_ps(&b.SY[i], _mm256_mul_ps(_mm256_mul_ps(c[1], iw), hy));
+		_mm256_storeu_ps(&b.SZ[i], _mm256_mul_ps(c[2], iw));
+		_mm256_storeu_ps(&b.SW[i], c[3]);
+	}
+	LineProjectScalar(b, i, end, view);
+}
+
+//------------------------------------------------------------------------------
+// Direction : unit screen direction of segment i -> i + 1. Len = 0 marks no
+// segment (last point, behind the eye, zero length), joins need both sides.
+//------------------------------------------------------------------------------
+inline void LineDirectionScalar(PolylineBatch &b, int begin, int end)
+{
+	for(int i = begin; i < end; i++)
+	{
+		float tx = 0, ty = 0, len = 0;
+		if(!(b.Flag[i] & LineLast) && b.SW[i] > LineNearW && b.SW[i + 1] > LineNearW)
+		{
+			float dx = b.SX[i + 1] - b.SX[i];
+			float dy = b.SY[i + 1] - b.SY[i];
+			len = sqrtf(dx * dx + dy * dy);
+			if(len > 1e-4f)
+			{
+				tx = dx / len;
+				ty = dy / len;
+			}
+			else
+			{
+				len = 0;
+			}
+		}
+		b.TX[i]  = tx;
+		b.TY[i]  = ty;
+		b.Len[i] = len;
+	}
+}
+
+TARGET_AVX2 inline void LineDirectionAVX2(PolylineBatch &b, int begin, int end)
+{
+	__m256  nearw = _mm256_set1_ps(LineNearW);
+	__m256  eps   = _mm256_set1_ps(1e-4f);
+	__m256i last  = _mm256_set1_epi32(LineLast);
+	int n = b.Size();
+	int i = begin;
+	for(; i + 8 <= end && i + 9 <= n; i += 8)
+	{
+		__m256 dx   = _mm256_sub_ps(_mm256_loadu_ps(&b.SX[i + 1]), _mm256_loadu_ps(&b.SX[i]));
+		__m256 dy   = _mm256_sub_ps(_mm256_loadu_ps(&b.SY[i + 1]), _mm256_loadu_ps(&b.SY[i]));
+		__m256 len  = _mm256_sqrt_ps(_mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy)));
+		__m128i f8  = _mm_loadl_epi64((const __m128i *)&b.Flag[i]);
+		__m256i f   = _mm256_and_si256(_mm256_cvtepu8_epi32(f8), last);
+		__m256 seg  = _mm256_castsi256_ps(_mm256_cmpeq_epi32(f, _mm256_setzero_si256()));
+		seg         = _mm256_and_ps(seg, _mm256_cmp_ps(_mm256_loadu_ps(&b.SW[i]),     nearw, _CMP_GT_OQ));
+		seg         = _mm256_and_ps(seg, _mm256_cmp_ps(_mm256_loadu_ps(&b.SW[i + 1]), nearw, _CMP_GT_OQ));
+		seg         = _mm256_and_ps(seg, _mm256_cmp_ps(len, eps, _CMP_GT_OQ));
+		__m256 inv  = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), len), seg);
+		_mm256_storeu_ps(&b.TX[i],  _mm256_mul_ps(dx, inv));
+		_mm256_storeu_ps(&b.TY[i],  _mm256_mul_ps(dy, inv));
+		_mm256_storeu_ps(&b.Len[i], _mm256_and_ps(len, seg));
+	}
+	LineDirectionScalar(b, i, end);
+}
+
+//------------------------------------------------------------------------------
+// Emit
+//------------------------------------------------------------------------------
+inline bool LineMiter(float t0x, float t0y, float t1x, float t1y, float *mx, float *my, float *scale)
+{
+	float sx = -t0y - t1y;
+	float sy =  t0x + t1x;
+	float l  = sqrtf(sx * sx + sy * sy);
+	if(l < 1e-6f) return false;
+	*mx = sx / l;
+	*my = sy / l;
+	float c = *mx * -t1y + *my * t1x;
+	if(c * LineMiterLimit < 1.0f) return false;
+	*scale = 1.0f / c;
+	return true;
+}
+
+inline void LineCorner(LineVertex *v, float x, float y, float z, float across, float ys, float ye,
+	float width, unsigned col, const float *ih)
+{
+	v->Pos[0]  = x * ih[0];
+	v->Pos[1]  = y * ih[1];
+	v->Pos[2]  = z;
+	v->Edge[0] = across;
+	v->Edge[1] = ys;
+	v->Edge[2] = ye;
+	v->Width   = width;
+	v->Col     = col;
+}
+
+//clip space position of point i, used for segments crossing the near plane only
+inline void LineClip(const PolylineBatch &b, int i, const float *vp, float c[4])
+{
+	for(int k = 0; k < 4; k++)
+	{
+		c[k] = b.X[i] * vp[k] + b.Y[i] * vp[4 + k] + b.Z[i] * vp[8 + k] + vp[12 + k];
+	}
+}
+
+inline void LineEmitSlot(const PolylineBatch &b, int i, const LineView &view, LineVertex *out)
+{
+	enum { Break, Cap, Join };
+	unsigned f = b.Flag[i];
+	if(f & LineLast)
+	{
+		memset(out, 0, sizeof(LineVertex) * LineSlotVertex);
+		return;
+	}
+
+	//segment A -> B in screen px
+	float ax = b.SX[i],     ay = b.SY[i],     az = b.SZ[i];
+	float bx = b.SX[i + 1], by = b.SY[i + 1], bz = b.SZ[i + 1];
+	float tx = b.TX[i],     ty = b.TY[i],     len = b.Len[i];
+	bool  clipa = !(b.SW[i] > LineNearW);
+	bool  clipb = !(b.SW[i + 1] > LineNearW);
+	if(clipa && clipb)
+	{
+		memset(out, 0, sizeof(LineVertex) * LineSlotVertex);
+		return;
+	}
+	if(clipa || clipb)
+	{
+		float ca[4], cb[4];
+		LineClip(b, i, view.vp, ca);
+		LineClip(b, i + 1, view.vp, cb);
+		float t  = (LineNearW * 2 - ca[3]) / (cb[3] - ca[3]);
+		float *c = clipa ? ca : cb;
+		for(int k = 0; k < 4; k++) c[k] = ca[k] + (cb[k] - ca[k]) * t;
+		ax = ca[0] / ca[3] * view.hx; ay = ca[1] / ca[3] * view.hy; az = ca[2] / ca[3];
+		bx = cb[0] / cb[3] * view.hx; by = cb[1] / cb[3] * view.hy; bz = cb[2] / cb[3];
+		float dx = bx - ax, dy = by - ay;
+		len = sqrtf(dx * dx + dy * dy);
+		if(!(len > 1e-4f))
+		{
+			memset(out, 0, sizeof(LineVertex) * LineSlotVertex);
+			return;
+		}
+		tx = dx / len;
+		ty = dy / len;
+	}
+	else if(len <= 0)
+	{
+		memset(out, 0, sizeof(LineVertex) * LineSlotVertex);
+		return;
+	}
+
+	//end kinds : a join needs a live segment on both sides of the point
+	int start = clipa ? Break : (f & LineFirst) ? Cap : (b.Len[i - 1] > 0 && b.Len[i] > 0) ? Join : Break;
+	int end   = clipb ? Break : (b.Flag[i + 1] & LineLast) ? Cap : (b.Len[i] > 0 && b.Len[i + 1] > 0) ? Join : Break;
+
+	float    hw     = b.Width[i];
+	float    hwf    = hw + LineFringe;
+	float    width  = (f & LineRound) ? -hw : hw;
+	float    capoff = (f & (LineRound | LineSquare)) ? 0.0f : hw;
+	float    capext = (f & (LineRound | LineSquare)) ? hw + LineFringe : LineFringe;
+	unsigned col    = b.Col[i];
+	float    nx     = -ty, ny = tx;
+	float    ih[2]  = { 1.0f / view.hx, 1.0f / view.hy };
+
+	//corners are A +- sp + t * sa and B +- ep + t * ea. Kept relative so the
+	//distances stay exact when the points themselves are far off screen.
+	float sp[2], ep[2], np[2];
+	float sa = 0, ea = 0;
+	float mx, my, scale;
+	if(start == Join && LineMiter(b.TX[i - 1], b.TY[i - 1], tx, ty, &mx, &my, &scale))
+	{
+		sp[0] = mx * hwf * scale;
+		sp[1] = my * hwf * scale;
+	}
+	else
+	{
+		sp[0] = nx * hwf;
+		sp[1] = ny * hwf;
+		sa    = start == Cap ? -capext : 0.0f;
+	}
+
+	//end corners and the start corners of the next segment (bevel quad)
+	bool bevel = false;
+	if(end == Join && LineMiter(tx, ty, b.TX[i + 1], b.TY[i + 1], &mx, &my, &scale))
+	{
+		ep[0] = mx * hwf * scale;
+		ep[1] = my * hwf * scale;
+	}
+	else
+	{
+		ep[0] = nx * hwf;
+		ep[1] = ny * hwf;
+		ea    = end == Cap ? capext : 0.0f;
+		bevel = end == Join;
+		np[0] = -b.TY[i + 1] * hwf;
+		np[1] =  b.TX[i + 1] * hwf;
+	}
+
+	//distance beyond a capped end is linear over the quad
+	float spt = sp[0] * tx + sp[1] * ty, spn = sp[0] * nx + sp[1] * ny;
+	float ept = ep[0] * tx + ep[1] * ty, epn = ep[0] * nx + ep[1] * ny;
+	for(int k = 0; k < 2; k++)
+	{
+		float sign = k ? -1.0f : 1.0f;
+		float sal  = sign * spt + sa;          //along from A
+		float eal  = sign * ept + ea;          //along from B
+		LineCorner(&out[k], ax + sign * sp[0] + tx * sa, ay + sign * sp[1] + ty * sa, az, sign * spn,
+			start == Cap ? capoff - sal       : -LineFar,
+			end   == Cap ? capoff + sal - len : -LineFar, width, col, ih);
+		LineCorner(&out[k + 2], bx + sign * ep[0] + tx * ea, by + sign * ep[1] + ty * ea, bz, sign * epn,
+			start == Cap ? capoff - eal - len : -LineFar,
+			end   == Cap ? capoff + eal       : -LineFar, width, col, ih);
+	}
+	if(bevel)
+	{
+		//|across| is all ps_line uses, the next segment's frame is fine
+		LineCorner(&out[4], bx + np[0], by + np[1], bz,  hwf, -LineFar, -LineFar, width, col, ih);
+		LineCorner(&out[5], bx - np[0], by - np[1], bz, -hwf, -LineFar, -LineFar, width, col, ih);
+	}
+	else
+	{
+		out[4] = out[2];
+		out[5] = out[3];
+	}
+}
+
+//slots are built on the stack and streamed out whole, the destination is
+//usually write combined (out must be 16 byte aligned, slots are 192 bytes)
+inline void LineStream(const LineVertex *src, int slots, LineVertex *out)
+{
+	const float *s = (const float *)src;
+	float       *d = (float *)out;
+	for(int k = 0; k < slots * int(sizeof(LineVertex) * LineSlotVertex / 16); k++) _mm_stream_ps(d + k * 4, _mm_loadu_ps(s + k * 4));
+}
+
+inline void LineEmitScalar(const PolylineBatch &b, int begin, int end, const LineView &view, LineVertex *out)
+{
+	LineVertex slot[LineSlotVertex];
+	for(int i = begin; i < end; i++)
+	{
+		LineEmitSlot(b, i, view, slot);
+		LineStream(slot, 1, out + (i - begin) * LineSlotVertex);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Emit AVX2 : 8 slots per step, one lane each, as LineEmitSlot. A LineVertex
+// is 8 floats, so the 8 lanes of its 8 fields transpose into 8 vertices.
+// Dead slots are masked to zero, slots with a point behind the eye (clipped
+// against the near plane) are redone scalar in the block before it streams.
+//------------------------------------------------------------------------------
+TARGET_AVX2 inline void LineTranspose8(__m256 r[8])
+{
+	__m256 t0 = _mm256_unpacklo_ps(r[0], r[1]), t1 = _mm256_unpackhi_ps(r[0], r[1]);
+	__m256 t2 = _mm256_unpacklo_ps(r[2], r[3]), t3 = _mm256_unpackhi_ps(r[2], r[3]);
+	__m256 t4 = _mm256_unpacklo_ps(r[4], r[5]), t5 = _mm256_unpackhi_ps(r[4], r[5]);
+	__m256 t6 = _mm256_unpacklo_ps(r[6], r[7]), t7 = _mm256_unpackhi_ps(r[6], r[7]);
+	__m256 u0 = _mm256_shuffle_ps(t0, t2, 0x44), u1 = _mm256_shuffle_ps(t0, t2, 0xEE);
+	__m256 u2 = _mm256_shuffle_ps(t1, t3, 0x44), u3 = _mm256_shuffle_ps(t1, t3, 0xEE);
+	__m256 u4 = _mm256_shuffle_ps(t4, t6, 0x44), u5 = _mm256_shuffle_ps(t4, t6, 0xEE);
+	__m256 u6 = _mm256_shuffle_ps(t5, t7, 0x44), u7 = _mm256_shuffle_ps(t5, t7, 0xEE);
+	r[0] = _mm256_permute2f128_ps(u0, u4, 0x20);
+	r[1] = _mm256_permute2f128_ps(u1, u5, 0x20);
+	r[2] = _mm256_permute2f128_ps(u2, u6, 0x20);
+	r[3] = _mm256_permute2f128_ps(u3, u7, 0x20);
+	r[4] = _mm256_permute2f128_ps(u0, u4, 0x31);
+	r[5] = _mm256_permute2f128_ps(u1, u5, 0x31);
+	r[6] = _mm256_permute2f128_ps(u2, u6, 0x31);
+	r[7] = _mm256_permute2f128_ps(u3, u7, 0x31);
+}
+
+//LineMiter on 8 lanes, the mask of the lanes it holds for
+TARGET_AVX2 inline __m256 LineMiter8(__m256 t0x, __m256 t0y, __m256 t1x, __m256 t1y, __m256 *mx, __m256 *my, __m256 *scale)
+{
+	__m256 sx = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_add_ps(t0y, t1y));
+	__m256 sy = _mm256_add_ps(t0x, t1x);
+	__m256 l  = _mm256_sqrt_ps(_mm256_fmadd_ps(sx, sx, _mm256_mul_ps(sy, sy)));
+	__m256 ok = _mm256_cmp_ps(l, _mm256_set1_ps(1e-6f), _CMP_GE_OQ);
+	*mx = _mm256_div_ps(sx, l);
+	*my = _mm256_div_ps(sy, l);
+	__m256 c = _mm256_fmsub_ps(*my, t1x, _mm256_mul_ps(*mx, t1y));
+	ok     = _mm256_and_ps(ok, _mm256_cmp_ps(_mm256_mul_ps(c, _mm256_set1_ps(LineMiterLimit)), _mm256_set1_ps(1.0f), _CMP_GE_OQ));
+	*scale = _mm256_div_ps(_mm256_set1_ps(1.0f), c);
+	return ok;
+}
+
+TARGET_AVX2 inline __m256 LineFlag8(const unsigned char *flag, int bit)
+{
+	__m256i f = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)flag));
+	__m256i m = _mm256_set1_epi32(bit);
+	return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(f, m), m));
+}
+
+//slots i .. i + 7 into blk (8 * LineSlotVertex), needs points i - 1 .. i + 8
+TARGET_AVX2 inline void LineEmitSlot8(const PolylineBatch &b, int i, const LineView &view, LineVertex *blk)
+{
+	__m256 zero  = _mm256_setzero_ps();
+	__m256 nearw = _mm256_set1_ps(LineNearW);
+	__m256 far   = _mm256_set1_ps(-LineFar);
+	__m256 ihx   = _mm256_set1_ps(1.0f / view.hx), ihy = _mm256_set1_ps(1.0f / view.hy);
+
+	//live : a segment on screen (Len > 0 : not last, both points in front)
+	__m256 len   = _mm256_loadu_ps(&b.Len[i]);
+	__m256 live  = _mm256_cmp_ps(len, zero, _CMP_GT_OQ);
+	__m256 clipa = _mm256_cmp_ps(_mm256_loadu_ps(&b.SW[i]),     nearw, _CMP_NGT_UQ);
+	__m256 clipb = _mm256_cmp_ps(_mm256_loadu_ps(&b.SW[i + 1]), nearw, _CMP_NGT_UQ);
+	__m256 last  = LineFlag8(&b.Flag[i], LineLast);
+	int    redo  = _mm256_movemask_ps(_mm256_andnot_ps(last, _mm256_xor_ps(clipa, clipb)));
+
+	__m256 tx = _mm256_loadu_ps(&b.TX[i]), ty = _mm256_loadu_ps(&b.TY[i]);
+	__m256 ax = _mm256_loadu_ps(&b.SX[i]),     ay = _mm256_loadu_ps(&b.SY[i]),     az = _mm256_loadu_ps(&b.SZ[i]);
+	__m256 bx = _mm256_loadu_ps(&b.SX[i + 1]), by = _mm256_loadu_ps(&b.SY[i + 1]), bz = _mm256_loadu_ps(&b.SZ[i + 1]);
+
+	//end kinds, as masks
+	__m256 round     = LineFlag8(&b.Flag[i], LineRound);
+	__m256 capped    = _mm256_or_ps(round, LineFlag8(&b.Flag[i], LineSquare));
+	__m256 startcap  = LineFlag8(&b.Flag[i], LineFirst);
+	__m256 startjoin = _mm256_andnot_ps(startcap, _mm256_cmp_ps(_mm256_loadu_ps(&b.Len[i - 1]), zero, _CMP_GT_OQ));
+	__m256 endcap    = LineFlag8(&b.Flag[i + 1], LineLast);
+	__m256 endjoin   = _mm256_andnot_ps(endcap, _mm256_cmp_ps(_mm256_loadu_ps(&b.Len[i + 1]), zero, _CMP_GT_OQ));
+
+	__m256 hw     = _mm256_loadu_ps(&b.Width[i]);
+	__m256 hwf    = _mm256_add_ps(hw, _mm256_set1_ps(LineFringe));
+	__m256 width  = _mm256_blendv_ps(hw, _mm256_sub_ps(zero, hw), round);
+	__m256 capoff = _mm256_andnot_ps(capped, hw);
+	__m256 capext = _mm256_blendv_ps(_mm256_set1_ps(LineFringe), hwf, capped);
+	__m256 col    = _mm256_castsi256_ps(_mm256_loadu_si256((const __m256i *)&b.Col[i]));
+	__m256 nx     = _mm256_sub_ps(zero, ty), ny = tx;
+
+	__m256 mx, my, scale, k;
+	__m256 sj  = _mm256_and_ps(startjoin, LineMiter8(_mm256_loadu_ps(&b.TX[i - 1]), _mm256_loadu_ps(&b.TY[i - 1]), tx, ty, &mx, &my, &scale));
+	k          = _mm256_mul_ps(hwf, scale);
+	__m256 sp0 = _mm256_blendv_ps(_mm256_mul_ps(nx, hwf), _mm256_mul_ps(mx, k), sj);
+	__m256 sp1 = _mm256_blendv_ps(_mm256_mul_ps(ny, hwf), _mm256_mul_ps(my, k), sj);
+	__m256 sa  = _mm256_and_ps(startcap, _mm256_sub_ps(zero, capext));
+
+	__m256 tnx = _mm256_loadu_ps(&b.TX[i + 1]), tny = _mm256_loadu_ps(&b.TY[i + 1]);
+	__m256 ej  = _mm256_and_ps(endjoin, LineMiter8(tx, ty, tnx, tny, &mx, &my, &scale));
+	k          = _mm256_mul_ps(hwf, scale);
+	__m256 ep0 = _mm256_blendv_ps(_mm256_mul_ps(nx, hwf), _mm256_mul_ps(mx, k), ej);
+	__m256 ep1 = _mm256_blendv_ps(_mm256_mul_ps(ny, hwf), _mm256_mul_ps(my, k), ej);
+	__m256 ea  = _mm256_and_ps(endcap, capext);
+	__m256 bev = _mm256_andnot_ps(ej, endjoin);
+	__m256 np0 = _mm256_mul_ps(_mm256_sub_ps(zero, tny), hwf), np1 = _mm256_mul_ps(tnx, hwf);
+
+	__m256 spt = _mm256_fmadd_ps(sp0, tx, _mm256_mul_ps(sp1, ty)), spn = _mm256_fmadd_ps(sp0, nx, _mm256_mul_ps(sp1, ny));
+	__m256 ept = _mm256_fmadd_ps(ep0, tx, _mm256_mul_ps(ep1, ty)), epn = _mm256_fmadd_ps(ep0, nx, _mm256_mul_ps(ep1, ny));
+
+	//v[vertex][field], fields in LineVertex order
+	__m256 v[LineSlotVertex][8];
+	for(int c = 0; c < 2; c++)
+	{
+		__m256 sign = _mm256_set1_ps(c ? -1.0f : 1.0f);
+		__m256 sal  = _mm256_fmadd_ps(sign, spt, sa);
+		__m256 eal  = _mm256_fmadd_ps(sign, ept, ea);
+		__m256 *s = v[c], *e = v[c + 2];
+		s[0] = _mm256_mul_ps(_mm256_fmadd_ps(tx, sa, _mm256_fmadd_ps(sign, sp0, ax)), ihx);
+		s[1] = _mm256_mul_ps(_mm256_fmadd_ps(ty, sa, _mm256_fmadd_ps(sign, sp1, ay)), ihy);
+		s[2] = az;
+		s[3] = _mm256_mul_ps(sign, spn);
+		s[4] = _mm256_blendv_ps(far, _mm256_sub_ps(capoff, sal), startcap);
+		s[5] = _mm256_blendv_ps(far, _mm256_sub_ps(_mm256_add_ps(capoff, sal), len), endcap);
+		e[0] = _mm256_mul_ps(_mm256_fmadd_ps(tx, ea, _mm256_fmadd_ps(sign, ep0, bx)), ihx);
+		e[1] = _mm256_mul_ps(_mm256_fmadd_ps(ty, ea, _mm256_fmadd_ps(sign, ep1, by)), ihy);
+		e[2] = bz;
+		e[3] = _mm256_mul_ps(sign, epn);
+		e[4] = _mm256_blendv_ps(far, _mm256_sub_ps(_mm256_sub_ps(capoff, eal), len), startcap);
+		e[5] = _mm256_blendv_ps(far, _mm256_add_ps(capoff, eal), endcap);
+		s[6] = e[6] = width;
+		s[7] = e[7] = col;
+
+		//bevel quad, or the end corners again
+		__m256 *n = v[c + 4];
+		n[0] = _mm256_blendv_ps(e[0], _mm256_mul_ps(_mm256_fmadd_ps(sign, np0, bx), ihx), bev);
+		n[1] = _mm256_blendv_ps(e[1], _mm256_mul_ps(_mm256_fmadd_ps(sign, np1, by), ihy), bev);
+		n[2] = bz;
+		n[3] = _mm256_blendv_ps(e[3], _mm256_mul_ps(sign, hwf), bev);
+		n[4] = _mm256_blendv_ps(e[4], far, bev);
+		n[5] = _mm256_blendv_ps(e[5], far, bev);
+		n[6] = width;
+		n[7] = col;
+	}
+
+	//dead lanes to zero, then lane j's vertex c goes to blk[j * LineSlotVertex + c]
+	for(int c = 0; c < LineSlotVertex; c++)
+	{
+		for(int f = 0; f < 8; f++) v[c][f] = _mm256_and_ps(v[c][f], live);
+		LineTranspose8(v[c]);
+		for(int j = 0; j < 8; j++) _mm256_store_ps((float *)&blk[j * LineSlotVertex + c], v[c][j]);
+	}
+	for(int j = 0; redo; j++, redo >>= 1)
+	{
+		if(redo & 1) LineEmitSlot(b, i + j, view, &blk[j * LineSlotVertex]);
+	}
+}
+
+TARGET_AVX2 inline void LineEmitAVX2(const PolylineBatch &b, int begin, int end, const LineView &view, LineVertex *out)
+{
+	alignas(32) LineVertex blk[8 * LineSlotVertex];
+	int n = b.Size();
+	int i = begin > 0 ? begin : 1;
+	LineEmitScalar(b, begin, std::min(i, end), view, out);
+	for(; i + 8 <= end && i + 9 <= n; i += 8)
+	{
+		LineEmitSlot8(b, i, view, blk);
+		LineStream(blk, 8, out + (i - begin) * LineSlotVertex);
+	}
+	if(i < end) LineEmitScalar(b, i, end, view, out + (i - begin) * LineSlotVertex);
+}
+
+inline void LineEmit(int isa, const PolylineBatch &b, int begin, int end, const LineView &view, LineVertex *out)
+{
+	if(isa == IsaAVX2) LineEmitAVX2(b, begin, end, view, out);
+	else               LineEmitScalar(b, begin, end, view, out);
+	_mm_sfence();
+}
+
+//------------------------------------------------------------------------------
+// PolylinePrepare : project + direction for the whole batch, once per frame
+// PolylineEmit    : slots [begin, begin + count) -> out, any split is valid
+//------------------------------------------------------------------------------
+inline void PolylinePrepare(JobSystem *jobs, int isa, PolylineBatch &b, const LineView &view)
+{
+	enum { Chunk = 8192 };
+	int n = b.Size();
+	b.SX.resize(n);
+	b.SY.resize(n);
+	b.SZ.resize(n);
+	b.SW.resize(n);
+	b.TX.resize(n);
+	b.TY.resize(n);
+	b.Len.resize(n);
+
+	auto project = [&](int begin, int end, int)
+	{
+		isa == IsaAVX2 ? LineProjectAVX2(b, begin, end, view) : LineProjectScalar(b, begin, end, view);
+	};
+	auto direction = [&](int begin, int end, int)
+	{
+		isa == IsaAVX2 ? LineDirectionAVX2(b, begin, end) : LineDirectionScalar(b, begin, end);
+	};
+	if(!jobs)
+	{
+		project(0, n, 0);
+		direction(0, n, 0);
+		return;
+	}
+	jobs->ParallelFor(n, Chunk, project);
+	jobs->ParallelFor(n, Chunk, direction);
+}
+
+inline void PolylineEmit(JobSystem *jobs, int isa, const PolylineBatch &b, int begin, int count, const LineView &view, LineVertex *out)
+{
+	enum { Chunk = 4096 };
+	if(!jobs)
+	{
+		LineEmit(isa, b, begin, begin + count, view, out);
+		return;
+	}
+	jobs->ParallelFor(count, Chunk, [&](int s, int e, int)
+	{
+		LineEmit(isa, b, begin + s, begin + e, view, out + s * LineSlotVertex);
+	});
+}
+
+#endif //_POLYLINE_H_
@@ -0,0 +1,59 @@
+//------------------------------------------------------------------------------
+//
+// RING.H
+//   Instance ring allocator for one large D3D11_USAGE_DYNAMIC buffer.
+//   Spans are handed out at a moving offset and mapped NO_OVERWRITE, only
+//   the span that wraps back to 0 is mapped DISCARD (the driver renames the
+//   buffer there, so regions still read by the GPU are never touched).
+//
+//------------------------------------------------------------------------------
+#ifndef _RING_H_
+#define _RING_H_
+
+struct InstanceRing
+{
+	struct Span
+	{
+		int  first;
+		int  count;
+		bool discard;
+	};
+
+	int      Capacity;
+	int      Head;
+	unsigned Wraps;
+
+	InstanceRing() : Capacity(0), Head(0), Wraps(0) {}
+
+	//the first Alloc after Init is a DISCARD : a fresh dynamic buffer must be
+	//discarded before it can be mapped NO_OVERWRITE
+	void Init(int capacity)
+	{
+		Capacity = capacity;
+		Head     = capacity;
+		Wraps    = 0;
+	}
+
+	//------------------------------------------------------------------------------
+	// Alloc : up to count contiguous elements. A span shorter than count is
+	// returned when the tail of the ring is reached, the caller loops.
+	//------------------------------------------------------------------------------
+	Span Alloc(int count)
+	{
+		Span span = { 0, 0, false };
+		if(count <= 0 || Capacity <= 0) return span;
+		if(Head >= Capacity)
+		{
+			Head         = 0;
+			span.discard = true;
+			Wraps++;
+		}
+		int space  = Capacity - Head;
+		span.first = Head;
+		span.count = count < space ? count : space;
+		Head      += span.count;
+		return span;
+	}
+};
+
+#endif //_RING_H_
@@ -0,0 +1,345 @@
+//------------------------------------------------------------------------------
+//
+// SERIES.H
+//   Uniformly sampled series with a min/max (M4 style) pyramid for plotting.
+//   Level l keeps, per bucket of 2^l samples, min, max and whether the min
+//   comes first, so a decimated line still passes through every extreme in
+//   the right order. Levels start at SeriesBaseLevel, finer zooms read the
+//   samples directly. Append only rebuilds the buckets it completes.
+//   Decimated x is relative to the window start (x0), so it stays exact in
+//   float however far into the series the window is.
+//
+//------------------------------------------------------------------------------
+#ifndef _SERIES_H_
+#define _SERIES_H_
+
+#include <vector>
+
+#include "../common/simd.h"
+#include "../common/jobs.h"
+
+enum
+{
+	SeriesBaseLevel = 4,     //16 samples per bucket
+	SeriesMaxLevel  = 31,
+};
+
+struct SeriesLevel
+{
+	std::vector<float>          Min;
+	std::vector<float>          Max;
+	std::vector<unsigned char>  Order;   //bit per bucket : min comes before max
+	int                         Count;
+
+	SeriesLevel() : Count(0) {}
+
+	bool MinFirst(int i) const
+	{
+		return (Order[i >> 3] >> (i & 7)) & 1;
+	}
+
+	void Set(int i, float mn, float mx, bool minfirst)
+	{
+		Min[i] = mn;
+		Max[i] = mx;
+		Order[i >> 3] = (unsigned char)((Order[i >> 3] & ~(1 << (i & 7))) | ((minfirst ? 1 : 0) << (i & 7)));
+	}
+};
+
+//------------------------------------------------------------------------------
+// Bucket kernels : [begin, end) output buckets, begin % 8 == 0 for the SIMD
+// versions (8 buckets -> one Order byte)
+//------------------------------------------------------------------------------
+inline void SeriesBaseScalar(const float *v, SeriesLevel &dst, int begin, int end)
+{
+	const int size = 1 << SeriesBaseLevel;
+	for(int i = begin; i < end; i++)
+	{
+		const float *s = v + (size_t)i * size;
+		int imn = 0, imx = 0;
+		for(int k = 1; k < size; k++)
+		{
+			if(s[k] < s[imn]) imn = k;
+			if(s[k] > s[imx]) imx = k;
+		}
+		dst.Set(i, s[imn], s[imx], imn < imx);
+	}
+}
+
+inline void SeriesReduceScalar(const SeriesLevel &src, SeriesLevel &dst, int begin, int end)
+{
+	for(int i = begin; i < end; i++)
+	{
+		int  a    = i * 2, b = i * 2 + 1;
+		bool minb = src.Min[b] < src.Min[a];
+		bool maxb = src.Max[b] > src.Max[a];
+		bool first;
+		if(minb != maxb) first = maxb;
+		else             first = minb ? src.MinFirst(b) : src.MinFirst(a);
+		dst.Set(i, minb ? src.Min[b] : src.Min[a], maxb ? src.Max[b] : src.Max[a], first);
+	}
+}
+
+TARGET_AVX2 inline void SeriesTranspose8(__m256 r[8])
+{
+	__m256 t[8], u[8];
+	for(int k = 0; k < 4; k++)
+	{
+		t[k * 2 + 0] = _mm256_unpacklo_ps(r[k * 2], r[k * 2 + 1]);
+		t[k * 2 + 1] = _mm256_unpackhi_ps(r[k * 2], r[k * 2 + 1]);
+	}
+	for(int k = 0; k < 2; k++)
+	{
+		u[k * 4 + 0] = _mm256_shuffle_ps(t[k * 4 + 0], t[k * 4 + 2], 0x44);
+		u[k * 4 + 1] = _mm256_shuffle_ps(t[k * 4 + 0], t[k * 4 + 2], 0xEE);
+		u[k * 4 + 2] = _mm256_shuffle_ps(t[k * 4 + 1], t[k * 4 + 3], 0x44);
+		u[k * 4 + 3] = _mm256_shuffle_ps(t[k * 4 + 1], t[k * 4 + 3], 0xEE);
+	}
+	for(int k = 0; k < 4; k++)
+	{
+		r[k]     = _mm256_permute2f128_ps(u[k], u[k + 4], 0x20);
+		r[k + 4] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x31);
+	}
+}
+
+//8 buckets of 16 samples : transpose so lane j walks bucket j, keep first min / max index
+TARGET_AVX2 inline void SeriesBaseAVX2(const float *v, SeriesLevel &dst, int begin, int end)
+{
+	const int size = 1 << SeriesBaseLevel;
+	int i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		const float *s = v + (size_t)i * size;
+		__m256 lo[8], hi[8];
+		for(int j = 0; j < 8; j++)
+		{
+			lo[j] = _mm256_loadu_ps(s + j * size);
+			hi[j] = _mm256_loadu_ps(s + j * size + 8);
+		}
+		SeriesTranspose8(lo);
+		SeriesTranspose8(hi);
+		__m256  mn = lo[0], mx = lo[0];
+		__m256i imn = _mm256_setzero_si256(), imx = _mm256_setzero_si256();
+		for(int k = 1; k < size; k++)
+		{
+			__m256  x  = k < 8 ? lo[k] : hi[k - 8];
+			__m256i ik = _mm256_set1_epi32(k);
+			__m256  lt = _mm256_cmp_ps(x, mn, _CMP_LT_OQ);
+			__m256  gt = _mm256_cmp_ps(x, mx, _CMP_GT_OQ);
+			mn  = _mm256_blendv_ps(mn, x, lt);
+			mx  = _mm256_blendv_ps(mx, x, gt);
+			imn = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(imn), _mm256_castsi256_ps(ik), lt));
+			imx = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(imx), _mm256_castsi256_ps(ik), gt));
+		}
+		_mm256_storeu_ps(&dst.Min[i], mn);
+		_mm256_storeu_ps(&dst.Max[i], mx);
+		dst.Order[i >> 3] = (unsigned char)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(imx, imn)));
+	}
+	SeriesBaseScalar(v, dst, i, end);
+}
+
+TARGET_AVX2 inline __m256 SeriesOrderMask(unsigned bits)
+{
+	const __m256i bit = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+	return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(int(bits)), bit), bit));
+}
+
+//pairs (2i, 2i + 1) -> i : even / odd children split by shuffle, lanes fixed up by a 64 bit permute
+TARGET_AVX2 inline void SeriesReduceAVX2(const SeriesLevel &src, SeriesLevel &dst, int begin, int end)
+{
+	int i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		int    c    = i * 2;
+		__m256 mna  = _mm256_loadu_ps(&src.Min[c]), mnb = _mm256_loadu_ps(&src.Min[c + 8]);
+		__m256 mxa  = _mm256_loadu_ps(&src.Max[c]), mxb = _mm256_loadu_ps(&src.Max[c + 8]);
+		__m256 oa   = SeriesOrderMask(src.Order[c >> 3]);
+		__m256 ob   = SeriesOrderMask(src.Order[(c >> 3) + 1]);
+		__m256 emn  = _mm256_shuffle_ps(mna, mnb, 0x88), omn = _mm256_shuffle_ps(mna, mnb, 0xDD);
+		__m256 emx  = _mm256_shuffle_ps(mxa, mxb, 0x88), omx = _mm256_shuffle_ps(mxa, mxb, 0xDD);
+		__m256 eo   = _mm256_shuffle_ps(oa,  ob,  0x88), oo  = _mm256_shuffle_ps(oa,  ob,  0xDD);
+		__m256 minb = _mm256_cmp_ps(omn, emn, _CMP_LT_OQ);
+		__m256 maxb = _mm256_cmp_ps(omx, emx, _CMP_GT_OQ);
+		__m256 same = _mm256_xor_ps(_mm256_xor_ps(minb, maxb), _mm256_castsi256_ps(_mm256_set1_epi32(-1)));
+		__m256 ord  = _mm256_blendv_ps(maxb, _mm256_blendv_ps(eo, oo, minb), same);
+		__m256 mn   = _mm256_blendv_ps(emn, omn, minb);
+		__m256 mx   = _mm256_blendv_ps(emx, omx, maxb);
+		mn  = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mn),  0xD8));
+		mx  = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(mx),  0xD8));
+		ord = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(ord), 0xD8));
+		_mm256_storeu_ps(&dst.Min[i], mn);
+		_mm256_storeu_ps(&dst.Max[i], mx);
+		dst.Order[i >> 3] = (unsigned char)_mm256_movemask_ps(ord);
+	}
+	SeriesReduceScalar(src, dst, i, end);
+}
+
+//------------------------------------------------------------------------------
+//
+// Series
+//
+//------------------------------------------------------------------------------
+struct Series
+{
+	std::vector<float>        Value;
+	std::vector<SeriesLevel>  Level;     //Level[k] : 2^(SeriesBaseLevel + k) samples per bucket
+
+	size_t Size() const
+	{
+		return Value.size();
+	}
+
+	void Clear()
+	{
+		Value.clear();
+		Level.clear();
+	}
+
+	//newest keep samples only, the pyramid is built again
+	void Trim(JobSystem *jobs, int isa, size_t keep)
+	{
+		if(Size() <= keep) return;
+		Value.erase(Value.begin(), Value.end() - keep);
+		Rebuild(jobs, isa);
+	}
+
+	//------------------------------------------------------------------------------
+	// Append : new samples, then the buckets they complete on every level
+	//------------------------------------------------------------------------------
+	void Append(JobSystem *jobs, int isa, const float *v, int count)
+	{
+		Value.insert(Value.end(), v, v + count);
+		Update(jobs, isa);
+	}
+
+	//whole pyramid again, after Value was written directly
+	void Rebuild(JobSystem *jobs, int isa)
+	{
+		Level.clear();
+		Update(jobs, isa);
+	}
+
+	void Update(JobSystem *jobs, int isa)
+	{
+		int complete = int(Size() >> SeriesBaseLevel);
+		for(int k = 0; complete > 0; k++, complete >>= 1)
+		{
+			if(k >= (int)Level.size()) Level.push_back(SeriesLevel());
+			SeriesLevel &dst = Level[k];
+			int begin = dst.Count;
+			if(complete <= begin) break;
+			dst.Min.resize(complete);
+			dst.Max.resize(complete);
+			dst.Order.resize((complete + 7) / 8 + 1);
+			Build(jobs, isa, k, begin, complete);
+			dst.Count = complete;
+		}
+	}
+
+	void Build(JobSystem *jobs, int isa, int k, int begin, int end)
+	{
+		enum { Chunk = 8192 };
+		SeriesLevel &dst = Level[k];
+		auto kernel = [&](int b, int e)
+		{
+			if(k == 0) isa == IsaAVX2 ? SeriesBaseAVX2(&Value[0], dst, b, e)     : SeriesBaseScalar(&Value[0], dst, b, e);
+			else       isa == IsaAVX2 ? SeriesReduceAVX2(Level[k - 1], dst, b, e) : SeriesReduceScalar(Level[k - 1], dst, b, e);
+		};
+
+		//scalar up to a whole Order byte, then chunks that never share one
+		int head = (begin + 7) & ~7;
+		head = head < end ? head : end;
+		kernel(begin, head);
+		if(!jobs)
+		{
+			kernel(head, end);
+			return;
+		}
+		jobs->ParallelFor(end - head, Chunk, [&](int b, int e, int)
+		{
+			kernel(head + b, head + e);
+		});
+	}
+
+	//------------------------------------------------------------------------------
+	// Decimate : samples [x0, x1] for a plot pixels wide -> xy pairs, x - x0.
+	//   Picks the coarsest level with buckets no wider than a pixel, so the
+	//   output is at most ~4 points per pixel whatever the zoom.
+	//------------------------------------------------------------------------------
+	int Choose(double x0, double x1, int pixels) const
+	{
+		double spp = (x1 - x0) / (pixels > 0 ? pixels : 1);
+		int level = -1;
+		for(int k = 0; k < (int)Level.size(); k++)
+		{
+			if(double(1 << (SeriesBaseLevel + k)) > spp || Level[k].Count <= 0) break;
+			level = k;
+		}
+		return level;
+	}
+
+	void Decimate(double x0, double x1, int pixels, std::vector<float> &xy) const
+	{
+		xy.clear();
+		size_t n = Size();
+		size_t a = x0 > 0 ? size_t(x0) : 0;
+		size_t b = x1 + 2 < double(n) ? size_t(x1) + 2 : n;
+		if(a >= b) return;
+		int level = Choose(x0, x1, pixels);
+		if(level < 0)
+		{
+			//below the first level : raw samples, or min/max of a few when still denser than the pixels
+			size_t step = size_t((x1 - x0) / (pixels > 0 ? pixels : 1)) + 1;
+			if(step <= 2) for(size_t i = a; i < b; i++) Push(xy, double(i) - x0, Value[i]);
+			else          for(size_t i = a; i < b; i += step) Scan(xy, x0, i, i + step < b ? i + step : b);
+			return;
+		}
+		const SeriesLevel &lv = Level[level];
+		size_t size = size_t(1) << (SeriesBaseLevel + level);
+		int    fb   = int((a + size - 1) / size);
+		int    lb   = b / size < size_t(lv.Count) ? int(b / size) : lv.Count;
+		if(fb >= lb)
+		{
+			Scan(xy, x0, a, b);
+			return;
+		}
+		Scan(xy, x0, a, fb * size);
+		for(int i = fb; i < lb; i++)
+		{
+			double x = double(i) * size - x0;
+			bool   f = lv.MinFirst(i);
+			Push(xy, x + size * 0.25, f ? lv.Min[i] : lv.Max[i]);
+			Push(xy, x + size * 0.75, f ? lv.Max[i] : lv.Min[i]);
+		}
+		Scan(xy, x0, lb * size, b);
+	}
+
+	//partial bucket at either end, straight from the samples
+	void Scan(std::vector<float> &xy, double x0, size_t a, size_t b) const
+	{
+		if(a >= b) return;
+		if(b - a <= 2)
+		{
+			for(size_t i = a; i < b; i++) Push(xy, double(i) - x0, Value[i]);
+			return;
+		}
+		size_t imn = a, imx = a;
+		for(size_t i = a + 1; i < b; i++)
+		{
+			if(Value[i] < Value[imn]) imn = i;
+			if(Value[i] > Value[imx]) imx = i;
+		}
+		size_t first = imn < imx ? imn : imx, second = imn < imx ? imx : imn;
+		Push(xy, double(first)  - x0, Value[first]);
+		Push(xy, double(second) - x0, Value[second]);
+	}
+
+	//x is taken relative to the window in double, then narrowed
+	static void Push(std::vector<float> &xy, double x, float y)
+	{
+		xy.push_back(float(x));
+		xy.push_back(y);
+	}
+};
+
+#endif //_SERIES_H_
@@ -21,6 +21,21 @@ cbuffer cbChangesEveryFrame : register( b2 )
     float4 vMeshColor;
 };
 
+cbuffer cbViewProj : register( b3 )
+{
+    matrix ViewProj;
+};
+
+//live stream plot : vertex i of the strip is sample First + i of the ring
+cbuffer cbStream : register( b4 )
+{
+    float4 StreamOrg;
+    float4 StreamU;
+    float4 StreamV;
+    float4 StreamCol;
+    float4 StreamRange;   //1 / (window - 1), ymin, 1 / (ymax - ymin)
+};
+
 
 //--------------------------------------------------------------------------------------
 // OUTPUT
@@ -34,6 +49,17 @@ struct VS_INPUT
 	uint                  iid : SV_InstanceID;
 };
 
+//compact instance : world matrix is composed in vs_compact
+struct VS_COMPACT_INPUT
+{
+	float4                Pos   : POSITION;
+	float4                Tex   : TEXCOORD;
+	float3                IPos  : INSTPOS;
+	float4                Col   : COLOR;
+	float4                Scale : SCALE;
+	float4                Rot   : ROTATION;
+};
+
 struct GS_INPUT
 {
 	float4                Pos : POSITION;
@@ -42,6 +68,34 @@ struct GS_INPUT
 	column_major float4x4 M   : MATRIX;
 };
 
+//polyline : tessellated on the CPU [polyline.h]
+struct VS_LINE_INPUT
+{
+	float3                Pos   : POSITION;
+	float3                Edge  : EDGE;
+	float                 Width : WIDTH;
+	float4                Col   : COLOR;
+};
+
+struct PS_LINE_INPUT
+{
+	float4                Pos   : SV_POSITION;
+	noperspective float4  Edge  : TEXCOORD0;
+	float4                Col   : COLOR0;
+};
+
+struct VS_STREAM_INPUT
+{
+	float                 Value : VALUE;
+	uint                  vid   : SV_VertexID;
+};
+
+struct PS_STREAM_INPUT
+{
+	float4                Pos   : SV_POSITION;
+	float4                Col   : COLOR0;
+};
+
 struct PS_INPUT
 {
 	float4 Pos   : SV_POSITION;
@@ -63,6 +117,57 @@ GS_INPUT vs_main( VS_INPUT input )
 	return output;
 }
 
+//----------------------------------------------------------------------------------
+// Vertex Shader [compact instance] : same TRS as TransformInstance on the CPU
+//----------------------------------------------------------------------------------
+GS_INPUT vs_compact( VS_COMPACT_INPUT input )
+{
+	float3 s, c;
+	sincos(input.Rot.xyz, s, c);
+	float sp = s.x, cp = c.x;
+	float sy = s.y, cy = c.y;
+	float sr = s.z, cr = c.z;
+	float4x4 world = float4x4(
+		float4(cr * cy + sr * sp * sy, sr * cp, sr * sp * cy - cr * sy, 0) * input.Scale.x,
+		float4(cr * sp * sy - sr * cy, cr * cp, sr * sy + cr * sp * cy, 0) * input.Scale.y,
+		float4(cp * sy,                -sp,     cp * cy,                0) * input.Scale.z,
+		float4(input.IPos, 1));
+
+	GS_INPUT output = (GS_INPUT)0;
+	output.Pos = input.Pos;
+	output.Tex = input.Tex;
+	output.Col = input.Col;
+	output.M   = mul(world, ViewProj);
+	return output;
+}
+
+//----------------------------------------------------------------------------------
+// Vertex Shader [polyline] : already in ndc
+//----------------------------------------------------------------------------------
+PS_LINE_INPUT vs_line( VS_LINE_INPUT input )
+{
+	PS_LINE_INPUT output = (PS_LINE_INPUT)0;
+	output.Pos  = float4(input.Pos, 1);
+	output.Edge = float4(input.Edge, input.Width);
+	output.Col  = input.Col;
+	return output;
+}
+
+//----------------------------------------------------------------------------------
+// Vertex Shader [stream] : x from the strip position, the IA offset does the ring
+//----------------------------------------------------------------------------------
+PS_STREAM_INPUT vs_stream( VS_STREAM_INPUT input )
+{
+	float  t   = input.vid * StreamRange.x;
+	float  y   = (input.Value - StreamRange.y) * StreamRange.z;
+	float3 pos = StreamOrg.xyz + StreamU.xyz * t + StreamV.xyz * y;
+
+	PS_STREAM_INPUT output = (PS_STREAM_INPUT)0;
+	output.Pos = mul(float4(pos, 1), ViewProj);
+	output.Col = StreamCol;
+	return output;
+}
+
 //----------------------------------------------------------------------------------
 // Geometry Shader 
 //----------------------------------------------------------------------------------
@@ -98,3 +203,25 @@ float4 ps_main( PS_INPUT input) : SV_Target
 	//return gants * float4( pow((input.Depth.xyz).xyz, 64.0), 1.0);// * input.Col;
 }
 
+//----------------------------------------------------------------------------------
+// Pixel Shader [polyline] : coverage from the distance to the stroke outline
+//   Edge.x : across, Edge.yz : beyond start / end, Edge.w : half width (< 0 round)
+//----------------------------------------------------------------------------------
+float4 ps_line( PS_LINE_INPUT input) : SV_Target
+{
+	float across = abs(input.Edge.x);
+	float beyond = max(input.Edge.y, input.Edge.z);
+	float hw     = abs(input.Edge.w);
+	float d      = input.Edge.w < 0 ? length(float2(across, max(beyond, 0))) : max(across, beyond);
+	float cover  = saturate(hw + 0.5 - d);
+	if(cover <= 0) discard;
+	return float4(input.Col.rgb, input.Col.a * cover);
+}
+
+//----------------------------------------------------------------------------------
+// Pixel Shader [stream]
+//----------------------------------------------------------------------------------
+float4 ps_stream( PS_STREAM_INPUT input) : SV_Target
+{
+	return input.Col;
+}
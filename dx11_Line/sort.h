@@ -0,0 +1,263 @@
+//------------------------------------------------------------------------------
+//
+// SORT.H
+//   Back to front order for RectSoA. Keys are the clip w of each instance
+//   (view depth for a perspective VP) as order preserving uint32, sorted
+//   far first by an LSD radix sort (3 passes of 11/11/10 bits) over jobs.
+//   Last frame's order is tried first : when the same instances come back
+//   and barely moved (paused or creeping camera), an insertion sort on that
+//   order is cheaper than any radix pass. The share of descents a camera
+//   step leaves grows with n (denser field, same motion), while a shuffled
+//   order stays near 1/2, so the limit sits at 1/3, about where the moves
+//   reach n. A dense field under an orbiting camera fails a sampled
+//   descent check at once and goes to radix, and the full attempt stops as
+//   soon as it passes its descent or move limit.
+//   All buffers are kept across frames.
+//
+//------------------------------------------------------------------------------
+#ifndef _SORT_H_
+#define _SORT_H_
+
+#include <string.h>
+#include <vector>
+
+#include "../common/simd.h"
+#include "../common/jobs.h"
+#include "instance.h"
+
+//------------------------------------------------------------------------------
+// DepthKey : ascending key = descending depth
+//------------------------------------------------------------------------------
+inline unsigned DepthKey(float w)
+{
+	unsigned u;
+	memcpy(&u, &w, 4);
+	u ^= (u >> 31) ? 0xFFFFFFFFu : 0x80000000u;
+	return ~u;
+}
+
+inline void DepthKeyScalar(const RectSoA &soa, int begin, int end, const float *vp, unsigned *key)
+{
+	const float *px = &soa.Field[RectSoA::PX][0], *py = &soa.Field[RectSoA::PY][0], *pz = &soa.Field[RectSoA::PZ][0];
+	for(int i = begin; i < end; i++) key[i] = DepthKey(px[i] * vp[3] + py[i] * vp[7] + pz[i] * vp[11] + vp[15]);
+}
+
+TARGET_AVX2 inline void DepthKeyAVX2(const RectSoA &soa, int begin, int end, const float *vp, unsigned *key)
+{
+	const float *px = &soa.Field[RectSoA::PX][0], *py = &soa.Field[RectSoA::PY][0], *pz = &soa.Field[RectSoA::PZ][0];
+	__m256 m0 = _mm256_set1_ps(vp[3]), m1 = _mm256_set1_ps(vp[7]), m2 = _mm256_set1_ps(vp[11]), m3 = _mm256_set1_ps(vp[15]);
+	__m256i sign = _mm256_set1_epi32(int(0x80000000u));
+	int i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		__m256 w = _mm256_fmadd_ps(_mm256_loadu_ps(px + i), m0, _mm256_fmadd_ps(_mm256_loadu_ps(py + i), m1, _mm256_fmadd_ps(_mm256_loadu_ps(pz + i), m2, m3)));
+		__m256i u = _mm256_castps_si256(w);
+		//negative : flip all, positive : flip sign, then invert for far first
+		__m256i flip = _mm256_or_si256(_mm256_srai_epi32(u, 31), sign);
+		_mm256_storeu_si256((__m256i *)(key + i), _mm256_andnot_si256(_mm256_xor_si256(u, flip), _mm256_set1_epi32(-1)));
+	}
+	DepthKeyScalar(soa, i, end, vp, key);
+}
+
+//------------------------------------------------------------------------------
+//
+// DepthSort
+//
+//------------------------------------------------------------------------------
+struct DepthSort
+{
+	enum
+	{
+		Pass        = 3,
+		Digit       = 2048,
+		KeyChunk    = 16384,
+		BlockMin    = 65536,     //keys per radix block, below that fewer blocks
+		MoveBudget  = 1,         //insertion sort gives up after n * MoveBudget moves
+		DescentMax  = 3,         //or while gathering, past n / DescentMax descents
+		DescentStep = 16,        //descents are first estimated on every DescentStep-th pair
+	};
+
+	std::vector<unsigned>  Key;         //key of source index
+	std::vector<unsigned>  Order;       //sorted position -> source index, kept for the next frame
+	std::vector<unsigned>  SortKey[2];
+	std::vector<unsigned>  SortIndex[2];
+	std::vector<unsigned>  Hist;        //[block][Digit]
+	int                    Count;
+	bool                   Radix;       //last Run : true radix, false coherent insertion
+	long long              Moves;
+
+	DepthSort() : Count(0), Radix(false), Moves(0) {}
+
+	static int Shift(int pass)
+	{
+		return pass * 11;
+	}
+
+	//------------------------------------------------------------------------------
+	// Run : Order = soa sorted far to near. jobs may be null.
+	//------------------------------------------------------------------------------
+	void Run(JobSystem *jobs, int isa, const RectSoA &soa, const float *vp)
+	{
+		int n = soa.Size();
+		Key.resize(n);
+		if(n > 0)
+		{
+			void (*kernel)(const RectSoA &, int, int, const float *, unsigned *) = isa == IsaAVX2 ? DepthKeyAVX2 : DepthKeyScalar;
+			if(jobs) jobs->ParallelFor(n, KeyChunk, [&](int b, int e, int) { kernel(soa, b, e, vp, &Key[0]); });
+			else     kernel(soa, 0, n, vp, &Key[0]);
+		}
+
+		bool coherent = n == Count && n > 0 && Insertion(n);
+		Count = n;
+		Radix = !coherent;
+		if(coherent) return;
+		Order.resize(n);
+		for(int i = 0; i < n; i++) Order[i] = unsigned(i);
+		if(n > 1) RadixSort(jobs, n);
+	}
+
+	//------------------------------------------------------------------------------
+	// Insertion : last frame's order, false when it is too far from sorted
+	//------------------------------------------------------------------------------
+	bool Insertion(int n)
+	{
+		std::vector<unsigned> &k = SortKey[0];
+		k.resize(n);
+		int descent = 0, limit = n / DescentMax;
+		Moves = 0;
+		for(int i = DescentStep; i < n; i += DescentStep) descent += Key[Order[i - 1]] > Key[Order[i]];
+		if(descent > limit / DescentStep) return false;
+		descent = 0;
+		for(int i = 0; i < n; i++)
+		{
+			k[i] = Key[Order[i]];
+			descent += i && k[i - 1] > k[i];
+			if(descent > limit) return false;
+		}
+		long long budget = (long long)n * MoveBudget;
+		for(int i = 1; i < n; i++)
+		{
+			unsigned key = k[i], index = Order[i];
+			int j = i;
+			while(j > 0 && k[j - 1] > key)
+			{
+				k[j]     = k[j - 1];
+				Order[j] = Order[j - 1];
+				j--;
+			}
+			k[j]     = key;
+			Order[j] = index;
+			Moves   += i - j;
+			if(Moves > budget) return false;
+		}
+		return true;
+	}
+
+	//------------------------------------------------------------------------------
+	// RadixSort : stable LSD, blocks histogram and scatter their own range
+	//------------------------------------------------------------------------------
+	void RadixSort(JobSystem *jobs, int n)
+	{
+		int threads = jobs ? jobs->Threads() : 1;
+		int blocks  = (n + BlockMin - 1) / BlockMin;
+		blocks = blocks < threads ? blocks : threads;
+		int size = (n + blocks - 1) / blocks;
+		Hist.resize((size_t)blocks * Digit);
+		for(int b = 0; b < 2; b++)
+		{
+			SortKey[b].resize(n);
+			SortIndex[b].resize(n);
+		}
+		memcpy(&SortKey[0][0], &Key[0], sizeof(unsigned) * n);
+		for(int i = 0; i < n; i++) SortIndex[0][i] = unsigned(i);
+
+		int src = 0;
+		for(int pass = 0; pass < Pass; pass++)
+		{
+			int shift = Shift(pass);
+			const unsigned *sk = &SortKey[src][0];
+			const unsigned *si = &SortIndex[src][0];
+			unsigned *dk = &SortKey[src ^ 1][0];
+			unsigned *di = &SortIndex[src ^ 1][0];
+
+			auto histogram = [&](int b0, int b1, int)
+			{
+				for(int b = b0; b < b1; b++)
+				{
+					unsigned *h = &Hist[(size_t)b * Digit];
+					memset(h, 0, sizeof(unsigned) * Digit);
+					int end = (b + 1) * size < n ? (b + 1) * size : n;
+					for(int i = b * size; i < end; i++) h[(sk[i] >> shift) & (Digit - 1)]++;
+				}
+			};
+			if(jobs && blocks > 1) jobs->ParallelFor(blocks, 1, histogram);
+			else                   histogram(0, blocks, 0);
+
+			//every key in one digit : nothing moves
+			bool skip = false;
+			for(int d = 0; d < Digit && !skip; d++)
+			{
+				unsigned total = 0;
+				for(int b = 0; b < blocks; b++) total += Hist[(size_t)b * Digit + d];
+				if(total == unsigned(n)) skip = true;
+				else if(total) break;
+			}
+			if(skip) continue;
+
+			//exclusive scan in (digit, block) order keeps it stable
+			unsigned sum = 0;
+			for(int d = 0; d < Digit; d++)
+			{
+				for(int b = 0; b < blocks; b++)
+				{
+					unsigned &h = Hist[(size_t)b * Digit + d];
+					unsigned  c = h;
+					h    = sum;
+					sum += c;
+				}
+			}
+
+			auto scatter = [&](int b0, int b1, int)
+			{
+				for(int b = b0; b < b1; b++)
+				{
+					unsigned *h = &Hist[(size_t)b * Digit];
+					int end = (b + 1) * size < n ? (b + 1) * size : n;
+					for(int i = b * size; i < end; i++)
+					{
+						unsigned o = h[(sk[i] >> shift) & (Digit - 1)]++;
+						dk[o] = sk[i];
+						di[o] = si[i];
+					}
+				}
+			};
+			if(jobs && blocks > 1) jobs->ParallelFor(blocks, 1, scatter);
+			else                   scatter(0, blocks, 0);
+			src ^= 1;
+		}
+		memcpy(&Order[0], &SortIndex[src][0], sizeof(unsigned) * n);
+	}
+
+	//------------------------------------------------------------------------------
+	// Gather : dst[i] = src[Order[i]]
+	//------------------------------------------------------------------------------
+	void Gather(JobSystem *jobs, const RectSoA &src, RectSoA &dst) const
+	{
+		int n = (int)Order.size();
+		dst.Resize(n);
+		if(n <= 0) return;
+		auto func = [&](int b, int e, int)
+		{
+			for(int f = 0; f < RectSoA::FieldMax; f++)
+			{
+				const float *s = &src.Field[f][0];
+				float       *d = &dst.Field[f][0];
+				for(int i = b; i < e; i++) d[i] = s[Order[i]];
+			}
+		};
+		if(jobs) jobs->ParallelFor(n, KeyChunk, func);
+		else     func(0, n, 0);
+	}
+};
+
+#endif //_SORT_H_
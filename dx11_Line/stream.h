@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+//
+// STREAM.H
+//   Live samples : lock-free ingest from any thread, and the slot bookkeeping
+//   for a GPU ring that only ever receives the new samples.
+//
+//------------------------------------------------------------------------------
+#ifndef _STREAM_H_
+#define _STREAM_H_
+
+#include <atomic>
+#include <memory>
+
+//------------------------------------------------------------------------------
+//
+// SampleQueue
+//   Bounded multi producer / single consumer queue. Every cell carries a
+//   sequence number : == position when free for that lap, == position + 1
+//   once written. A batch is reserved with one CAS on Tail, the consumer
+//   releases in order so the last cell being free means all of them are.
+//
+//------------------------------------------------------------------------------
+struct SampleQueue
+{
+	struct Cell
+	{
+		std::atomic<unsigned> Seq;
+		float                 Value;
+	};
+
+	std::unique_ptr<Cell[]>          Buf;
+	unsigned                         Mask;
+	alignas(64) std::atomic<unsigned> Tail;
+	alignas(64) unsigned              Head;
+	std::atomic<unsigned>             Dropped;
+
+	SampleQueue() : Mask(0), Tail(0), Head(0), Dropped(0) {}
+
+	//capacity : power of two, not thread safe
+	void Init(int capacity)
+	{
+		Buf.reset(new Cell[capacity]);
+		Mask = unsigned(capacity - 1);
+		for(int i = 0; i < capacity; i++) Buf[i].Seq.store(unsigned(i), std::memory_order_relaxed);
+		Tail.store(0);
+		Head = 0;
+		Dropped.store(0);
+	}
+
+	int Capacity() const
+	{
+		return int(Mask + 1);
+	}
+
+	//[consumer thread] samples reserved and not popped yet, some may still be being written
+	int Pending() const
+	{
+		return int(Tail.load(std::memory_order_relaxed) - Head);
+	}
+
+	//------------------------------------------------------------------------------
+	// Push [any thread] : all of v or nothing, false (and counted) when full
+	//------------------------------------------------------------------------------
+	bool Push(const float *v, int count)
+	{
+		if(count <= 0) return true;
+		if(!Buf || count > Capacity())
+		{
+			Dropped.fetch_add(unsigned(count), std::memory_order_relaxed);
+			return false;
+		}
+		unsigned pos = Tail.load(std::memory_order_relaxed);
+		for(;;)
+		{
+			unsigned last = pos + unsigned(count - 1);
+			int      dif  = int(Buf[last & Mask].Seq.load(std::memory_order_acquire) - last);
+			if(dif == 0)
+			{
+				if(Tail.compare_exchange_weak(pos, pos + unsigned(count), std::memory_order_relaxed)) break;
+			}
+			else if(dif < 0)
+			{
+				Dropped.fetch_add(unsigned(count), std::memory_order_relaxed);
+				return false;
+			}
+			else
+			{
+				pos = Tail.load(std::memory_order_relaxed);
+			}
+		}
+		for(int i = 0; i < count; i++)
+		{
+			Cell &c = Buf[(pos + unsigned(i)) & Mask];
+			c.Value = v[i];
+			c.Seq.store(pos + unsigned(i) + 1, std::memory_order_release);
+		}
+		return true;
+	}
+
+	bool Push(float v)
+	{
+		return Push(&v, 1);
+	}
+
+	//------------------------------------------------------------------------------
+	// Pop [consumer thread only] : up to count published samples, in order
+	//------------------------------------------------------------------------------
+	int Pop(float *out, int count)
+	{
+		int n = 0;
+		for(; n < count; n++)
+		{
+			Cell &c = Buf[Head & Mask];
+			if(c.Seq.load(std::memory_order_acquire) != Head + 1) break;
+			out[n] = c.Value;
+			c.Seq.store(Head + Mask + 1, std::memory_order_release);
+			Head++;
+		}
+		return n;
+	}
+};
+
+//------------------------------------------------------------------------------
+//
+// StreamRing
+//   Slots of a vertex buffer twice Capacity long. Sample t goes to slot
+//   t % Capacity and to its mirror Capacity above, so the newest Window
+//   samples are always one contiguous run starting at First() and the
+//   draw just offsets the vertex buffer binding.
+//   Every write is NO_OVERWRITE : Capacity = Window + Slack, and at most
+//   Budget() samples are written a frame, so a slot is only reused after it
+//   left the window of the last StreamLatency frames. That only holds if the
+//   device never queues more : the owner sets the DXGI maximum frame latency
+//   to StreamLatency.
+//
+//------------------------------------------------------------------------------
+enum
+{
+	StreamLatency = 3,     //frames the GPU may still be reading
+};
+
+struct StreamRing
+{
+	struct Run
+	{
+		int slot;            //first slot, also written at slot + Capacity
+		int src;             //first sample of the batch
+		int count;
+	};
+
+	int       Capacity;
+	int       Window;
+	long long Total;
+	bool      Fresh;         //first Map must be a DISCARD
+
+	StreamRing() : Capacity(0), Window(0), Total(0), Fresh(true) {}
+
+	void Init(int window, int slack)
+	{
+		Capacity = window + slack;
+		Window   = window;
+		Total    = 0;
+		Fresh    = true;
+	}
+
+	int Budget() const
+	{
+		return (Capacity - Window) / (StreamLatency + 1);
+	}
+
+	int Drawn() const
+	{
+		return Total < Window ? int(Total) : Window;
+	}
+
+	int First() const
+	{
+		return int((Total - Drawn()) % Capacity);
+	}
+
+	//------------------------------------------------------------------------------
+	// Plan : slots for the next count (<= Budget) samples, at most 2 runs
+	//------------------------------------------------------------------------------
+	int Plan(int count, Run run[2]) const
+	{
+		int slot = int(Total % Capacity);
+		int n    = 0;
+		for(int src = 0; src < count;)
+		{
+			int space = Capacity - slot;
+			int num   = count - src < space ? count - src : space;
+			run[n].slot  = slot;
+			run[n].src   = src;
+			run[n].count = num;
+			n++;
+			src  += num;
+			slot  = 0;
+		}
+		return n;
+	}
+
+	void Commit(int count)
+	{
+		Total += count;
+		Fresh  = false;
+	}
+};
+
+#endif //_STREAM_H_
@@ -0,0 +1,199 @@
+//------------------------------------------------------------------------------
+//
+// TRANSFORM.H
+//   RectSoA -> InstanceData kernels. Same math as TransformInstance, built
+//   as TRS x VP directly with vectorized sin/cos and streamed to the
+//   (write combined) mapped instance buffer.
+//
+//------------------------------------------------------------------------------
+#ifndef _TRANSFORM_H_
+#define _TRANSFORM_H_
+
+#include "instance.h"
+#include "../common/simd.h"
+#include "../common/jobs.h"
+
+//------------------------------------------------------------------------------
+// TransformScalar
+//------------------------------------------------------------------------------
+inline void TransformScalar(const RectSoA &soa, int begin, int end, const float *vp, InstanceData *out)
+{
+	for(int i = begin; i < end; i++)
+	{
+		TransformInstance(soa.Get(i), vp, &out[i - begin]);
+	}
+}
+
+//------------------------------------------------------------------------------
+// TransformSSE : 4 instances per step
+//------------------------------------------------------------------------------
+inline void TransformSSE(const RectSoA &soa, int begin, int end, const float *vp, InstanceData *out)
+{
+	const float *f[RectSoA::FieldMax];
+	for(int k = 0; k < RectSoA::FieldMax; k++) f[k] = soa.Field[k].data();
+
+	int i = begin;
+	for(; i + 4 <= end; i += 4)
+	{
+		__m128 sp, cp, sy, cy, sr, cr;
+		SinCos4(_mm_loadu_ps(f[RectSoA::RX] + i), &sp, &cp);
+		SinCos4(_mm_loadu_ps(f[RectSoA::RY] + i), &sy, &cy);
+		SinCos4(_mm_loadu_ps(f[RectSoA::RZ] + i), &sr, &cr);
+		__m128 sx = _mm_loadu_ps(f[RectSoA::SX] + i);
+		__m128 sc = _mm_loadu_ps(f[RectSoA::SY] + i);
+		__m128 sz = _mm_loadu_ps(f[RectSoA::SZ] + i);
+
+		//world rows (scaled rotation) + translation
+		__m128 w[4][3];
+		__m128 srsp = _mm_mul_ps(sr, sp);
+		__m128 crsp = _mm_mul_ps(cr, sp);
+		w[0][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cr, cy), _mm_mul_ps(srsp, sy)), sx);
+		w[0][1] = _mm_mul_ps(_mm_mul_ps(sr, cp), sx);
+		w[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(srsp, cy), _mm_mul_ps(cr, sy)), sx);
+		w[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(crsp, sy), _mm_mul_ps(sr, cy)), sc);
+		w[1][1] = _mm_mul_ps(_mm_mul_ps(cr, cp), sc);
+		w[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sr, sy), _mm_mul_ps(crsp, cy)), sc);
+		w[2][0] = _mm_mul_ps(_mm_mul_ps(cp, sy), sz);
+		w[2][1] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sp), sz);
+		w[2][2] = _mm_mul_ps(_mm_mul_ps(cp, cy), sz);
+		w[3][0] = _mm_loadu_ps(f[RectSoA::PX] + i);
+		w[3][1] = _mm_loadu_ps(f[RectSoA::PY] + i);
+		w[3][2] = _mm_loadu_ps(f[RectSoA::PZ] + i);
+
+		//group 0 : Col, group 1 + c : column c of W * VP (= row c of M)
+		__m128 t[4][5];
+		for(int g = 0; g < 5; g++)
+		{
+			__m128 a[4];
+			if(g == 0)
+			{
+				for(int r = 0; r < 4; r++) a[r] = _mm_loadu_ps(f[RectSoA::R + r] + i);
+			}
+			else
+			{
+				int c = g - 1;
+				__m128 m0 = _mm_set1_ps(vp[0 * 4 + c]), m1 = _mm_set1_ps(vp[1 * 4 + c]);
+				__m128 m2 = _mm_set1_ps(vp[2 * 4 + c]), m3 = _mm_set1_ps(vp[3 * 4 + c]);
+				for(int r = 0; r < 4; r++)
+				{
+					a[r] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w[r][0], m0), _mm_mul_ps(w[r][1], m1)), _mm_mul_ps(w[r][2], m2));
+				}
+				a[3] = _mm_add_ps(a[3], m3);
+			}
+			_MM_TRANSPOSE4_PS(a[0], a[1], a[2], a[3]);
+			for(int l = 0; l < 4; l++) t[l][g] = a[l];
+		}
+
+		//stream whole instances in address order to keep write combining happy
+		float *dst = (float *)&out[i - begin];
+		for(int l = 0; l < 4; l++)
+		{
+			for(int g = 0; g < 5; g++) _mm_stream_ps(dst + l * 20 + g * 4, t[l][g]);
+		}
+	}
+	TransformScalar(soa, i, end, vp, out + (i - begin));
+	_mm_sfence();
+}
+
+//------------------------------------------------------------------------------
+// TransformAVX2 : 8 instances per step
+//------------------------------------------------------------------------------
+TARGET_AVX2 inline void TransformAVX2(const RectSoA &soa, int begin, int end, const float *vp, InstanceData *out)
+{
+	const float *f[RectSoA::FieldMax];
+	for(int k = 0; k < RectSoA::FieldMax; k++) f[k] = soa.Field[k].data();
+
+	int i = begin;
+	for(; i + 8 <= end; i += 8)
+	{
+		__m256 sp, cp, sy, cy, sr, cr;
+		SinCos8(_mm256_loadu_ps(f[RectSoA::RX] + i), &sp, &cp);
+		SinCos8(_mm256_loadu_ps(f[RectSoA::RY] + i), &sy, &cy);
+		SinCos8(_mm256_loadu_ps(f[RectSoA::RZ] + i), &sr, &cr);
+		__m256 sx = _mm256_loadu_ps(f[RectSoA::SX] + i);
+		__m256 sc = _mm256_loadu_ps(f[RectSoA::SY] + i);
+		__m256 sz = _mm256_loadu_ps(f[RectSoA::SZ] + i);
+
+		__m256 w[4][3];
+		__m256 srsp = _mm256_mul_ps(sr, sp);
+		__m256 crsp = _mm256_mul_ps(cr, sp);
+		w[0][0] = _mm256_mul_ps(_mm256_fmadd_ps(cr, cy, _mm256_mul_ps(srsp, sy)), sx);
+		w[0][1] = _mm256_mul_ps(_mm256_mul_ps(sr, cp), sx);
+		w[0][2] = _mm256_mul_ps(_mm256_fmsub_ps(srsp, cy, _mm256_mul_ps(cr, sy)), sx);
+		w[1][0] = _mm256_mul_ps(_mm256_fmsub_ps(crsp, sy, _mm256_mul_ps(sr, cy)), sc);
+		w[1][1] = _mm256_mul_ps(_mm256_mul_ps(cr, cp), sc);
+		w[1][2] = _mm256_mul_ps(_mm256_fmadd_ps(sr, sy, _mm256_mul_ps(crsp, cy)), sc);
+		w[2][0] = _mm256_mul_ps(_mm256_mul_ps(cp, sy), sz);
+		w[2][1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(), sp), sz);
+		w[2][2] = _mm256_mul_ps(_mm256_mul_ps(cp, cy), sz);
+		w[3][0] = _mm256_loadu_ps(f[RectSoA::PX] + i);
+		w[3][1] = _mm256_loadu_ps(f[RectSoA::PY] + i);
+		w[3][2] = _mm256_loadu_ps(f[RectSoA::PZ] + i);
+
+		//low lanes -> instance 0..3, high lanes -> 4..7
+		__m128 t[8][5];
+		for(int g = 0; g < 5; g++)
+		{
+			__m256 a[4];
+			if(g == 0)
+			{
+				for(int r = 0; r < 4; r++) a[r] = _mm256_loadu_ps(f[RectSoA::R + r] + i);
+			}
+			else
+			{
+				int c = g - 1;
+				__m256 m0 = _mm256_broadcast_ss(vp + 0 * 4 + c), m1 = _mm256_broadcast_ss(vp + 1 * 4 + c);
+				__m256 m2 = _mm256_broadcast_ss(vp + 2 * 4 + c), m3 = _mm256_broadcast_ss(vp + 3 * 4 + c);
+				for(int r = 0; r < 4; r++)
+				{
+					a[r] = _mm256_fmadd_ps(w[r][2], m2, _mm256_fmadd_ps(w[r][1], m1, _mm256_mul_ps(w[r][0], m0)));
+				}
+				a[3] = _mm256_add_ps(a[3], m3);
+			}
+			for(int h = 0; h < 2; h++)
+			{
+				__m128 a0 = h ? _mm256_extractf128_ps(a[0], 1) : _mm256_castps256_ps128(a[0]);
+				__m128 a1 = h ? _mm256_extractf128_ps(a[1], 1) : _mm256_castps256_ps128(a[1]);
+				__m128 a2 = h ? _mm256_extractf128_ps(a[2], 1) : _mm256_castps256_ps128(a[2]);
+				__m128 a3 = h ? _mm256_extractf128_ps(a[3], 1) : _mm256_castps256_ps128(a[3]);
+				_MM_TRANSPOSE4_PS(a0, a1, a2, a3);
+				t[h * 4 + 0][g] = a0;
+				t[h * 4 + 1][g] = a1;
+				t[h * 4 + 2][g] = a2;
+				t[h * 4 + 3][g] = a3;
+			}
+		}
+
+		float *dst = (float *)&out[i - begin];
+		for(int l = 0; l < 8; l++)
+		{
+			for(int g = 0; g < 5; g++) _mm_stream_ps(dst + l * 20 + g * 4, t[l][g]);
+		}
+	}
+	TransformScalar(soa, i, end, vp, out + (i - begin));
+	_mm_sfence();
+}
+
+//------------------------------------------------------------------------------
+// TransformBatch
+//   soa[begin, begin + count) -> out[0, count), chunked over jobs (may be null).
+//   out must be 16 byte aligned (mapped D3D11 buffers are).
+//------------------------------------------------------------------------------
+inline void TransformBatch(JobSystem *jobs, int isa, const RectSoA &soa, int begin, int count, const float *vp, InstanceData *out)
+{
+	enum { Chunk = 2048 };
+	void (*kernel)(const RectSoA &, int, int, const float *, InstanceData *) =
+		isa == IsaAVX2 ? TransformAVX2 : isa == IsaSSE ? TransformSSE : TransformScalar;
+
+	if(!jobs)
+	{
+		kernel(soa, begin, begin + count, vp, out);
+		return;
+	}
+	jobs->ParallelFor(count, Chunk, [&](int b, int e, int)
+	{
+		kernel(soa, begin + b, begin + e, vp, out + b);
+	});
+}
+
+#endif //_TRANSFORM_H_
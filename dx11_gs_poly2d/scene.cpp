@@ -7,6 +7,7 @@
 //  include
 //------------------------------------------------------------------------------
 #include "common.h"
+#include "../common/rng.h"
 
 ID3D11VertexShader    *vshader   = NULL;
 ID3D11GeometryShader  *gshader   = NULL;
@@ -20,19 +21,9 @@ char *fxfilename = "main.fx";
 XMFLOAT4  constant[SHADER_Cx_MAX];
 
 //------------------------------------------------------------------------------
-// random
+// random [Philox, common/rng.h]
 //------------------------------------------------------------------------------
-int _rand() {
-  static int a = 1;
-  static int b = 234567;
-  static int c = 890123;
-  a += b; b += c; c += a;
-  return (a >> 16);
-}
-
-float frand() {
-  return (float)(_rand()) / 32767.0f;
-}
+#define OBJ_RAND_NUM  8
 
 
 //------------------------------------------------------------------------------
@@ -45,11 +36,14 @@ struct Obj {
 };
 Obj obj[OBJ_MAX];
 void obj_init() {
+  static float r[OBJ_MAX * OBJ_RAND_NUM];
+  RandomFloat(NULL, DetectIsa(), 1, 0, 0, OBJ_MAX * OBJ_RAND_NUM, r, -1, 1);
   for(int i = 0 ; i < OBJ_MAX; i++) {
     Obj *w = &(obj[i]);
-    w->pos  = XMFLOAT2(frand(), frand());
-    w->dir  = XMFLOAT2(frand() * 0.005, frand() * 0.005);
-    w->data = XMFLOAT4(abs(frand()), abs(frand()), abs(frand()), abs(frand()));
+    const float *f = &r[i * OBJ_RAND_NUM];
+    w->pos  = XMFLOAT2(f[0], f[1]);
+    w->dir  = XMFLOAT2(f[2] * 0.005, f[3] * 0.005);
+    w->data = XMFLOAT4(abs(f[4]), abs(f[5]), abs(f[6]), abs(f[7]));
   }
 }
 
@@ -580,9 +580,10 @@ void PresentGraphics(
 		
 		//CMD_DRAW_INDEX
 		if(type == CMD_DRAW_INDEX) {
+			auto start = c.draw_index.start;
 			auto count = c.draw_index.count;
 			//ctx->DrawIndexed(count, 0, 0);
-			ctx->DrawInstanced(count, 1, 0, 0);
+			ctx->DrawInstanced(count, 1, start, 0);
 /*
 void DrawInstanced(
 UINT VertexCountPerInstance,
@@ -1027,12 +1028,25 @@ struct Image {
 };
 
 
+struct SubMesh {
+	int material;
+	int first_index;
+	int index_count;
+};
+
 struct GeometryData {
 	std::map<std::string, std::vector<vertex_format>> mvtx;
 	std::map<std::string, std::vector<uint32_t>> mib;
+	std::map<std::string, std::vector<SubMesh>> msubmesh;
 	std::map<std::string, std::string> mmaterial;
 };
 
+std::string
+SubMeshName(const std::string & name, const SubMesh & sub)
+{
+	return name + "_" + std::to_string(sub.material);
+}
+
 
 
 void
@@ -1052,6 +1066,7 @@ LoadFbxFromFile(std::string name,
 		//}eȀǂݍł܂
 		auto materialCount = fbxScene->GetMaterialCount();
 		std::vector<std::string> vmatname;
+		std::map<std::string, std::string> mtexname;
 		for (int i = 0; i < materialCount; ++i)
 		{
 			auto fbxMaterial = fbxScene->GetMaterial(i);
@@ -1090,6 +1105,7 @@ LoadFbxFromFile(std::string name,
 						{
 							printf("texName=%s\n", texName.c_str());
 							vmatname.push_back(texName);
+							mtexname[fbxMaterial->GetName()] = texName;
 						}
 						/*
 						else if (src == "Maya|NormalTexture")
@@ -1160,32 +1176,35 @@ LoadFbxFromFile(std::string name,
 			}
 
 			//}eA\
-			struct matinfo {
-				int offset;
-				int count;
-			};
-			std::map<int, matinfo> mmatinfo;
+			auto polygon_count = mesh->GetPolygonCount();
+			std::vector<int> vpolymat(polygon_count, 0);
+			std::map<int, SubMesh> msub;
 			{
-				auto lMaterialIndice = &mesh->GetElementMaterial()->GetIndexArray();
-				auto lMaterialMappingMode = mesh->GetElementMaterial()->GetMappingMode();
-				if (lMaterialIndice && lMaterialMappingMode == FbxGeometryElement::eByPolygon)
+				auto matelem = mesh->GetElementMaterial();
+				auto mapping = matelem ? matelem->GetMappingMode() : FbxGeometryElement::eNone;
+				if (mapping == FbxGeometryElement::eByPolygon)
 				{
 					printf("MAT : FbxGeometryElement::eByPolygon\n");
-					auto polygon_count = mesh->GetPolygonCount();
+					auto & indices = matelem->GetIndexArray();
 					for ( int poly_index = 0; poly_index < polygon_count; poly_index++) {
-						auto lMaterialIndex = lMaterialIndice->GetAt(polygon_count);
-						mmatinfo[lMaterialIndex].count++;
+						vpolymat[poly_index] = indices.GetAt(poly_index);
 					}
+				} else if (mapping == FbxGeometryElement::eAllSame) {
+					printf("MAT : FbxGeometryElement::eAllSame\n");
+					std::fill(vpolymat.begin(), vpolymat.end(), matelem->GetIndexArray().GetAt(0));
 				} else {
 					printf("MAT : FbxGeometryElement::OTHER\n");
 				}
-				auto matcount = mmatinfo.size();
+				for (auto mat : vpolymat) {
+					msub[mat].material = mat;
+					msub[mat].index_count += 3;
+				}
 				int off = 0;
-				for(int i = 0 ; i < matcount; i++) {
-					mmatinfo[i].offset = off;
-					off += mmatinfo[i].count * 3;
+				for (auto & m : msub) {
+					m.second.first_index = off;
+					off += m.second.index_count;
 				}
-				printf("mmatinfo.size() = %d\n", mmatinfo.size());
+				printf("msub.size() = %zu\n", msub.size());
 			}
 
 			auto idxbuf = mesh->GetPolygonVertices();
@@ -1262,18 +1281,47 @@ LoadFbxFromFile(std::string name,
 				vvtx.push_back(vfmt);
 			}
 
-			geo.mvtx[name] = vvtx;
-			geo.mib[name] = vib;
-		}
-		
-
-		for(auto & m : geo.mvtx) {
-			auto & name = m.first;
-			if(vmatname.empty()) {
-				geo.mmaterial[name] = "DEFAULT_NORMAL.tga";
+			//sort triangles by material index into contiguous submesh ranges
+			if (vvtx.size() == size_t(polygon_count) * 3) {
+				std::vector<vertex_format> vsorted(vvtx.size());
+				std::vector<uint32_t> vibsorted(vib.size());
+				std::map<int, int> mcursor;
+				for (auto & m : msub)
+					mcursor[m.first] = m.second.first_index;
+				for (int poly_index = 0; poly_index < polygon_count; poly_index++) {
+					auto & dst = mcursor[vpolymat[poly_index]];
+					for (int k = 0; k < 3; k++) {
+						vsorted[dst + k] = vvtx[poly_index * 3 + k];
+						vibsorted[dst + k] = vib[poly_index * 3 + k];
+					}
+					dst += 3;
+				}
+				vvtx.swap(vsorted);
+				vib.swap(vibsorted);
 			} else {
-				geo.mmaterial[name] = vmatname[0];
+				printf("MAT : not triangulated, single submesh\n");
+				msub.clear();
+				msub[0] = {0, 0, int(vib.size())};
+			}
+
+			auto node = mesh->GetNode();
+			auto & vsub = geo.msubmesh[name];
+			for (auto & m : msub) {
+				auto & sub = m.second;
+				auto material = node->GetMaterial(sub.material);
+				std::string texName = "DEFAULT_NORMAL.tga";
+				if (material && mtexname.count(material->GetName()))
+					texName = mtexname[material->GetName()];
+				else if (!vmatname.empty())
+					texName = vmatname[0];
+				printf("SUBMESH : material=%d first_index=%d index_count=%d tex=%s\n",
+					sub.material, sub.first_index, sub.index_count, texName.c_str());
+				geo.mmaterial[SubMeshName(name, sub)] = texName;
+				vsub.push_back(sub);
 			}
+
+			geo.mvtx[name] = vvtx;
+			geo.mib[name] = vib;
 		}
 	}
 	fbxManager->Destroy();
@@ -1414,15 +1462,17 @@ int main() {
 		for(auto & x : fbxgeo.mvtx) {
 			auto & vb = fbxgeo.mvtx[x.first];
 			auto & ib = fbxgeo.mib[x.first];
-			auto & img = mimage[x.first];
-			SetTexture(vcmd, x.first + "_mat", 0, img.Width, img.Height, img.GetData(),
-				img.Width * img.Height * sizeof(uint32_t), img.Width * sizeof(uint32_t));
-			SetTexture(vcmd, x.first + "_mat", 1, img.Width, img.Height, img.GetData(),
-				img.Width * img.Height * sizeof(uint32_t), img.Width * sizeof(uint32_t));
-			
 			SetVertex(vcmd, x.first + "_vb", vb.data(), vb.size() * sizeof(vertex_format), sizeof(vertex_format));
 			SetIndex(vcmd, x.first + "_ib", ib.data(), ib.size() * sizeof(uint32_t));
-			DrawIndex(vcmd, x.first, 0, ib.size());
+			for(auto & sub : fbxgeo.msubmesh[x.first]) {
+				auto subname = SubMeshName(x.first, sub);
+				auto & img = mimage[subname];
+				SetTexture(vcmd, subname + "_mat", 0, img.Width, img.Height, img.GetData(),
+					img.Width * img.Height * sizeof(uint32_t), img.Width * sizeof(uint32_t));
+				SetTexture(vcmd, subname + "_mat", 1, img.Width, img.Height, img.GetData(),
+					img.Width * img.Height * sizeof(uint32_t), img.Width * sizeof(uint32_t));
+				DrawIndex(vcmd, subname, sub.first_index, sub.index_count);
+			}
 		}
 
 		/*